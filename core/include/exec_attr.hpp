@@ -64,6 +64,10 @@ struct ExecAttr
     bool low_mem_mode;
     bool fc_mt;    // fc should in multi-threaded?
     bool pooling_mt;    // pooling should in multi-threaded?
+    bool blocked_layout;    // may internal tensors be channel blocked?
+    bool tiled_exec;    // run conv chains on large inputs tile by tile?
+    bool parallel_prerun;    // prepare the nodes on the aider threads?
+    bool lazy_prerun;    // prepare the nodes on a thread overlapping the first run?
     void* exec_context;
     void* dev_handle;
     int layout;
@@ -76,6 +80,10 @@ struct ExecAttr
         low_mem_mode = false;
         fc_mt = false;
         pooling_mt = false;
+        blocked_layout = false;
+        tiled_exec = false;
+        parallel_prerun = false;
+        lazy_prerun = false;
         model_format = MODEL_FORMAT_TENGINE;
         exec_context = nullptr;
         dev_handle = nullptr;
@@ -9,10 +9,24 @@ namespace TEngine {
 
 #define ATTR_GRAPH_PERF_STAT "GraphPerfStat"
 
+/* get the perf_counter_info records, instead of the perf_info ones */
+#define GRAPH_PERF_STAT_GET_COUNTER 7
+
 struct GraphPerfMsg
 {
     int action;
-    struct perf_info** buf;
+    void** buf;    // struct perf_info* or struct perf_counter_info*, by action
+    int buf_size;
+    int ret_number;
+};
+
+/* the node latency histograms of a subgraph, for GRAPH_ATTR_LATENCY_STAT */
+#define ATTR_NODE_LATENCY_STAT "NodeLatencyStat"
+
+struct NodeLatencyMsg
+{
+    int action;    // LATENCY_STAT_xxx, to set
+    struct latency_stat* buf;    // to get
     int buf_size;
     int ret_number;
 };
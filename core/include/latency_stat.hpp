@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __LATENCY_STAT_HPP__
+#define __LATENCY_STAT_HPP__
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "tengine_c_api.h"
+
+/*
+ * HDR style latency histogram: below 2^LATENCY_SUB_BUCKET_BITS ns each value
+ * has its bucket, above it each power of 2 is split in LATENCY_SUB_BUCKET_NUM
+ * linear buckets, so a value is kept within 1/16 of it, up to 2^36 ns (68s).
+ *
+ * Record() is a few relaxed loads and stores, no lock and no allocation: it
+ * is meant to stay on in production. One thread records at a time (the one
+ * running the graph or the subgraph), any thread may read; a reader may see
+ * a run in the buckets but not yet in the total, never a torn counter.
+ */
+
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKET_NUM (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_BITS 36
+#define LATENCY_BUCKET_NUM ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKET_NUM)
+
+namespace TEngine {
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram(void)
+    {
+        Reset();
+    }
+
+    static uint64_t Now(void)
+    {
+        struct timespec tm;
+
+        clock_gettime(CLOCK_MONOTONIC, &tm);
+
+        return tm.tv_sec * 1000000000UL + tm.tv_nsec;
+    }
+
+    /* single writer */
+    void Record(uint64_t ns)
+    {
+        std::atomic<uint32_t>* bucket = &bucket_[Index(ns)];
+
+        bucket->store(bucket->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        total_.store(total_.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+
+        if(ns > max_.load(std::memory_order_relaxed))
+            max_.store(ns, std::memory_order_relaxed);
+
+        if(ns < min_.load(std::memory_order_relaxed))
+            min_.store(ns, std::memory_order_relaxed);
+    }
+
+    /* not synchronized with Record(): a run recorded meanwhile may be half cleared */
+    void Reset(void);
+
+    /* count, total, min, max and percentiles, stat->name is left as is */
+    void GetStat(struct latency_stat* stat) const;
+
+    static int Index(uint64_t ns)
+    {
+        if(ns < LATENCY_SUB_BUCKET_NUM)
+            return ns;
+
+        if(ns >= (1UL << LATENCY_MAX_BITS))
+            return LATENCY_BUCKET_NUM - 1;
+
+        int msb = 63 - __builtin_clzll(ns);
+        int shift = msb - LATENCY_SUB_BUCKET_BITS;
+
+        return (shift + 1) * LATENCY_SUB_BUCKET_NUM + ((ns >> shift) & (LATENCY_SUB_BUCKET_NUM - 1));
+    }
+
+    /* the highest value kept in the bucket */
+    static uint64_t HighestValue(int idx);
+
+private:
+    std::atomic<uint32_t> bucket_[LATENCY_BUCKET_NUM];
+    std::atomic<uint64_t> total_;
+    std::atomic<uint64_t> min_;
+    std::atomic<uint64_t> max_;
+};
+
+}    // namespace TEngine
+
+#endif
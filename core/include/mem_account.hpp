@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __MEM_ACCOUNT_HPP__
+#define __MEM_ACCOUNT_HPP__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tengine_c_api.h"
+
+/*
+ * Memory accounting of a graph, by category (MEM_STAT_xxx) and by node.
+ *
+ * The device runners allocate through MemAccount::Alloc() and Free(): an
+ * allocation is charged to the tag of the calling thread, set by MemTag
+ * around Prerun, Run and the memory planning, and remembers it in a small
+ * header, so that it is released from the same account, node and category
+ * whatever the thread freeing it. Allocations without a tag are not counted.
+ */
+
+/* subgraph attribute: the MemAccount* of the graph the subgraph belongs to */
+#define ATTR_MEM_ACCOUNT "MemAccount"
+
+namespace TEngine {
+
+struct MemRecord
+{
+    std::string name;
+    std::atomic<int64_t> current[MEM_STAT_NUM];
+    std::atomic<int64_t> peak[MEM_STAT_NUM];
+
+    MemRecord(const std::string& record_name);
+
+    void Add(int category, int64_t size);
+};
+
+class MemAccount
+{
+public:
+    MemAccount(void);
+    ~MemAccount(void);
+
+    /* the record of a node, created at the first call: the records are kept in that order */
+    MemRecord* GetRecord(const std::string& node_name);
+
+    /* record may be null: the memory shared by the nodes counts in the total only */
+    void Add(MemRecord* record, int category, int64_t size);
+
+    /* set the bytes of a category, for the memory not allocated through Alloc() */
+    void Set(MemRecord* record, int category, int64_t size);
+
+    /* total first, then the nodes using memory: returns the number of entries filled */
+    int GetStat(struct mem_stat* buf, int buf_size);
+
+    static void* Alloc(int size);
+    static void Free(void* ptr);
+
+private:
+    std::mutex lock_;
+    MemRecord total_;
+    std::atomic<int64_t> total_peak_;
+    std::vector<MemRecord*> record_list_;
+};
+
+/* the tag of the thread, restored at the end of the scope */
+class MemTag
+{
+public:
+    MemTag(MemAccount* account, MemRecord* record, int category);
+
+    /* same account and node, another category */
+    MemTag(int category);
+
+    ~MemTag(void);
+
+private:
+    MemAccount* saved_account_;
+    MemRecord* saved_record_;
+    int saved_category_;
+};
+
+}    // namespace TEngine
+
+#endif
@@ -27,6 +27,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 #include "attribute.hpp"
 #include "safe_object_manager.hpp"
@@ -60,6 +62,8 @@ struct StaticGraph
     std::vector<StaticTensorPtr> tensor_list;
     std::unordered_map<std::string, StaticTensorPtr> const_tensor_map;
     std::vector<void*> mem_src;
+    /* model file mappings the lazy const tensors read from: unmapped with the graph */
+    std::vector<std::pair<void*, int>> mapped_src;
     int layout;
 
     StaticGraph(void)
@@ -115,9 +119,28 @@ struct StaticConstTensor : public StaticTensor
     int file_offset;
     int file_size;
 
+    /*
+       lazy load: the data stays in the model file mapping (lazy_src) until
+       the first use, which copies it to mem_addr
+     */
+    const void* lazy_src;
+    std::atomic<void*> loaded_addr;
+    std::mutex load_lock;
+
     StaticConstTensor()
     {
         mem_addr = nullptr;
+        lazy_src = nullptr;
+        loaded_addr = nullptr;
+    }
+
+    /* mem_addr, read from lazy_src at the first call */
+    void* Load(void);
+
+    /* mem_addr, or null if not read yet */
+    void* GetLoaded(void) const
+    {
+        return lazy_src ? loaded_addr.load(std::memory_order_acquire) : mem_addr;
     }
 
     virtual ~StaticConstTensor()
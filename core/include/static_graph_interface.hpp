@@ -104,6 +104,8 @@ StaticTensor* CreateStaticConstTensor(StaticGraph* grap, const std::string& name
 void SetConstTensorBuffer(StaticTensor* tensor, void* addr);
 void* GetConstTensorBuffer(StaticTensor* tensor);
 void SetConstTensorFileLocation(StaticTensor* tensor, int offset, int file_size);
+/* the data is copied from src at the first use: src must live as long as the graph */
+void SetConstTensorLazySource(StaticTensor* tensor, const void* src);
 
 }    // namespace TEngine
 
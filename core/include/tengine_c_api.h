@@ -70,6 +70,44 @@ extern "C" {
 #define GRAPH_PERF_STAT_START 3
 #define GRAPH_PERF_STAT_RESET 4
 #define GRAPH_PERF_STAT_GET 5
+#define GRAPH_PERF_STAT_ENABLE_COUNTER 6 /* enable, and count the cpu events of each node too */
+
+/* cpu event counters, index of perf_counter_info.counter */
+#define PERF_COUNTER_CYCLES 0
+#define PERF_COUNTER_INSTRUCTIONS 1
+#define PERF_COUNTER_CACHE_REFERENCES 2
+#define PERF_COUNTER_CACHE_MISSES 3
+#define PERF_COUNTER_STALLED_CYCLES 4 /* backend stalls: waiting for memory, mostly */
+#define PERF_COUNTER_TASK_CLOCK 5 /* ns on cpu */
+#define PERF_COUNTER_NUM 6
+
+/*
+   graph attribute of the latency histograms, always on:
+   get_graph_attr(graph, GRAPH_ATTR_LATENCY_STAT, struct latency_stat* buf, size in bytes)
+   fills buf[0] with the end to end latency of run_graph(), then one entry per node, in run order.
+   the unused entries are zeroed, with name NULL.
+   set_graph_attr(graph, GRAPH_ATTR_LATENCY_STAT, int* action, sizeof(int)) takes LATENCY_STAT_xxx
+*/
+#define GRAPH_ATTR_LATENCY_STAT "latency_stat"
+
+#define LATENCY_STAT_DISABLE 0
+#define LATENCY_STAT_ENABLE 1
+#define LATENCY_STAT_RESET 2
+
+/*
+   graph attribute of the memory accounting, after prerun:
+   get_graph_attr(graph, GRAPH_ATTR_MEM_STAT, struct mem_stat* buf, size in bytes)
+   fills buf[0] with the graph total, then one entry per node holding memory, in run order.
+   the unused entries are zeroed, with name NULL.
+*/
+#define GRAPH_ATTR_MEM_STAT "mem_stat"
+
+/* memory categories, index of mem_stat.current and mem_stat.peak */
+#define MEM_STAT_WEIGHT 0 /* the const tensors of the model */
+#define MEM_STAT_PACKED_WEIGHT 1 /* weights converted by the kernels at prerun: interleaved, folded */
+#define MEM_STAT_ACTIVATION 2 /* the tensors between the nodes */
+#define MEM_STAT_SCRATCH 3 /* temporary buffers of the kernels: im2col, shared and scratch memory */
+#define MEM_STAT_NUM 4
 
 /* follow the std. UNIX log level definitioin */
 enum log_level
@@ -133,6 +171,43 @@ struct perf_info
     uint32_t base; /* 1ms second time number */
 };
 
+/* the cpu events of a node, summed over the master and the aider threads running it */
+
+struct perf_counter_info
+{
+    const char* name; /* node name */
+    const char* dev_name; /* device name */
+    uint32_t count; /* runs counted */
+    uint32_t valid_mask; /* bit (1 << PERF_COUNTER_xxx) set: the counter is supported */
+    uint64_t total_time; /* us */
+    uint64_t counter[PERF_COUNTER_NUM];
+};
+
+/* latency of the runs, in ns: percentiles are within 1/16 of the exact value */
+
+struct latency_stat
+{
+    const char* name; /* graph name for the end to end entry, node name else */
+    uint64_t count;
+    uint64_t total_time;
+    uint64_t min;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+};
+
+/* bytes used by a graph or a node */
+
+struct mem_stat
+{
+    const char* name; /* graph name for the total, node name else */
+    uint64_t current[MEM_STAT_NUM];
+    uint64_t peak[MEM_STAT_NUM];
+    uint64_t total_peak; /* graph: peak of the sum; node: sum of the peaks */
+};
+
 struct custom_kernel_tensor
 {
     int dim[MAX_SHAPE_DIM_NUM]; /* the shape dim array */
@@ -1100,6 +1175,52 @@ int do_graph_perf_stat(graph_t graph, int action);
 
 int get_graph_perf_stat(graph_t graph, struct perf_info** buf, int buf_size);
 
+/*!
+ * @brief get the cpu event counters of each node, after do_graph_perf_stat()
+ *        with GRAPH_PERF_STAT_ENABLE_COUNTER and GRAPH_PERF_STAT_START.
+ *        The counters come from perf_event_open(): the ones the kernel or the
+ *        cpu does not support are left out of valid_mask
+ *
+ * @param [in] graph: the graph handle
+ * @param [out] buf: the pointer array to struct perf_counter_info buffer
+ * @param [in] buf_size: the number of record pointer can be stored in buf
+ *
+ * @return the number of record retrieved or -1 on fail
+ */
+
+int get_graph_perf_counter(graph_t graph, struct perf_counter_info** buf, int buf_size);
+
+/*!
+ * @brief Start recording the execution timeline of all graphs: the run of each node
+ *        and of its sub tasks on the aider threads, with their thread and cpu.
+ *        The ring buffer keeps the last event_number events.
+ *        Setting env TENGINE_TRACE=file traces from init_tengine to release_tengine.
+ *
+ * @param [in] event_number: the ring buffer size, 0 for the default (64K events)
+ *
+ * @return 0 success, -1 fail (already started)
+ */
+
+int start_trace(int event_number);
+
+/*!
+ * @brief Stop recording the execution timeline
+ *
+ * @return 0 success, -1 fail (not started)
+ */
+
+int stop_trace(void);
+
+/*!
+ * @brief Write the recorded timeline as Chrome trace JSON, for chrome://tracing or Perfetto
+ *
+ * @param [in] file_name: the json file
+ *
+ * @return 0 success, -1 fail
+ */
+
+int dump_trace(const char* file_name);
+
 /*!
  * @brief Get the device number in the system.
  *
@@ -39,9 +39,52 @@ test_node_t create_fc_test_node(int hidden_number, int output_number);
 test_node_t create_pooling_test_node(int pool_method, int kernel_h, int kernel_w, int stride_h, int stride_w,
                                      int pad_h0, int pad_h1, int pad_w0, int pad_w1, int global);
 
+/* a node of any operator, with the default params */
+test_node_t create_test_node(const char* op_name);
+
+int test_node_set_param_int(test_node_t node, const char* param_name, int val);
+int test_node_set_param_float(test_node_t node, const char* param_name, float val);
+
+/* before adding the tensors: TENGINE_LAYOUT_NCHW (the default) or TENGINE_LAYOUT_NHWC for the 4 dim ones */
+int test_node_set_layout(test_node_t node, int layout);
+
+/* convolution only */
 int test_node_set_input(test_node_t node, float* input_data[], int* input_shape[], int input_number);
 int test_node_set_output(test_node_t node, float* output_data[], int* output_shape[], int output_number);
 
+/* any operator: append the next input or output, of dim_number dims */
+int test_node_add_input(test_node_t node, float* data, const int* dims, int dim_number);
+int test_node_add_output(test_node_t node, float* data, const int* dims, int dim_number);
+
+/* the shape of output idx, from the inputs added; returns the dim number, or -1 */
+int test_node_infer_output_shape(test_node_t node, int idx, int dims[], int max_dim_number);
+
+/*
+ * Before prerun: run the node by the implementation of the given registry
+ * ("common", "arm64" ...) registered with the given priority, or by any of
+ * that registry when priority is -1. The prerun fails if it does not take the node.
+ */
+int test_node_set_ops(test_node_t node, const char* registry_name, int priority);
+
+/* the priorities registered for op_name in the registry, in search order; returns the number */
+int test_get_ops_priority(const char* registry_name, const char* op_name, int priority[], int max_number);
+
+/* the registry names; returns the number */
+int test_get_registry_names(const char* names[], int max_number);
+
+/* after prerun: the type name of the implementation running the node */
+const char* test_node_get_ops_name(test_node_t node);
+
+/*
+ * After prerun: the dump of the implementation running the node, as
+ * do_node_dump() with a NODE_DUMP_ACTION_xxx action. Once started, each run
+ * copies the inputs then the outputs of the node in the dump records.
+ */
+int test_node_do_dump(test_node_t node, int action);
+
+/* the struct tensor_dump_header records of the last run dumped; returns the number, or -1 */
+int test_node_get_dump(test_node_t node, void** buf, int buf_size);
+
 int test_node_prerun(test_node_t node);
 
 int test_node_run(test_node_t node);
@@ -27,6 +27,8 @@
 #include <iostream>
 #include <string>
 #include <atomic>
+#include <functional>
+#include <utility>
 
 #include "base_object.hpp"
 #include "tensor_shape.hpp"
@@ -62,27 +64,32 @@ public:
         static_tensor_ = nullptr;
         reshaped_count_ = 0;
         producer = nullptr;
+        mem_addr_ = nullptr;
+        data_mem_ = nullptr;
+        data_mem_size_ = 0;
     }
     virtual ~Tensor()
     {
         FreeTensor();
+        ReleaseDataMem();
     }
 
     void FreeTensor(void)
     {
-        if(type_ == kConstTensor && ExistAttr("free_mem") && ExistAttr("mem_addr"))
+        if(type_ == kConstTensor && mem_addr_ && ExistAttr("free_mem"))
         {
-            void* mem = any_cast<void*>(GetAttr("mem_addr"));
-            std::free(mem);
+            std::free(mem_addr_);
 
             RemoveAttr("free_mem");
-            RemoveAttr("mem_addr");
+            mem_addr_ = nullptr;
         }
     }
 
+    /* the run-time memory is not shared with the copy */
     Tensor(const Tensor& o)
         : BaseObject(o), producer(o.producer), consumer(o.consumer), quant_param_(o.quant_param_), type_(o.type_),
-          name_(o.name_), data_type_(o.data_type_), shape_(o.shape_), static_tensor_(o.static_tensor_){};
+          name_(o.name_), data_type_(o.data_type_), shape_(o.shape_), static_tensor_(o.static_tensor_),
+          mem_addr_(o.mem_addr_), data_mem_(nullptr), data_mem_size_(0){};
 
     Tensor& operator=(const Tensor& rhs) = delete;
 
@@ -210,15 +217,62 @@ public:
 
     void* GetMemAddr(void) const
     {
-        if(!ExistAttr("mem_addr"))
-            return nullptr;
+        /* the const tensors of a lazy loaded model are read at their first use */
+        if(mem_addr_ == nullptr && static_tensor_)
+            return LoadStaticMem();
 
-        return any_cast<void*>(GetAttr("mem_addr"));
+        return mem_addr_;
     }
 
+    /* as GetMemAddr(), but null for a lazy const tensor not read yet */
+    void* GetLoadedMemAddr(void) const;
+
     void SetMemAddr(void* addr)
     {
-        (*this)["mem_addr"] = addr;
+        mem_addr_ = addr;
+    }
+
+    /*
+       run-time memory of non-const tensors, kept as plain fields so that
+       get_tensor_mem() is a load rather than an attribute lookup.
+       the releaser, if any, is called when the memory is replaced or released
+     */
+
+    void* GetDataMem(void) const
+    {
+        return data_mem_;
+    }
+
+    int GetDataMemSize(void) const
+    {
+        return data_mem_size_;
+    }
+
+    void SetDataMem(void* addr, int size, const std::function<void(void*)>& releaser)
+    {
+        ReleaseDataMem();
+
+        data_mem_ = addr;
+        data_mem_size_ = size;
+        data_mem_releaser_ = releaser;
+    }
+
+    void ReleaseDataMem(void)
+    {
+        if(data_mem_ && data_mem_releaser_)
+            data_mem_releaser_(data_mem_);
+
+        data_mem_ = nullptr;
+        data_mem_size_ = 0;
+        data_mem_releaser_ = nullptr;
+    }
+
+    /* exchange the data memory with the given one, nothing is released */
+    void SwapDataMem(void*& addr, int& size, std::function<void(void*)>& releaser)
+    {
+        std::swap(data_mem_, addr);
+        std::swap(data_mem_size_, size);
+        std::swap(data_mem_releaser_, releaser);
     }
 
     void FreeMem(void);
@@ -236,8 +290,17 @@ protected:
     int data_type_;
     TShape shape_;
 
+    void* LoadStaticMem(void) const;
+
     StaticConstTensor* static_tensor_;
 
+    /* const tensor data */
+    void* mem_addr_;
+
+    void* data_mem_;
+    int data_mem_size_;
+    std::function<void(void*)> data_mem_releaser_;
+
     std::atomic<int> reshaped_count_;
 };
 
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __TRACE_EVENT_HPP__
+#define __TRACE_EVENT_HPP__
+
+#include <stdint.h>
+
+#include <atomic>
+
+/*
+ * Execution timeline: complete events (begin and duration) of the graph
+ * runs, the node runs and the sub tasks on the aider threads, with the
+ * thread and cpu they ran on. Writers take a slot of a ring buffer with one
+ * atomic add, so the buffer keeps the last events and never blocks a run.
+ * Dump() writes the Chrome trace JSON read by chrome://tracing and Perfetto.
+ *
+ * Off by default: a disabled tracer costs one relaxed load per node.
+ */
+
+#define TRACE_DEFAULT_EVENT_NUM (64 * 1024)
+#define TRACE_NAME_SIZE 40
+
+namespace TEngine {
+
+enum trace_category
+{
+    TRACE_GRAPH,    // a subgraph run on a device
+    TRACE_NODE,    // a node run by the master thread
+    TRACE_TASK,    // a sub task of a node, on an aider thread
+    TRACE_DISPATCH,    // queuing the sub tasks
+    TRACE_WAIT,    // the master waiting for the sub tasks
+    TRACE_CATEGORY_NUM
+};
+
+struct TraceEvent
+{
+    uint64_t start;    // ns
+    uint64_t dur;    // ns
+    int tid;
+    int cpu;
+    int category;
+    char name[TRACE_NAME_SIZE];
+};
+
+struct TraceSlot
+{
+    /* index + 1 of the event in the slot, 0 while it is written */
+    std::atomic<uint64_t> seq;
+    TraceEvent event;
+};
+
+class Tracer
+{
+public:
+    static bool Enabled(void)
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /*
+       event_number is rounded up to a power of 2, 0 for the default.
+       a new buffer size should be set while no graph runs
+     */
+    static bool Start(int event_number);
+    static bool Stop(void);
+
+    /* write the events in the buffer, as Chrome trace JSON */
+    static bool Dump(const char* file_name);
+
+    static uint64_t Now(void);
+
+    /* an event from start to now, on this thread */
+    static void Record(int category, const char* name, uint64_t start);
+
+    /* the node the thread is running: names the sub tasks it dispatches */
+    static void SetContext(const char* name);
+    static const char* GetContext(void);
+
+private:
+    static std::atomic<bool> enabled_;
+    static std::atomic<uint64_t> next_;
+
+    static TraceSlot* slot_buf_;
+    static uint64_t mask_;
+};
+
+}    // namespace TEngine
+
+#endif
@@ -75,6 +75,20 @@ public:
         worker_cv_->notify_all();
     }
 
+    void PushTask(const T& task)
+    {
+        std::unique_lock<std::mutex> cv_lock(*worker_lock_);
+
+        task_queue_->push(task);
+
+        if(inc_req_)
+            inc_req_(1);
+
+        cv_lock.unlock();
+
+        worker_cv_->notify_all();
+    }
+
     void SetQueue(std::queue<T>* task_queue, std::mutex* worker_lock, std::condition_variable* worker_cv)
     {
         task_queue_ = task_queue;
@@ -179,7 +179,7 @@ bool Graph::CreateNodeFromStatic(Node* node, const StaticGraph* static_graph, co
         {
             StaticConstTensor* const_tensor = dynamic_cast<StaticConstTensor*>(static_tensor);
 
-            (*tensor)["mem_addr"] = const_tensor->mem_addr;
+            tensor->SetMemAddr(const_tensor->mem_addr);
             (*tensor)["file_offset"] = const_tensor->file_offset;
             (*tensor)["file_size"] = const_tensor->file_size;
             tensor->BindStaticTensor(const_tensor);
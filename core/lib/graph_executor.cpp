@@ -166,6 +166,54 @@ bool GraphExecutor::SetExecParam(Graph* graph)
             exec_attr_.low_mem_mode = true;
     }
 
+    // check blocked_layout env var
+
+    const char* blocked = std::getenv("BLOCKED_LAYOUT");
+
+    if(blocked)
+    {
+        if(blocked[0] == '0')
+            exec_attr_.blocked_layout = false;
+        else
+            exec_attr_.blocked_layout = true;
+    }
+
+    // check tiled_exec env var
+
+    const char* tiled = std::getenv("TILED_EXEC");
+
+    if(tiled)
+    {
+        if(tiled[0] == '0')
+            exec_attr_.tiled_exec = false;
+        else
+            exec_attr_.tiled_exec = true;
+    }
+
+    // check parallel_prerun env var
+
+    const char* parallel_prerun = std::getenv("PARALLEL_PRERUN");
+
+    if(parallel_prerun)
+    {
+        if(parallel_prerun[0] == '0')
+            exec_attr_.parallel_prerun = false;
+        else
+            exec_attr_.parallel_prerun = true;
+    }
+
+    // check lazy_prerun env var
+
+    const char* lazy_prerun = std::getenv("LAZY_PRERUN");
+
+    if(lazy_prerun)
+    {
+        if(lazy_prerun[0] == '0')
+            exec_attr_.lazy_prerun = false;
+        else
+            exec_attr_.lazy_prerun = true;
+    }
+
     return true;
 }
 
@@ -617,6 +665,38 @@ bool GraphExecutor::SetExecAttrEntry(const char* name, const void* val, int size
         else
             exec_attr_.pooling_mt = false;
     }
+    else if(!strcmp("blocked_layout", name))
+    {
+        int n = *( int* )val;
+        if(n)
+            exec_attr_.blocked_layout = true;
+        else
+            exec_attr_.blocked_layout = false;
+    }
+    else if(!strcmp("tiled_exec", name))
+    {
+        int n = *( int* )val;
+        if(n)
+            exec_attr_.tiled_exec = true;
+        else
+            exec_attr_.tiled_exec = false;
+    }
+    else if(!strcmp("parallel_prerun", name))
+    {
+        int n = *( int* )val;
+        if(n)
+            exec_attr_.parallel_prerun = true;
+        else
+            exec_attr_.parallel_prerun = false;
+    }
+    else if(!strcmp("lazy_prerun", name))
+    {
+        int n = *( int* )val;
+        if(n)
+            exec_attr_.lazy_prerun = true;
+        else
+            exec_attr_.lazy_prerun = false;
+    }
     else
     {
         return false;
@@ -653,6 +733,34 @@ bool GraphExecutor::GetExecAttrEntry(const char* name, void* val, int size)
         else
             *( int* )val = 0;
     }
+    else if(!strcmp("blocked_layout", name))
+    {
+        if(exec_attr_.blocked_layout)
+            *( int* )val = 1;
+        else
+            *( int* )val = 0;
+    }
+    else if(!strcmp("tiled_exec", name))
+    {
+        if(exec_attr_.tiled_exec)
+            *( int* )val = 1;
+        else
+            *( int* )val = 0;
+    }
+    else if(!strcmp("parallel_prerun", name))
+    {
+        if(exec_attr_.parallel_prerun)
+            *( int* )val = 1;
+        else
+            *( int* )val = 0;
+    }
+    else if(!strcmp("lazy_prerun", name))
+    {
+        if(exec_attr_.lazy_prerun)
+            *( int* )val = 1;
+        else
+            *( int* )val = 0;
+    }
     else
     {
         return false;
@@ -682,6 +790,10 @@ void GraphExecutor::InitAttrIO(void)
     attr_io_.RegGetFunc("low_mem_mode", get_func);
     attr_io_.RegGetFunc("fc_mt", get_func);
     attr_io_.RegGetFunc("pooling_mt", get_func);
+    attr_io_.RegGetFunc("blocked_layout", get_func);
+    attr_io_.RegGetFunc("tiled_exec", get_func);
+    attr_io_.RegGetFunc("parallel_prerun", get_func);
+    attr_io_.RegGetFunc("lazy_prerun", get_func);
 
     auto set_func = std::bind(&GraphExecutor::SetExecAttrEntry, this, std::placeholders::_1, std::placeholders::_2,
                               std::placeholders::_3);
@@ -692,6 +804,10 @@ void GraphExecutor::InitAttrIO(void)
     attr_io_.RegSetFunc("low_mem_mode", set_func);
     attr_io_.RegSetFunc("fc_mt", set_func);
     attr_io_.RegSetFunc("pooling_mt", set_func);
+    attr_io_.RegSetFunc("blocked_layout", set_func);
+    attr_io_.RegSetFunc("tiled_exec", set_func);
+    attr_io_.RegSetFunc("parallel_prerun", set_func);
+    attr_io_.RegSetFunc("lazy_prerun", set_func);
 
     // bailout
     auto set_func2 = std::bind(&GraphExecutor::BailoutSetAttr, this, std::placeholders::_1, std::placeholders::_2,
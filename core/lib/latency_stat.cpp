@@ -0,0 +1,99 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include "latency_stat.hpp"
+
+namespace TEngine {
+
+void LatencyHistogram::Reset(void)
+{
+    for(int i = 0; i < LATENCY_BUCKET_NUM; i++)
+        bucket_[i].store(0, std::memory_order_relaxed);
+
+    total_.store(0, std::memory_order_relaxed);
+    min_.store(UINT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::HighestValue(int idx)
+{
+    if(idx < LATENCY_SUB_BUCKET_NUM)
+        return idx;
+
+    int shift = idx / LATENCY_SUB_BUCKET_NUM - 1;
+    uint64_t low = ( uint64_t )(LATENCY_SUB_BUCKET_NUM + idx % LATENCY_SUB_BUCKET_NUM) << shift;
+
+    return low + (1UL << shift) - 1;
+}
+
+void LatencyHistogram::GetStat(struct latency_stat* stat) const
+{
+    uint32_t count[LATENCY_BUCKET_NUM];
+    uint64_t number = 0;
+
+    for(int i = 0; i < LATENCY_BUCKET_NUM; i++)
+    {
+        count[i] = bucket_[i].load(std::memory_order_relaxed);
+        number += count[i];
+    }
+
+    stat->count = number;
+    stat->total_time = total_.load(std::memory_order_relaxed);
+    stat->max = max_.load(std::memory_order_relaxed);
+    stat->min = number ? min_.load(std::memory_order_relaxed) : 0;
+
+    /* per mille */
+    static const int quantile[4] = {500, 900, 990, 999};
+    uint64_t* value[4] = {&stat->p50, &stat->p90, &stat->p99, &stat->p999};
+
+    uint64_t seen = 0;
+    int idx = 0;
+
+    for(int q = 0; q < 4; q++)
+    {
+        *value[q] = 0;
+
+        if(number == 0)
+            continue;
+
+        /* the value of the rank-th run, in order, from 1 */
+        uint64_t rank = (number * quantile[q] + 999) / 1000;
+
+        while(idx < LATENCY_BUCKET_NUM && seen + count[idx] < rank)
+            seen += count[idx++];
+
+        if(idx == LATENCY_BUCKET_NUM)
+            idx--;
+
+        uint64_t v = HighestValue(idx);
+
+        if(v > stat->max)
+            v = stat->max;
+        if(v < stat->min)
+            v = stat->min;
+
+        *value[q] = v;
+    }
+}
+
+}    // namespace TEngine
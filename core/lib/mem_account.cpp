@@ -0,0 +1,227 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <cstdlib>
+#include <cstring>
+
+#include "mem_account.hpp"
+
+namespace TEngine {
+
+/* in front of each allocation: keeps the malloc() alignment */
+struct MemHeader
+{
+    MemAccount* account;
+    MemRecord* record;
+    int64_t size;
+    int64_t category;
+};
+
+static thread_local MemAccount* tag_account = nullptr;
+static thread_local MemRecord* tag_record = nullptr;
+static thread_local int tag_category = 0;
+
+static void update_peak(std::atomic<int64_t>* peak, int64_t value)
+{
+    int64_t old_peak = peak->load(std::memory_order_relaxed);
+
+    while(value > old_peak && !peak->compare_exchange_weak(old_peak, value, std::memory_order_relaxed))
+        ;
+}
+
+MemRecord::MemRecord(const std::string& record_name) : name(record_name)
+{
+    for(int i = 0; i < MEM_STAT_NUM; i++)
+    {
+        current[i] = 0;
+        peak[i] = 0;
+    }
+}
+
+void MemRecord::Add(int category, int64_t size)
+{
+    int64_t value = current[category].fetch_add(size, std::memory_order_relaxed) + size;
+
+    update_peak(&peak[category], value);
+}
+
+MemAccount::MemAccount(void) : total_("")
+{
+    total_peak_ = 0;
+}
+
+MemAccount::~MemAccount(void)
+{
+    for(unsigned int i = 0; i < record_list_.size(); i++)
+        delete record_list_[i];
+}
+
+MemRecord* MemAccount::GetRecord(const std::string& node_name)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+
+    for(unsigned int i = 0; i < record_list_.size(); i++)
+    {
+        if(record_list_[i]->name == node_name)
+            return record_list_[i];
+    }
+
+    MemRecord* record = new MemRecord(node_name);
+
+    record_list_.push_back(record);
+
+    return record;
+}
+
+void MemAccount::Add(MemRecord* record, int category, int64_t size)
+{
+    if(record)
+        record->Add(category, size);
+
+    total_.Add(category, size);
+
+    int64_t sum = 0;
+
+    for(int i = 0; i < MEM_STAT_NUM; i++)
+        sum += total_.current[i].load(std::memory_order_relaxed);
+
+    update_peak(&total_peak_, sum);
+}
+
+void MemAccount::Set(MemRecord* record, int category, int64_t size)
+{
+    std::lock_guard<std::mutex> lock(lock_);
+
+    int64_t old_size = record->current[category].load(std::memory_order_relaxed);
+
+    if(size != old_size)
+        Add(record, category, size - old_size);
+}
+
+int MemAccount::GetStat(struct mem_stat* buf, int buf_size)
+{
+    if(buf_size <= 0)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(lock_);
+
+    const MemRecord* record = &total_;
+    int stat_number = 0;
+
+    for(int i = -1; i < ( int )record_list_.size() && stat_number < buf_size; i++)
+    {
+        if(i >= 0)
+            record = record_list_[i];
+
+        struct mem_stat* stat = &buf[stat_number];
+        bool used = false;
+
+        for(int c = 0; c < MEM_STAT_NUM; c++)
+        {
+            stat->current[c] = record->current[c].load(std::memory_order_relaxed);
+            stat->peak[c] = record->peak[c].load(std::memory_order_relaxed);
+
+            if(stat->peak[c])
+                used = true;
+        }
+
+        if(i >= 0 && !used)
+            continue;
+
+        stat->name = record->name.c_str();
+        stat->total_peak = 0;
+
+        if(i < 0)
+            stat->total_peak = total_peak_.load(std::memory_order_relaxed);
+        else
+        {
+            /* the peaks of the categories may not be at the same time */
+            for(int c = 0; c < MEM_STAT_NUM; c++)
+                stat->total_peak += stat->peak[c];
+        }
+
+        stat_number++;
+    }
+
+    return stat_number;
+}
+
+void* MemAccount::Alloc(int size)
+{
+    MemHeader* header = ( MemHeader* )std::malloc(sizeof(MemHeader) + size);
+
+    if(header == nullptr)
+        return nullptr;
+
+    header->account = tag_account;
+    header->record = tag_record;
+    header->size = size;
+    header->category = tag_category;
+
+    if(tag_account)
+        tag_account->Add(tag_record, tag_category, size);
+
+    return header + 1;
+}
+
+void MemAccount::Free(void* ptr)
+{
+    if(ptr == nullptr)
+        return;
+
+    MemHeader* header = ( MemHeader* )ptr - 1;
+
+    if(header->account)
+        header->account->Add(header->record, header->category, -header->size);
+
+    std::free(header);
+}
+
+MemTag::MemTag(MemAccount* account, MemRecord* record, int category)
+{
+    saved_account_ = tag_account;
+    saved_record_ = tag_record;
+    saved_category_ = tag_category;
+
+    tag_account = account;
+    tag_record = record;
+    tag_category = category;
+}
+
+MemTag::MemTag(int category)
+{
+    saved_account_ = tag_account;
+    saved_record_ = tag_record;
+    saved_category_ = tag_category;
+
+    tag_category = category;
+}
+
+MemTag::~MemTag(void)
+{
+    tag_account = saved_account_;
+    tag_record = saved_record_;
+    tag_category = saved_category_;
+}
+
+}    // namespace TEngine
@@ -22,6 +22,9 @@
  * Author: haitao@openailab.com
  */
 #include <iostream>
+#include <sys/mman.h>
+
+#include <cstring>
 #include <functional>
 #include <algorithm>
 
@@ -36,6 +39,9 @@ StaticGraph::~StaticGraph(void)
     for(auto p : mem_src)
         free(p);
 
+    for(auto& m : mapped_src)
+        munmap(m.first, m.second);
+
     if(release_func)
         release_func(dev_handle);
 }
@@ -480,6 +486,38 @@ void SetConstTensorFileLocation(StaticTensor* tensor, int offset, int file_size)
     const_tensor->file_size = file_size;
 }
 
+void SetConstTensorLazySource(StaticTensor* tensor, const void* src)
+{
+    StaticConstTensor* const_tensor = dynamic_cast<StaticConstTensor*>(tensor);
+
+    const_tensor->lazy_src = src;
+}
+
+void* StaticConstTensor::Load(void)
+{
+    void* addr = GetLoaded();
+
+    if(addr || lazy_src == nullptr)
+        return addr;
+
+    std::lock_guard<std::mutex> lock(load_lock);
+
+    if(mem_addr == nullptr)
+    {
+        void* buf = std::malloc(mem_size);
+
+        if(buf == nullptr)
+            return nullptr;
+
+        std::memcpy(buf, lazy_src, mem_size);
+
+        mem_addr = buf;
+        loaded_addr.store(buf, std::memory_order_release);
+    }
+
+    return mem_addr;
+}
+
 const std::string& GetTensorName(StaticTensor* tensor)
 {
     return tensor->name;
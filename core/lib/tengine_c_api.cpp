@@ -39,6 +39,7 @@
 
 #include "node_dump.hpp"
 #include "graph_perf.hpp"
+#include "trace_event.hpp"
 #include "static_graph.hpp"
 #include "graph_executor.hpp"
 
@@ -88,6 +89,11 @@ int init_tengine(void)
         set_cpu_list(cpu_list_str);
     }
 
+    const char* trace_file = std::getenv("TENGINE_TRACE");
+
+    if(trace_file)
+        Tracer::Start(0);
+
     InitAllPlugin();
 
     if(TEnginePlugin::InitModule() < 0)
@@ -107,6 +113,11 @@ int init_tengine(void)
 void release_tengine(void)
 {
     TEnginePlugin::ReleaseModule();
+
+    const char* trace_file = std::getenv("TENGINE_TRACE");
+
+    if(trace_file && Tracer::Stop())
+        Tracer::Dump(trace_file);
 }
 
 graph_t create_graph(context_t context, const char* model_format, const char* fname, ...)
@@ -857,7 +868,8 @@ void* get_tensor_buffer(tensor_t tensor)
 {
     Tensor* real_tensor = reinterpret_cast<Tensor*>(tensor);
 
-    return get_tensor_mem(real_tensor);
+    /* an internal tensor may be stored channel blocked: the user reads NCHW */
+    return get_tensor_nchw_mem(real_tensor);
 }
 
 int set_tensor_buffer(tensor_t tensor, void* buffer, int buffer_size)
@@ -1196,7 +1208,7 @@ int do_graph_perf_stat(graph_t graph, int action)
         return -1;
     }
 
-    if(action < GRAPH_PERF_STAT_DISABLE || action >= GRAPH_PERF_STAT_GET)
+    if(action < GRAPH_PERF_STAT_DISABLE || action > GRAPH_PERF_STAT_ENABLE_COUNTER || action == GRAPH_PERF_STAT_GET)
     {
         set_tengine_errno(EINVAL);
         return -1;
@@ -1220,7 +1232,7 @@ int get_graph_perf_stat(graph_t graph, struct perf_info** buf, int buf_size)
     }
 
     GraphPerfMsg msg;
-    msg.buf = buf;
+    msg.buf = ( void** )buf;
     msg.buf_size = buf_size;
 
     msg.action = GRAPH_PERF_STAT_GET;
@@ -1233,6 +1245,63 @@ int get_graph_perf_stat(graph_t graph, struct perf_info** buf, int buf_size)
     return -1;
 }
 
+int get_graph_perf_counter(graph_t graph, struct perf_counter_info** buf, int buf_size)
+{
+    GraphExecutor* executor = reinterpret_cast<GraphExecutor*>(graph);
+
+    if(!executor->PrerunDone())
+    {
+        set_tengine_errno(EAGAIN);
+        return -1;
+    }
+
+    GraphPerfMsg msg;
+    msg.buf = ( void** )buf;
+    msg.buf_size = buf_size;
+
+    msg.action = GRAPH_PERF_STAT_GET_COUNTER;
+
+    int ret = get_graph_attr(graph, ATTR_GRAPH_PERF_STAT, &msg, sizeof(msg));
+
+    if(ret == 0)
+        return msg.ret_number;
+
+    return -1;
+}
+
+int start_trace(int event_number)
+{
+    if(!Tracer::Start(event_number))
+    {
+        set_tengine_errno(EBUSY);
+        return -1;
+    }
+
+    return 0;
+}
+
+int stop_trace(void)
+{
+    if(!Tracer::Stop())
+    {
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    return 0;
+}
+
+int dump_trace(const char* file_name)
+{
+    if(!Tracer::Dump(file_name))
+    {
+        set_tengine_errno(EIO);
+        return -1;
+    }
+
+    return 0;
+}
+
 int get_device_number(void)
 {
     return DevExecutorManager::GetNum();
@@ -24,7 +24,12 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
+#include <atomic>
 #include <map>
 #include <set>
 
@@ -136,6 +141,223 @@ int node_add_attr(void* node, const char* param_name, const void* type_info, int
     return NodeAddParamGeneric(node, param_name, type_info, param_size);
 }
 
+/* fnv-1a, a word at a time */
+static const uint64_t fnv_prime = 0x100000001b3ULL;
+static const uint64_t fnv_basis = 0xcbf29ce484222325ULL;
+
+static inline uint64_t fnv_string(uint64_t hash, const char* p)
+{
+    for(; *p; p++)
+        hash = (hash ^ ( unsigned char )*p) * fnv_prime;
+
+    /* the boundaries between the strings */
+    return (hash ^ 0xff) * fnv_prime;
+}
+
+static bool same_stat(const struct stat& a, const struct stat& b)
+{
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+           a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+/* the hash of the contents of the files, false if one changed while it was read */
+static bool hash_model_files(const char* model_format, const std::vector<std::string>& file_list,
+                             const std::vector<struct stat>& stat_list, uint64_t& hash)
+{
+    std::vector<char> buf(1 << 20);
+
+    hash = fnv_string(fnv_basis, model_format);
+
+    for(unsigned int i = 0; i < file_list.size(); i++)
+    {
+        FILE* fp = fopen(file_list[i].c_str(), "rb");
+
+        if(fp == nullptr)
+            return false;
+
+        uint64_t file_size = 0;
+        size_t n;
+
+        while((n = fread(buf.data(), 1, buf.size(), fp)) > 0)
+        {
+            size_t k = 0;
+
+            for(; k + sizeof(uint64_t) <= n; k += sizeof(uint64_t))
+            {
+                uint64_t word;
+
+                memcpy(&word, buf.data() + k, sizeof(word));
+                hash = (hash ^ word) * fnv_prime;
+            }
+
+            for(; k < n; k++)
+                hash = (hash ^ ( unsigned char )buf[k]) * fnv_prime;
+
+            file_size += n;
+        }
+
+        struct stat sb;
+        bool changed = fstat(fileno(fp), &sb) < 0 || !same_stat(sb, stat_list[i]);
+
+        fclose(fp);
+
+        if(changed)
+            return false;
+
+        /* the boundaries between the files */
+        hash = (hash ^ file_size) * fnv_prime;
+    }
+
+    return true;
+}
+
+/*
+   the conversion cache: with TENGINE_MODEL_CACHE set to a directory, a model
+   of another format is saved there as a tmfile when it is first loaded, named
+   by the hash of the format and of the file contents, and the later loads of
+   the same files read that tmfile instead of parsing them again.
+
+   hashing a big model at each load would cost a good part of the parse it
+   saves: a key file, named by the hash of the path, size and mtime of the
+   files, keeps the content hash, and the contents are read again only when
+   one of those changed
+ */
+static std::string get_cache_file(const char* model_format, const std::vector<std::string>& file_list)
+{
+    const char* cache_dir = std::getenv("TENGINE_MODEL_CACHE");
+
+    if(cache_dir == nullptr || cache_dir[0] == '\0' || !strcmp(model_format, "tengine"))
+        return std::string();
+
+    std::vector<struct stat> stat_list(file_list.size());
+    uint64_t key = fnv_string(fnv_basis, model_format);
+
+    for(unsigned int i = 0; i < file_list.size(); i++)
+    {
+        struct stat& sb = stat_list[i];
+
+        if(stat(file_list[i].c_str(), &sb) < 0)
+            return std::string();
+
+        key = fnv_string(key, file_list[i].c_str());
+
+        key = (key ^ ( uint64_t )sb.st_dev) * fnv_prime;
+        key = (key ^ ( uint64_t )sb.st_ino) * fnv_prime;
+        key = (key ^ ( uint64_t )sb.st_size) * fnv_prime;
+        key = (key ^ ( uint64_t )sb.st_mtim.tv_sec) * fnv_prime;
+        key = (key ^ ( uint64_t )sb.st_mtim.tv_nsec) * fnv_prime;
+    }
+
+    char name[64];
+
+    snprintf(name, sizeof(name), "/%s-%016llx.key", model_format, ( unsigned long long )key);
+
+    std::string key_file = std::string(cache_dir) + name;
+    unsigned long long hash = 0;
+    FILE* fp = fopen(key_file.c_str(), "r");
+
+    if(fp != nullptr)
+    {
+        bool found = fscanf(fp, "%16llx", &hash) == 1;
+
+        fclose(fp);
+
+        if(found)
+        {
+            snprintf(name, sizeof(name), "/%s-%016llx.tmfile", model_format, hash);
+            return std::string(cache_dir) + name;
+        }
+    }
+
+    uint64_t content_hash;
+
+    if(!hash_model_files(model_format, file_list, stat_list, content_hash))
+        return std::string();
+
+    hash = content_hash;
+
+    /* renamed once complete, as the tmfile: a key file read is whole */
+    static std::atomic<unsigned int> key_seq(0);
+
+    std::string tmp_file = key_file + "." + std::to_string(getpid()) + "." + std::to_string(key_seq++);
+
+    fp = fopen(tmp_file.c_str(), "w");
+
+    if(fp != nullptr)
+    {
+        bool ret = fprintf(fp, "%016llx\n", hash) > 0;
+
+        if(fclose(fp) != 0 || !ret || rename(tmp_file.c_str(), key_file.c_str()) < 0)
+            unlink(tmp_file.c_str());
+    }
+
+    snprintf(name, sizeof(name), "/%s-%016llx.tmfile", model_format, hash);
+
+    return std::string(cache_dir) + name;
+}
+
+/* null if there is no usable tmfile: the caller loads the model files */
+static StaticGraph* load_cached_model(const char* model_name, const char* model_format, const std::string& source,
+                                      const std::string& cache_file)
+{
+    SerializerPtr tm_serializer;
+
+    if(access(cache_file.c_str(), R_OK) < 0 || !SerializerManager::SafeGet("tengine", tm_serializer))
+        return nullptr;
+
+    StaticGraph* static_graph = CreateStaticGraph(model_name);
+    std::vector<std::string> file_list(1, cache_file);
+
+    if(!tm_serializer->LoadModel(file_list, static_graph) || !CheckGraphIntegraity(static_graph))
+    {
+        XLOG_WARN() << "cannot load the cached model: " << cache_file << ", convert it again\n";
+        delete static_graph;
+        return nullptr;
+    }
+
+    /* the same graph as if the model files were loaded: the kernels check the source format */
+    SetGraphSource(static_graph, source);
+    SetGraphSourceFormat(static_graph, model_format);
+
+    return static_graph;
+}
+
+static void save_cached_model(const char* model_name, const StaticGraphPtr& static_graph,
+                              const std::string& cache_file)
+{
+    SerializerPtr tm_serializer;
+
+    /* a tmfile for benchmark has no weights */
+    if(std::getenv("TM_FOR_BENCHMARK") || !SerializerManager::SafeGet("tengine", tm_serializer))
+        return;
+
+    Graph* graph = Graph::CreateFromStatic(model_name, static_graph);
+
+    if(graph == nullptr)
+        return;
+
+    /* renamed once complete: the other loads see the whole file or none.
+       the counter keeps the threads of one process saving the same model apart */
+    static std::atomic<unsigned int> save_seq(0);
+
+    std::string tmp_file = cache_file + "." + std::to_string(getpid()) + "." + std::to_string(save_seq++);
+
+    /* the tm serializer does not truncate: drop what a dead process left behind */
+    unlink(tmp_file.c_str());
+
+    std::vector<std::string> file_list(1, tmp_file);
+
+    bool ret = tm_serializer->SaveModel(file_list, graph);
+
+    delete graph;
+
+    if(!ret || rename(tmp_file.c_str(), cache_file.c_str()) < 0)
+    {
+        XLOG_WARN() << "cannot save the model to the cache: " << cache_file << "\n";
+        unlink(tmp_file.c_str());
+    }
+}
+
 static int real_vload_model(context_t exec_context, const char* model_name, const char* model_format, const void* addr,
                             int mem_size, va_list argp)
 {
@@ -153,6 +375,7 @@ static int real_vload_model(context_t exec_context, const char* model_name, cons
     static_graph->exec_context = exec_context;
 
     int saved_file_number = serializer->GetFileNum();
+    std::string cache_file;
 
     if(mem_size == 0)    // file mode
     {
@@ -165,7 +388,23 @@ static int real_vload_model(context_t exec_context, const char* model_name, cons
             file_list.emplace_back(file);
         }
 
-        if(!serializer->LoadModel(file_list, static_graph) || !CheckGraphIntegraity(static_graph))
+        cache_file = get_cache_file(model_format, file_list);
+
+        StaticGraph* cached_graph = nullptr;
+
+        if(!cache_file.empty())
+            cached_graph = load_cached_model(model_name, model_format, file_list[0], cache_file);
+
+        if(cached_graph)
+        {
+            delete static_graph;
+
+            static_graph = cached_graph;
+            static_graph->exec_context = exec_context;
+
+            cache_file.clear();
+        }
+        else if(!serializer->LoadModel(file_list, static_graph) || !CheckGraphIntegraity(static_graph))
         {
             delete static_graph;
             return -1;
@@ -197,13 +436,19 @@ static int real_vload_model(context_t exec_context, const char* model_name, cons
 
     va_end(argp);
 
-    if(!StaticGraphManager::Add(std::string(model_name), StaticGraphPtr(static_graph)))
+    StaticGraphPtr static_graph_ptr(static_graph);
+
+    if(!StaticGraphManager::Add(std::string(model_name), static_graph_ptr))
     {
         XLOG_ERROR() << "replicated model name detected: " << model_name << " should not happen\n";
         set_tengine_errno(EBADSLT);
         return -1;
     }
 
+    /* converted now: the next loads of the files read the tmfile */
+    if(!cache_file.empty())
+        save_cached_model(model_name, static_graph_ptr, cache_file);
+
     return 0;
 }
 
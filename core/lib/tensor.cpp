@@ -94,10 +94,25 @@ void Tensor::FreeMem(void)
             std::free(static_tensor_->mem_addr);
 
         static_tensor_->mem_addr = nullptr;
+        static_tensor_->lazy_src = nullptr;
+        static_tensor_->loaded_addr = nullptr;
         static_tensor_ = nullptr;
     }
 }
 
+void* Tensor::LoadStaticMem(void) const
+{
+    return static_tensor_->Load();
+}
+
+void* Tensor::GetLoadedMemAddr(void) const
+{
+    if(mem_addr_ || static_tensor_ == nullptr)
+        return mem_addr_;
+
+    return static_tensor_->GetLoaded();
+}
+
 void Tensor::BindStaticTensor(StaticConstTensor* static_tensor)
 {
     static_tensor_ = static_tensor;
@@ -0,0 +1,209 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include "trace_event.hpp"
+
+namespace TEngine {
+
+std::atomic<bool> Tracer::enabled_(false);
+std::atomic<uint64_t> Tracer::next_(0);
+TraceSlot* Tracer::slot_buf_ = nullptr;
+uint64_t Tracer::mask_ = 0;
+
+static thread_local const char* trace_context = nullptr;
+static thread_local int trace_tid = 0;
+
+static const char* category_name[TRACE_CATEGORY_NUM] = {"graph", "node", "task", "dispatch", "wait"};
+
+bool Tracer::Start(int event_number)
+{
+    if(Enabled())
+        return false;
+
+    if(event_number <= 0)
+        event_number = TRACE_DEFAULT_EVENT_NUM;
+
+    uint64_t size = 1;
+
+    while(size < ( uint64_t )event_number)
+        size <<= 1;
+
+    if(slot_buf_ == nullptr || size != mask_ + 1)
+    {
+        delete[] slot_buf_;
+
+        slot_buf_ = new TraceSlot[size];
+        mask_ = size - 1;
+    }
+
+    for(uint64_t i = 0; i <= mask_; i++)
+        slot_buf_[i].seq.store(0, std::memory_order_relaxed);
+
+    next_.store(0, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_release);
+
+    return true;
+}
+
+bool Tracer::Stop(void)
+{
+    return enabled_.exchange(false);
+}
+
+uint64_t Tracer::Now(void)
+{
+    struct timespec tm;
+
+    clock_gettime(CLOCK_MONOTONIC, &tm);
+
+    return tm.tv_sec * 1000000000UL + tm.tv_nsec;
+}
+
+void Tracer::Record(int category, const char* name, uint64_t start)
+{
+    uint64_t end = Now();
+
+    if(!Enabled())
+        return;
+
+    if(trace_tid == 0)
+        trace_tid = syscall(SYS_gettid);
+
+    uint64_t idx = next_.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot* slot = &slot_buf_[idx & mask_];
+    TraceEvent* event = &slot->event;
+
+    slot->seq.store(0, std::memory_order_relaxed);
+
+    event->start = start;
+    event->dur = end - start;
+    event->tid = trace_tid;
+    event->cpu = sched_getcpu();
+    event->category = category;
+
+    std::strncpy(event->name, name ? name : "", TRACE_NAME_SIZE - 1);
+    event->name[TRACE_NAME_SIZE - 1] = 0;
+
+    slot->seq.store(idx + 1, std::memory_order_release);
+}
+
+void Tracer::SetContext(const char* name)
+{
+    trace_context = name;
+}
+
+const char* Tracer::GetContext(void)
+{
+    return trace_context;
+}
+
+static void write_json_string(FILE* fp, const char* str)
+{
+    std::fputc('"', fp);
+
+    for(; *str; str++)
+    {
+        unsigned char c = *str;
+
+        if(c == '"' || c == '\\')
+            std::fprintf(fp, "\\%c", c);
+        else if(c < 0x20)
+            std::fprintf(fp, "\\u%04x", c);
+        else
+            std::fputc(c, fp);
+    }
+
+    std::fputc('"', fp);
+}
+
+bool Tracer::Dump(const char* file_name)
+{
+    if(slot_buf_ == nullptr)
+        return false;
+
+    FILE* fp = std::fopen(file_name, "w");
+
+    if(fp == nullptr)
+        return false;
+
+    /* copy the events completely written, skip the slots being written */
+    std::vector<TraceEvent> events(mask_ + 1);
+    int number = 0;
+
+    for(uint64_t i = 0; i <= mask_; i++)
+    {
+        TraceSlot* slot = &slot_buf_[i];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+
+        if(seq == 0)
+            continue;
+
+        events[number] = slot->event;
+
+        if(slot->seq.load(std::memory_order_acquire) != seq)
+            continue;
+
+        number++;
+    }
+
+    std::sort(events.begin(), events.begin() + number,
+              [](const TraceEvent& a, const TraceEvent& b) { return a.start < b.start; });
+
+    uint64_t base = number ? events[0].start : 0;
+    int pid = getpid();
+
+    std::fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    for(int i = 0; i < number; i++)
+    {
+        const TraceEvent& e = events[i];
+
+        std::fprintf(fp, "{\"name\": ");
+        write_json_string(fp, e.name);
+        std::fprintf(fp,
+                     ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d, "
+                     "\"args\": {\"cpu\": %d}}%s\n",
+                     category_name[e.category], (e.start - base) / 1000.0, e.dur / 1000.0, pid, e.tid, e.cpu,
+                     i + 1 < number ? "," : "");
+    }
+
+    std::fprintf(fp, "]}\n");
+
+    bool ret = !std::ferror(fp);
+
+    std::fclose(fp);
+
+    return ret;
+}
+
+}    // namespace TEngine
@@ -174,15 +174,11 @@ bool CPUDriver::SyncRun(Device* dev, void* graph_handle)
 
 void CPUDriver::PushGraph(CPUDevice* cpu_dev, DevContext* context)
 {
-    std::vector<cpu_task> task_list;
-
     cpu_task task;
 
     task.context = context;
 
-    task_list.emplace_back(task);
-
-    cpu_dev->PushMasterTask(task_list);
+    cpu_dev->PushMasterTask(task);
 }
 
 bool CPUDriver::Run(Device* dev, void* graph_handle)
@@ -381,11 +377,19 @@ void CPUDriver::InitGraphAttrIO(void)
     auto f3 = std::bind(&CPUDriver::OnGetNodeDumpAttr, this, std::placeholders::_1, std::placeholders::_2,
                         std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
 
+    auto f4 = std::bind(&CPUDriver::OnSetLatencyAttr, this, std::placeholders::_1, std::placeholders::_2,
+                        std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+
+    auto f5 = std::bind(&CPUDriver::OnGetLatencyAttr, this, std::placeholders::_1, std::placeholders::_2,
+                        std::placeholders::_3, std::placeholders::_4, std::placeholders::_5);
+
     set_attr_table_[ATTR_GRAPH_PERF_STAT] = f0;
     set_attr_table_[ATTR_GRAPH_NODE_DUMP] = f2;
+    set_attr_table_[ATTR_NODE_LATENCY_STAT] = f4;
 
     get_attr_table_[ATTR_GRAPH_PERF_STAT] = f1;
     get_attr_table_[ATTR_GRAPH_NODE_DUMP] = f3;
+    get_attr_table_[ATTR_NODE_LATENCY_STAT] = f5;
 }
 
 bool CPUDriver::OnSetGraphAttr(DevContext* context, Subgraph* graph, const char* attr_name, const void* val, int size)
@@ -461,7 +465,10 @@ bool CPUDriver::OnGetGraphPerfAttr(DevContext* context, Subgraph* graph, const c
 
     CPUDevice* dev = context->dev;
 
-    msg->ret_number = dev->GetGraphPerfStat(graph, msg->buf, msg->buf_size);
+    if(msg->action == GRAPH_PERF_STAT_GET_COUNTER)
+        msg->ret_number = dev->GetGraphPerfCounter(graph, ( struct perf_counter_info** )msg->buf, msg->buf_size);
+    else
+        msg->ret_number = dev->GetGraphPerfStat(graph, ( struct perf_info** )msg->buf, msg->buf_size);
 
     if(msg->ret_number >= 0)
         return true;
@@ -533,6 +540,41 @@ bool CPUDriver::OnSetGraphPerfAttr(DevContext* context, Subgraph* graph, const c
     return dev->SetGraphPerfStat(graph, msg->action);
 }
 
+bool CPUDriver::OnGetLatencyAttr(DevContext* context, Subgraph* graph, const char* name, void* buf, int size)
+{
+    if(size != sizeof(NodeLatencyMsg))
+    {
+        set_tengine_errno(EINVAL);
+        return false;
+    }
+
+    NodeLatencyMsg* msg = ( NodeLatencyMsg* )(buf);
+
+    CPUDevice* dev = context->dev;
+
+    msg->ret_number = dev->GetLatencyStat(graph, msg->buf, msg->buf_size);
+
+    if(msg->ret_number >= 0)
+        return true;
+    else
+        return false;
+}
+
+bool CPUDriver::OnSetLatencyAttr(DevContext* context, Subgraph* graph, const char* name, const void* buf, int size)
+{
+    if(size != sizeof(NodeLatencyMsg))
+    {
+        set_tengine_errno(EINVAL);
+        return false;
+    }
+
+    const NodeLatencyMsg* msg = ( const NodeLatencyMsg* )(buf);
+
+    CPUDevice* dev = context->dev;
+
+    return dev->SetLatencyStat(graph, msg->action);
+}
+
 /************************************/
 
 struct default_cpu_param
@@ -41,6 +41,8 @@
 #include "worker_thread.hpp"
 
 #include "graph_perf.hpp"
+#include "trace_event.hpp"
+#include "perf_counter.hpp"
 
 namespace TEngine {
 
@@ -120,6 +122,21 @@ public:
         return backend_runner_.GetGraphPerfStat(graph, buf, buf_size);
     }
 
+    int GetGraphPerfCounter(Subgraph* graph, struct perf_counter_info** buf, int buf_size)
+    {
+        return backend_runner_.GetGraphPerfCounter(graph, buf, buf_size);
+    }
+
+    bool SetLatencyStat(Subgraph* graph, int action)
+    {
+        return backend_runner_.SetLatencyStat(graph, action);
+    }
+
+    int GetLatencyStat(Subgraph* graph, struct latency_stat* buf, int buf_size)
+    {
+        return backend_runner_.GetLatencyStat(graph, buf, buf_size);
+    }
+
     void LaunchMaster(void)
     {
         auto f = std::bind(&CPUDevice::MasterProcess, this, std::placeholders::_1, std::placeholders::_2);
@@ -159,12 +176,17 @@ public:
 
     void WaitDone(void)
     {
+        uint64_t trace_start = Tracer::Enabled() ? Tracer::Now() : 0;
+
         std::unique_lock<std::mutex> lock(wait_mutex_);
 
         if(done_ != request_)
             wait_cv_.wait(lock, [this] { return done_ == request_; });
 
         lock.unlock();
+
+        if(trace_start)
+            Tracer::Record(TRACE_WAIT, Tracer::GetContext(), trace_start);
     }
 
     void IncRequest(int req_number)
@@ -190,14 +212,60 @@ public:
     {
         auto tr = aider_threads_[0];
 
+        if(Tracer::Enabled() || PerfCounter::GetContext())
+        {
+            PushProfiledTask(tr, task_list);
+            return true;
+        }
+
         tr->PushTask(task_list);
 
         return true;
     }
 
-    void PushMasterTask(std::vector<cpu_task>& task_list)
+    /*
+       the tasks trace themselves, named by the node dispatching them,
+       and count their cpu events into the record of the node
+     */
+    void PushProfiledTask(WorkerThread<sub_op_task>* tr, const std::vector<sub_op_task>& task_list)
+    {
+        bool trace = Tracer::Enabled();
+        uint64_t trace_start = trace ? Tracer::Now() : 0;
+        const char* context = Tracer::GetContext();
+        std::string name = context ? context : "";
+        struct perf_counter_info* counter = PerfCounter::GetContext();
+        std::vector<sub_op_task> profiled_list(task_list);
+
+        for(auto& task : profiled_list)
+        {
+            task_exec_t func = task.exec_func;
+
+            task.exec_func = [func, trace, name, counter](int cpu, int seq, void* data) {
+                uint64_t task_start = trace ? Tracer::Now() : 0;
+                uint64_t counter_start[PERF_COUNTER_NUM];
+                uint32_t counter_mask = counter ? PerfCounter::Read(counter_start) : 0;
+
+                bool ret = func(cpu, seq, data);
+
+                if(counter)
+                    PerfCounter::Accumulate(counter, counter_start, counter_mask);
+
+                if(trace)
+                    Tracer::Record(TRACE_TASK, name.c_str(), task_start);
+
+                return ret;
+            };
+        }
+
+        tr->PushTask(profiled_list);
+
+        if(trace)
+            Tracer::Record(TRACE_DISPATCH, name.c_str(), trace_start);
+    }
+
+    void PushMasterTask(const cpu_task& task)
     {
-        master_thread_->PushTask(task_list);
+        master_thread_->PushTask(task);
     }
 
     void KillMaster(void)
@@ -402,6 +470,10 @@ protected:
 
     bool OnSetGraphPerfAttr(DevContext* context, Subgraph* graph, const char* name, const void*, int);
 
+    bool OnGetLatencyAttr(DevContext* context, Subgraph* graph, const char* name, void*, int);
+
+    bool OnSetLatencyAttr(DevContext* context, Subgraph* graph, const char* name, const void*, int);
+
     std::unordered_map<std::string, CPUDevice*> device_table_;
     std::unordered_map<std::string, get_func_t> get_attr_table_;
     std::unordered_map<std::string, set_func_t> set_attr_table_;
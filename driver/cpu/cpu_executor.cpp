@@ -84,7 +84,8 @@ bool CPUExecutor::DevGetGraphAttr(void* graph_handle, const char* name, void* va
 
 bool CPUExecutor::DevRun(void* graph_handle)
 {
-    auto f = std::bind(&CPUExecutor::OnSubgraphDone, this, std::placeholders::_1, std::placeholders::_2);
+    /* a lambda capturing this only is stored in std::function without allocation */
+    auto f = [this](Graph* graph, bool exec_success) { OnSubgraphDone(graph, exec_success); };
 
     backend_dev_->SetGraphDoneHook(graph_handle, dev_graph_cb_t(f));
 
@@ -21,7 +21,13 @@
  * Copyright (c) 2018, Open AI Lab
  * Author: haitao@openailab.com
  */
+#include <string.h>
+
 #include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <memory>
+#include <condition_variable>
 
 #include "graph.hpp"
 #include "custom_kernel.hpp"
@@ -29,15 +35,31 @@
 #include "tensor_mem.hpp"
 #include "prof_utils.hpp"
 #include "prof_record.hpp"
+#include "trace_event.hpp"
+#include "perf_counter.hpp"
+#include "latency_stat.hpp"
+#include "mem_account.hpp"
 #include "graph_optimizer.hpp"
 #include "cpu_driver.hpp"
 #include "operator/convolution.hpp"
+#include "operator/pooling.hpp"
 #include "tengine_errno.hpp"
 
 namespace TEngine {
 
 #define ENABLE_TIME_PROFILING
 #define ATTR_GRAPH_PERF_BUFFER "GraphPerfStatBuf"
+#define ATTR_TILED_CHAIN "TiledChain"
+#define ATTR_TILED_CHAIN_LIST "TiledChainList"
+#define ATTR_NODE_LATENCY_BUF "NodeLatencyBuf"
+#define ATTR_NODE_MEM_RECORD "NodeMemRecord"
+#define ATTR_LAZY_PRERUN "LazyPrerun"
+
+/* a chain is tiled when the tensors inside it are bigger than this times L2 */
+#define TILED_CHAIN_MIN_RATIO 4
+
+/* the work done again on the tile halos, in percent, that makes tiles larger than L2 */
+#define TILED_CHAIN_MAX_REDO 25
 
 void DumpFloat(const char* fname, float* data, int number);
 
@@ -52,6 +74,10 @@ struct GraphPerfStatBuf
     int real_number;
     bool started;
 
+    /* the cpu event counters, by the same index as records */
+    bool counter_enabled;
+    std::vector<struct perf_counter_info> counters;
+
     void reset(void)
     {
         for(unsigned int i = 0; i < records.size(); i++)
@@ -62,6 +88,9 @@ struct GraphPerfStatBuf
             p_info->base = 1;    // 1ms
         }
 
+        for(unsigned int i = 0; i < counters.size(); i++)
+            memset(&counters.at(i), 0x0, sizeof(struct perf_counter_info));
+
         real_number = 0;
     }
 
@@ -69,9 +98,111 @@ struct GraphPerfStatBuf
     {
         reset();
         started = false;
+        counter_enabled = false;
+    }
+};
+
+/* always on latency of each node, by the index in seq_nodes */
+struct NodeLatencyBuf
+{
+    std::atomic<bool> enabled;
+    std::vector<LatencyHistogram> hist;
+
+    NodeLatencyBuf(int node_number) : enabled(true), hist(node_number) {}
+};
+
+/* where the memory of each node is charged, by the index in seq_nodes */
+struct NodeMemRecord
+{
+    MemAccount* account;
+    std::vector<MemRecord*> records;
+};
+
+/*
+   the nodes prepared in the run order on a thread of their own, while the
+   first run goes. Not for graphs of dynamic shape, reshaped by the run as
+   it goes.
+
+   Run() touches a node, its attrs and its NodeOps only once the ready flag
+   of the node is set, and waits for all the nodes before a reshape. The
+   state the worker shares with the running nodes:
+   - the scratch arena: Reserve() counts per thread under reserve_lock, and
+     only the running thread allocates the block, between two nodes
+   - the mem account: the records are atomic, the tag is per thread
+   - the input shapes and the const tensors, only read by both until a
+     reshape, which first waits for the worker
+   the Prerun() of a kernel must not touch anything else it shares with the
+   other nodes, as with parallel_prerun
+ */
+struct LazyPrerun
+{
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable cv;
+
+    /* one per seq_node: set once its Prerun() is done */
+    std::unique_ptr<std::atomic<bool>[]> ready;
+    unsigned int node_number;
+
+    std::atomic<bool> failed;
+    std::atomic<bool> stopped;
+
+    LazyPrerun(unsigned int number)
+        : ready(new std::atomic<bool>[number]), node_number(number), failed(false), stopped(false)
+    {
+        for(unsigned int i = 0; i < number; i++)
+            ready[i].store(false, std::memory_order_relaxed);
+    }
+
+    void SetReady(unsigned int idx)
+    {
+        lock.lock();
+        ready[idx].store(true, std::memory_order_release);
+        lock.unlock();
+
+        cv.notify_all();
+    }
+
+    void SetFailed(void)
+    {
+        lock.lock();
+        failed = true;
+        lock.unlock();
+
+        cv.notify_all();
+    }
+
+    /* false if the node, or one before it, failed */
+    bool Wait(unsigned int idx)
+    {
+        if(ready[idx].load(std::memory_order_acquire))
+            return true;
+
+        std::unique_lock<std::mutex> guard(lock);
+
+        cv.wait(guard, [&] { return failed || ready[idx].load(std::memory_order_acquire); });
+
+        return ready[idx].load(std::memory_order_acquire);
+    }
+
+    /* the worker goes in order: the last node is the last one ready */
+    bool WaitAll(void)
+    {
+        return Wait(node_number - 1);
     }
 };
 
+static bool has_dynamic_shape(Subgraph* sub_graph)
+{
+    for(auto node : sub_graph->seq_nodes)
+    {
+        if(node->IsDynamicShape())
+            return true;
+    }
+
+    return false;
+}
+
 struct MemPool
 {
     struct MemBlock
@@ -224,16 +355,165 @@ struct MemPool
     tensor_addr_t addr_map;
 };
 
+/*
+   tiled execution: a chain of conv/pool/activation nodes, adjacent in the run
+   order, each one reading only the output of the previous one, is run tile by
+   tile of the chain output. Going back along the chain, a tile grows by the
+   halo that the window of each node reads, and the pads of the node become
+   the part of its window out of the image. The tensors inside the chain only
+   keep the memory of a tile: their content is not the full result.
+ */
+struct TileWindow
+{
+    /* {h, w} */
+    int kernel[2];
+    int stride[2];
+    int pad[2];
+
+    /* the work of one output element */
+    float cost;
+};
+
+/* the part of a tensor in a tile: [start, end) of {h, w} */
+struct TileRange
+{
+    int start[2];
+    int end[2];
+};
+
+struct TiledChain
+{
+    std::vector<Node*> nodes;
+    std::vector<NodeOps*> node_ops;
+
+    /* tensors[0] is the chain input, tensors[i + 1] is the output of nodes[i] */
+    std::vector<Tensor*> tensors;
+    std::vector<std::vector<int>> full_dims;
+    std::vector<std::vector<int>> tile_dims;
+    std::vector<float*> tile_mem;
+    std::vector<int> tile_mem_size;
+
+    /* the window of nodes[i], and the param pads changed for each tile */
+    std::vector<TileWindow> window;
+    std::vector<std::vector<int>*> pads;
+    std::vector<std::vector<int>> full_pads;
+
+    /* of each tensor, in the tile being run */
+    std::vector<TileRange> range;
+
+    int tile_h;
+    int tile_w;
+    void* mem;
+};
+
+/* the input tensors released after node: a tiled chain reads its input until its last node */
+static void GetReleasedInputs(Node* node, std::vector<Tensor*>& tensors)
+{
+    TiledChain* chain = nullptr;
+
+    if(node->ExistAttr(ATTR_TILED_CHAIN))
+        chain = any_cast<TiledChain*>(node->GetAttr(ATTR_TILED_CHAIN));
+
+    tensors.clear();
+
+    for(unsigned int i = 0; i < node->GetInputNum(); i++)
+    {
+        Tensor* tensor = node->GetInputTensor(i);
+
+        if(chain && tensor == chain->tensors[0])
+            continue;
+
+        tensors.push_back(tensor);
+    }
+
+    if(chain && node == chain->nodes.back())
+        tensors.push_back(chain->tensors[0]);
+}
+
 bool debug_graph = false;
 
 bool CPURunner::Prerun(Subgraph* sub_graph)
 {
+    NodeMemRecord* mem_record = new NodeMemRecord();
+
+    mem_record->account = nullptr;
+    mem_record->records.resize(sub_graph->seq_nodes.size(), nullptr);
+
+    if(sub_graph->ExistAttr(ATTR_MEM_ACCOUNT))
+    {
+        MemAccount* account = any_cast<MemAccount*>(sub_graph->GetAttr(ATTR_MEM_ACCOUNT));
+
+        /* the records without memory are not reported */
+        for(unsigned int i = 0; i < sub_graph->seq_nodes.size(); i++)
+            mem_record->records[i] = account->GetRecord(sub_graph->seq_nodes[i]->GetName());
+
+        mem_record->account = account;
+    }
+
+    sub_graph->SetAttr(ATTR_NODE_MEM_RECORD, mem_record);
+
+    /* the buffers not owned by a node */
+    MemTag mem_tag(mem_record->account, nullptr, MEM_STAT_SCRATCH);
+
     if(!BindNodeOps(sub_graph))
         return false;
 
+    if(!SetTiledChains(sub_graph))
+        return false;
+
+    if(!SetBlockedLayout(sub_graph))
+        return false;
+
     if(!AllocateMem(sub_graph))
         return false;
 
+    NodeLatencyBuf* latency_buf = new NodeLatencyBuf(sub_graph->seq_nodes.size());
+
+    sub_graph->SetAttr(ATTR_NODE_LATENCY_BUF, latency_buf);
+
+    latency_lock_.lock();
+    latency_table_[sub_graph] = latency_buf;
+    latency_lock_.unlock();
+
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(sub_graph->GetAttr("exec_attr"));
+
+    if(exec_attr->lazy_prerun && sub_graph->seq_nodes.size() > 1 && !has_dynamic_shape(sub_graph))
+        return StartLazyPrerun(sub_graph);
+
+    if(!PrerunNodes(sub_graph))
+        return false;
+
+    ScratchArena* scratch_arena = any_cast<ScratchArena*>(sub_graph->GetAttr(ATTR_SCRATCH_ARENA));
+
+    /* all temporary memory needed by Run() is known now */
+    if(!scratch_arena->Allocate())
+    {
+        XLOG_ERROR() << "cannot allocate scratch memory: " << scratch_arena->max_node_size << " bytes\n";
+        return false;
+    }
+
+    return true;
+}
+
+/*
+   the Prerun() of the nodes: packing the weights and setting up the buffers
+   of a big model takes long on one core, and the nodes are prepared
+   independently, so the aider threads may take them from a shared index, the
+   biggest weights first.
+
+   opt-in with the exec attr parallel_prerun (PARALLEL_PRERUN=1): the Prerun()
+   of a kernel then runs next to the Prerun() of the others, and must not touch
+   state shared with them beyond the scratch reservations and the mem tags
+ */
+bool CPURunner::PrerunNodes(Subgraph* sub_graph)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(sub_graph->GetAttr("exec_attr"));
+    NodeMemRecord* mem_record = any_cast<NodeMemRecord*>(sub_graph->GetAttr(ATTR_NODE_MEM_RECORD));
+    ScratchArena* scratch_arena = any_cast<ScratchArena*>(sub_graph->GetAttr(ATTR_SCRATCH_ARENA));
+
+    /* weight bytes, node index */
+    std::vector<std::pair<long, int>> node_list;
+
     for(unsigned int i = 0; i < sub_graph->seq_nodes.size(); i++)
     {
         Node* node = sub_graph->seq_nodes[i];
@@ -241,15 +521,136 @@ bool CPURunner::Prerun(Subgraph* sub_graph)
         if(!node->ExistAttr(ATTR_NODE_OPS))
             continue;
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        long weight_size = 0;
 
-        if(!node_ops->Prerun(node))
-            return false;
+        for(unsigned int k = 0; k < node->GetInputNum(); k++)
+        {
+            Tensor* tensor = node->GetInputTensor(k);
+
+            if(tensor->GetType() == TENSOR_TYPE_CONST)
+                weight_size += tensor->GetTotalSize();
+        }
+
+        node_list.emplace_back(weight_size, i);
+    }
+
+    int cpu_number = cpu_info_->GetCPUNumber();
+    bool parallel = exec_attr->parallel_prerun && cpu_number > 1 && node_list.size() > 1;
+
+    if(parallel)
+        std::stable_sort(node_list.begin(), node_list.end(),
+                         [](const std::pair<long, int>& a, const std::pair<long, int>& b) { return a.first > b.first; });
+
+    std::atomic<unsigned int> next_node(0);
+    std::atomic<bool> failed(false);
+
+    auto prerun_func = [&](int cpu, int seq, void* data) {
+        unsigned int k;
+
+        while(!failed && (k = next_node.fetch_add(1)) < node_list.size())
+        {
+            int i = node_list[k].second;
+            Node* node = sub_graph->seq_nodes[i];
+            NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+            scratch_arena->BeginNode();
+
+            MemTag node_tag(mem_record->account, mem_record->records[i], MEM_STAT_PACKED_WEIGHT);
+
+            if(!node_ops->Prerun(node))
+                failed = true;
+        }
+
+        return true;
+    };
+
+    if(!parallel)
+        prerun_func(cpu_info_->GetMasterCPU(), 0, nullptr);
+    else
+    {
+        std::vector<sub_op_task> task_list(cpu_number);
+
+        for(int i = 0; i < cpu_number; i++)
+        {
+            task_list[i].exec_func = prerun_func;
+            task_list[i].seq = i;
+            task_list[i].data = nullptr;
+        }
+
+        cpu_dev_->PushAiderTask(task_list, -1);
+        cpu_dev_->WaitDone();
     }
 
+    return !failed;
+}
+
+/*
+   the first run starts without waiting for all the nodes: the worker reads
+   (a lazy loaded model reads its weights at the first use) and packs the
+   weights of a node while the nodes before it run, the scratch block grows
+   as the nodes are prepared
+ */
+bool CPURunner::StartLazyPrerun(Subgraph* sub_graph)
+{
+    NodeMemRecord* mem_record = any_cast<NodeMemRecord*>(sub_graph->GetAttr(ATTR_NODE_MEM_RECORD));
+    ScratchArena* scratch_arena = any_cast<ScratchArena*>(sub_graph->GetAttr(ATTR_SCRATCH_ARENA));
+    LazyPrerun* lazy = new LazyPrerun(sub_graph->seq_nodes.size());
+
+    sub_graph->SetAttr(ATTR_LAZY_PRERUN, lazy);
+
+    lazy->worker = std::thread([sub_graph, mem_record, scratch_arena, lazy]() {
+        std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+
+        for(unsigned int i = 0; i < seq_nodes.size() && !lazy->stopped; i++)
+        {
+            Node* node = seq_nodes[i];
+
+            if(node->ExistAttr(ATTR_NODE_OPS))
+            {
+                NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+                scratch_arena->BeginNode();
+
+                MemTag node_tag(mem_record->account, mem_record->records[i], MEM_STAT_PACKED_WEIGHT);
+
+                if(!node_ops->Prerun(node))
+                {
+                    XLOG_ERROR() << "Prerun failed for node: " << node->GetName() << "\n";
+
+                    lazy->SetFailed();
+
+                    return;
+                }
+            }
+
+            lazy->SetReady(i);
+        }
+    });
+
     return true;
 }
 
+/* stop the worker: if prepared is given, it tells the seq_nodes prepared */
+static void stop_lazy_prerun(Subgraph* sub_graph, std::vector<bool>* prepared = nullptr)
+{
+    LazyPrerun* lazy = any_cast<LazyPrerun*>(sub_graph->GetAttr(ATTR_LAZY_PRERUN));
+
+    lazy->stopped = true;
+    lazy->worker.join();
+
+    if(prepared)
+    {
+        prepared->resize(lazy->node_number);
+
+        for(unsigned int i = 0; i < lazy->node_number; i++)
+            (*prepared)[i] = lazy->ready[i].load();
+    }
+
+    delete lazy;
+
+    sub_graph->RemoveAttr(ATTR_LAZY_PRERUN);
+}
+
 #ifdef ENABLE_TIME_PROFILING
 
 static void parse_node(void* data, int repeat_count, uint64_t total_time)
@@ -308,6 +709,14 @@ bool CPURunner::Run(Subgraph* sub_graph)
 {
     std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
 
+    /* constructed once: the attribute lookups below should not allocate in each run */
+    static const std::string perf_buffer_attr(ATTR_GRAPH_PERF_BUFFER);
+    static const std::string scratch_arena_attr(ATTR_SCRATCH_ARENA);
+    static const std::string tiled_chain_attr(ATTR_TILED_CHAIN);
+    static const std::string latency_buf_attr(ATTR_NODE_LATENCY_BUF);
+    static const std::string mem_record_attr(ATTR_NODE_MEM_RECORD);
+    static const std::string lazy_prerun_attr(ATTR_LAZY_PRERUN);
+
 #ifdef ENABLE_TIME_PROFILING
     ProfRecord* prof = nullptr;
 
@@ -331,18 +740,35 @@ bool CPURunner::Run(Subgraph* sub_graph)
 #endif
     bool ret = true;
 
+    bool do_trace = Tracer::Enabled();
+    uint64_t graph_trace_start = do_trace ? Tracer::Now() : 0;
+
     sub_graph->Lock();    // sync with graph perf start/stop/get
 
     GraphPerfStatBuf* p_perf_stat = nullptr;
     int perf_record_idx = 0;
+    bool do_counter = false;
+
+    ScratchArena* scratch_arena = any_cast<ScratchArena*>(sub_graph->GetAttr(scratch_arena_attr));
+    NodeLatencyBuf* latency_buf = any_cast<NodeLatencyBuf*>(sub_graph->GetAttr(latency_buf_attr));
+    NodeMemRecord* mem_record = any_cast<NodeMemRecord*>(sub_graph->GetAttr(mem_record_attr));
+    LazyPrerun* lazy = nullptr;
 
-    if(sub_graph->ExistAttr(ATTR_GRAPH_PERF_BUFFER))
+    if(sub_graph->ExistAttr(lazy_prerun_attr))
+        lazy = any_cast<LazyPrerun*>(sub_graph->GetAttr(lazy_prerun_attr));
+
+    /* one clock read per node: a node ends when the next starts */
+    bool do_latency = latency_buf->enabled.load(std::memory_order_relaxed);
+    uint64_t node_start = do_latency ? LatencyHistogram::Now() : 0;
+
+    if(sub_graph->ExistAttr(perf_buffer_attr))
     {
-        GraphPerfStatBuf* stat = any_cast<GraphPerfStatBuf>(&sub_graph->GetAttr(ATTR_GRAPH_PERF_BUFFER));
+        GraphPerfStatBuf* stat = any_cast<GraphPerfStatBuf>(&sub_graph->GetAttr(perf_buffer_attr));
 
         if(stat->started)
         {
             p_perf_stat = stat;
+            do_counter = stat->counter_enabled;
         }
     }
 
@@ -350,11 +776,77 @@ bool CPURunner::Run(Subgraph* sub_graph)
     {
         Node* node = seq_nodes[i];
 
+        /* the worker may be still in the Prerun() of the node, which sets its attrs */
+        if(lazy && !lazy->Wait(i))
+        {
+            XLOG_ERROR() << "node: " << node->GetName() << " is not prepared\n";
+            ret = false;
+            break;
+        }
+
         if(!node->ExistAttr(ATTR_NODE_OPS))
             continue;
 
         NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
 
+        /* the reshape below changes the shapes the worker reads: let it finish first */
+        if(lazy && node->InputReshaped())
+        {
+            MemTag arena_tag(mem_record->account, nullptr, MEM_STAT_SCRATCH);
+
+            bool ready = lazy->WaitAll();
+
+            stop_lazy_prerun(sub_graph);
+            lazy = nullptr;
+
+            if(!ready || !scratch_arena->Allocate())
+            {
+                XLOG_ERROR() << "node: " << node->GetName() << " is not prepared\n";
+                ret = false;
+                break;
+            }
+        }
+
+        /* a tiled chain runs all its nodes at the first one */
+        TiledChain* chain = nullptr;
+
+        if(node->ExistAttr(tiled_chain_attr))
+        {
+            chain = any_cast<TiledChain*>(node->GetAttr(tiled_chain_attr));
+
+            if(node != chain->nodes[0])
+                continue;
+
+            /* the tiles were planned for the old shape: run the nodes one by one */
+            if(node->InputReshaped())
+            {
+                RemoveTiledChain(chain);
+                chain = nullptr;
+            }
+        }
+
+        /* the rest of the chain may be still being prepared */
+        if(lazy)
+        {
+            unsigned int last = i;
+
+            if(chain)
+                last = std::find(seq_nodes.begin() + i, seq_nodes.end(), chain->nodes.back()) - seq_nodes.begin();
+
+            /* the block is not owned by a node, as in Prerun() */
+            MemTag arena_tag(mem_record->account, nullptr, MEM_STAT_SCRATCH);
+
+            if(!lazy->Wait(last) || !scratch_arena->Allocate())
+            {
+                XLOG_ERROR() << "node: " << node->GetName() << " is not prepared\n";
+                ret = false;
+                break;
+            }
+        }
+
+        /* what the node allocates while running is scratch, but the reshaped outputs */
+        MemTag mem_tag(mem_record->account, mem_record->records[i], MEM_STAT_SCRATCH);
+
         /* dynamic shape process */
         if(node->IsDynamicShape() || node->InputReshaped())
         {
@@ -440,15 +932,21 @@ bool CPURunner::Run(Subgraph* sub_graph)
 
                 if(mem_size < total_size)
                 {
+                    MemTag output_tag(MEM_STAT_ACTIVATION);
+
                     void* tensor_addr = mem_alloc(total_size);
                     set_tensor_mem(tensor, tensor_addr, total_size, mem_free);
                 }
             }
 
             /* call the Reshape() to prepare for run */
+            scratch_arena->BeginNode();
             node_ops->Reshape(node);
+            scratch_arena->Allocate();
         }
 
+        scratch_arena->Reset();
+
 #ifdef ENABLE_TIME_PROFILING
         if(do_prof)
             prof->Start(i, node);
@@ -456,10 +954,50 @@ bool CPURunner::Run(Subgraph* sub_graph)
         unsigned long start_time = 0;
         unsigned long end_time = 0;
 
+        struct perf_counter_info* p_counter = nullptr;
+        uint64_t counter_start[PERF_COUNTER_NUM];
+        uint32_t counter_mask = 0;
+
+        if(do_counter)
+        {
+            p_counter = &p_perf_stat->counters.at(perf_record_idx);
+            counter_mask = PerfCounter::Read(counter_start);
+
+            PerfCounter::SetContext(p_counter);
+        }
+
         if(p_perf_stat)
             start_time = get_cur_time();
 
-        if(!node_ops->Run(node))
+        uint64_t trace_start = 0;
+
+        if(do_trace)
+        {
+            trace_start = Tracer::Now();
+            Tracer::SetContext(node->GetName().c_str());
+        }
+
+        bool run_ok;
+
+        if(chain)
+            run_ok = RunTiledChain(chain, scratch_arena);
+        else
+            run_ok = node_ops->Run(node);
+
+        if(do_trace)
+        {
+            Tracer::Record(TRACE_NODE, node->GetName().c_str(), trace_start);
+            Tracer::SetContext(nullptr);
+        }
+
+        /* the aider threads have added theirs */
+        if(p_counter)
+        {
+            PerfCounter::Accumulate(p_counter, counter_start, counter_mask);
+            PerfCounter::SetContext(nullptr);
+        }
+
+        if(!run_ok)
         {
             Operator* op = node->GetOp();
             LOG_ERROR() << "Failed to execute on: " << node->GetName() << " Op: " << op->GetName() << std::endl;
@@ -467,6 +1005,14 @@ bool CPURunner::Run(Subgraph* sub_graph)
             break;
         }
 
+        if(do_latency)
+        {
+            uint64_t node_end = LatencyHistogram::Now();
+
+            latency_buf->hist[i].Record(node_end - node_start);
+            node_start = node_end;
+        }
+
 //#define DUMP_NODE_OUTPUT
 #ifdef DUMP_NODE_OUTPUT
         {
@@ -508,12 +1054,27 @@ bool CPURunner::Run(Subgraph* sub_graph)
             p_info->name = node->GetName().c_str();
             p_info->dev_name = cpu_dev_->GetName().c_str();
 
+            if(p_counter)
+            {
+                p_counter->count++;
+                p_counter->total_time += off;
+                p_counter->name = p_info->name;
+                p_counter->dev_name = p_info->dev_name;
+            }
+
             perf_record_idx++;
             p_perf_stat->real_number = perf_record_idx;
         }
     }
 
+    /* all the nodes are prepared: the worker is done */
+    if(lazy && ret)
+        stop_lazy_prerun(sub_graph);
+
     sub_graph->Unlock();    // sync with graph perf start/stop/get
+
+    if(do_trace)
+        Tracer::Record(TRACE_GRAPH, sub_graph->GetName().c_str(), graph_trace_start);
 #if 0
 
 	std::printf("master cpu: %d run subgraph: %s --  %s\n",cpu_info_->GetMasterCPU(),
@@ -526,11 +1087,19 @@ bool CPURunner::Run(Subgraph* sub_graph)
 bool CPURunner::Postrun(Subgraph* sub_graph)
 {
     std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+    std::vector<bool> prepared(seq_nodes.size(), true);
+
+    /* not run to the end: the nodes after the worker stopped were not prepared */
+    if(sub_graph->ExistAttr(ATTR_LAZY_PRERUN))
+        stop_lazy_prerun(sub_graph, &prepared);
 
     for(unsigned int i = 0; i < seq_nodes.size(); i++)
     {
         Node* node = seq_nodes[i];
 
+        if(!prepared[i])
+            continue;
+
         if(!node->ExistAttr(ATTR_NODE_OPS))
             continue;
 
@@ -654,32 +1223,91 @@ bool CPURunner::FreeMem(Subgraph* sub_graph)
         sub_graph->RemoveAttr("shared_temp_memory");
     }
 
-    MemPool* mem_pool = any_cast<MemPool*>(sub_graph->GetAttr("MemPool"));
-    delete mem_pool;
-
-    sub_graph->RemoveAttr("MemPool");
-
-    return true;
-}
+    if(sub_graph->ExistAttr(ATTR_NODE_MEM_RECORD))
+    {
+        delete any_cast<NodeMemRecord*>(sub_graph->GetAttr(ATTR_NODE_MEM_RECORD));
 
-bool CPURunner::UnbindNodeOps(Subgraph* sub_graph)
-{
-    std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+        sub_graph->RemoveAttr(ATTR_NODE_MEM_RECORD);
+    }
 
-    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    if(sub_graph->ExistAttr(ATTR_NODE_LATENCY_BUF))
     {
-        Node* node = seq_nodes[i];
+        NodeLatencyBuf* latency_buf = any_cast<NodeLatencyBuf*>(sub_graph->GetAttr(ATTR_NODE_LATENCY_BUF));
 
-        if(!node->ExistAttr(ATTR_NODE_OPS))
-            continue;
+        latency_lock_.lock();
+        latency_table_.erase(sub_graph);
+        latency_lock_.unlock();
 
-        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+        delete latency_buf;
 
-        node_ops->OnUnbind(node);
+        sub_graph->RemoveAttr(ATTR_NODE_LATENCY_BUF);
+    }
 
-        node_ops->Release();
+    /* a failed Prerun may stop before the memory is allocated */
+    if(sub_graph->ExistAttr("MemPool"))
+    {
+        MemPool* mem_pool = any_cast<MemPool*>(sub_graph->GetAttr("MemPool"));
+        delete mem_pool;
 
-        node->RemoveAttr(ATTR_NODE_OPS);
+        sub_graph->RemoveAttr("MemPool");
+    }
+
+    if(sub_graph->ExistAttr(ATTR_TILED_CHAIN_LIST))
+    {
+        std::vector<TiledChain*>* chain_list =
+            any_cast<std::vector<TiledChain*>>(&sub_graph->GetAttr(ATTR_TILED_CHAIN_LIST));
+
+        for(unsigned int i = 0; i < chain_list->size(); i++)
+        {
+            TiledChain* chain = chain_list->at(i);
+
+            RemoveTiledChain(chain);
+            mem_free(chain->mem);
+
+            delete chain;
+        }
+
+        sub_graph->RemoveAttr(ATTR_TILED_CHAIN_LIST);
+    }
+
+    if(!sub_graph->ExistAttr(ATTR_SCRATCH_ARENA))
+        return true;
+
+    ScratchArena* scratch_arena = any_cast<ScratchArena*>(sub_graph->GetAttr(ATTR_SCRATCH_ARENA));
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if(node->ExistAttr(ATTR_NODE_OPS))
+            any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS))->SetScratchArena(nullptr);
+    }
+
+    delete scratch_arena;
+
+    sub_graph->RemoveAttr(ATTR_SCRATCH_ARENA);
+
+    return true;
+}
+
+bool CPURunner::UnbindNodeOps(Subgraph* sub_graph)
+{
+    std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if(!node->ExistAttr(ATTR_NODE_OPS))
+            continue;
+
+        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+        node_ops->OnUnbind(node);
+
+        node_ops->Release();
+
+        node->RemoveAttr(ATTR_NODE_OPS);
     }
 
     return true;
@@ -691,6 +1319,9 @@ bool CPURunner::OptimizeGraph(Subgraph* optimized_graph)
     GraphOptimizerManager::RunOpt("ConvBN", optimized_graph);
     GraphOptimizerManager::RunOpt("ConvReLu", optimized_graph);
     GraphOptimizerManager::RunOpt("ConvReLu6", optimized_graph);
+    GraphOptimizerManager::RunOpt("DeconvReLu", optimized_graph);
+    GraphOptimizerManager::RunOpt("DeconvReLu6", optimized_graph);
+    GraphOptimizerManager::RunOpt("EltwiseReLu", optimized_graph);
 
     return true;
 }
@@ -706,6 +1337,8 @@ static void CalculateMemBlocks(std::vector<int>& mem_block, Subgraph* sub_graph)
     int max_active_num = 0;
     int active_num = 0;
 
+    std::vector<Tensor*> released;
+
     for(int i = 0; i < node_number; i++)
     {
         Node* node = seq_nodes[i];
@@ -731,9 +1364,11 @@ static void CalculateMemBlocks(std::vector<int>& mem_block, Subgraph* sub_graph)
             max_active_num = active_num;
 
         // second, reduce the active_num by  release input
-        for(unsigned int j = 0; j < node->GetInputNum(); j++)
+        GetReleasedInputs(node, released);
+
+        for(unsigned int j = 0; j < released.size(); j++)
         {
-            Tensor* tensor = node->GetInputTensor(j);
+            Tensor* tensor = released[j];
 
             if(tensor_map.count(tensor) == 0)
                 continue;
@@ -839,6 +1474,26 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
         // std::cout<<"max shared memory: "<<max_shared_mem_size<<"\n";
     }
 
+    /*
+       the scratch arena is sized by the reservations made in Prerun(),
+       and is allocated after all nodes have been prepared
+     */
+    ScratchArena* scratch_arena = new ScratchArena(mem_alloc, mem_free);
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if(!node->ExistAttr(ATTR_NODE_OPS))
+            continue;
+
+        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+        node_ops->SetScratchArena(scratch_arena);
+    }
+
+    sub_graph->SetAttr(ATTR_SCRATCH_ARENA, scratch_arena);
+
     /*
      *  now, calculate the maximum input and output memory blocks to run the graph
      */
@@ -847,10 +1502,18 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
 
     CalculateMemBlocks(mem_blocks, sub_graph);
 
-    MemPool* mem_pool = new MemPool(mem_blocks, mem_alloc, mem_free);
+    MemPool* mem_pool;
+
+    {
+        MemTag mem_tag(MEM_STAT_ACTIVATION);
+
+        mem_pool = new MemPool(mem_blocks, mem_alloc, mem_free);
+    }
 
     sub_graph->SetAttr("MemPool", mem_pool);
 
+    std::vector<Tensor*> released;
+
     /*
      *  Real allocate memory
      *
@@ -872,7 +1535,8 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
 
             int input_idx = -1;
 
-            if(node->ExistAttr(ATTR_INPLACE))
+            /* the input of the last node in a tiled chain is a tile */
+            if(node->ExistAttr(ATTR_INPLACE) && !node->ExistAttr(ATTR_TILED_CHAIN))
             {
                 const inplace_t& inplace = any_cast<inplace_t>(node->GetAttr("inplace"));
 
@@ -904,11 +1568,10 @@ bool CPURunner::AllocateMem(Subgraph* sub_graph)
             }
         }
         /* input tensor */
-        for(unsigned int i = 0; i < node->GetInputNum(); i++)
-        {
-            Tensor* input_tensor = node->GetInputTensor(i);
-            mem_pool->Free(input_tensor);
-        }
+        GetReleasedInputs(node, released);
+
+        for(unsigned int i = 0; i < released.size(); i++)
+            mem_pool->Free(released[i]);
     }
 
     return true;
@@ -985,6 +1648,659 @@ bool CPURunner::BindNodeOps(Subgraph* sub_graph)
     return true;
 }
 
+/*
+   choose the internal tensors to be stored channel blocked.
+
+   a tensor may be blocked if it is a fp32 4D variable with a multiple of
+   BLOCKED_LAYOUT_C channels, is not a sub graph output, and its producer and
+   all its consumers are in this sub graph and support the blocked layout.
+   BLOCKED_LAYOUT_SAME nodes tie their 4D tensors into one group, which is
+   blocked only if every tensor of the group may be.
+
+   off unless the exec attr blocked_layout is set. a blocked tensor keeps its
+   NCHW shape: get_tensor_buffer() and the node dumps convert it back to NCHW
+ */
+bool CPURunner::SetBlockedLayout(Subgraph* sub_graph)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(sub_graph->GetAttr("exec_attr"));
+    bool enabled = exec_attr->blocked_layout && exec_attr->layout == TENGINE_LAYOUT_NCHW &&
+                   exec_attr->kernel_mode == EXEC_KERNEL_FP32;
+
+    std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+    std::unordered_map<Node*, int> support;
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if(!node->ExistAttr(ATTR_NODE_OPS))
+            continue;
+
+        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+        if(!enabled || node->IsDynamicShape() || node->ExistAttr(ATTR_TILED_CHAIN))
+            support[node] = BLOCKED_LAYOUT_NONE;
+        else
+            support[node] = node_ops->GetBlockedLayoutSupport(node);
+    }
+
+    std::unordered_set<Node*> output_nodes(sub_graph->output_nodes.begin(), sub_graph->output_nodes.end());
+
+    auto node_support = [&support](Node* node) {
+        auto ir = support.find(node);
+
+        return ir == support.end() ? BLOCKED_LAYOUT_NONE : ir->second;
+    };
+
+    auto tensor_allowed = [&node_support, &output_nodes](Tensor* tensor) {
+        const std::vector<int>& dims = tensor->GetShape().GetDim();
+
+        if(dims.size() != 4 || dims[1] % BLOCKED_LAYOUT_C || tensor->GetType() != TENSOR_TYPE_VAR ||
+           tensor->GetDataType() != TENGINE_DT_FP32)
+            return false;
+
+        if(tensor->producer == nullptr || node_support(tensor->producer->owner) == BLOCKED_LAYOUT_NONE)
+            return false;
+
+        /* the user reads the sub graph outputs */
+        if(output_nodes.count(tensor->producer->owner))
+            return false;
+
+        if(tensor->consumer.empty())
+            return false;
+
+        for(unsigned int i = 0; i < tensor->consumer.size(); i++)
+        {
+            if(node_support(tensor->consumer[i]->owner) == BLOCKED_LAYOUT_NONE)
+                return false;
+        }
+
+        return true;
+    };
+
+    /* union find over the 4D tensors */
+    std::unordered_map<Tensor*, Tensor*> parent;
+
+    std::function<Tensor*(Tensor*)> find_root = [&parent, &find_root](Tensor* tensor) {
+        Tensor* p = parent[tensor];
+
+        if(p == tensor)
+            return tensor;
+
+        p = find_root(p);
+        parent[tensor] = p;
+
+        return p;
+    };
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        Node* node = seq_nodes[i];
+
+        if(!node->ExistAttr(ATTR_NODE_OPS))
+            continue;
+
+        std::vector<Tensor*> group;
+
+        for(unsigned int j = 0; j < node->GetInputNum(); j++)
+            group.push_back(node->GetInputTensor(j));
+
+        for(unsigned int j = 0; j < node->GetOutputNum(); j++)
+            group.push_back(node->GetOutputTensor(j));
+
+        Tensor* root = nullptr;
+
+        for(unsigned int j = 0; j < group.size(); j++)
+        {
+            Tensor* tensor = group[j];
+
+            if(tensor == nullptr || tensor->GetShape().GetDim().size() != 4)
+                continue;
+
+            if(parent.count(tensor) == 0)
+                parent[tensor] = tensor;
+
+            if(node_support(node) != BLOCKED_LAYOUT_SAME)
+                continue;
+
+            if(root == nullptr)
+                root = find_root(tensor);
+            else
+                parent[find_root(tensor)] = root;
+        }
+    }
+
+    std::unordered_map<Tensor*, bool> group_allowed;
+
+    for(auto& ir : parent)
+    {
+        Tensor* root = find_root(ir.first);
+
+        if(group_allowed.count(root) == 0)
+            group_allowed[root] = true;
+
+        if(!tensor_allowed(ir.first))
+            group_allowed[root] = false;
+    }
+
+    for(auto& ir : parent)
+    {
+        Tensor* tensor = ir.first;
+
+        if(group_allowed[find_root(tensor)])
+            tensor->SetAttr(ATTR_BLOCKED_LAYOUT, BLOCKED_LAYOUT_C);
+        else if(tensor->ExistAttr(ATTR_BLOCKED_LAYOUT))
+            tensor->RemoveAttr(ATTR_BLOCKED_LAYOUT);
+    }
+
+    return true;
+}
+
+/* the window of node, a node that is neither conv nor pooling must keep the shape */
+static bool GetTileWindow(Node* node, TileWindow& window, std::vector<int>*& pads)
+{
+    Operator* op = node->GetOp();
+
+    if(op->GetName() == "Convolution")
+    {
+        ConvParam* param = dynamic_cast<Convolution*>(op)->GetParam();
+        int in_c = node->GetInputTensor(0)->GetShape().GetDim()[1];
+
+        window.kernel[0] = (param->kernel_h - 1) * param->dilation_h + 1;
+        window.kernel[1] = (param->kernel_w - 1) * param->dilation_w + 1;
+        window.stride[0] = param->stride_h;
+        window.stride[1] = param->stride_w;
+        window.cost = in_c / param->group * param->kernel_h * param->kernel_w;
+        pads = &param->pads;
+    }
+    else if(op->GetName() == "Pooling")
+    {
+        PoolParam* param = dynamic_cast<Pooling*>(op)->GetParam();
+
+        if(param->kernel_shape.size() < 2 || param->strides.size() < 2)
+            return false;
+
+        window.kernel[0] = param->kernel_shape[0];
+        window.kernel[1] = param->kernel_shape[1];
+        window.stride[0] = param->strides[0];
+        window.stride[1] = param->strides[1];
+        window.cost = window.kernel[0] * window.kernel[1];
+        pads = &param->pads;
+    }
+    else
+    {
+        for(int a = 0; a < 2; a++)
+        {
+            window.kernel[a] = 1;
+            window.stride[a] = 1;
+            window.pad[a] = 0;
+        }
+
+        window.cost = 1;
+        pads = nullptr;
+
+        return node->GetInputTensor(0)->GetShape().GetDim() == node->GetOutputTensor(0)->GetShape().GetDim();
+    }
+
+    if(pads->size() < 4)
+        return false;
+
+    /* each tile reads one row and one column at least */
+    for(int a = 0; a < 2; a++)
+    {
+        window.pad[a] = (*pads)[a];
+
+        if(window.stride[a] <= 0 || (*pads)[a] >= window.kernel[a] || (*pads)[a + 2] >= window.kernel[a])
+            return false;
+    }
+
+    return true;
+}
+
+/*
+   the rows and cols of each chain tensor in a tile of tile_h x tile_w outputs,
+   returns the work to run all the tiles, and the memory of one tile in mem_size
+ */
+static double GetTileCost(const TiledChain* chain, int tile_h, int tile_w, std::vector<int>& rows,
+                          std::vector<int>& cols, long& mem_size)
+{
+    int node_num = chain->nodes.size();
+    const std::vector<int>& out_dims = chain->full_dims[node_num];
+
+    rows.resize(node_num + 1);
+    cols.resize(node_num + 1);
+
+    rows[node_num] = tile_h;
+    cols[node_num] = tile_w;
+
+    for(int i = node_num - 1; i >= 0; i--)
+    {
+        const TileWindow& window = chain->window[i];
+
+        rows[i] = std::min((rows[i + 1] - 1) * window.stride[0] + window.kernel[0], chain->full_dims[i][2]);
+        cols[i] = std::min((cols[i + 1] - 1) * window.stride[1] + window.kernel[1], chain->full_dims[i][3]);
+    }
+
+    double work = 0;
+
+    mem_size = 0;
+
+    for(int i = 0; i <= node_num; i++)
+    {
+        const std::vector<int>& dims = chain->full_dims[i];
+        long size = ( long )dims[0] * dims[1] * rows[i] * cols[i];
+
+        mem_size += size * sizeof(float);
+
+        if(i > 0)
+            work += ( double )size * chain->window[i - 1].cost;
+    }
+
+    int tile_num = ((out_dims[2] + tile_h - 1) / tile_h) * ((out_dims[3] + tile_w - 1) / tile_w);
+
+    return work * tile_num;
+}
+
+static void GetTileCandidates(int size, std::vector<int>& list)
+{
+    for(int s = 1; s < size; s *= 2)
+        list.push_back(s);
+
+    list.push_back(size);
+}
+
+/* copy rows x cols of each plane, from (src_row, src_col) to (dst_row, dst_col) */
+static void copy_tile(const float* src, int src_h, int src_w, int src_row, int src_col, float* dst, int dst_h,
+                      int dst_w, int dst_row, int dst_col, int plane_num, int rows, int cols)
+{
+    for(int p = 0; p < plane_num; p++)
+    {
+        const float* s = src + (( long )p * src_h + src_row) * src_w + src_col;
+        float* d = dst + (( long )p * dst_h + dst_row) * dst_w + dst_col;
+
+        for(int r = 0; r < rows; r++)
+            memcpy(d + r * dst_w, s + r * src_w, sizeof(float) * cols);
+    }
+}
+
+TiledChain* CPURunner::CreateTiledChain(const std::vector<Node*>& nodes)
+{
+    int node_num = nodes.size();
+    TiledChain* chain = new TiledChain();
+
+    chain->nodes = nodes;
+    chain->tensors.push_back(nodes[0]->GetInputTensor(0));
+
+    for(int i = 0; i < node_num; i++)
+    {
+        Node* node = nodes[i];
+        TileWindow window;
+        std::vector<int>* pads;
+
+        GetTileWindow(node, window, pads);
+
+        chain->node_ops.push_back(any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS)));
+        chain->tensors.push_back(node->GetOutputTensor(0));
+        chain->window.push_back(window);
+        chain->pads.push_back(pads);
+        chain->full_pads.push_back(pads ? *pads : std::vector<int>());
+    }
+
+    long inner_size = 0;
+
+    for(int i = 0; i <= node_num; i++)
+    {
+        chain->full_dims.push_back(chain->tensors[i]->GetShape().GetDim());
+
+        if(i > 0 && i < node_num)
+            inner_size += chain->tensors[i]->GetTotalSize();
+    }
+
+    int l2_size = cpu_info_->GetL2Size(cpu_info_->GetMasterCPU());
+
+    if(l2_size <= 0)
+        l2_size = 512 << 10;
+
+    /* the tensors inside fit the cache already */
+    if(inner_size <= ( long )TILED_CHAIN_MIN_RATIO * l2_size)
+    {
+        delete chain;
+        return nullptr;
+    }
+
+    /*
+       the tile of least work whose memory fits in L2. When the halos make
+       too much work again, the budget is doubled for larger tiles.
+     */
+    const std::vector<int>& out_dims = chain->full_dims[node_num];
+    std::vector<int> h_list;
+    std::vector<int> w_list;
+    std::vector<int> rows;
+    std::vector<int> cols;
+    long mem_size;
+
+    GetTileCandidates(out_dims[2], h_list);
+    GetTileCandidates(out_dims[3], w_list);
+
+    double full_work = GetTileCost(chain, out_dims[2], out_dims[3], rows, cols, mem_size);
+    int tile_h = 0;
+    int tile_w = 0;
+
+    for(long budget = l2_size; budget < inner_size && tile_h == 0; budget *= 2)
+    {
+        double best_work = 0;
+
+        for(unsigned int h = 0; h < h_list.size(); h++)
+        {
+            for(unsigned int w = 0; w < w_list.size(); w++)
+            {
+                if(h_list[h] == out_dims[2] && w_list[w] == out_dims[3])
+                    continue;
+
+                double work = GetTileCost(chain, h_list[h], w_list[w], rows, cols, mem_size);
+
+                if(mem_size > budget || (tile_h && work >= best_work))
+                    continue;
+
+                tile_h = h_list[h];
+                tile_w = w_list[w];
+                best_work = work;
+            }
+        }
+
+        if(tile_h && best_work > full_work * (100 + TILED_CHAIN_MAX_REDO) / 100)
+            tile_h = 0;
+    }
+
+    if(tile_h == 0)
+    {
+        delete chain;
+        return nullptr;
+    }
+
+    chain->tile_h = tile_h;
+    chain->tile_w = tile_w;
+
+    GetTileCost(chain, tile_h, tile_w, rows, cols, mem_size);
+
+    /* an in-place node writes the tile of its input */
+    std::vector<bool> shared(node_num + 1, false);
+
+    for(int i = 0; i < node_num; i++)
+    {
+        Node* node = nodes[i];
+
+        if(node->ExistAttr(ATTR_INPLACE))
+        {
+            const inplace_t& inplace = any_cast<inplace_t>(node->GetAttr(ATTR_INPLACE));
+
+            shared[i + 1] = inplace.count(0) && inplace.at(0) == 0;
+        }
+    }
+
+    mem_size = 0;
+
+    for(int i = 0; i <= node_num; i++)
+    {
+        const std::vector<int>& dims = chain->full_dims[i];
+
+        chain->tile_mem_size.push_back(sizeof(float) * dims[0] * dims[1] * rows[i] * cols[i]);
+
+        if(!shared[i])
+            mem_size += chain->tile_mem_size[i];
+    }
+
+    chain->mem = mem_alloc(mem_size);
+
+    if(chain->mem == nullptr)
+    {
+        delete chain;
+        return nullptr;
+    }
+
+    float* tile_mem = ( float* )chain->mem;
+
+    for(int i = 0; i <= node_num; i++)
+    {
+        if(shared[i])
+        {
+            float* prev_mem = chain->tile_mem[i - 1];
+
+            chain->tile_mem.push_back(prev_mem);
+            continue;
+        }
+
+        chain->tile_mem.push_back(tile_mem);
+        tile_mem += chain->tile_mem_size[i] / sizeof(float);
+    }
+
+    chain->tile_dims = chain->full_dims;
+    chain->range.resize(node_num + 1);
+
+    /* the memory planner skips the tensors inside */
+    for(int i = 1; i < node_num; i++)
+        set_tensor_mem(chain->tensors[i], chain->tile_mem[i], chain->tile_mem_size[i], nullptr);
+
+    for(int i = 0; i < node_num; i++)
+        nodes[i]->SetAttr(ATTR_TILED_CHAIN, chain);
+
+    return chain;
+}
+
+void CPURunner::RemoveTiledChain(TiledChain* chain)
+{
+    for(unsigned int i = 0; i < chain->nodes.size(); i++)
+    {
+        Node* node = chain->nodes[i];
+
+        if(node->ExistAttr(ATTR_TILED_CHAIN))
+            node->RemoveAttr(ATTR_TILED_CHAIN);
+    }
+}
+
+bool CPURunner::SetTiledChains(Subgraph* sub_graph)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(sub_graph->GetAttr("exec_attr"));
+
+    if(!exec_attr->tiled_exec || exec_attr->layout != TENGINE_LAYOUT_NCHW ||
+       exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return true;
+
+    std::vector<Node*>& seq_nodes = sub_graph->seq_nodes;
+    std::unordered_set<Node*> output_nodes(sub_graph->output_nodes.begin(), sub_graph->output_nodes.end());
+
+    auto node_tileable = [](Node* node) {
+        if(node->IsDynamicShape())
+            return false;
+
+        if(node->GetInputNum() < 1 || node->GetOutputNum() != 1)
+            return false;
+
+        Tensor* input = node->GetInputTensor(0);
+        Tensor* output = node->GetOutputTensor(0);
+
+        if(input->GetType() == TENSOR_TYPE_CONST || input->GetShape().GetDim().size() != 4 ||
+           output->GetShape().GetDim().size() != 4 || input->GetDataType() != TENGINE_DT_FP32 ||
+           output->GetDataType() != TENGINE_DT_FP32)
+            return false;
+
+        for(unsigned int i = 1; i < node->GetInputNum(); i++)
+        {
+            if(node->GetInputTensor(i)->GetType() != TENSOR_TYPE_CONST)
+                return false;
+        }
+
+        TileWindow window;
+        std::vector<int>* pads;
+
+        if(!GetTileWindow(node, window, pads))
+            return false;
+
+        NodeOps* node_ops = any_cast<NodeOps*>(node->GetAttr(ATTR_NODE_OPS));
+
+        return node_ops->GetTiledRunSupport(node);
+    };
+
+    /* the nodes without ops, as the const ones, do not run */
+    std::vector<Node*> run_nodes;
+
+    for(unsigned int i = 0; i < seq_nodes.size(); i++)
+    {
+        if(seq_nodes[i]->ExistAttr(ATTR_NODE_OPS))
+            run_nodes.push_back(seq_nodes[i]);
+    }
+
+    std::vector<TiledChain*> chain_list;
+    unsigned int i = 0;
+
+    while(i < run_nodes.size())
+    {
+        std::vector<Node*> nodes;
+        unsigned int j = i;
+
+        for(; j < run_nodes.size() && node_tileable(run_nodes[j]); j++)
+        {
+            Node* node = run_nodes[j];
+
+            if(nodes.empty())
+            {
+                nodes.push_back(node);
+                continue;
+            }
+
+            /* the tensor between must be private to the chain */
+            Node* prev = nodes.back();
+            Tensor* tensor = prev->GetOutputTensor(0);
+
+            if(node->GetInputTensor(0) != tensor || tensor->consumer.size() != 1 || output_nodes.count(prev) ||
+               get_tensor_mem(tensor))
+                break;
+
+            nodes.push_back(node);
+        }
+
+        if(nodes.size() >= 2)
+        {
+            TiledChain* chain = CreateTiledChain(nodes);
+
+            if(chain)
+                chain_list.push_back(chain);
+        }
+
+        i = nodes.empty() ? i + 1 : j;
+    }
+
+    if(!chain_list.empty())
+        sub_graph->SetAttr(ATTR_TILED_CHAIN_LIST, chain_list);
+
+    return true;
+}
+
+bool CPURunner::RunTiledChain(TiledChain* chain, ScratchArena* scratch_arena)
+{
+    int node_num = chain->nodes.size();
+    Tensor* input = chain->tensors[0];
+    Tensor* output = chain->tensors[node_num];
+    const std::vector<int>& in_dims = chain->full_dims[0];
+    const std::vector<int>& out_dims = chain->full_dims[node_num];
+    const std::vector<int>& in_tile = chain->tile_dims[0];
+    const std::vector<int>& out_tile = chain->tile_dims[node_num];
+
+    const float* input_data = ( const float* )get_tensor_mem(input);
+    float* output_data = ( float* )get_tensor_mem(output);
+
+    /* the nodes see the chain input and output as tiles too */
+    void* in_mem = chain->tile_mem[0];
+    int in_mem_size = chain->tile_mem_size[0];
+    std::function<void(void*)> in_releaser;
+    void* out_mem = chain->tile_mem[node_num];
+    int out_mem_size = chain->tile_mem_size[node_num];
+    std::function<void(void*)> out_releaser;
+
+    input->SwapDataMem(in_mem, in_mem_size, in_releaser);
+    output->SwapDataMem(out_mem, out_mem_size, out_releaser);
+
+    bool ret = true;
+
+    for(int row = 0; row < out_dims[2] && ret; row += chain->tile_h)
+    {
+        for(int col = 0; col < out_dims[3] && ret; col += chain->tile_w)
+        {
+            TileRange& out_range = chain->range[node_num];
+
+            out_range.start[0] = row;
+            out_range.end[0] = std::min(row + chain->tile_h, out_dims[2]);
+            out_range.start[1] = col;
+            out_range.end[1] = std::min(col + chain->tile_w, out_dims[3]);
+
+            /* the part each node reads, and the part of its window out of the image */
+            for(int i = node_num - 1; i >= 0; i--)
+            {
+                const TileWindow& window = chain->window[i];
+                const TileRange& next = chain->range[i + 1];
+                TileRange& range = chain->range[i];
+
+                for(int a = 0; a < 2; a++)
+                {
+                    int low = next.start[a] * window.stride[a] - window.pad[a];
+                    int high = (next.end[a] - 1) * window.stride[a] - window.pad[a] + window.kernel[a];
+
+                    range.start[a] = std::max(low, 0);
+                    range.end[a] = std::min(high, chain->full_dims[i][2 + a]);
+
+                    if(chain->pads[i])
+                    {
+                        (*chain->pads[i])[a] = range.start[a] - low;
+                        (*chain->pads[i])[a + 2] = high - range.end[a];
+                    }
+                }
+            }
+
+            for(int i = 0; i <= node_num; i++)
+            {
+                const TileRange& range = chain->range[i];
+
+                chain->tile_dims[i][2] = range.end[0] - range.start[0];
+                chain->tile_dims[i][3] = range.end[1] - range.start[1];
+                chain->tensors[i]->GetShape().SetDim(chain->tile_dims[i]);
+            }
+
+            copy_tile(input_data, in_dims[2], in_dims[3], chain->range[0].start[0], chain->range[0].start[1],
+                      chain->tile_mem[0], in_tile[2], in_tile[3], 0, 0, in_dims[0] * in_dims[1], in_tile[2],
+                      in_tile[3]);
+
+            for(int i = 0; i < node_num; i++)
+            {
+                scratch_arena->Reset();
+
+                if(!chain->node_ops[i]->Run(chain->nodes[i]))
+                {
+                    LOG_ERROR() << "Failed to execute on: " << chain->nodes[i]->GetName() << " in a tiled chain\n";
+                    ret = false;
+                    break;
+                }
+            }
+
+            copy_tile(chain->tile_mem[node_num], out_tile[2], out_tile[3], 0, 0, output_data, out_dims[2],
+                      out_dims[3], row, col, out_dims[0] * out_dims[1], out_tile[2], out_tile[3]);
+        }
+    }
+
+    for(int i = 0; i < node_num; i++)
+    {
+        if(chain->pads[i])
+            *chain->pads[i] = chain->full_pads[i];
+    }
+
+    for(int i = 0; i <= node_num; i++)
+        chain->tensors[i]->GetShape().SetDim(chain->full_dims[i]);
+
+    input->SwapDataMem(in_mem, in_mem_size, in_releaser);
+    output->SwapDataMem(out_mem, out_mem_size, out_releaser);
+
+    return ret;
+}
+
 void CPURunner::AttachCPUDevice(CPUDevice* cpu_dev)
 {
     cpu_dev_ = cpu_dev;
@@ -1006,6 +2322,7 @@ bool CPURunner::SetGraphPerfStat(Subgraph* graph, int action)
             }
             break;
         case GRAPH_PERF_STAT_ENABLE:
+        case GRAPH_PERF_STAT_ENABLE_COUNTER:
             if(!graph->ExistAttr(ATTR_GRAPH_PERF_BUFFER))
             {
                 GraphPerfStatBuf buf;
@@ -1014,6 +2331,20 @@ bool CPURunner::SetGraphPerfStat(Subgraph* graph, int action)
 
                 graph->SetAttr(ATTR_GRAPH_PERF_BUFFER, buf);
             }
+
+            if(action == GRAPH_PERF_STAT_ENABLE_COUNTER)
+            {
+                GraphPerfStatBuf* buf = any_cast<GraphPerfStatBuf>(&graph->GetAttr(ATTR_GRAPH_PERF_BUFFER));
+
+                /* the records start from 0 at the next start */
+                if(!buf->counter_enabled && !buf->started)
+                {
+                    buf->counter_enabled = true;
+                    buf->records.clear();
+                }
+                else if(!buf->counter_enabled)
+                    ret = false;
+            }
             break;
         case GRAPH_PERF_STAT_START:
             if(!graph->ExistAttr(ATTR_GRAPH_PERF_BUFFER))
@@ -1028,6 +2359,10 @@ bool CPURunner::SetGraphPerfStat(Subgraph* graph, int action)
                 if(buf->records.size() == 0)
                 {
                     buf->records.resize(node_num);
+
+                    if(buf->counter_enabled)
+                        buf->counters.resize(node_num);
+
                     buf->reset();
                 }
 
@@ -1069,6 +2404,41 @@ bool CPURunner::SetGraphPerfStat(Subgraph* graph, int action)
     return ret;
 }
 
+int CPURunner::GetGraphPerfCounter(Subgraph* graph, struct perf_counter_info** buf, int buf_size)
+{
+    graph->Lock();
+
+    if(!graph->ExistAttr(ATTR_GRAPH_PERF_BUFFER))
+    {
+        graph->Unlock();
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    GraphPerfStatBuf* perf_buf = any_cast<GraphPerfStatBuf>(&graph->GetAttr(ATTR_GRAPH_PERF_BUFFER));
+
+    if(!perf_buf->counter_enabled)
+    {
+        graph->Unlock();
+        set_tengine_errno(EINVAL);
+        return -1;
+    }
+
+    int cpy_number = perf_buf->real_number;
+
+    if(cpy_number > buf_size)
+        cpy_number = buf_size;
+
+    for(int i = 0; i < cpy_number; i++)
+    {
+        buf[i] = &perf_buf->counters.at(i);
+    }
+
+    graph->Unlock();
+
+    return cpy_number;
+}
+
 int CPURunner::GetGraphPerfStat(Subgraph* graph, struct perf_info** buf, int buf_size)
 {
     graph->Lock();
@@ -1097,4 +2467,66 @@ int CPURunner::GetGraphPerfStat(Subgraph* graph, struct perf_info** buf, int buf
     return cpy_number;
 }
 
+bool CPURunner::SetLatencyStat(Subgraph* graph, int action)
+{
+    std::lock_guard<std::mutex> lock(latency_lock_);
+
+    if(latency_table_.count(graph) == 0)
+    {
+        set_tengine_errno(ENODATA);
+        return false;
+    }
+
+    NodeLatencyBuf* latency_buf = latency_table_.at(graph);
+
+    switch(action)
+    {
+        case LATENCY_STAT_DISABLE:
+            latency_buf->enabled = false;
+            break;
+        case LATENCY_STAT_ENABLE:
+            latency_buf->enabled = true;
+            break;
+        case LATENCY_STAT_RESET:
+            for(unsigned int i = 0; i < latency_buf->hist.size(); i++)
+                latency_buf->hist[i].Reset();
+            break;
+        default:
+            set_tengine_errno(EINVAL);
+            return false;
+    }
+
+    return true;
+}
+
+int CPURunner::GetLatencyStat(Subgraph* graph, struct latency_stat* buf, int buf_size)
+{
+    std::lock_guard<std::mutex> lock(latency_lock_);
+
+    if(latency_table_.count(graph) == 0)
+    {
+        set_tengine_errno(ENODATA);
+        return -1;
+    }
+
+    NodeLatencyBuf* latency_buf = latency_table_.at(graph);
+    int stat_number = 0;
+
+    /* the nodes run: the ones without ops and the tiled chain members after the first are not */
+    for(unsigned int i = 0; i < latency_buf->hist.size() && stat_number < buf_size; i++)
+    {
+        struct latency_stat* stat = &buf[stat_number];
+
+        latency_buf->hist[i].GetStat(stat);
+
+        if(stat->count == 0)
+            continue;
+
+        stat->name = graph->seq_nodes[i]->GetName().c_str();
+        stat_number++;
+    }
+
+    return stat_number;
+}
+
 }    // namespace TEngine
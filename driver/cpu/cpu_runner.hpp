@@ -27,14 +27,19 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 
 #include "node_ops.hpp"
 #include "graph_perf.hpp"
+#include "mem_account.hpp"
 
 namespace TEngine {
 
 class Graph;
 class CPUDevice;
+struct TiledChain;
+struct NodeLatencyBuf;
 
 using Subgraph = Graph;
 
@@ -43,6 +48,10 @@ class CPURunner
 public:
     bool SetGraphPerfStat(Subgraph* graph, int action);
     int GetGraphPerfStat(Subgraph* graph, struct perf_info** buf, int buf_size);
+    int GetGraphPerfCounter(Subgraph* graph, struct perf_counter_info** buf, int buf_size);
+
+    bool SetLatencyStat(Subgraph* graph, int action);
+    int GetLatencyStat(Subgraph* graph, struct latency_stat* buf, int buf_size);
 
     bool Prerun(Subgraph* sub_graph);
     bool Run(Subgraph* sub_graph);
@@ -53,6 +62,13 @@ public:
     void AttachCPUDevice(CPUDevice* cpu_dev);
 
     bool BindNodeOps(Subgraph* graph);
+    bool PrerunNodes(Subgraph* graph);
+    bool StartLazyPrerun(Subgraph* graph);
+    bool SetBlockedLayout(Subgraph* graph);
+    bool SetTiledChains(Subgraph* graph);
+    TiledChain* CreateTiledChain(const std::vector<Node*>& nodes);
+    void RemoveTiledChain(TiledChain* chain);
+    bool RunTiledChain(TiledChain* chain, ScratchArena* scratch_arena);
     bool AllocateMem(Subgraph* graph);
 
     bool FreeMem(Subgraph* graph);
@@ -62,8 +78,8 @@ public:
 
     CPURunner()
     {
-        mem_alloc = malloc;
-        mem_free = free;
+        mem_alloc = MemAccount::Alloc;
+        mem_free = MemAccount::Free;
     }
 
     ~CPURunner() {}
@@ -72,6 +88,13 @@ public:
     mem_free_t mem_free;
     CPUDevice* cpu_dev_;
     const CPUInfo* cpu_info_;
+
+    /*
+       the node latency histograms of the subgraphs: read without the subgraph lock,
+       which Run() holds for the whole run
+     */
+    std::mutex latency_lock_;
+    std::unordered_map<Subgraph*, NodeLatencyBuf*> latency_table_;
 };
 
 }    // namespace TEngine
@@ -0,0 +1,152 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counter.hpp"
+
+namespace TEngine {
+
+struct counter_event
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+/* by PERF_COUNTER_xxx */
+static const counter_event counter_events[PERF_COUNTER_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+
+struct ThreadCounter
+{
+    ThreadCounter(void)
+    {
+        leader = -1;
+        number = 0;
+        mask = 0;
+
+        /* one group: all the counters run over the same time */
+        for(int i = 0; i < PERF_COUNTER_NUM; i++)
+        {
+            struct perf_event_attr attr;
+
+            memset(&attr, 0, sizeof(attr));
+
+            attr.size = sizeof(attr);
+            attr.type = counter_events[i].type;
+            attr.config = counter_events[i].config;
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+
+            if(fd < 0)
+                continue;
+
+            if(leader < 0)
+                leader = fd;
+
+            fd_list[number] = fd;
+            counter_idx[number] = i;
+            number++;
+
+            mask |= 1 << i;
+        }
+    }
+
+    ~ThreadCounter(void)
+    {
+        for(int i = number - 1; i >= 0; i--)
+            close(fd_list[i]);
+    }
+
+    int leader;
+    int number;
+    uint32_t mask;
+    int fd_list[PERF_COUNTER_NUM];
+    int counter_idx[PERF_COUNTER_NUM];
+};
+
+static thread_local struct perf_counter_info* counter_context = nullptr;
+
+uint32_t PerfCounter::Read(uint64_t value[PERF_COUNTER_NUM])
+{
+    static thread_local ThreadCounter thread_counter;
+
+    /* nr, then the values in the order the counters were opened */
+    uint64_t buf[1 + PERF_COUNTER_NUM];
+
+    for(int i = 0; i < PERF_COUNTER_NUM; i++)
+        value[i] = 0;
+
+    if(thread_counter.number == 0)
+        return 0;
+
+    if(read(thread_counter.leader, buf, sizeof(buf)) < ( ssize_t )((1 + thread_counter.number) * sizeof(uint64_t)))
+        return 0;
+
+    for(int i = 0; i < thread_counter.number; i++)
+        value[thread_counter.counter_idx[i]] = buf[1 + i];
+
+    return thread_counter.mask;
+}
+
+void PerfCounter::Accumulate(struct perf_counter_info* info, const uint64_t start[PERF_COUNTER_NUM], uint32_t mask)
+{
+    uint64_t end[PERF_COUNTER_NUM];
+
+    mask &= Read(end);
+
+    if(mask == 0)
+        return;
+
+    for(int i = 0; i < PERF_COUNTER_NUM; i++)
+    {
+        if(mask & (1 << i))
+            __atomic_fetch_add(&info->counter[i], end[i] - start[i], __ATOMIC_RELAXED);
+    }
+
+    __atomic_fetch_or(&info->valid_mask, mask, __ATOMIC_RELAXED);
+}
+
+void PerfCounter::SetContext(struct perf_counter_info* info)
+{
+    counter_context = info;
+}
+
+struct perf_counter_info* PerfCounter::GetContext(void)
+{
+    return counter_context;
+}
+
+}    // namespace TEngine
@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __PERF_COUNTER_HPP__
+#define __PERF_COUNTER_HPP__
+
+#include <stdint.h>
+
+#include "tengine_c_api.h"
+
+namespace TEngine {
+
+/*
+ * Per thread cpu event counters, from perf_event_open(): a thread opens
+ * its counter group at its first read, in user space only, and closes it
+ * when it exits. The events the kernel or the cpu does not have are left
+ * out of the valid mask.
+ */
+struct PerfCounter
+{
+    /* the counters of the calling thread; returns the valid mask */
+    static uint32_t Read(uint64_t value[PERF_COUNTER_NUM]);
+
+    /* add the counts of the calling thread since start to info: safe from several threads */
+    static void Accumulate(struct perf_counter_info* info, const uint64_t start[PERF_COUNTER_NUM], uint32_t mask);
+
+    /* the record the thread counts into: the sub tasks it dispatches count there too */
+    static void SetContext(struct perf_counter_info* info);
+    static struct perf_counter_info* GetContext(void);
+};
+
+}    // namespace TEngine
+
+#endif
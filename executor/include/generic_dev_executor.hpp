@@ -26,8 +26,8 @@
 #define __GENERIC_DEV_EXECUTOR_HPP_
 
 #include <map>
-#include <set>
 #include <vector>
+#include <algorithm>
 
 #include "dev_executor.hpp"
 
@@ -36,7 +36,12 @@ namespace TEngine {
 class GenericDevExecutor : public DevExecutor
 {
 public:
-    using task_queue_t = std::map<int, std::set<SubgraphTask*>>;
+    /*
+       tasks of each priority. a task moves between the queues on every run:
+       the vectors and the map entries are kept when they empty, so that
+       after the first run this allocates nothing
+     */
+    using task_queue_t = std::map<int, std::vector<SubgraphTask*>>;
 
     enum QueueType
     {
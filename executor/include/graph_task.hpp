@@ -31,6 +31,8 @@
 #include "dev_executor.hpp"
 #include "graph_executor.hpp"
 #include "exec_attr.hpp"
+#include "latency_stat.hpp"
+#include "mem_account.hpp"
 
 namespace TEngine {
 
@@ -108,6 +110,10 @@ public:
     bool GetAttr(const char* name, void* val, int size);
     bool SetGraphPerfAttr(const char* name, const void* val, int size);
     bool GetGraphPerfAttr(const char* name, void* val, int size);
+    bool SetLatencyAttr(const void* val, int size);
+    bool GetLatencyAttr(void* val, int size);
+    bool GetMemAttr(void* val, int size);
+    void UpdateWeightMem(void);
 
 private:
     GraphExecutor* graph_executor_;
@@ -116,12 +122,20 @@ private:
     std::atomic<unsigned int> output_wait_count_;
     std::atomic<unsigned int> active_sub_task_count_;
     int output_task_number_;
-    int status_;
+    std::atomic<int> status_;    // written by the threads finishing the sub tasks
     GenericEngine* dev_engine_;
     WaitEvent wait_event_;
     bool task_done_;
     Graph* optimized_graph_;
     ExecAttr* p_exec_attr_;
+
+    /* end to end latency of the runs */
+    LatencyHistogram latency_hist_;
+    bool latency_enabled_;
+    uint64_t run_start_;
+
+    /* memory of the graph: the device runners charge it through the subgraph attribute ATTR_MEM_ACCOUNT */
+    MemAccount mem_account_;
 };
 
 class SubgraphTask
@@ -36,14 +36,30 @@
 
 #include "cpu_info.hpp"
 #include "exec_attr.hpp"
+#include "tensor_mem.hpp"
 
 namespace TEngine {
 
 #define ATTR_NODE_OPS "node_ops"
 #define ATTR_INPLACE "inplace"
 #define ATTR_EXEC_ATTR "exec_attr"
+#define ATTR_SCRATCH_ARENA "ScratchArena"
+
+/*
+   node attrs pinning the implementation, for tests and benchmarks:
+   search only the registry ATTR_OPS_REGISTRY (std::string), and in it, if set,
+   only the implementation registered with priority ATTR_OPS_PRIORITY (int)
+ */
+#define ATTR_OPS_REGISTRY "ops_registry"
+#define ATTR_OPS_PRIORITY "ops_priority"
+
+/* how an implementation handles the blocked layout, see NodeOps::GetBlockedLayoutSupport() */
+#define BLOCKED_LAYOUT_NONE 0    // NCHW only
+#define BLOCKED_LAYOUT_ANY 1    // each input and output may be blocked or not
+#define BLOCKED_LAYOUT_SAME 2    // blocked, if all its 4D data tensors are
 
 class Node;
+class Tensor;
 struct NodeOps;
 struct sub_op_task;
 
@@ -65,6 +81,59 @@ struct sub_op_task
     void* data;
 };
 
+/*
+ * Temporary memory for NodeOps::Run().
+ *
+ * Nodes are executed one after another, so a single block sized for the
+ * hungriest node is enough: each node declares its needs with Reserve()
+ * while being prepared, the block is allocated once, and it is rewound
+ * with Reset() before each node runs. Alloc() is a bump pointer; requests
+ * that do not fit fall back to the heap and are released at the next Reset().
+ * Nodes may be prepared in parallel, or while the graph runs: BeginNode()
+ * and Reserve() count the node of the calling thread, the running thread
+ * only allocates.
+ */
+struct ScratchArena
+{
+    ScratchArena(mem_alloc_t alloc_func, mem_free_t free_func);
+    ~ScratchArena();
+
+    /* start counting the reservations of a new node */
+    void BeginNode(void);
+    void Reserve(int size);
+
+    /* (re)allocate the block if the reserved size grew */
+    bool Allocate(void);
+
+    void Reset(void);
+    void* Alloc(int size);
+
+    int GetSize(void) const
+    {
+        return block_size;
+    }
+
+    /* number of allocations that did not fit and went to the heap */
+    int GetFallbackCount(void) const
+    {
+        return fallback_count;
+    }
+
+    mem_alloc_t mem_alloc;
+    mem_free_t mem_free;
+
+    void* mem_block;
+    char* base;
+    int block_size;
+    int offset;
+
+    std::mutex reserve_lock;
+    int max_node_size;
+
+    std::vector<void*> fallback_list;
+    int fallback_count;
+};
+
 struct tensor_dump_header
 {
     int elem_size;
@@ -115,6 +184,26 @@ struct NodeOps
         return true;
     }    // used in dynamic shape or reshped case:
     //      will be called before run
+
+    /* called after all nodes are bound, before Prerun() */
+    virtual int GetBlockedLayoutSupport(Node*)
+    {
+        return BLOCKED_LAYOUT_NONE;
+    }
+
+    static bool IsBlockedLayout(const Tensor* tensor);
+
+    /*
+       called after all nodes are bound, before Prerun():
+       may Run() work on a spatial tile? Between the runs, the H and W of the
+       4D input and output and the pads of the op param change, and
+       Prerun()/Reshape() are not called again
+     */
+    virtual bool GetTiledRunSupport(Node*)
+    {
+        return false;
+    }
+
     virtual bool EnableDump(Node* node);
     virtual bool DisableDump(Node* node);
     virtual bool StartDump(Node* node);
@@ -127,6 +216,7 @@ struct NodeOps
     NodeOps(void)
     {
         need_free = false;
+        scratch_arena = nullptr;
         dump_enabled = false;
         dump_started = false;
     }
@@ -151,6 +241,27 @@ struct NodeOps
         cpu_info = cpu;
     }
 
+    void SetScratchArena(ScratchArena* arena)
+    {
+        scratch_arena = arena;
+    }
+
+    /*
+       declare temporary memory needed by one Run(), in Prerun() or Reshape().
+       the sizes reserved by one node add up.
+     */
+    void ScratchReserve(int size)
+    {
+        if(scratch_arena)
+            scratch_arena->Reserve(size);
+    }
+
+    /*
+       get temporary memory in Run(), valid until Run() returns.
+       it must not be freed, and only the thread calling Run() may call it
+     */
+    void* ScratchAlloc(int size);
+
     virtual ~NodeOps() {}
 
     bool need_free;
@@ -162,6 +273,8 @@ struct NodeOps
 
     const CPUInfo* cpu_info;
 
+    ScratchArena* scratch_arena;
+
     bool dump_enabled;
     bool dump_started;
     std::vector<tensor_dump_header> dump_records;
@@ -197,6 +310,16 @@ struct PrioSelector : public NodeOpsSelector
         return nullptr;
     }
 
+    NodeOps* Select(int priority, const CPUInfo* cpu_info, Node* node)
+    {
+        auto ir = prio_list.find(priority);
+
+        if(ir == prio_list.end())
+            return nullptr;
+
+        return ir->second(cpu_info, node);
+    }
+
     void Register(int priority, select_node_ops_t func)
     {
         prio_list[priority] = func;
@@ -237,6 +360,11 @@ public:
     static NodeOps* RealFindNodeOps(const CPUInfo*, Node*);
     static NodeOps* FindNodeOps(const CPUInfo*, Node*);
     static NodeOps* FindNodeOps(const std::string& registry_name, const CPUInfo*, Node*);
+    static NodeOps* FindNodeOps(const std::string& registry_name, int priority, const CPUInfo*, Node*);
+
+    /* the names of all registries, and the priorities registered for op_name in one */
+    static std::vector<std::string> GetRegistryNames(void);
+    static std::vector<int> GetPriorityList(const std::string& registry_name, const std::string& op_name);
 
     static NodeOpsRegistryManager* GetInstance(void);
 
@@ -24,7 +24,6 @@
 #ifndef __TENSOR_MEM_HPP__
 #define __TENSOR_MEM_HPP__
 
-#include <memory>
 #include <functional>
 
 namespace TEngine {
@@ -33,56 +32,32 @@ using mem_release_t = std::function<void(void*)>;
 
 class Tensor;
 
-class TensorMem
-{
-public:
-    TensorMem()
-    {
-        mem_addr_ = nullptr;
-        mem_size_ = 0;
-        releaser_ = nullptr;
-    }
-    ~TensorMem()
-    {
-        if(mem_addr_)
-        {
-            if(releaser_)
-                releaser_(mem_addr_);
-        }
-    }
-
-    void SetMem(void* addr, int size, mem_release_t releaser)
-    {
-        mem_addr_ = addr;
-        mem_size_ = size;
-        releaser_ = releaser;
-    }
-
-    int GetSize(void)
-    {
-        return mem_size_;
-    }
-    void* GetMem(void)
-    {
-        return mem_addr_;
-    }
-
-private:
-    void* mem_addr_;
-    int mem_size_;
-    mem_release_t releaser_;
-};
-
-using TensorMemPtr = std::shared_ptr<TensorMem>;
+/*
+   tensor attr: the fp32 NCHW tensor is stored channel blocked,
+   as [N][C / BLOCKED_LAYOUT_C][H][W][BLOCKED_LAYOUT_C]. set by the cpu runner,
+   only on internal tensors whose channel number is a multiple of the block.
+ */
+#define ATTR_BLOCKED_LAYOUT "BlockedLayout"
+#define BLOCKED_LAYOUT_C 4
 
-bool get_tensor_memptr(const Tensor*, TensorMemPtr&);
-void set_tensor_mem(Tensor*, const TensorMemPtr&);
+/*
+   the memory of a non-const tensor lives in the tensor itself,
+   see Tensor::SetDataMem(); set_tensor_mem() releases the previous memory
+ */
 
 void* get_tensor_mem(const Tensor*);
 int get_tensor_mem_size(const Tensor*);
 bool set_tensor_mem(Tensor*, void*, int, mem_release_t);
 void free_tensor_mem(Tensor*);
 
+/*
+   the tensor data as the user sees it: a blocked tensor is converted back
+   to NCHW. get_tensor_nchw_mem() converts into a buffer kept by the tensor,
+   valid until the next call; copy_tensor_nchw() into dst of GetTotalSize()
+ */
+void* get_tensor_nchw_mem(Tensor*);
+void copy_tensor_nchw(const Tensor*, void* dst);
+
 }    // namespace TEngine
 
 #endif
@@ -62,20 +62,10 @@ void GenericDevExecutor::InsertQueue(GenericDevExecutor::QueueType queue_type, S
 
     Lock(*p_mutex);
 
-    // first one?
+    std::vector<SubgraphTask*>& tasks = (*p_queue)[task->exec_priority];
 
-    auto ir = p_queue->find(task->exec_priority);
-
-    if(ir == p_queue->end())
-    {
-        std::set<SubgraphTask*> set;
-        set.insert(task);
-        (*p_queue)[task->exec_priority] = set;
-    }
-    else
-    {
-        ir->second.insert(task);
-    }
+    if(std::find(tasks.begin(), tasks.end(), task) == tasks.end())
+        tasks.push_back(task);
 
     Unlock(*p_mutex);
 }
@@ -97,12 +87,15 @@ bool GenericDevExecutor::RemoveQueue(QueueType queue_type, SubgraphTask* task)
         return false;
     }
 
-    bool ret;
+    std::vector<SubgraphTask*>& tasks = ir->second;
+    auto task_ir = std::find(tasks.begin(), tasks.end(), task);
+    bool ret = false;
 
-    if(ir->second.erase(task))
+    if(task_ir != tasks.end())
+    {
+        tasks.erase(task_ir);
         ret = true;
-    else
-        ret = false;
+    }
 
     Unlock(*p_mutex);
 
@@ -118,24 +111,22 @@ SubgraphTask* GenericDevExecutor::PopQueue(QueueType queue_type)
 
     Lock(*p_mutex);
 
+    // the first task of the highest priority: empty entries are kept
+
     auto ir = p_queue->begin();
 
+    while(ir != p_queue->end() && ir->second.empty())
+        ir++;
+
     if(ir == p_queue->end())
     {
         Unlock(*p_mutex);
         return nullptr;
     }
 
-    auto set_ir = ir->second.begin();
+    SubgraphTask* task = ir->second.front();
 
-    SubgraphTask* task = *set_ir;
-
-    ir->second.erase(set_ir);
-
-    if(ir->second.empty())
-    {
-        p_queue->erase(ir);
-    }
+    ir->second.erase(ir->second.begin());
 
     Unlock(*p_mutex);
     return task;
@@ -157,6 +148,7 @@ int GenericDevExecutor::GetElementNumber(QueueType queue_type)
     while(ir != p_queue->end())
     {
         count += ir->second.size();
+        ir++;
     }
 
     Unlock(*p_mutex);
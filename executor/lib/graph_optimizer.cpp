@@ -30,6 +30,7 @@
 #include "operator/fused_operator.hpp"
 #include "operator/batch_norm.hpp"
 #include "operator/convolution.hpp"
+#include "operator/deconvolution.hpp"
 #include "operator/relu.hpp"
 #include "operator/scale.hpp"
 #include "operator/eltwise.hpp"
@@ -42,7 +43,10 @@ static bool GraphFuseBNScale(Graph* graph, GraphOptimizer* opt);
 static bool GraphFuseConvBN(Graph* graph, GraphOptimizer* opt);
 static bool GraphFuseConvReLu(Graph* graph, GraphOptimizer* opt);
 static bool GraphFuseConvReLu6(Graph* graph, GraphOptimizer* opt);
+static bool GraphFuseDeconvReLu(Graph* graph, GraphOptimizer* opt);
+static bool GraphFuseDeconvReLu6(Graph* graph, GraphOptimizer* opt);
 static bool GraphFuseRelu6(Graph* graph, GraphOptimizer* opt);
+static bool GraphFuseEltwiseReLu(Graph* graph, GraphOptimizer* opt);
 static void AddConstNodeToSubGraph(Subgraph* graph, Tensor* tensor, Node* fused_node, int fused_port_index);
 
 static bool Weight_Bn(Subgraph* graph, Node* ConvNode, float* mean, float* var, float* gamma, float* beta, float eps,
@@ -604,10 +608,25 @@ void GraphOptimizerManager::Init(void)
     opt->optimizer = graph_opt_t(GraphFuseConvReLu6);
     Add(opt->name, opt);
 
+    opt = new GraphOptimizer();
+    opt->name = "DeconvReLu";
+    opt->optimizer = graph_opt_t(GraphFuseDeconvReLu);
+    Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "DeconvReLu6";
+    opt->optimizer = graph_opt_t(GraphFuseDeconvReLu6);
+    Add(opt->name, opt);
+
     opt = new GraphOptimizer();
     opt->name = "Relu6";
     opt->optimizer = graph_opt_t(GraphFuseRelu6);
     Add(opt->name, opt);
+
+    opt = new GraphOptimizer();
+    opt->name = "EltwiseReLu";
+    opt->optimizer = graph_opt_t(GraphFuseEltwiseReLu);
+    Add(opt->name, opt);
 }
 
 static bool NodeInGraph(Node* node, Graph* graph)
@@ -623,9 +642,10 @@ static bool NodeInGraph(Node* node, Graph* graph)
     return false;
 }
 
-/* the graph optimizer: conv_relu */
-static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu6)
+/* the graph optimizer: conv_relu, also used for deconv_relu */
+static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu6, bool deconv = false)
 {
+    const char* conv_op_name = deconv ? "Deconvolution" : "Convolution";
     int node_number = graph->seq_nodes.size();
     std::vector<Subgraph*> orig_sub;
 
@@ -654,7 +674,7 @@ static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu
 
         op = conv_node->GetOp();
 
-        if(op->GetName() != "Convolution")
+        if(op->GetName() != conv_op_name)
             continue;
 
         // check if node in seq_nodes
@@ -694,7 +714,7 @@ static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu
         std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
 
         Node* fused_node = new Node(node_name);
-        Operator* op = OpManager::CreateOp("Convolution");
+        Operator* op = OpManager::CreateOp(conv_op_name);
 
         fused_node->SetDynamicShape(orig_input->IsDynamicShape());
 
@@ -702,18 +722,24 @@ static bool GraphFuseConvReLuCommon(Graph* graph, GraphOptimizer* opt, bool relu
         fused_node->MergeAttr(orig_input);
         fused_node->MergeAttr(orig_output);
 
-        Convolution* fused_op = dynamic_cast<Convolution*>(op);
-        ConvParam* fused_param = fused_op->GetParam();
+        int activation = relu6 ? ActRELU6 : ActRELU;
 
-        Convolution* orig_op = dynamic_cast<Convolution*>(orig_input->GetOp());
-        ConvParam* orig_param = orig_op->GetParam();
-
-        *fused_param = *orig_param;
+        if(deconv)
+        {
+            DeconvParam* fused_param = dynamic_cast<Deconvolution*>(op)->GetParam();
+            DeconvParam* orig_param = dynamic_cast<Deconvolution*>(orig_input->GetOp())->GetParam();
 
-        if(relu6)
-            fused_param->activation = ActRELU6;
+            *fused_param = *orig_param;
+            fused_param->activation = activation;
+        }
         else
-            fused_param->activation = ActRELU;
+        {
+            ConvParam* fused_param = dynamic_cast<Convolution*>(op)->GetParam();
+            ConvParam* orig_param = dynamic_cast<Convolution*>(orig_input->GetOp())->GetParam();
+
+            *fused_param = *orig_param;
+            fused_param->activation = activation;
+        }
 
         Tensor* output_tensor = orig_output->GetOutputTensor(0);
         fused_node->AddOutputTensor(output_tensor);
@@ -762,4 +788,135 @@ static bool GraphFuseConvReLu6(Graph* graph, GraphOptimizer* opt)
     return GraphFuseConvReLuCommon(graph, opt, true);
 }
 
+static bool GraphFuseDeconvReLu(Graph* graph, GraphOptimizer* opt)
+{
+    return GraphFuseConvReLuCommon(graph, opt, false, true);
+}
+
+static bool GraphFuseDeconvReLu6(Graph* graph, GraphOptimizer* opt)
+{
+    return GraphFuseConvReLuCommon(graph, opt, true, true);
+}
+
+/* eltwise followed by relu or relu6: the activation is done by the eltwise */
+static bool GraphFuseEltwiseReLu(Graph* graph, GraphOptimizer* opt)
+{
+    int node_number = graph->seq_nodes.size();
+    std::vector<Subgraph*> orig_sub;
+
+    for(int i = 0; i < node_number; i++)
+    {
+        Node* node = graph->seq_nodes[i];
+        Operator* op = node->GetOp();
+
+        if(op->GetName() != "ReLu" && op->GetName() != "ReLu6")
+            continue;
+
+        if(op->GetName() == "ReLu" && dynamic_cast<ReLu*>(op)->GetParam()->negative_slope != 0.f)
+            continue;
+
+        Tensor* input_tensor = node->GetInputTensor(0);
+        Node* elt_node = input_tensor->producer->owner;
+
+        if(elt_node->GetOp()->GetName() != "Eltwise" || !NodeInGraph(elt_node, graph))
+            continue;
+
+        /* the eltwise output is only read by the relu */
+        if(input_tensor->consumer.size() != 1 || elt_node->GetOutputNum() != 1)
+            continue;
+
+        EltwiseParam* param = dynamic_cast<Eltwise*>(elt_node->GetOp())->GetParam();
+
+        if(param->activation >= 0)
+            continue;
+
+        /* the const nodes are replaced, they must not be shared */
+        bool shared_const = false;
+
+        for(unsigned int j = 0; j < elt_node->GetInputNum(); j++)
+        {
+            Tensor* tensor = elt_node->GetInputTensor(j);
+
+            if(tensor->GetType() == kConstTensor && tensor->consumer.size() != 1)
+                shared_const = true;
+        }
+
+        if(shared_const)
+            continue;
+
+        Subgraph* sub = new Subgraph("eltwise_relu");
+
+        sub->seq_nodes.push_back(elt_node);
+        sub->seq_nodes.push_back(node);
+
+        sub->input_nodes.push_back(elt_node);
+        sub->output_nodes.push_back(node);
+
+        for(unsigned int j = 0; j < elt_node->GetInputNum(); j++)
+        {
+            Tensor* tensor = elt_node->GetInputTensor(j);
+
+            if(tensor->GetType() == kConstTensor)
+                sub->seq_nodes.push_back(tensor->producer->owner);
+        }
+
+        orig_sub.push_back(sub);
+    }
+
+    for(unsigned int i = 0; i < orig_sub.size(); i++)
+    {
+        Subgraph fused("fused");
+        Subgraph* orig = orig_sub[i];
+
+        Node* orig_output = orig->output_nodes[0];
+        Node* orig_input = orig->input_nodes[0];
+
+        std::string node_name = orig_input->GetName() + "-" + orig_output->GetName();
+
+        Node* fused_node = new Node(node_name);
+        Operator* op = OpManager::CreateOp("Eltwise");
+
+        fused_node->SetDynamicShape(orig_input->IsDynamicShape());
+
+        fused_node->SetOp(op);
+        fused_node->MergeAttr(orig_input);
+        fused_node->MergeAttr(orig_output);
+
+        EltwiseParam* fused_param = dynamic_cast<Eltwise*>(op)->GetParam();
+        EltwiseParam* orig_param = dynamic_cast<Eltwise*>(orig_input->GetOp())->GetParam();
+
+        *fused_param = *orig_param;
+        fused_param->activation = orig_output->GetOp()->GetName() == "ReLu6" ? ActRELU6 : ActRELU;
+
+        Tensor* output_tensor = orig_output->GetOutputTensor(0);
+        fused_node->AddOutputTensor(output_tensor);
+
+        fused.seq_nodes.push_back(fused_node);
+        fused.input_nodes.push_back(fused_node);
+        fused.output_nodes.push_back(fused_node);
+        fused.SetNodeOwner(fused_node);
+
+        for(unsigned int j = 0; j < orig_input->GetInputNum(); j++)
+        {
+            Tensor* tensor = orig_input->GetInputTensor(j);
+
+            if(tensor->GetType() == kConstTensor)
+                AddConstNodeToSubGraph(&fused, tensor, fused_node, j);
+            else
+                fused_node->AddInputTensor(tensor);
+        }
+
+        graph->Replace(orig, &fused);
+    }
+
+    for(unsigned int i = 0; i < orig_sub.size(); i++)
+    {
+        Subgraph* orig = orig_sub[i];
+
+        delete orig;
+    }
+
+    return true;
+}
+
 }    // namespace TEngine
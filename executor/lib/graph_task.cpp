@@ -25,6 +25,7 @@
 #include <string.h>
 #include <atomic>
 #include <set>
+#include <unordered_set>
 
 #include "tengine_errno.hpp"
 #include "generic_engine.hpp"
@@ -44,6 +45,8 @@ GraphTask::GraphTask(GraphExecutor* graph_executor)
     dev_engine_ = nullptr;
     optimized_graph_ = nullptr;
     status_ = EXEC_STATUS_CREATED;
+    latency_enabled_ = true;
+    run_start_ = 0;
 }
 
 void GraphTask::AddSubgraphTask(SubgraphTask* sub_task)
@@ -86,11 +89,6 @@ bool GraphTask::RunSubgraphTask(SubgraphTask* sub_task)
 
     DevScheduler* scheduler = dev_engine_->GetScheduler();
 
-    std::string msg;
-
-    msg = msg + "graph " + sub_task->sub_graph->GetName() +
-          " launched. active:" + std::to_string(( int )active_sub_task_count_) + "\n";
-
     active_sub_task_count_++;
 
     return scheduler->SchedTask(dev_engine_, sub_task->dev_executor, sub_task);
@@ -224,6 +222,8 @@ bool GraphTask::Prerun(void)
 
     for(auto e : sub_task_list_)
     {
+        e->sub_graph->SetAttr(ATTR_MEM_ACCOUNT, &mem_account_);
+
         if(!scheduler->PrerunTask(dev_engine_, e->dev_executor, e))
         {
             XLOG_ERROR() << "failed to Prerun task on  dev executor: " << e->dev_executor->GetName() << "\n";
@@ -236,6 +236,8 @@ bool GraphTask::Prerun(void)
             output_task_number_++;
     }
 
+    UpdateWeightMem();
+
     status_ = EXEC_STATUS_INITED;
 
     return true;
@@ -246,12 +248,15 @@ bool GraphTask::SyncRun(void)
     if(status_ != EXEC_STATUS_INITED && status_ != EXEC_STATUS_READY)
 
     {
-        XLOG_ERROR() << "bad status: " << dev_engine_->GetStatusStr(status_) << "\n";
+        XLOG_ERROR() << "bad status: " << dev_engine_->GetStatusStr(status_.load()) << "\n";
         return false;
     }
 
     status_ = EXEC_STATUS_RUN;
     output_wait_count_ = output_task_number_ * 2;    // never signal graph task done
+
+    if(latency_enabled_)
+        run_start_ = LatencyHistogram::Now();
     active_sub_task_count_ = 0;
 
     std::set<SubgraphTask*> working_set;
@@ -302,6 +307,9 @@ bool GraphTask::SyncRun(void)
         }
     }
 
+    if(latency_enabled_)
+        latency_hist_.Record(LatencyHistogram::Now() - run_start_);
+
     status_ = EXEC_STATUS_READY;
     return true;
 }
@@ -312,7 +320,7 @@ bool GraphTask::Run(exec_event_t& event)
 
     if(status_ != EXEC_STATUS_INITED && status_ != EXEC_STATUS_READY)
     {
-        XLOG_ERROR() << "bad status: " << dev_engine_->GetStatusStr(status_) << "\n";
+        XLOG_ERROR() << "bad status: " << dev_engine_->GetStatusStr(status_.load()) << "\n";
         wait_event_.mutex.unlock();
         return false;
     }
@@ -321,6 +329,9 @@ bool GraphTask::Run(exec_event_t& event)
     status_ = EXEC_STATUS_RUN;
     wait_event_.mutex.unlock();
 
+    if(latency_enabled_)
+        run_start_ = LatencyHistogram::Now();
+
     output_wait_count_ = output_task_number_;
     active_sub_task_count_ = 0;
     task_done_ = false;
@@ -435,6 +446,10 @@ void GraphTask::OnOutputSubgraphTaskDone(SubgraphTask* sub_task)
 
     if(output_wait_count_.fetch_sub(1) == 1)
     {
+        /* before READY: the next run may start right after */
+        if(latency_enabled_)
+            latency_hist_.Record(LatencyHistogram::Now() - run_start_);
+
         status_ = EXEC_STATUS_READY;
         SignalGraphTaskDone();
     }
@@ -494,7 +509,7 @@ bool GraphTask::GetGraphPerfAttr(const char* name, void* val, int size)
 {
     GraphPerfMsg* perf_msg = ( GraphPerfMsg* )val;
 
-    struct perf_info** info = perf_msg->buf;
+    void** info = perf_msg->buf;
     int info_idx = 0;
     bool loop_done = false;
     bool fetch_error = false;
@@ -517,7 +532,7 @@ bool GraphTask::GetGraphPerfAttr(const char* name, void* val, int size)
                 buf_num += 100;
             }
 
-            tmp_msg.buf = ( struct perf_info** )malloc(buf_num * sizeof(void*));
+            tmp_msg.buf = ( void** )malloc(buf_num * sizeof(void*));
             tmp_msg.buf_size = buf_num;
             tmp_msg.ret_number = -1;
 
@@ -556,8 +571,143 @@ bool GraphTask::GetGraphPerfAttr(const char* name, void* val, int size)
     }
 }
 
+bool GraphTask::SetLatencyAttr(const void* val, int size)
+{
+    if(size != sizeof(int))
+    {
+        set_tengine_errno(EINVAL);
+        return false;
+    }
+
+    int action = *( const int* )val;
+
+    switch(action)
+    {
+        case LATENCY_STAT_DISABLE:
+            latency_enabled_ = false;
+            break;
+        case LATENCY_STAT_ENABLE:
+            latency_enabled_ = true;
+            break;
+        case LATENCY_STAT_RESET:
+            latency_hist_.Reset();
+            break;
+        default:
+            set_tengine_errno(EINVAL);
+            return false;
+    }
+
+    NodeLatencyMsg msg;
+
+    msg.action = action;
+
+    /* the devices without node histograms just keep the end to end one */
+    for(unsigned int i = 0; i < sub_task_list_.size(); i++)
+        sub_task_list_[i]->SetAttr(ATTR_NODE_LATENCY_STAT, &msg, sizeof(msg));
+
+    return true;
+}
+
+bool GraphTask::GetLatencyAttr(void* val, int size)
+{
+    int entry_number = size / sizeof(struct latency_stat);
+
+    if(entry_number < 1)
+    {
+        set_tengine_errno(EINVAL);
+        return false;
+    }
+
+    struct latency_stat* stat = ( struct latency_stat* )val;
+
+    memset(stat, 0x0, entry_number * sizeof(struct latency_stat));
+
+    latency_hist_.GetStat(&stat[0]);
+    stat[0].name = graph_->GetName().c_str();
+
+    int stat_idx = 1;
+
+    for(unsigned int i = 0; i < sub_task_list_.size() && stat_idx < entry_number; i++)
+    {
+        NodeLatencyMsg msg;
+
+        msg.buf = stat + stat_idx;
+        msg.buf_size = entry_number - stat_idx;
+        msg.ret_number = 0;
+
+        if(sub_task_list_[i]->GetAttr(ATTR_NODE_LATENCY_STAT, &msg, sizeof(msg)))
+            stat_idx += msg.ret_number;
+    }
+
+    return true;
+}
+
+/* the const tensors are loaded by the serializers before the graph exists: count what the nodes hold */
+void GraphTask::UpdateWeightMem(void)
+{
+    std::unordered_set<void*> counted;
+
+    for(unsigned int i = 0; i < sub_task_list_.size(); i++)
+    {
+        Subgraph* sub_graph = sub_task_list_[i]->sub_graph;
+
+        for(unsigned int j = 0; j < sub_graph->seq_nodes.size(); j++)
+        {
+            Node* node = sub_graph->seq_nodes[j];
+            int64_t weight_size = 0;
+            bool has_weight = false;
+
+            for(unsigned int k = 0; k < node->GetInputNum(); k++)
+            {
+                Tensor* tensor = node->GetInputTensor(k);
+
+                if(tensor->GetType() != kConstTensor)
+                    continue;
+
+                has_weight = true;
+
+                /* a buffer may be shared by the copies of a tensor: lazy weights count once read */
+                void* addr = tensor->GetLoadedMemAddr();
+
+                if(addr && counted.insert(addr).second)
+                    weight_size += tensor->GetTotalSize();
+            }
+
+            if(has_weight)
+                mem_account_.Set(mem_account_.GetRecord(node->GetName()), MEM_STAT_WEIGHT, weight_size);
+        }
+    }
+}
+
+bool GraphTask::GetMemAttr(void* val, int size)
+{
+    int entry_number = size / sizeof(struct mem_stat);
+
+    if(entry_number < 1)
+    {
+        set_tengine_errno(EINVAL);
+        return false;
+    }
+
+    struct mem_stat* stat = ( struct mem_stat* )val;
+
+    memset(stat, 0x0, entry_number * sizeof(struct mem_stat));
+
+    /* the kernels may have released the original weights once packed */
+    UpdateWeightMem();
+
+    mem_account_.GetStat(stat, entry_number);
+
+    stat[0].name = graph_->GetName().c_str();
+
+    return true;
+}
+
 bool GraphTask::SetAttr(const char* name, const void* val, int size)
 {
+    if(!strcmp(name, GRAPH_ATTR_LATENCY_STAT))
+        return SetLatencyAttr(val, size);
+
     if(!strncmp(name, ATTR_GRAPH_PERF_STAT, strlen(ATTR_GRAPH_PERF_STAT)))
     {
         return SetGraphPerfAttr(name, val, size);
@@ -577,6 +727,12 @@ bool GraphTask::SetAttr(const char* name, const void* val, int size)
 
 bool GraphTask::GetAttr(const char* name, void* val, int size)
 {
+    if(!strcmp(name, GRAPH_ATTR_LATENCY_STAT))
+        return GetLatencyAttr(val, size);
+
+    if(!strcmp(name, GRAPH_ATTR_MEM_STAT))
+        return GetMemAttr(val, size);
+
     if(!strncmp(name, ATTR_GRAPH_PERF_STAT, strlen(ATTR_GRAPH_PERF_STAT)))
     {
         return GetGraphPerfAttr(name, val, size);
@@ -21,6 +21,8 @@
  * Copyright (c) 2018, Open AI Lab
  * Author: haitao@openailab.com
  */
+#include <algorithm>
+
 #include "data_type.hpp"
 #include "logger.hpp"
 #include "graph.hpp"
@@ -33,6 +35,144 @@ namespace TEngine {
 
 static std::mutex node_dump_lock;
 
+#define SCRATCH_ALIGN 64
+#define SCRATCH_ALIGN_SIZE(size) ((( size ) + SCRATCH_ALIGN - 1) & ~(SCRATCH_ALIGN - 1))
+
+/* the reservations of the node being prepared by this thread */
+static thread_local int scratch_node_size = 0;
+
+ScratchArena::ScratchArena(mem_alloc_t alloc_func, mem_free_t free_func)
+{
+    mem_alloc = alloc_func;
+    mem_free = free_func;
+
+    mem_block = nullptr;
+    base = nullptr;
+    block_size = 0;
+    offset = 0;
+
+    max_node_size = 0;
+
+    fallback_count = 0;
+}
+
+ScratchArena::~ScratchArena()
+{
+    for(unsigned int i = 0; i < fallback_list.size(); i++)
+        mem_free(fallback_list[i]);
+
+    if(mem_block)
+        mem_free(mem_block);
+}
+
+void ScratchArena::BeginNode(void)
+{
+    scratch_node_size = 0;
+}
+
+void ScratchArena::Reserve(int size)
+{
+    scratch_node_size += SCRATCH_ALIGN_SIZE(size);
+
+    std::lock_guard<std::mutex> lock(reserve_lock);
+
+    if(scratch_node_size > max_node_size)
+        max_node_size = scratch_node_size;
+}
+
+bool ScratchArena::Allocate(void)
+{
+    reserve_lock.lock();
+    int alloc_size = max_node_size;
+    reserve_lock.unlock();
+
+    if(alloc_size <= block_size)
+        return true;
+
+    if(mem_block)
+        mem_free(mem_block);
+
+    mem_block = mem_alloc(alloc_size + SCRATCH_ALIGN);
+
+    if(mem_block == nullptr)
+    {
+        base = nullptr;
+        block_size = 0;
+        return false;
+    }
+
+    base = ( char* )SCRATCH_ALIGN_SIZE(( unsigned long )mem_block);
+    block_size = alloc_size;
+    offset = 0;
+
+    return true;
+}
+
+void ScratchArena::Reset(void)
+{
+    offset = 0;
+
+    if(fallback_list.empty())
+        return;
+
+    for(unsigned int i = 0; i < fallback_list.size(); i++)
+        mem_free(fallback_list[i]);
+
+    fallback_list.clear();
+
+    /* grow, so that the next run fits */
+    Allocate();
+}
+
+void* ScratchArena::Alloc(int size)
+{
+    int aligned_size = SCRATCH_ALIGN_SIZE(size);
+
+    if(offset + aligned_size <= block_size)
+    {
+        void* addr = base + offset;
+        offset += aligned_size;
+        return addr;
+    }
+
+    /* aligned as the arena: the block as allocated goes to the list, for mem_free() */
+    void* block = mem_alloc(aligned_size + SCRATCH_ALIGN);
+
+    if(block == nullptr)
+        return nullptr;
+
+    void* addr = ( void* )SCRATCH_ALIGN_SIZE(( unsigned long )block);
+
+    fallback_list.push_back(block);
+    fallback_count++;
+
+    /* the node reserved too little, remember the real need */
+    offset += aligned_size;
+
+    std::lock_guard<std::mutex> lock(reserve_lock);
+
+    if(offset > max_node_size)
+        max_node_size = offset;
+
+    return addr;
+}
+
+bool NodeOps::IsBlockedLayout(const Tensor* tensor)
+{
+    return tensor->ExistAttr(ATTR_BLOCKED_LAYOUT);
+}
+
+void* NodeOps::ScratchAlloc(int size)
+{
+    if(scratch_arena == nullptr)
+    {
+        LOG_ERROR() << "no scratch arena is bound to the node ops\n";
+        return nullptr;
+    }
+
+    return scratch_arena->Alloc(size);
+}
+
 bool NodeOps::EnableDump(Node* node)
 {
     dump_enabled = true;
@@ -172,7 +312,7 @@ bool NodeOps::SaveDump(Node* node)
             }
         }
 
-        memcpy(head->data, get_tensor_mem(tensor), head->elem_number * head->elem_size);
+        copy_tensor_nchw(tensor, head->data);
     }
 
     node_dump_lock.unlock();
@@ -206,8 +346,73 @@ NodeOps* NodeOpsRegistryManager::FindNodeOps(const std::string& registry_name, c
     return ops;
 }
 
+NodeOps* NodeOpsRegistryManager::FindNodeOps(const std::string& registry_name, int priority, const CPUInfo* cpu_info,
+                                              Node* node)
+{
+    NodeOpsRegistry* registry = FindRegistry(registry_name);
+
+    if(!registry)
+        return nullptr;
+
+    PrioSelector* selector = dynamic_cast<PrioSelector*>(registry->FindSelector(node->GetOp()->GetName()));
+
+    if(!selector)
+        return nullptr;
+
+    NodeOps* ops = selector->Select(priority, cpu_info, node);
+
+    if(!ops)
+        return nullptr;
+
+    ops->SetCPUInfo(cpu_info);
+
+    return ops;
+}
+
+std::vector<std::string> NodeOpsRegistryManager::GetRegistryNames(void)
+{
+    auto manager = GetInstance();
+    std::vector<std::string> names;
+
+    for(auto& ir : manager->registry_list)
+        names.push_back(ir.first);
+
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+std::vector<int> NodeOpsRegistryManager::GetPriorityList(const std::string& registry_name, const std::string& op_name)
+{
+    std::vector<int> prio_list;
+    NodeOpsRegistry* registry = FindRegistry(registry_name);
+
+    if(!registry)
+        return prio_list;
+
+    PrioSelector* selector = dynamic_cast<PrioSelector*>(registry->FindSelector(op_name));
+
+    if(!selector)
+        return prio_list;
+
+    for(auto& ir : selector->prio_list)
+        prio_list.push_back(ir.first);
+
+    return prio_list;
+}
+
 NodeOps* NodeOpsRegistryManager::FindNodeOps(const CPUInfo* cpu_info, Node* node)
 {
+    if(node->ExistAttr(ATTR_OPS_REGISTRY))
+    {
+        const std::string& registry_name = any_cast<std::string>(node->GetAttr(ATTR_OPS_REGISTRY));
+
+        if(node->ExistAttr(ATTR_OPS_PRIORITY))
+            return FindNodeOps(registry_name, any_cast<int>(node->GetAttr(ATTR_OPS_PRIORITY)), cpu_info, node);
+
+        return FindNodeOps(registry_name, cpu_info, node);
+    }
+
     const char* target_registry = std::getenv("OPS_REGISTRY");
     const char* target_op = std::getenv("OP_NAME");
     NodeOps* ops;
@@ -21,10 +21,15 @@
  * Copyright (c) 2018, Open AI Lab
  * Author: haitao@openailab.com
  */
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <algorithm>
+
 #include "data_type.hpp"
 #include "exec_context.hpp"
 #include "graph.hpp"
 #include "tensor_mem.hpp"
+#include "tengine_errno.hpp"
 #include "operator/convolution.hpp"
 
 #include "tengine_test_api.h"
@@ -72,6 +77,271 @@ test_node_t create_convolution_test_node(int kernel_h, int kernel_w, int stride_
     return node;
 }
 
+test_node_t create_test_node(const char* op_name)
+{
+    Operator* op = OpManager::CreateOp(op_name);
+
+    if(op == nullptr)
+        return nullptr;
+
+    Node* node = new Node(std::string("test_") + op_name);
+
+    node->SetOp(op);
+
+    return node;
+}
+
+int test_node_set_param_int(test_node_t node, const char* param_name, int val)
+{
+    Operator* op = (( Node* )node)->GetOp();
+
+    return op->SetParamItem(param_name, &typeid(int), &val) ? 0 : -1;
+}
+
+int test_node_set_param_float(test_node_t node, const char* param_name, float val)
+{
+    Operator* op = (( Node* )node)->GetOp();
+
+    return op->SetParamItem(param_name, &typeid(float), &val) ? 0 : -1;
+}
+
+test_node_t create_fc_test_node(int hidden_number, int output_number)
+{
+    test_node_t node = create_test_node("FullyConnected");
+
+    if(node)
+        test_node_set_param_int(node, "num_output", output_number);
+
+    return node;
+}
+
+test_node_t create_pooling_test_node(int pool_method, int kernel_h, int kernel_w, int stride_h, int stride_w,
+                                     int pad_h0, int pad_h1, int pad_w0, int pad_w1, int global)
+{
+    test_node_t node = create_test_node("Pooling");
+
+    if(node == nullptr)
+        return nullptr;
+
+    /* the end pads follow from the output size */
+    test_node_set_param_int(node, "alg", pool_method);
+    test_node_set_param_int(node, "kernel_h", kernel_h);
+    test_node_set_param_int(node, "kernel_w", kernel_w);
+    test_node_set_param_int(node, "stride_h", stride_h);
+    test_node_set_param_int(node, "stride_w", stride_w);
+    test_node_set_param_int(node, "pad_h", pad_h0);
+    test_node_set_param_int(node, "pad_w", pad_w0);
+    test_node_set_param_int(node, "global", global);
+
+    return node;
+}
+
+int test_node_set_layout(test_node_t node, int layout)
+{
+    if(layout != TENGINE_LAYOUT_NCHW && layout != TENGINE_LAYOUT_NHWC)
+        return -1;
+
+    (( Node* )node)->SetAttr("TEST_LAYOUT", layout);
+
+    return 0;
+}
+
+static int get_test_layout(Node* node)
+{
+    if(!node->ExistAttr("TEST_LAYOUT"))
+        return TENGINE_LAYOUT_NCHW;
+
+    return any_cast<int>(node->GetAttr("TEST_LAYOUT"));
+}
+
+static const char* test_layout(int dim_number, int layout)
+{
+    switch(dim_number)
+    {
+        case 4:
+            return layout == TENGINE_LAYOUT_NHWC ? "NHWC" : "NCHW";
+        case 3:
+            return "CHW";
+        case 2:
+            return "HW";
+        default:
+            return "W";
+    }
+}
+
+static Tensor* create_test_tensor(const std::string& name, float* data, const int* dims, int dim_number, int layout)
+{
+    Tensor* tensor = new Tensor(name);
+
+    tensor->SetDataType(DataType::GetTypeID("float32"));
+    tensor->SetType(kConstTensor);
+    tensor->SetMemAddr(data);
+
+    TShape& shape = tensor->GetShape();
+
+    shape.SetDataLayout(test_layout(dim_number, layout));
+    shape.SetDim(std::vector<int>(dims, dims + dim_number));
+
+    return tensor;
+}
+
+int test_node_add_input(test_node_t node, float* data, const int* dims, int dim_number)
+{
+    Node* test_node = ( Node* )node;
+    std::string name = test_node->GetName() + "_in" + std::to_string(test_node->GetInputNum());
+
+    test_node->AddInputTensor(create_test_tensor(name, data, dims, dim_number, get_test_layout(test_node)));
+
+    return 0;
+}
+
+int test_node_add_output(test_node_t node, float* data, const int* dims, int dim_number)
+{
+    Node* test_node = ( Node* )node;
+    std::string name = test_node->GetName() + "_out" + std::to_string(test_node->GetOutputNum());
+
+    test_node->AddOutputTensor(create_test_tensor(name, data, dims, dim_number, get_test_layout(test_node)));
+
+    return 0;
+}
+
+int test_node_infer_output_shape(test_node_t node, int idx, int dims[], int max_dim_number)
+{
+    Node* test_node = ( Node* )node;
+    Operator* op = test_node->GetOp();
+
+    std::vector<TShape> ishape;
+    std::vector<TShape> oshape(op->GetOutputNum());
+
+    for(unsigned int i = 0; i < test_node->GetInputNum(); i++)
+        ishape.push_back(test_node->GetInputTensor(i)->GetShape());
+
+    if(idx < 0 || idx >= ( int )oshape.size() || !op->InferShape(ishape, oshape, get_test_layout(test_node)))
+        return -1;
+
+    const std::vector<int>& out_dims = oshape[idx].GetDim();
+    int dim_number = out_dims.size();
+
+    if(dim_number > max_dim_number)
+        return -1;
+
+    for(int i = 0; i < dim_number; i++)
+        dims[i] = out_dims[i];
+
+    return dim_number;
+}
+
+int test_node_set_ops(test_node_t node, const char* registry_name, int priority)
+{
+    Node* test_node = ( Node* )node;
+
+    test_node->SetAttr(ATTR_OPS_REGISTRY, std::string(registry_name));
+
+    if(priority >= 0)
+        test_node->SetAttr(ATTR_OPS_PRIORITY, priority);
+    else
+        test_node->RemoveAttr(ATTR_OPS_PRIORITY);
+
+    return 0;
+}
+
+int test_get_ops_priority(const char* registry_name, const char* op_name, int priority[], int max_number)
+{
+    std::vector<int> prio_list = NodeOpsRegistryManager::GetPriorityList(registry_name, op_name);
+    int number = std::min(( int )prio_list.size(), max_number);
+
+    for(int i = 0; i < number; i++)
+        priority[i] = prio_list[i];
+
+    return number;
+}
+
+int test_get_registry_names(const char* names[], int max_number)
+{
+    static std::vector<std::string> name_list;
+
+    name_list = NodeOpsRegistryManager::GetRegistryNames();
+
+    int number = std::min(( int )name_list.size(), max_number);
+
+    for(int i = 0; i < number; i++)
+        names[i] = name_list[i].c_str();
+
+    return number;
+}
+
+const char* test_node_get_ops_name(test_node_t node)
+{
+    Node* test_node = ( Node* )node;
+
+    if(!test_node->ExistAttr(ATTR_NODE_OPS))
+        return nullptr;
+
+    if(!test_node->ExistAttr("TEST_OPS_NAME"))
+    {
+        NodeOps* node_ops = any_cast<NodeOps*>(test_node->GetAttr(ATTR_NODE_OPS));
+        const char* mangled = typeid(*node_ops).name();
+        int status;
+        char* name = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+
+        test_node->SetAttr("TEST_OPS_NAME", std::string(status == 0 ? name : mangled));
+
+        free(name);
+    }
+
+    return any_cast<std::string>(&test_node->GetAttr("TEST_OPS_NAME"))->c_str();
+}
+
+int test_node_do_dump(test_node_t node, int action)
+{
+    Node* test_node = ( Node* )node;
+
+    if(!test_node->ExistAttr(ATTR_NODE_OPS))
+    {
+        set_tengine_errno(EAGAIN);
+        return -1;
+    }
+
+    NodeOps* node_ops = any_cast<NodeOps*>(test_node->GetAttr(ATTR_NODE_OPS));
+    bool ret;
+
+    switch(action)
+    {
+        case NODE_DUMP_ACTION_DISABLE:
+            ret = node_ops->DisableDump(test_node);
+            break;
+        case NODE_DUMP_ACTION_ENABLE:
+            ret = node_ops->EnableDump(test_node);
+            break;
+        case NODE_DUMP_ACTION_START:
+            ret = node_ops->StartDump(test_node);
+            break;
+        case NODE_DUMP_ACTION_STOP:
+            ret = node_ops->StopDump(test_node);
+            break;
+        default:
+            set_tengine_errno(EINVAL);
+            return -1;
+    }
+
+    return ret ? 0 : -1;
+}
+
+int test_node_get_dump(test_node_t node, void** buf, int buf_size)
+{
+    Node* test_node = ( Node* )node;
+
+    if(!test_node->ExistAttr(ATTR_NODE_OPS))
+    {
+        set_tengine_errno(EAGAIN);
+        return -1;
+    }
+
+    NodeOps* node_ops = any_cast<NodeOps*>(test_node->GetAttr(ATTR_NODE_OPS));
+
+    return node_ops->GetDump(test_node, buf, buf_size);
+}
+
 static int test_conv_node_set_input(Node* node, float* input_data[], int* input_shape[], int input_number)
 {
     // input
@@ -187,11 +457,9 @@ static Graph* create_test_graph(Node* node)
 {
     Graph* graph = new Graph(node->GetName());
 
-    node->SetNodeIndex(0);
-    graph->seq_nodes.push_back(node);
-
-    graph->AddInputNode(node);
-    graph->AddOutputNode(node);
+    /* test tensors are NCHW, unless set by test_node_set_layout() */
+    graph->SetModelFormat(MODEL_FORMAT_TENGINE);
+    graph->SetLayout(get_test_layout(node));
 
     /* for all tensors */
 
@@ -199,12 +467,34 @@ static Graph* create_test_graph(Node* node)
     {
         Tensor* tensor = node->GetInputTensor(i);
         graph->AddTensorMap(tensor->GetName(), tensor);
+
+        /* the graph walks from the inputs to their producers: give each a Const node */
+
+        Node* const_node = new Node(tensor->GetName() + "_const");
+
+        const_node->SetOp(OpManager::CreateOp("Const"));
+        const_node->AddOutputTensor(tensor);
+        const_node->SetNodeIndex(graph->seq_nodes.size());
+
+        tensor->producer = const_node->GetOutputPort(0);
+        tensor->consumer.assign(1, node->GetInputPort(i));
+
+        graph->seq_nodes.push_back(const_node);
+        graph->SetNodeOwner(const_node);
+        graph->AddInputNode(const_node);
     }
 
+    node->SetNodeIndex(graph->seq_nodes.size());
+    graph->seq_nodes.push_back(node);
+
+    graph->AddOutputNode(node);
+
     for(unsigned int i = 0; i < node->GetOutputNum(); i++)
     {
         Tensor* tensor = node->GetOutputTensor(i);
         graph->AddTensorMap(tensor->GetName(), tensor);
+
+        tensor->producer = node->GetOutputPort(i);
     }
 
     return graph;
@@ -224,6 +514,10 @@ int test_node_prerun(test_node_t node)
     if(!executor->AttachGraph(exec_context, graph) || !executor->Prerun())
     {
         std::cout << "Prerun failed\n";
+
+        delete executor;
+        delete graph;
+
         return -1;
     }
 
@@ -317,12 +611,15 @@ void destroy_test_node(test_node_t node)
 
     /* releaset graph executor & graph */
 
-    GraphExecutor* executor = any_cast<GraphExecutor*>(test_node->GetAttr("TEST_EXECUTOR"));
+    if(test_node->ExistAttr("TEST_EXECUTOR"))
+    {
+        GraphExecutor* executor = any_cast<GraphExecutor*>(test_node->GetAttr("TEST_EXECUTOR"));
 
-    Graph* graph = executor->GetGraph();
+        Graph* graph = executor->GetGraph();
 
-    delete executor;
-    delete graph;
+        delete executor;
+        delete graph;
+    }
 
     /* free tensor */
 
@@ -21,6 +21,9 @@
  * Copyright (c) 2017, Open AI Lab
  * Author: haitao@openailab.com
  */
+#include <cstring>
+#include <vector>
+
 #include "graph.hpp"
 
 #include "tensor_mem.hpp"
@@ -32,12 +35,7 @@ void* get_tensor_mem(const Tensor* tensor)
     if(tensor->GetType() == kConstTensor)
         return tensor->GetMemAddr();
 
-    TensorMemPtr ptr;
-
-    if(get_tensor_memptr(tensor, ptr) && ptr.get() != nullptr)
-        return ptr.get()->GetMem();
-
-    return nullptr;
+    return tensor->GetDataMem();
 }
 
 int get_tensor_mem_size(const Tensor* tensor)
@@ -45,23 +43,7 @@ int get_tensor_mem_size(const Tensor* tensor)
     if(tensor->GetType() == kConstTensor)
         return tensor->GetTotalSize();
 
-    TensorMemPtr ptr;
-
-    if(get_tensor_memptr(tensor, ptr) && ptr.get() != nullptr)
-        return ptr.get()->GetSize();
-    else
-        return 0;
-}
-
-bool get_tensor_memptr(const Tensor* tensor, TensorMemPtr& ptr)
-{
-    if(tensor->ExistAttr("tensor_mem"))
-    {
-        ptr = any_cast<TensorMemPtr>(tensor->GetAttr("tensor_mem"));
-        return true;
-    }
-
-    return false;
+    return tensor->GetDataMemSize();
 }
 
 bool set_tensor_mem(Tensor* tensor, void* addr, int size, mem_release_t releaser)
@@ -81,27 +63,70 @@ bool set_tensor_mem(Tensor* tensor, void* addr, int size, mem_release_t releaser
         return true;
     }
 
-    TensorMemPtr ptr(new TensorMem());
+    tensor->SetDataMem(addr, size, releaser);
 
-    ptr.get()->SetMem(addr, size, releaser);
+    return true;
+}
 
-    set_tensor_mem(tensor, ptr);
+void free_tensor_mem(Tensor* tensor)
+{
+    if(tensor->GetType() == kConstTensor)
+        return;
 
-    return true;
+    tensor->ReleaseDataMem();
 }
 
-void set_tensor_mem(Tensor* tensor, const TensorMemPtr& ptr)
+/* tensor attr: the NCHW copy of a blocked tensor, see get_tensor_nchw_mem() */
+#define ATTR_NCHW_MEM "NCHWMem"
+
+static void unblock_tensor_data(const Tensor* tensor, const float* blocked, float* nchw)
 {
-    tensor->SetAttr("tensor_mem", ptr);
+    const std::vector<int>& dims = tensor->GetShape().GetDim();
+    int batch = dims[0];
+    int channel = dims[1];
+    int hw = dims[2] * dims[3];
+
+    for(int n = 0; n < batch; n++)
+    {
+        for(int c = 0; c < channel; c++)
+        {
+            int block_c = c / BLOCKED_LAYOUT_C * BLOCKED_LAYOUT_C;
+            const float* src = blocked + (n * channel + block_c) * hw + c % BLOCKED_LAYOUT_C;
+            float* dst = nchw + (n * channel + c) * hw;
+
+            for(int i = 0; i < hw; i++)
+                dst[i] = src[i * BLOCKED_LAYOUT_C];
+        }
+    }
 }
 
-void free_tensor_mem(Tensor* tensor)
+void* get_tensor_nchw_mem(Tensor* tensor)
 {
-    if(tensor->GetType() == kConstTensor)
-        return;
+    void* addr = get_tensor_mem(tensor);
+
+    if(addr == nullptr || !tensor->ExistAttr(ATTR_BLOCKED_LAYOUT))
+        return addr;
 
-    if(tensor->ExistAttr("tensor_mem"))
-        tensor->RemoveAttr("tensor_mem");
+    if(!tensor->ExistAttr(ATTR_NCHW_MEM))
+        tensor->SetAttr(ATTR_NCHW_MEM, std::vector<float>());
+
+    std::vector<float>& nchw = any_cast<std::vector<float>&>(tensor->GetAttr(ATTR_NCHW_MEM));
+
+    nchw.resize(tensor->GetShape().GetSize());
+
+    unblock_tensor_data(tensor, ( const float* )addr, nchw.data());
+
+    return nchw.data();
+}
+
+void copy_tensor_nchw(const Tensor* tensor, void* dst)
+{
+    const void* addr = get_tensor_mem(tensor);
+
+    if(tensor->ExistAttr(ATTR_BLOCKED_LAYOUT))
+        unblock_tensor_data(tensor, ( const float* )addr, ( float* )dst);
+    else
+        memcpy(dst, addr, tensor->GetTotalSize());
 }
 
 }    // namespace TEngine
@@ -31,6 +31,7 @@
 #include "graph.hpp"
 #include "node_ops.hpp"
 #include "operator/convolution.hpp"
+#include "conv_dw_kernel.h"
 #include <math.h>
 namespace TEngine {
 
@@ -63,11 +64,17 @@ struct Conv2dDepth : public NodeOps
     bool Run(Node* node);
 
     int activation;
+    bool asm_kernel;    // k3s1p1/k3s2p1 has hand-written kernels
+    dw_conv_shape shape;
 
     void DirectConv(float* input_buf, int input_h, int input_w, float* output_buf, int output_h, int output_w,
                     float* weight_buf, int channel_num, int stride, float* bias);
 
     bool Aider(int cpu, int seq, void* data);
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<dw_param> param_list;
 };
 
 bool Conv2dDepth::Aider(int cpu, int seq, void* data)
@@ -86,6 +93,12 @@ void Conv2dDepth::DirectConv(float* input_buf, int input_h, int input_w, float*
     int channel_size = input_h * input_w;
     float* bias_tmp = bias;
 
+    if(!asm_kernel)
+    {
+        dw_conv_channels(input_buf, output_buf, weight_buf, bias, channel_num, &shape);
+        return;
+    }
+
     for(int i = 0; i < channel_num; i++)
     {
         if(NULL != bias)
@@ -152,8 +165,23 @@ bool Conv2dDepth::Run(Node* node)
     float* output_buf = ( float* )get_tensor_mem(output_tensor);
 
     int stride_h = param->stride_h;
+    int kernel_hw = param->kernel_h * param->kernel_w;
     int cpu_number = cpu_info->GetCPUNumber();
 
+    shape.in_h = input_h;
+    shape.in_w = input_w;
+    shape.out_h = output_h;
+    shape.out_w = output_w;
+    shape.kernel_h = param->kernel_h;
+    shape.kernel_w = param->kernel_w;
+    shape.stride_h = param->stride_h;
+    shape.stride_w = param->stride_w;
+    shape.dilation_h = param->dilation_h;
+    shape.dilation_w = param->dilation_w;
+    shape.pad_top = param->pads[0];
+    shape.pad_left = param->pads[1];
+    shape.activation = activation;
+
     float* bias = NULL;
     // get bias
     if(node->GetInputNum() > 2)
@@ -170,11 +198,7 @@ bool Conv2dDepth::Run(Node* node)
         else
         {
             // partition into 4 tasks
-            std::vector<sub_op_task> task_list;
-            std::vector<dw_param> param_list;
-
-            auto f = std::bind(&Conv2dDepth::Aider, this, std::placeholders::_1, std::placeholders::_2,
-                               std::placeholders::_3);
+            auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
 
             task_list.resize(cpu_number);
             param_list.resize(cpu_number);
@@ -206,11 +230,8 @@ bool Conv2dDepth::Run(Node* node)
                     param->bias = NULL;
 
                 input_buf += channel_size * step;
-                if(stride_h == 1)
-                    output_buf += channel_size * step;
-                else
-                    output_buf += output_h * output_w * step;
-                weight_buf += 9 * step;
+                output_buf += output_h * output_w * step;
+                weight_buf += kernel_hw * step;
             }
 
             // the last left ones
@@ -225,10 +246,20 @@ bool Conv2dDepth::Run(Node* node)
     return true;
 }
 
-static bool isDepthwiseSupported(const ConvParam* param, const TShape& input_shape)
+static bool isDepthwiseSupported(const ConvParam* param, const TShape& input_shape, const TShape& output_shape)
 {
     int input_c = input_shape.GetC();
+    int output_c = output_shape.GetC();
     int group = param->group;
+
+    if(group == 1 || input_c != group || output_c != input_c)
+        return false;
+
+    return true;
+}
+
+static bool isAsmKernelSupported(const ConvParam* param)
+{
     int kernel_h = param->kernel_h;
     int kernel_w = param->kernel_w;
     int stride_h = param->stride_h;
@@ -240,8 +271,8 @@ static bool isDepthwiseSupported(const ConvParam* param, const TShape& input_sha
     int pad_h1 = param->pads[2];
     int pad_w1 = param->pads[3];
 
-    if(group == 1 || input_c != group || kernel_h != 3 || kernel_w != 3 || pad_h0 != 1 || pad_w0 != 1 ||
-       pad_h0 != pad_h1 || pad_w0 != pad_w1 || dilation_h != 1 || dilation_w != 1 || stride_w != stride_h)
+    if(kernel_h != 3 || kernel_w != 3 || pad_h0 != 1 || pad_w0 != 1 || pad_h0 != pad_h1 || pad_w0 != pad_w1 ||
+       dilation_h != 1 || dilation_w != 1 || stride_w != stride_h || (stride_h != 1 && stride_h != 2))
     {
         return false;
     }
@@ -262,13 +293,15 @@ NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
     ConvParam* param = conv_op->GetParam();
 
     const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
 
-    if(!isDepthwiseSupported(param, input_shape))
+    if(!isDepthwiseSupported(param, input_shape, output_shape))
         return nullptr;
 
     Conv2dDepth* ops = new Conv2dDepth();
 
     ops->activation = param->activation;
+    ops->asm_kernel = isAsmKernelSupported(param);
 
     ops->need_free = true;
 
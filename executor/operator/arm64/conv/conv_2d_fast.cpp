@@ -29,6 +29,7 @@
 #include "logger.hpp"
 #include "node_ops.hpp"
 #include "tensor_mem.hpp"
+#include "mem_account.hpp"
 
 #include "graph.hpp"
 #include "operator/convolution.hpp"
@@ -52,15 +53,18 @@ namespace conv_fast {
 const char* conv_name = "CONV_FAST";
 const int default_prio = 1000;
 
+/* bytes of the largest im2col buffer built in one piece */
+#define CONV_FAST_COL_BUDGET (32 << 20)
+
 void im2col(float* im, float* col, int input_chan, int input_x, int input_y, int kernel_x, int kernel_y, int stride_x,
             int stride_y, int dilation_x, int dilation_y, int pad_x0, int pad_x1, int pad_y0, int pad_y1, int output_x,
-            int output_y, int col_start, int col_end)
+            int output_y, int col_start, int col_end, int col_base)
 {
     int kernel_size = kernel_x * kernel_y * input_chan;
     int input_xy = input_x * input_y;
     int pad_x = pad_x0;
     int pad_y = pad_y0;
-    float* cur_col = col + col_start * kernel_size;
+    float* cur_col = col + (col_start - col_base) * kernel_size;
     bool is_1x1 = (kernel_x == 1) && (kernel_y == 1) && (stride_x == 1) && (stride_y == 1);
     bool is_dilation = (dilation_x != 1) || (dilation_y != 1);
     bool is_3x3 = (kernel_x == 3) && (kernel_y == 3) && (!is_dilation);
@@ -98,7 +102,7 @@ void im2col(float* im, float* col, int input_chan, int input_x, int input_y, int
         bool is_pad0 = (pad_x0 == 0) && (pad_y0 == 0) && (pad_x1 == 0) && (pad_y1 == 0);
         for(col_i = (col_start & -4); col_i < (col_end & -4); col_i += 4)
         {
-            cur_col = col + col_i * kernel_size;
+            cur_col = col + (col_i - col_base) * kernel_size;
             int imy0 = col_i / output_x;
             int imy3 = (col_i + 3) / output_x;
             int imx0 = col_i - imy0 * output_x;
@@ -343,8 +347,8 @@ void interleave_kernel(float* kernel, float* kernel_interleaved, int kernel_chan
 }
 
 static void sgemm4x16(float* col, float* kernel, float* biases, bool bias_term, float* output, int kernel_size,
-                      int col_start, int col_end, int kernel_start, int kernel_end, int output_xy, int activation,
-                      int cpu_type)
+                      int col_start, int col_end, int col_base, int kernel_start, int kernel_end, int output_xy,
+                      int activation, int cpu_type)
 {
     float initial[64], result[64];
     int col_line, kernel_num;
@@ -360,7 +364,7 @@ static void sgemm4x16(float* col, float* kernel, float* biases, bool bias_term,
 
         for(col_line = (col_start & -4); col_line < (col_end & -4); col_line += 4)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
             if(activation >= 0)
                 sgemm_4x16_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
             else
@@ -393,7 +397,7 @@ static void sgemm4x16(float* col, float* kernel, float* biases, bool bias_term,
         }
         if(col_end & 0x3)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
 
             if(activation >= 0)
                 sgemm_4x16_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
@@ -414,8 +418,8 @@ static void sgemm4x16(float* col, float* kernel, float* biases, bool bias_term,
 }
 
 static void sgemm4x4(float* col, float* kernel, float* biases, bool bias_term, float* output, int kernel_size,
-                     int col_start, int col_end, int kernel_start, int kernel_end, int output_xy, int activation,
-                     int cpu_type)
+                     int col_start, int col_end, int col_base, int kernel_start, int kernel_end, int output_xy,
+                     int activation, int cpu_type)
 {
     float initial[16], result[16];
     int col_line, kernel_num;
@@ -430,7 +434,7 @@ static void sgemm4x4(float* col, float* kernel, float* biases, bool bias_term, f
         cur_kernel = ( float* )(kernel + kernel_num * kernel_size);
         for(col_line = (col_start & -4); col_line < (col_end & -4); col_line += 4)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
 
             if(activation >= 0)
                 sgemm_4x4_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
@@ -464,7 +468,7 @@ static void sgemm4x4(float* col, float* kernel, float* biases, bool bias_term, f
         }
         if(col_end & 0x3)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
             if(activation >= 0)
                 sgemm_4x4_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
             else
@@ -491,7 +495,7 @@ static void sgemm4x4(float* col, float* kernel, float* biases, bool bias_term, f
         cur_kernel = ( float* )(kernel + kernel_num * kernel_size);
         for(col_line = (col_start & -4); col_line < (col_end & -4); col_line += 4)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
 
             if(activation >= 0)
                 sgemm_4x4_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
@@ -525,7 +529,7 @@ static void sgemm4x4(float* col, float* kernel, float* biases, bool bias_term, f
         }
         if(col_end & 0x3)
         {
-            cur_col = ( float* )(col + col_line * kernel_size);
+            cur_col = ( float* )(col + (col_line - col_base) * kernel_size);
             if(activation >= 0)
                 sgemm_4x4_interleave_relu_fused(bias_term, initial, cur_col, cur_kernel, result, kernel_size);
             else
@@ -579,6 +583,7 @@ struct sgemm_param
     int kernel_size;
     int col_start;
     int col_end;
+    int col_base;
     int kernel_start;
     int kernel_end;
     int output_xy;
@@ -608,6 +613,15 @@ struct ConvFast : public MTNodeOps
     bool GetSharedMemorySize(Node*, unsigned int& mem_size) override;
     bool SetSharedMemoryAddr(Node*, void* mem_addr, int mem_size) override;
 
+    /* columns of one L2 cache block */
+    int GetColBlock(int kernel_size);
+
+    /*
+       in low_mem_mode, or when the whole im2col buffer is over budget, only one L2
+       block of columns is packed at a time, just before its sgemm
+     */
+    bool IsColTiled(int kernel_size, int output_xy);
+
     bool float_mode;
     bool im2col_aider(int cpu, int seq, void* data /* im2col_param * param */);
     bool sgemm_aider(int cpu, int seq, void* data /* sgemm_param * param */);
@@ -615,6 +629,11 @@ struct ConvFast : public MTNodeOps
 
     int activation;
     bool dynamic_shape;
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<im2col_param> im2col_param_list;
+    std::vector<sgemm_param> param_list;
 };
 
 bool ConvFast::im2col_aider(int cpu, int seq, void* data)
@@ -622,7 +641,7 @@ bool ConvFast::im2col_aider(int cpu, int seq, void* data)
     im2col_param* param = ( im2col_param* )(data);
     im2col(param->im, param->col, param->input_chan, param->input_x, param->input_y, param->kernel_x, param->kernel_y,
            param->stride_x, param->stride_y, param->dilation_x, param->dilation_y, param->pad_x0, param->pad_x1,
-           param->pad_y0, param->pad_y1, param->output_x, param->output_y, param->col_start, param->col_end);
+           param->pad_y0, param->pad_y1, param->output_x, param->output_y, param->col_start, param->col_end, 0);
 
     return true;
 }
@@ -633,8 +652,8 @@ bool ConvFast::sgemm4x4_aider(int cpu, int seq, void* data)
     sgemm_param* param = ( sgemm_param* )(data);
 
     sgemm4x4(param->col, param->kernel, param->biases, param->bias_term, param->output, param->kernel_size,
-             param->col_start, param->col_end, param->kernel_start, param->kernel_end, param->output_xy, activation,
-             cpu_type);
+             param->col_start, param->col_end, param->col_base, param->kernel_start, param->kernel_end,
+             param->output_xy, activation, cpu_type);
 
     return true;
 }
@@ -645,12 +664,35 @@ bool ConvFast::sgemm_aider(int cpu, int seq, void* data)
     sgemm_param* param = ( sgemm_param* )(data);
 
     sgemm4x16(param->col, param->kernel, param->biases, param->bias_term, param->output, param->kernel_size,
-              param->col_start, param->col_end, param->kernel_start, param->kernel_end, param->output_xy, activation,
-              cpu_type);
+              param->col_start, param->col_end, param->col_base, param->kernel_start, param->kernel_end,
+              param->output_xy, activation, cpu_type);
 
     return true;
 }
 
+int ConvFast::GetColBlock(int kernel_size)
+{
+    int cpu_type;
+
+    if(cpu_info->GetCPUModel(cpu_info->GetMasterCPU()) == CPU_A72)
+        cpu_type = TYPE_A72;
+    else
+        cpu_type = TYPE_A53;
+
+    int L2_CACHE_SIZE = (cpu_type == TYPE_A53) ? 512 * 1024 : 1024 * 1024;
+    int col_cnt_l2 = L2_CACHE_SIZE / 4 / kernel_size * 7 / 8;
+
+    return col_cnt_l2 > 4 ? (col_cnt_l2 & -4) : 4;
+}
+
+bool ConvFast::IsColTiled(int kernel_size, int output_xy)
+{
+    if(exec_attr->low_mem_mode)
+        return true;
+
+    return ( long )sizeof(float) * kernel_size * output_xy > CONV_FAST_COL_BUDGET;
+}
+
 bool ConvFast::Prerun(Node* node)
 {
     Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
@@ -682,6 +724,8 @@ bool ConvFast::Prerun(Node* node)
 
             GetSharedMemorySize(node, col_size);
 
+            MemTag mem_tag(MEM_STAT_SCRATCH);
+
             float* col_buf = ( float* )mem_alloc(col_size);
             (*node)["col_buf"] = col_buf;
             node->SetAttr("col_buf_allocated", col_size);
@@ -803,10 +847,8 @@ bool ConvFast::Run(Node* node)
         cpu_type = TYPE_A53;
 
     /* block size split parameter */
-    int L2_CACHE_SIZE = (cpu_type == TYPE_A53) ? 512 * 1024 : 1024 * 1024;
-    int kernel_size_l1 = kernel_size;
-    int col_cnt_l2 = L2_CACHE_SIZE / 4 / kernel_size_l1 * 7 / 8;
-    col_cnt_l2 = col_cnt_l2 > 4 ? (col_cnt_l2 & -4) : 4;
+    int col_cnt_l2 = GetColBlock(kernel_size);
+    bool col_tiled = IsColTiled(kernel_size, output_xy);
 
     /* one image per time */
     for(int i = 0; i < output_n; i++)
@@ -819,16 +861,16 @@ bool ConvFast::Run(Node* node)
             float* input_g = input + g * input_size;
             int total_num = output_xy * input_chan * kernel_x * kernel_y;
 
-            if(cpu_number == 1 || total_num < 100 * 1000)
+            if(col_tiled)
+            {
+                /* packed block by block, below */
+            }
+            else if(cpu_number == 1 || total_num < 100 * 1000)
                 im2col(input_g, col, input_chan, input_w, input_h, kernel_x, kernel_y, stride_x, stride_y, dilation_x,
-                       dilation_y, pad_x0, pad_x1, pad_y0, pad_y1, output_x, output_y, 0, output_xy);
+                       dilation_y, pad_x0, pad_x1, pad_y0, pad_y1, output_x, output_y, 0, output_xy, 0);
             else
             {
-                std::vector<sub_op_task> task_list;
-                std::vector<im2col_param> param_list;
-
-                auto f = std::bind(&ConvFast::im2col_aider, this, std::placeholders::_1, std::placeholders::_2,
-                                   std::placeholders::_3);
+                auto f = [this](int cpu, int seq, void* data) { return im2col_aider(cpu, seq, data); };
 
                 int steps = output_xy / cpu_number;
 
@@ -848,11 +890,11 @@ bool ConvFast::Run(Node* node)
                 }
 
                 task_list.resize(real_cpu_number);
-                param_list.resize(real_cpu_number);
+                im2col_param_list.resize(real_cpu_number);
 
                 for(int i = 0; i < real_cpu_number; i++)
                 {
-                    im2col_param* param = &param_list[i];
+                    im2col_param* param = &im2col_param_list[i];
                     sub_op_task* task = &task_list[i];
 
                     task->exec_func = f;
@@ -880,7 +922,7 @@ bool ConvFast::Run(Node* node)
                     param->col_end = param->col_start + steps;
                 }
 
-                param_list[real_cpu_number - 1].col_end = output_xy;
+                im2col_param_list[real_cpu_number - 1].col_end = output_xy;
 
                 task_dispatch(task_list, -1);
                 wait_done();
@@ -890,8 +932,7 @@ bool ConvFast::Run(Node* node)
             float* output_g = output + g * output_xy * output_chan;
             float* bias_g = biases + g * output_chan;
 
-            std::vector<sub_op_task> task_list;
-            std::vector<sgemm_param> param_list;
+            task_list.clear();
 
             int chan_16_num = output_chan / 16;
             int chan_4_num = (output_chan & 0xf) ? 1 : 0;
@@ -908,18 +949,25 @@ bool ConvFast::Run(Node* node)
                 int col_end = col_i + col_cnt_l2;
                 col_end = col_end > output_xy ? output_xy : col_end;
 
+                /* the column at the buffer start: tiled, each block is packed from there */
+                int col_base = col_tiled ? col_start : 0;
+
+                if(col_tiled)
+                    im2col(input_g, col, input_chan, input_w, input_h, kernel_x, kernel_y, stride_x, stride_y,
+                           dilation_x, dilation_y, pad_x0, pad_x1, pad_y0, pad_y1, output_x, output_y, col_start,
+                           col_end, col_base);
+
                 if(cpu_number == 1)
                 {
-                    sgemm4x16(col, kernel_g, bias_g, have_biases, output_g, kernel_size, col_start, col_end, 0,
-                              output_chan & -16, output_xy, activation, cpu_type);
+                    sgemm4x16(col, kernel_g, bias_g, have_biases, output_g, kernel_size, col_start, col_end, col_base,
+                              0, output_chan & -16, output_xy, activation, cpu_type);
                     if(output_chan & 0xf)
                         sgemm4x4(col, kernel_g, bias_g, have_biases, output_g, kernel_size, col_start, col_end,
-                                 output_chan & -16, output_chan, output_xy, activation, cpu_type);
+                                 col_base, output_chan & -16, output_chan, output_xy, activation, cpu_type);
                 }
                 else
                 {
-                    auto f = std::bind(&ConvFast::sgemm_aider, this, std::placeholders::_1, std::placeholders::_2,
-                                       std::placeholders::_3);
+                    auto f = [this](int cpu, int seq, void* data) { return sgemm_aider(cpu, seq, data); };
 
                     for(int i = 0; i < chan_16_num; i++)
                     {
@@ -938,6 +986,7 @@ bool ConvFast::Run(Node* node)
                         param->kernel_size = kernel_size;
                         param->col_start = col_start;
                         param->col_end = col_end;
+                        param->col_base = col_base;
                         param->kernel_start = i * 16;
                         param->kernel_end = param->kernel_start + 16;
                         param->output_xy = output_xy;
@@ -947,8 +996,7 @@ bool ConvFast::Run(Node* node)
 
                     if(output_chan & 0xf)
                     {
-                        auto f = std::bind(&ConvFast::sgemm4x4_aider, this, std::placeholders::_1,
-                                           std::placeholders::_2, std::placeholders::_3);
+                        auto f = [this](int cpu, int seq, void* data) { return sgemm4x4_aider(cpu, seq, data); };
                         sub_op_task tmp_task;
                         sgemm_param* param = &param_list[task_list.size()];
                         sub_op_task* task = &tmp_task;
@@ -964,16 +1012,25 @@ bool ConvFast::Run(Node* node)
                         param->kernel_size = kernel_size;
                         param->col_start = col_start;
                         param->col_end = col_end;
+                        param->col_base = col_base;
                         param->kernel_start = output_chan & -16;
                         param->kernel_end = output_chan;
                         param->output_xy = output_xy;
 
                         task_list.emplace_back(tmp_task);
                     }
+
+                    /* the next block is packed into the same buffer */
+                    if(col_tiled)
+                    {
+                        task_dispatch(task_list, -1);
+                        wait_done();
+                        task_list.clear();
+                    }
                 }
             }
 
-            if(cpu_number > 1)
+            if(cpu_number > 1 && !col_tiled)
             {
                 task_dispatch(task_list, -1);
                 wait_done();
@@ -1028,6 +1085,9 @@ bool ConvFast::GetSharedMemorySize(Node* node, unsigned int& mem_size)
     int kernel_size = input_chan * param->kernel_h * param->kernel_w;
     int output_xy = output_x * output_y;
 
+    if(IsColTiled(kernel_size, output_xy))
+        output_xy = std::min(output_xy, GetColBlock(kernel_size));
+
     mem_size = (sizeof(float) * (kernel_size * ((output_xy + 3) & -4)) + 128);
 
     return true;
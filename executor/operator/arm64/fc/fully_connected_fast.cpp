@@ -274,22 +274,18 @@ struct FCOps : public MTNodeOps
 
                 step = step * 8;
 
-                std::vector<sub_op_task> task_list;
-                std::vector<SgemvParam> param_list;
-
                 task_list.resize(cpu_number);
                 param_list.resize(cpu_number);
 
                 int start_channel = 0;
 
+                auto f = [this](int cpu, int aider, void* data) { return SgemvAider(cpu, aider, data); };
+
                 for(int i = 0; i < cpu_number; i++)
                 {
                     SgemvParam* param = &param_list[i];
                     sub_op_task* task = &task_list[i];
 
-                    auto f = std::bind(&FCOps::SgemvAider, this, std::placeholders::_1, std::placeholders::_2,
-                                       std::placeholders::_3);
-
                     task->exec_func = f;
                     task->seq = i;
                     task->data = param;
@@ -334,6 +330,10 @@ struct FCOps : public MTNodeOps
 
         return true;
     }
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<SgemvParam> param_list;
 };
 
 NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
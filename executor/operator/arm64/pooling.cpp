@@ -196,14 +196,10 @@ struct PoolingOps : public NodeOps
             }
             else
             {
-                std::vector<sub_op_task> task_list;
-                std::vector<pooling_param> param_list;
-
                 task_list.resize(in_dim[1]);
                 param_list.resize(in_dim[1]);
 
-                auto f = std::bind(&PoolingOps::pooling_aider, this, std::placeholders::_1, std::placeholders::_2,
-                                   std::placeholders::_3);
+                auto f = [this](int cpu, int seq, void* data) { return pooling_aider(cpu, seq, data); };
 
                 for(int i = 0; i < in_dim[1]; i++)
                 {
@@ -239,6 +235,10 @@ struct PoolingOps : public NodeOps
 
         return true;
     }
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<pooling_param> param_list;
 };
 
 const int default_prio = 100;
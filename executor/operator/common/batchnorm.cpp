@@ -30,16 +30,30 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "operator/batch_norm.hpp"
+#include "channel_affine.hpp"
 #include <cmath>
 
 namespace TEngine {
 
 namespace BatchNormImpl {
 
-struct BatchNormOps : public NodeOps
+struct BatchNormOps : public ChannelAffineOps
 {
-    bool Prerun(Node* node)
+    int GetBlockedLayoutSupport(Node* node) override
     {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    /* fold mean, var, gamma and beta into output = input * mul[c] + add[c] */
+    bool Prerun(Node* node) override
+    {
+        in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+
         const Tensor* input_tensor = node->GetInputTensor(0);
         const TShape& shape = input_tensor->GetShape();
 
@@ -47,8 +61,8 @@ struct BatchNormOps : public NodeOps
 
         int channel_num = dims[1];
 
-        float* scale_mean = ( float* )mem_alloc(channel_num * sizeof(float));
-        float* scale_var_inv = ( float* )mem_alloc(channel_num * sizeof(float));
+        mul = ( float* )mem_alloc(channel_num * 2 * sizeof(float));
+        add = mul + channel_num;
 
         const Tensor* mean_tensor = node->GetInputTensor(3);
         const Tensor* var_tensor = node->GetInputTensor(4);
@@ -64,105 +78,57 @@ struct BatchNormOps : public NodeOps
         rescale_factor = param->rescale_factor ? 1 / param->rescale_factor : 0;
         for(int c = 0; c < channel_num; c++)
         {
-            scale_var_inv[c] = 1.f / sqrt(var[c] * rescale_factor + eps);
-            scale_mean[c] = -mean[c] * rescale_factor * scale_var_inv[c];
+            mul[c] = 1.f / sqrt(var[c] * rescale_factor + eps);
+            add[c] = -mean[c] * rescale_factor * mul[c];
         }
 
-        node->SetAttr("scale_mean", scale_mean);
-        node->SetAttr("scale_var_inv", scale_var_inv);
+        /* caffe flavor: only use mean and var */
+        if(!param->caffe_flavor)
+        {
+            const float* gamma = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+            const float* beta = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+            for(int c = 0; c < channel_num; c++)
+            {
+                add[c] = beta[c] + gamma[c] * add[c];
+                mul[c] = gamma[c] * mul[c];
+            }
+        }
 
         return true;
     }
 
-    bool Run(Node* node)
+    bool Run(Node* node) override
     {
         const Tensor* input_tensor = node->GetInputTensor(0);
         Tensor* output_tensor = node->GetOutputTensor(0);
         const TShape& shape = input_tensor->GetShape();
         const std::vector<int> dims = shape.GetDim();
 
-        int batch_number = dims[0];
-        int channel_num = dims[1];
-        int channel_size = dims[2] * dims[3];
-        int img_size = channel_num * channel_size;
-
-        BatchNorm* bn_op = dynamic_cast<BatchNorm*>(node->GetOp());
-        BatchNormParam* param = bn_op->GetParam();
-
         const float* input = ( const float* )get_tensor_mem(input_tensor);
         float* output = ( float* )get_tensor_mem(output_tensor);
 
-        if(param->caffe_flavor)
-        {
-            float* scale_mean = any_cast<float*>(node->GetAttr("scale_mean"));
-            float* scale_var_inv = any_cast<float*>(node->GetAttr("scale_var_inv"));
-
-            /* only use mean and var */
-            for(int i = 0; i < batch_number; i++)
-            {
-                for(int c = 0; c < channel_num; c++)
-                {
-                    float s_mean = scale_mean[c];
-                    float s_var = scale_var_inv[c];
-                    int offset = i * img_size + c * channel_size;
-                    const float* input_ptr = input + offset;
-                    float* output_ptr = output + offset;
-
-                    for(int l = 0; l < channel_size; l++)
-                    {
-                        output_ptr[l] = input_ptr[l] * s_var + s_mean;
-                    }
-                }
-            }
-        }
-        else
-        {
-            float* scale_mean = any_cast<float*>(node->GetAttr("scale_mean"));
-            float* scale_var_inv = any_cast<float*>(node->GetAttr("scale_var_inv"));
+        channel_affine_plan(&plan, dims[0], dims[1], ( long )dims[2] * dims[3], in_blocked);
 
-            const Tensor* gamma_tensor = node->GetInputTensor(1);
-            const Tensor* beta_tensor = node->GetInputTensor(2);
-            const float* gamma = ( const float* )get_tensor_mem(gamma_tensor);
-            const float* beta = ( const float* )get_tensor_mem(beta_tensor);
+        plan.mul = mul;
+        plan.add = add;
 
-            for(int i = 0; i < batch_number; i++)
-            {
-                for(int c = 0; c < channel_num; c++)
-                {
-                    float s_mean = scale_mean[c];
-                    float s_var = scale_var_inv[c];
-                    float s_gamma = gamma[c];
-                    float s_beta = beta[c];
-
-                    float s_val1 = s_beta + s_gamma * s_mean;
-                    float s_val2 = s_gamma * s_var;
-
-                    int offset = i * img_size + c * channel_size;
-                    const float* input_ptr = input + offset;
-                    float* output_ptr = output + offset;
-
-                    for(int l = 0; l < channel_size; l++)
-                    {
-                        // output = val1 + _input * val2
-                        output_ptr[l] = input_ptr[l] * s_val2 + s_val1;
-                    }
-                }
-            }
-        }
+        RunAffine(&plan, input, output);
 
         return true;
     }
 
-    bool Postrun(Node* node)
+    bool Postrun(Node* node) override
     {
-        float* scale_mean = any_cast<float*>(node->GetAttr("scale_mean"));
-        float* scale_var = any_cast<float*>(node->GetAttr("scale_var_inv"));
-
-        mem_free(scale_mean);
-        mem_free(scale_var);
+        mem_free(mul);
 
         return true;
     }
+
+    bool in_blocked;
+    float* mul;
+    float* add;
+    ChannelAffine plan;
 };
 
 }    // namespace BatchNormImpl
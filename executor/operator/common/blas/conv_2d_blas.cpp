@@ -40,6 +40,12 @@ namespace ConvolutionImpl {
 const char* conv_name = "CONV_IMPL";
 const int default_prio = 1200;
 
+/* bytes of the largest im2col matrix built in one piece */
+#define CONV_BLAS_COL_BUDGET (16 << 20)
+
+/* bytes of an im2col column tile, when the matrix is built by tiles */
+#define CONV_BLAS_TILE_SIZE (1 << 20)
+
 struct ConvolutionOps : public NodeOps
 {
     void im2col(float* data_img, float* data_col, int inh, int inw, int inc, int outh, int outw, int outc, int ksize_h,
@@ -105,6 +111,67 @@ struct ConvolutionOps : public NodeOps
             }
         }
     }
+    /*
+       columns [col_start, col_start + col_num) of the im2col matrix, as a [k][col_num] panel.
+       it lets the GEMM run on column tiles, without the whole matrix in memory
+     */
+    void im2col_tile(const float* data_img, float* data_col, int inh, int inw, int inc, int outw, int ksize_h,
+                     int ksize_w, int sh, int sw, int ph, int pw, int dh, int dw, int col_start, int col_num)
+    {
+        const int channels_col = ksize_h * ksize_w * inc;
+        const int col_end = col_start + col_num;
+
+        for(int c = 0; c < channels_col; ++c)
+        {
+            const int kw = c % ksize_w;
+            int c_ = c / ksize_w;
+            const int kh = c_ % ksize_h;
+            c_ = c_ / ksize_h;
+            const float* img = data_img + c_ * inh * inw;
+            float* out = data_col + c * col_num;
+
+            for(int j = col_start; j < col_end;)
+            {
+                const int h = j / outw;
+                const int w_start = j % outw;
+                const int w_end = std::min(outw, w_start + col_end - j);
+                const int im_row = kh * dh + h * sh - ph;
+
+                if(im_row >= 0 && im_row < inh)
+                {
+                    const float* in = img + im_row * inw;
+
+                    for(int w = w_start; w < w_end; w++)
+                    {
+                        const int im_col = kw * dw + w * sw - pw;
+
+                        *(out++) = (im_col >= 0 && im_col < inw) ? in[im_col] : 0.f;
+                    }
+                }
+                else
+                {
+                    memset(out, 0, (w_end - w_start) * sizeof(float));
+                    out += w_end - w_start;
+                }
+
+                j += w_end - w_start;
+            }
+        }
+    }
+
+    /* the im2col columns packed at a time: all of them, unless low_mem_mode or over budget */
+    int GetColNum(int k, int n)
+    {
+        if(!exec_attr->low_mem_mode && ( long )k * n * sizeof(float) <= CONV_BLAS_COL_BUDGET)
+            return n;
+
+        int col_num = CONV_BLAS_TILE_SIZE / (k * sizeof(float));
+
+        col_num = std::max(col_num / 16 * 16, 16);
+
+        return std::min(col_num, n);
+    }
+
     bool Prerun(Node* node)
     {
         Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
@@ -118,24 +185,27 @@ struct ConvolutionOps : public NodeOps
         TShape& shape1 = output_tensor->GetShape();
         std::vector<int> out_dims = shape1.GetDim();
 
-        int size = param->kernel_h * param->kernel_w * in_dims[1] / param->group * out_dims[2] * out_dims[3];
-        float* buffer = ( float* )std::malloc(sizeof(float) * size);
-        (*node)["buffer"] = buffer;
+        int k = param->kernel_h * param->kernel_w * in_dims[1] / param->group;
+        int n = out_dims[2] * out_dims[3];
+
+        col_num = GetColNum(k, n);
+
+        ScratchReserve(sizeof(float) * k * col_num);
+
         return true;
     }
 
     bool Reshape(Node* node)
     {
-        if(node->ExistAttr("buffer"))
-        {
-            float* buffer = any_cast<float*>(node->GetAttr("buffer"));
-            free(buffer);
-            node->RemoveAttr("buffer");
-        }
-
         return Prerun(node);
     }
 
+    /* a tile has less columns than col_num, they are packed by column tiles */
+    bool GetTiledRunSupport(Node* node)
+    {
+        return true;
+    }
+
     bool Run(Node* node)
     {
         bool debug_conv = false;
@@ -148,7 +218,6 @@ struct ConvolutionOps : public NodeOps
         Tensor* input_tensor = node->GetInputTensor(0);
         Tensor* output_tensor = node->GetOutputTensor(0);
         Tensor* weight_tensor = node->GetInputTensor(1);
-        float* buffer = any_cast<float*>(node->GetAttr("buffer"));
 
         Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
         ConvParam* param = conv_op->GetParam();
@@ -206,15 +275,38 @@ struct ConvolutionOps : public NodeOps
                       << " " << dilation_w << " " << group << "\t" << outc << " " << outh << " " << outw << "\t";
         }
 
+        float* buffer = ( float* )ScratchAlloc(sizeof(float) * k * col_num);
+
+        if(buffer == nullptr)
+            return false;
+
         for(int i = 0; i < batch_number; i++)
         {
             for(int g = 0; g < group; g++)
             {
-                im2col(input + i * in_chw + g * in_chw_g, buffer, inh, inw, inc_g, outh, outw, outc_g, ksize_h, ksize_w,
-                       stride_h, stride_w, pad_h, pad_w, dilation_h, dilation_w);
+                float* img = input + i * in_chw + g * in_chw_g;
+                float* out = output + i * out_chw + g * out_chw_g;
+
+                if(col_num == n)
+                {
+                    im2col(img, buffer, inh, inw, inc_g, outh, outw, outc_g, ksize_h, ksize_w, stride_h, stride_w,
+                           pad_h, pad_w, dilation_h, dilation_w);
+
+                    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1, kernel + g * kernel_size_g, k,
+                                buffer, n, 0, out, n);
+                    continue;
+                }
 
-                cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k, 1, kernel + g * kernel_size_g, k,
-                            buffer, n, 0, output + i * out_chw + g * out_chw_g, n);
+                for(int col_start = 0; col_start < n; col_start += col_num)
+                {
+                    int cols = std::min(col_num, n - col_start);
+
+                    im2col_tile(img, buffer, inh, inw, inc_g, outw, ksize_h, ksize_w, stride_h, stride_w, pad_h, pad_w,
+                                dilation_h, dilation_w, col_start, cols);
+
+                    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, cols, k, 1, kernel + g * kernel_size_g,
+                                k, buffer, cols, 0, out + col_start, n);
+                }
             }
         }
         if(have_biases)
@@ -237,13 +329,7 @@ struct ConvolutionOps : public NodeOps
         return true;
     }
 
-    bool Postrun(Node* node)
-    {
-        float* addr;
-        addr = any_cast<float*>(node->GetAttr("buffer"));
-        std::free(addr);
-        return true;
-    }
+    int col_num;
 };
 
 NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
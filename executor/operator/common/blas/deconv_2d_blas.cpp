@@ -59,7 +59,7 @@ struct DeconvBlasOps : public NodeOps
         return true;
     }
 
-    void add_bias(float* output, float* bias, int c_out, int hw)
+    void add_bias(float* output, float* bias, int c_out, int hw, int activation)
     {
         float* out_ptr = output;
         for(int c = 0; c < c_out; ++c)
@@ -67,7 +67,17 @@ struct DeconvBlasOps : public NodeOps
             float val = bias[c];
             for(int i = 0; i < hw; ++i)
             {
-                *out_ptr += val;
+                float v = *out_ptr + val;
+
+                if(activation >= 0)
+                {
+                    if(v < 0)
+                        v = 0;
+                    if(activation > 0 && v > activation)
+                        v = activation;
+                }
+
+                *out_ptr = v;
                 out_ptr++;
             }
         }
@@ -189,7 +199,7 @@ struct DeconvBlasOps : public NodeOps
 
             col2im(buffer, out_ptr, c_out, h_out, w_out, ksize, stride, pad, dilation, h_in, w_in);
 
-            add_bias(out_ptr, bias, c_out, hw_out);
+            add_bias(out_ptr, bias, c_out, hw_out, param_->activation);
         }
 
         return true;
@@ -342,8 +342,8 @@ struct LSTMOps : public NodeOps
 
             if(i + output_len >= seq_lens)
             {
-                memcpy(output, init_h, hidden_size * sizeof(float));
-                output += hidden_size;
+                memcpy(output, init_h, batch_size * hidden_size * sizeof(float));
+                output += batch_size * hidden_size;
             }
         }
 
@@ -458,8 +458,8 @@ struct LSTMOps : public NodeOps
         }
         else
         {
-            memset(init_h, 0x0, sizeof(batch_size * hidden_size * sizeof(float)));
-            memset(init_c, 0x0, sizeof(batch_size * cell_size * sizeof(float)));
+            memset(init_h, 0x0, batch_size * hidden_size * sizeof(float));
+            memset(init_c, 0x0, batch_size * cell_size * sizeof(float));
         }
 
         float* kernel = ( float* )get_tensor_mem(kernel_tensor);
@@ -0,0 +1,192 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <algorithm>
+
+#include "channel_affine.hpp"
+#include "simd_vec.h"
+
+namespace TEngine {
+
+void channel_affine_plan(ChannelAffine* plan, int batch_number, int channel_num, long channel_size, bool blocked)
+{
+    plan->mul = nullptr;
+    plan->add = nullptr;
+    plan->slope = nullptr;
+    plan->slope_value = 0.f;
+    plan->activation = -1;
+
+    plan->batch_number = batch_number;
+    plan->channel_num = channel_num;
+    plan->channel_size = channel_size;
+    plan->blocked = blocked;
+
+    long row_num = blocked ? ( long )batch_number * channel_num / 4 : ( long )batch_number * channel_num;
+    long row_size = blocked ? channel_size * 4 : channel_size;
+
+    plan->chunk_num = std::max((row_size + CHANNEL_AFFINE_UNIT_SIZE - 1) / CHANNEL_AFFINE_UNIT_SIZE, 1L);
+    plan->unit_num = row_num * plan->chunk_num;
+}
+
+void channel_affine_plan(ChannelAffine* plan, long elem_num)
+{
+    channel_affine_plan(plan, 1, 1, elem_num, false);
+}
+
+/* mul, add and slope hold the coefficients of the 4 lanes, the scalar tail uses lane 0 */
+template <bool AFFINE, bool SLOPE>
+static void affine_row(const float* input, float* output, long size, const float* mul, const float* add,
+                       const float* slope, int activation)
+{
+    vf4_t v_mul = vf4_load(mul);
+    vf4_t v_add = vf4_load(add);
+    vf4_t v_slope = vf4_load(slope);
+    vf4_t v_zero = vf4_zero();
+    long i = 0;
+
+    for(; i + 4 <= size; i += 4)
+    {
+        vf4_t v = vf4_load(input + i);
+
+        if(AFFINE)
+            v = vf4_mla(v_add, v, v_mul);
+
+        if(SLOPE)
+            v = vf4_mla(vf4_max(v, v_zero), vf4_min(v, v_zero), v_slope);
+
+        vf4_store(output + i, vf4_activation(v, activation));
+    }
+
+    for(; i < size; i++)
+    {
+        float v = input[i];
+
+        if(AFFINE)
+            v = v * mul[0] + add[0];
+
+        if(SLOPE)
+            v = std::max(v, 0.f) + slope[0] * std::min(v, 0.f);
+
+        output[i] = f_activation(v, activation);
+    }
+}
+
+template <bool AFFINE, bool SLOPE>
+static void affine_run(const ChannelAffine* plan, const float* input, float* output, long unit_start, long unit_end)
+{
+    int lane_num = plan->blocked ? 4 : 1;
+    int row_channels = plan->channel_num / lane_num;
+    long row_size = plan->channel_size * lane_num;
+
+    for(long u = unit_start; u < unit_end; u++)
+    {
+        long row = u / plan->chunk_num;
+        long start = (u % plan->chunk_num) * CHANNEL_AFFINE_UNIT_SIZE;
+        long size = std::min(( long )CHANNEL_AFFINE_UNIT_SIZE, row_size - start);
+        int c = (row % row_channels) * lane_num;
+
+        float mul[4];
+        float add[4];
+        float slope[4];
+
+        for(int l = 0; l < 4; l++)
+        {
+            int k = plan->blocked ? c + l : c;
+
+            mul[l] = plan->mul ? plan->mul[k] : 1.f;
+            add[l] = plan->add ? plan->add[k] : 0.f;
+            slope[l] = plan->slope ? plan->slope[k] : plan->slope_value;
+        }
+
+        long offset = row * row_size + start;
+
+        affine_row<AFFINE, SLOPE>(input + offset, output + offset, size, mul, add, slope, plan->activation);
+    }
+}
+
+void channel_affine_run(const ChannelAffine* plan, const float* input, float* output, long unit_start,
+                        long unit_end)
+{
+    bool affine = plan->mul || plan->add;
+    bool slope = plan->slope || plan->slope_value != 0.f;
+
+    if(affine && slope)
+        affine_run<true, true>(plan, input, output, unit_start, unit_end);
+    else if(affine)
+        affine_run<true, false>(plan, input, output, unit_start, unit_end);
+    else if(slope)
+        affine_run<false, true>(plan, input, output, unit_start, unit_end);
+    else
+        affine_run<false, false>(plan, input, output, unit_start, unit_end);
+}
+
+bool ChannelAffineOps::Aider(int cpu, int seq, void* data)
+{
+    channel_affine_task_param* param = ( channel_affine_task_param* )data;
+
+    channel_affine_run(param->plan, param->input, param->output, param->unit_start, param->unit_end);
+
+    return true;
+}
+
+void ChannelAffineOps::RunAffine(const ChannelAffine* plan, const float* input, float* output)
+{
+    int cpu_number = cpu_info->GetCPUNumber();
+    long total = ( long )plan->batch_number * plan->channel_num * plan->channel_size;
+
+    if(cpu_number == 1 || total < CHANNEL_AFFINE_MT_MIN_SIZE || plan->unit_num < cpu_number)
+    {
+        channel_affine_run(plan, input, output, 0, plan->unit_num);
+        return;
+    }
+
+    auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+    task_list.resize(cpu_number);
+    param_list.resize(cpu_number);
+
+    long step = plan->unit_num / cpu_number;
+
+    for(int i = 0; i < cpu_number; i++)
+    {
+        channel_affine_task_param* p = &param_list[i];
+        sub_op_task* task = &task_list[i];
+
+        task->exec_func = f;
+        task->seq = i;
+        task->data = p;
+
+        p->plan = plan;
+        p->input = input;
+        p->output = output;
+        p->unit_start = i * step;
+        p->unit_end = p->unit_start + step;
+    }
+
+    param_list[cpu_number - 1].unit_end = plan->unit_num;
+
+    task_dispatch(task_list, -1);
+    wait_done();
+}
+
+}    // namespace TEngine
@@ -42,6 +42,18 @@ namespace ConcatImpl {
 
 struct ConcatOps : public NodeOps
 {
+    /* the channel blocks of all inputs stay contiguous when concated on C */
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        Concat* concat_op = dynamic_cast<Concat*>(node->GetOp());
+        ConcatParam* param = concat_op->GetParam();
+
+        if(param->axis == 1 && node->GetOutputTensor(0)->GetShape().GetDim().size() == 4)
+            return BLOCKED_LAYOUT_SAME;
+
+        return BLOCKED_LAYOUT_NONE;
+    }
+
     bool Run(Node* node)
     {
         Tensor* input_tensor = node->GetInputTensor(0);
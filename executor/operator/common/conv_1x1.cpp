@@ -0,0 +1,505 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+#include <vector>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/convolution.hpp"
+
+#include "sgemm_kernel.h"
+
+/*
+ * Float 1x1 convolution without padding, as a GEMM in the NCHW layout.
+ *
+ * For each group, output[OC][HW] = weight[OC][IC] * input[IC][HW]. The
+ * weights are packed once in Prerun as the SGEMM A panels. With stride 1
+ * the input is already a row major B: the micro kernel reads 8 columns of
+ * it in place, so nothing is copied. With a larger stride, or for the last
+ * columns, the 8 input pixels of a B panel are gathered into a small buffer.
+ *
+ * The work is split into units of a block of output channels, whose A
+ * panels stay in cache, times a block of output pixels. Bias and
+ * activation are applied on each output tile while it is in cache.
+ *
+ * Without groups, the input and output may be channel blocked (NCHW4):
+ * a blocked input is always gathered, and the 4 output channels of a
+ * tile are transposed into their block when written.
+ */
+
+namespace TEngine {
+
+namespace conv_1x1 {
+
+const char* conv_name = "CONV_1X1";
+const int default_prio = 800;
+
+/* size of the A panels of one unit */
+#define CONV_1X1_A_BLOCK_SIZE (128 * 1024)
+
+/* output pixels of one unit */
+#define CONV_1X1_COL_BLOCK 64
+
+struct conv_shape
+{
+    int batch;
+    int group;
+    int in_c;
+    int in_h;
+    int in_w;
+    int out_c;
+    int out_h;
+    int out_w;
+    int stride_h;
+    int stride_w;
+    int activation;
+};
+
+struct conv_task_param
+{
+    const float* input;
+    float* output;
+    int unit_start;
+    int unit_end;
+    float* buf;
+};
+
+struct Conv1x1 : public MTNodeOps
+{
+    Conv1x1()
+    {
+        packed_weight = nullptr;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+
+        return conv_op->GetParam()->group == 1 ? BLOCKED_LAYOUT_ANY : BLOCKED_LAYOUT_NONE;
+    }
+
+    /* Run() gets the shape again */
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    bool Aider(int cpu, int seq, void* data);
+
+    void GetShape(Node* node);
+    void RunUnits(const float* input, float* output, int unit_start, int unit_end, float* buf);
+    void GatherColumns(const float* input, int p0, int cols, float* packed);
+    void WriteBlocked(const float* tile, int cols, float* output);
+
+    conv_shape shape;
+    bool in_blocked;
+    bool out_blocked;
+
+    /* the GEMM of one group: M output channels, K input channels */
+    int m_dim;
+    int k_dim;
+
+    /* output channels of one unit, a multiple of SGEMM_MR */
+    int m_block;
+
+    /* weights of each group as SGEMM A panels */
+    float* packed_weight;
+    const float* bias;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<conv_task_param> param_list;
+};
+
+void Conv1x1::GetShape(Node* node)
+{
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    shape.batch = input_shape.GetN();
+    shape.group = param->group;
+    shape.in_c = input_shape.GetC();
+    shape.in_h = input_shape.GetH();
+    shape.in_w = input_shape.GetW();
+    shape.out_c = output_shape.GetC();
+    shape.out_h = output_shape.GetH();
+    shape.out_w = output_shape.GetW();
+    shape.stride_h = param->stride_h;
+    shape.stride_w = param->stride_w;
+
+    /* as ConvRef: only relu and relu6 are fused */
+    if(param->activation == 0 || param->activation == 6)
+        shape.activation = param->activation;
+    else
+        shape.activation = -1;
+}
+
+bool Conv1x1::Prerun(Node* node)
+{
+    GetShape(node);
+
+    in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+    out_blocked = IsBlockedLayout(node->GetOutputTensor(0));
+
+    const float* weight = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    m_dim = shape.out_c / shape.group;
+    k_dim = shape.in_c / shape.group;
+
+    m_block = CONV_1X1_A_BLOCK_SIZE / (k_dim * sizeof(float)) / SGEMM_MR * SGEMM_MR;
+
+    if(m_block < SGEMM_MR)
+        m_block = SGEMM_MR;
+    if(m_block > SGEMM_ALIGN_M(m_dim))
+        m_block = SGEMM_ALIGN_M(m_dim);
+
+    int group_size = sgemm_pack_a_size(m_dim, k_dim);
+
+    packed_weight = ( float* )mem_alloc(sizeof(float) * group_size * shape.group);
+
+    for(int g = 0; g < shape.group; g++)
+        sgemm_pack_a(m_dim, k_dim, weight + g * m_dim * k_dim, k_dim, packed_weight + g * group_size);
+
+    int cpu_number = cpu_info->GetCPUNumber();
+
+    ScratchReserve(sizeof(float) * sgemm_pack_b_size(k_dim, SGEMM_NR) * cpu_number);
+
+    return true;
+}
+
+/* output pixels [p0, p0 + cols) of one group, as a zero filled SGEMM B panel */
+void Conv1x1::GatherColumns(const float* input, int p0, int cols, float* packed)
+{
+    int in_hw = shape.in_h * shape.in_w;
+
+    /* channel k of a blocked pixel is at [k / 4][pixel][k % 4] */
+    int pixel_size = in_blocked ? 4 : 1;
+    int offset[SGEMM_NR];
+
+    for(int c = 0; c < cols; c++)
+    {
+        int oy = (p0 + c) / shape.out_w;
+        int ox = (p0 + c) % shape.out_w;
+
+        offset[c] = (oy * shape.stride_h * shape.in_w + ox * shape.stride_w) * pixel_size;
+    }
+
+    for(int k = 0; k < k_dim; k++)
+    {
+        const float* src = in_blocked ? input + (k >> 2) * in_hw * 4 + (k & 3) : input + k * in_hw;
+        int c = 0;
+
+        for(; c < cols; c++)
+            packed[c] = src[offset[c]];
+        for(; c < SGEMM_NR; c++)
+            packed[c] = 0.f;
+
+        packed += SGEMM_NR;
+    }
+}
+
+/* rows x cols of output, ldc apart, one bias per row */
+static void bias_activation(float* output, int rows, int cols, int ldc, const float* bias, int activation)
+{
+    if(bias == nullptr && activation < 0)
+        return;
+
+    for(int r = 0; r < rows; r++)
+    {
+        float* out = output + r * ldc;
+        float b = bias ? bias[r] : 0.f;
+        int c = 0;
+
+        if(cols == SGEMM_NR)
+        {
+            vf4_t vb = vf4_dup(b);
+
+            vf4_store(out, vf4_activation(vf4_add(vf4_load(out), vb), activation));
+            vf4_store(out + 4, vf4_activation(vf4_add(vf4_load(out + 4), vb), activation));
+
+            continue;
+        }
+
+        for(; c < cols; c++)
+            out[c] = f_activation(out[c] + b, activation);
+    }
+}
+
+/* the 4 x cols tile of an output channel block, as [pixel][4] */
+void Conv1x1::WriteBlocked(const float* tile, int cols, float* output)
+{
+    if(cols == SGEMM_NR)
+    {
+        for(int h = 0; h < SGEMM_NR; h += 4)
+        {
+            vf4_t r[4];
+
+            for(int i = 0; i < 4; i++)
+                r[i] = vf4_load(tile + i * SGEMM_NR + h);
+
+            vf4_transpose4(r);
+
+            for(int i = 0; i < 4; i++)
+                vf4_store(output + (h + i) * 4, r[i]);
+        }
+
+        return;
+    }
+
+    for(int c = 0; c < cols; c++)
+        for(int r = 0; r < 4; r++)
+            output[c * 4 + r] = tile[r * SGEMM_NR + c];
+}
+
+/* a unit is a block of output channels of one group, times a block of output pixels */
+void Conv1x1::RunUnits(const float* input, float* output, int unit_start, int unit_end, float* buf)
+{
+    int in_hw = shape.in_h * shape.in_w;
+    int out_hw = shape.out_h * shape.out_w;
+    int m_block_num = (m_dim + m_block - 1) / m_block;
+    int col_block_num = (out_hw + CONV_1X1_COL_BLOCK - 1) / CONV_1X1_COL_BLOCK;
+    int group_size = sgemm_pack_a_size(m_dim, k_dim);
+
+    /* the input pixel of each output pixel is at the same place */
+    bool in_place = shape.stride_h == 1 && shape.stride_w == 1;
+
+    float tile[SGEMM_MR * SGEMM_NR];
+
+    for(int u = unit_start; u < unit_end; u++)
+    {
+        int mb = u % m_block_num;
+        int cb = (u / m_block_num) % col_block_num;
+        int g = (u / m_block_num / col_block_num) % shape.group;
+        int n = u / m_block_num / col_block_num / shape.group;
+
+        const float* in = input + (( long )n * shape.in_c + g * k_dim) * in_hw;
+        float* out = output + (( long )n * shape.out_c + g * m_dim) * out_hw;
+        const float* a = packed_weight + g * group_size;
+        const float* b_group = bias ? bias + g * m_dim : nullptr;
+
+        int m0 = mb * m_block;
+        int m1 = std::min(m0 + m_block, m_dim);
+        int p0 = cb * CONV_1X1_COL_BLOCK;
+        int p1 = std::min(p0 + CONV_1X1_COL_BLOCK, out_hw);
+
+        for(int p = p0; p < p1; p += SGEMM_NR)
+        {
+            int cols = std::min(SGEMM_NR, p1 - p);
+            const float* b;
+            int ldb;
+
+            if(in_place && !in_blocked && cols == SGEMM_NR)
+            {
+                b = in + p;
+                ldb = in_hw;
+            }
+            else
+            {
+                GatherColumns(in, p, cols, buf);
+                b = buf;
+                ldb = SGEMM_NR;
+            }
+
+            for(int m = m0; m < m1; m += SGEMM_MR)
+            {
+                int rows = std::min(SGEMM_MR, m1 - m);
+                const float* a_panel = a + m * k_dim;
+                float* c = out + m * out_hw + p;
+                const float* b_rows = b_group ? b_group + m : nullptr;
+
+                /* out_c is a multiple of 4 then, as is m */
+                if(out_blocked)
+                {
+                    sgemm_kernel_4x8_ldb(k_dim, a_panel, b, ldb, tile, SGEMM_NR);
+                    bias_activation(tile, rows, cols, SGEMM_NR, b_rows, shape.activation);
+                    WriteBlocked(tile, cols, out + m * out_hw + p * 4);
+
+                    continue;
+                }
+
+                if(rows == SGEMM_MR && cols == SGEMM_NR)
+                {
+                    sgemm_kernel_4x8_ldb(k_dim, a_panel, b, ldb, c, out_hw);
+                    bias_activation(c, rows, cols, out_hw, b_rows, shape.activation);
+
+                    continue;
+                }
+
+                if(rows < SGEMM_MR)
+                {
+                    for(int r = 0; r < rows; r++)
+                        sgemm_kernel_1x8_ldb(k_dim, a_panel + r, b, ldb, tile + r * SGEMM_NR);
+                }
+                else
+                {
+                    sgemm_kernel_4x8_ldb(k_dim, a_panel, b, ldb, tile, SGEMM_NR);
+                }
+
+                bias_activation(tile, rows, cols, SGEMM_NR, b_rows, shape.activation);
+
+                for(int r = 0; r < rows; r++)
+                    memcpy(c + r * out_hw, tile + r * SGEMM_NR, cols * sizeof(float));
+            }
+        }
+    }
+}
+
+bool Conv1x1::Aider(int cpu, int seq, void* data)
+{
+    conv_task_param* param = ( conv_task_param* )data;
+
+    RunUnits(param->input, param->output, param->unit_start, param->unit_end, param->buf);
+
+    return true;
+}
+
+bool Conv1x1::Run(Node* node)
+{
+    /* the spatial dims may change on reshape, the weights may not */
+    GetShape(node);
+
+    const float* input = ( const float* )get_tensor_mem(node->GetInputTensor(0));
+    float* output = ( float* )get_tensor_mem(node->GetOutputTensor(0));
+
+    bias = nullptr;
+
+    if(node->GetInputNum() > 2)
+        bias = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+    int cpu_number = cpu_info->GetCPUNumber();
+    int out_hw = shape.out_h * shape.out_w;
+    int unit_num = shape.batch * shape.group * ((out_hw + CONV_1X1_COL_BLOCK - 1) / CONV_1X1_COL_BLOCK) *
+                   ((m_dim + m_block - 1) / m_block);
+
+    int buf_stride = sgemm_pack_b_size(k_dim, SGEMM_NR);
+    float* buf = ( float* )ScratchAlloc(sizeof(float) * buf_stride * cpu_number);
+
+    if(buf == nullptr)
+        return false;
+
+    if(cpu_number == 1 || unit_num < cpu_number)
+    {
+        RunUnits(input, output, 0, unit_num, buf);
+        return true;
+    }
+
+    auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+    task_list.resize(cpu_number);
+    param_list.resize(cpu_number);
+
+    int step = unit_num / cpu_number;
+
+    for(int i = 0; i < cpu_number; i++)
+    {
+        conv_task_param* p = &param_list[i];
+        sub_op_task* task = &task_list[i];
+
+        task->exec_func = f;
+        task->seq = i;
+        task->data = p;
+
+        p->input = input;
+        p->output = output;
+        p->unit_start = i * step;
+        p->unit_end = p->unit_start + step;
+        p->buf = buf + i * buf_stride;
+    }
+
+    param_list[cpu_number - 1].unit_end = unit_num;
+
+    task_dispatch(task_list, -1);
+    wait_done();
+
+    return true;
+}
+
+bool Conv1x1::Postrun(Node* node)
+{
+    if(packed_weight)
+    {
+        mem_free(packed_weight);
+        packed_weight = nullptr;
+    }
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->layout == TENGINE_LAYOUT_NHWC || exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    if(param->kernel_h != 1 || param->kernel_w != 1 || param->pads.size() < 4)
+        return nullptr;
+
+    for(unsigned int i = 0; i < 4; i++)
+    {
+        if(param->pads[i] != 0)
+            return nullptr;
+    }
+
+    if(param->stride_h < 1 || param->stride_w < 1 || param->group < 1)
+        return nullptr;
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    if(input_shape.GetC() % param->group || output_shape.GetC() % param->group)
+        return nullptr;
+
+    Conv1x1* ops = new Conv1x1();
+
+    ops->need_free = true;
+
+    return ops;
+}
+
+}    // namespace conv_1x1
+
+void RegisterConv2d1x1(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Convolution", conv_1x1::SelectFunc,
+                                                  conv_1x1::default_prio);
+}
+
+}    // namespace TEngine
@@ -0,0 +1,337 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/convolution.hpp"
+
+#include "conv_dw_kernel.h"
+#include "transpose.hpp"
+
+namespace TEngine {
+
+namespace conv_dw {
+
+const char* conv_name = "CONV_DW_GENERIC";
+const int default_prio = 100;
+
+struct dw_param
+{
+    const float* input;
+    float* output;
+    const float* kernel;
+    const float* bias;
+    int channel_num;
+    const dw_conv_shape* shape;
+    bool blocked;
+};
+
+struct ConvDwGeneric : public MTNodeOps
+{
+    ConvDwGeneric()
+    {
+        blocked_kernel = nullptr;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Reshape(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_ANY;
+    }
+
+    /* all the shape is taken in Run() */
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    bool Aider(int cpu, int seq, void* data);
+
+    bool RunChannels(dw_param* param_base, int channel);
+
+    bool in_blocked;
+    bool out_blocked;
+
+    /* [C / 4][KH][KW][4], when any of input and output is blocked */
+    float* blocked_kernel;
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<dw_param> param_list;
+};
+
+bool ConvDwGeneric::Prerun(Node* node)
+{
+    in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+    out_blocked = IsBlockedLayout(node->GetOutputTensor(0));
+
+    if(!in_blocked && !out_blocked)
+        return true;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    int channel = node->GetInputTensor(0)->GetShape().GetC();
+    int kernel_hw = param->kernel_h * param->kernel_w;
+    const float* kernel = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    blocked_kernel = ( float* )mem_alloc(sizeof(float) * channel * kernel_hw);
+
+    for(int c = 0; c < channel; c++)
+        for(int k = 0; k < kernel_hw; k++)
+            blocked_kernel[((c / 4) * kernel_hw + k) * 4 + c % 4] = kernel[c * kernel_hw + k];
+
+    return Reshape(node);
+}
+
+bool ConvDwGeneric::Reshape(Node* node)
+{
+    if(!in_blocked && !out_blocked)
+        return true;
+
+    /* the side that is plain NCHW is converted through the scratch memory */
+    if(!in_blocked)
+        ScratchReserve(node->GetInputTensor(0)->GetShape().GetSize() * sizeof(float));
+
+    if(!out_blocked)
+        ScratchReserve(node->GetOutputTensor(0)->GetShape().GetSize() * sizeof(float));
+
+    return true;
+}
+
+bool ConvDwGeneric::Postrun(Node* node)
+{
+    if(blocked_kernel)
+    {
+        mem_free(blocked_kernel);
+        blocked_kernel = nullptr;
+    }
+
+    return true;
+}
+
+bool ConvDwGeneric::Aider(int cpu, int seq, void* data)
+{
+    dw_param* param = ( dw_param* )data;
+
+    if(param->blocked)
+        dw_conv_blocked(param->input, param->output, param->kernel, param->bias, param->channel_num / 4,
+                        param->shape);
+    else
+        dw_conv_channels(param->input, param->output, param->kernel, param->bias, param->channel_num, param->shape);
+
+    return true;
+}
+
+/* split the channels of one image between the cpus; blocked data is split by blocks of 4 */
+bool ConvDwGeneric::RunChannels(dw_param* param_base, int channel)
+{
+    int cpu_number = cpu_info->GetCPUNumber();
+    int unit = param_base->blocked ? 4 : 1;
+    int unit_num = channel / unit;
+
+    if(cpu_number == 1 || unit_num < cpu_number)
+        return Aider(0, 0, param_base);
+
+    const dw_conv_shape* shape = param_base->shape;
+    int in_hw = shape->in_h * shape->in_w;
+    int out_hw = shape->out_h * shape->out_w;
+    int kernel_hw = shape->kernel_h * shape->kernel_w;
+
+    auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+    task_list.resize(cpu_number);
+    param_list.resize(cpu_number);
+
+    int step = unit_num / cpu_number * unit;
+
+    for(int i = 0; i < cpu_number; i++)
+    {
+        dw_param* p = &param_list[i];
+        sub_op_task* task = &task_list[i];
+
+        task->exec_func = f;
+        task->seq = i;
+        task->data = p;
+
+        *p = *param_base;
+
+        p->input = param_base->input + i * step * in_hw;
+        p->output = param_base->output + i * step * out_hw;
+        p->kernel = param_base->kernel + i * step * kernel_hw;
+        p->bias = param_base->bias ? param_base->bias + i * step : nullptr;
+        p->channel_num = step;
+    }
+
+    param_list[cpu_number - 1].channel_num += channel - cpu_number * step;
+
+    task_dispatch(task_list, -1);
+    wait_done();
+
+    return true;
+}
+
+bool ConvDwGeneric::Run(Node* node)
+{
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    Tensor* input_tensor = node->GetInputTensor(0);
+    Tensor* weight_tensor = node->GetInputTensor(1);
+    Tensor* output_tensor = node->GetOutputTensor(0);
+
+    const TShape& input_shape = input_tensor->GetShape();
+    const TShape& output_shape = output_tensor->GetShape();
+
+    dw_conv_shape shape;
+
+    shape.in_h = input_shape.GetH();
+    shape.in_w = input_shape.GetW();
+    shape.out_h = output_shape.GetH();
+    shape.out_w = output_shape.GetW();
+    shape.kernel_h = param->kernel_h;
+    shape.kernel_w = param->kernel_w;
+    shape.stride_h = param->stride_h;
+    shape.stride_w = param->stride_w;
+    shape.dilation_h = param->dilation_h;
+    shape.dilation_w = param->dilation_w;
+    shape.pad_top = param->pads[0];
+    shape.pad_left = param->pads[1];
+    shape.activation = param->activation;
+
+    int channel = input_shape.GetC();
+    int batch = input_shape.GetN();
+    int in_chw = channel * shape.in_h * shape.in_w;
+    int out_chw = channel * shape.out_h * shape.out_w;
+
+    const float* input_org = ( const float* )get_tensor_mem(input_tensor);
+    float* output_org = ( float* )get_tensor_mem(output_tensor);
+    const float* bias = nullptr;
+
+    if(node->GetInputNum() > 2)
+        bias = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+    bool blocked = in_blocked || out_blocked;
+    float* in_buf = nullptr;
+    float* out_buf = nullptr;
+
+    if(blocked && !in_blocked)
+        in_buf = ( float* )ScratchAlloc(sizeof(float) * in_chw);
+
+    if(blocked && !out_blocked)
+        out_buf = ( float* )ScratchAlloc(sizeof(float) * out_chw);
+
+    if((blocked && !in_blocked && in_buf == nullptr) || (blocked && !out_blocked && out_buf == nullptr))
+        return false;
+
+    for(int n = 0; n < batch; n++)
+    {
+        const float* input = input_org + n * in_chw;
+        float* output = output_org + n * out_chw;
+
+        dw_param p;
+
+        p.input = input;
+        p.output = output;
+        p.kernel = blocked ? blocked_kernel : ( const float* )get_tensor_mem(weight_tensor);
+        p.bias = bias;
+        p.channel_num = channel;
+        p.shape = &shape;
+        p.blocked = blocked;
+
+        if(in_buf)
+        {
+            layout_nchw_to_nchw4(input, in_buf, 1, channel, shape.in_h, shape.in_w);
+            p.input = in_buf;
+        }
+
+        if(out_buf)
+            p.output = out_buf;
+
+        RunChannels(&p, channel);
+
+        if(out_buf)
+            layout_nchw4_to_nchw(out_buf, output, 1, channel, shape.out_h, shape.out_w);
+    }
+
+    return true;
+}
+
+static bool IsDepthwise(const ConvParam* param, const TShape& input_shape, const TShape& output_shape)
+{
+    int input_c = input_shape.GetC();
+    int output_c = output_shape.GetC();
+
+    if(param->group == 1 || input_c != param->group || output_c != input_c)
+        return false;
+
+    if(param->pads.size() < 4)
+        return false;
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->layout == TENGINE_LAYOUT_NHWC || exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    if(!IsDepthwise(param, input_shape, output_shape))
+        return nullptr;
+
+    ConvDwGeneric* ops = new ConvDwGeneric();
+
+    ops->need_free = true;
+
+    return ops;
+}
+
+}    // namespace conv_dw
+
+void RegisterConv2dDepthGeneric(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Convolution", conv_dw::SelectFunc, conv_dw::default_prio);
+}
+
+}    // namespace TEngine
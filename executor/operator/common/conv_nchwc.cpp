@@ -0,0 +1,525 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+#include <vector>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/convolution.hpp"
+
+#include "simd_vec.h"
+
+/*
+ * Direct convolution on the channel blocked layout (NCHW4).
+ *
+ * The input is read as [C / 4][H][W][4], zero padded in a scratch buffer
+ * when the convolution has padding or the input tensor is plain NCHW.
+ * The weights are packed once as [OC / 4][IC / 4][KH][KW][4 ic][4 oc], so
+ * one input value times one weight vector updates four output channels of
+ * a pixel. A tile of 8 pixels keeps 8 accumulators in registers, with no
+ * im2col buffer at all.
+ *
+ * The output is written blocked, or transposed back to NCHW, depending on
+ * the layout the cpu runner chose for the output tensor.
+ */
+
+namespace TEngine {
+
+namespace conv_nchwc {
+
+const char* conv_name = "CONV_NCHWC";
+const int default_prio = 1300;
+
+#define CONV_NCHWC_TILE 8
+
+struct conv_shape
+{
+    int in_c;
+    int in_h;
+    int in_w;
+    int out_c;
+    int out_h;
+    int out_w;
+    int kernel_h;
+    int kernel_w;
+    int stride_h;
+    int stride_w;
+    int dilation_h;
+    int dilation_w;
+    int pad_top;
+    int pad_left;
+    int pad_bottom;
+    int pad_right;
+    int activation;
+
+    int ic_block;
+    int oc_block;
+
+    /* dims of the (padded) blocked input */
+    int buf_h;
+    int buf_w;
+};
+
+struct conv_task_param
+{
+    const float* input;
+    float* output;
+    int unit_start;
+    int unit_end;
+};
+
+/* acc[j] += input pixel j of the tile * weights, over all input channels and taps */
+template <int N>
+static inline void conv_tile(const float* input, const float* weight, vf4_t* acc, const conv_shape* s)
+{
+    int block_size = s->buf_h * s->buf_w * 4;
+    int row_size = s->buf_w * 4;
+    int pixel_step = s->stride_w * 4;
+
+    for(int icb = 0; icb < s->ic_block; icb++)
+    {
+        for(int ky = 0; ky < s->kernel_h; ky++)
+        {
+            const float* row = input + icb * block_size + ky * s->dilation_h * row_size;
+
+            for(int kx = 0; kx < s->kernel_w; kx++)
+            {
+                const float* p = row + kx * s->dilation_w * 4;
+
+                vf4_t w0 = vf4_load(weight);
+                vf4_t w1 = vf4_load(weight + 4);
+                vf4_t w2 = vf4_load(weight + 8);
+                vf4_t w3 = vf4_load(weight + 12);
+
+                for(int j = 0; j < N; j++)
+                {
+                    const float* q = p + j * pixel_step;
+
+                    acc[j] = vf4_mla_n(acc[j], w0, q[0]);
+                    acc[j] = vf4_mla_n(acc[j], w1, q[1]);
+                    acc[j] = vf4_mla_n(acc[j], w2, q[2]);
+                    acc[j] = vf4_mla_n(acc[j], w3, q[3]);
+                }
+
+                weight += 16;
+            }
+        }
+    }
+}
+
+struct ConvNCHWc : public MTNodeOps
+{
+    ConvNCHWc()
+    {
+        packed_weight = nullptr;
+        packed_bias = nullptr;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Reshape(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_ANY;
+    }
+
+    /* Run() gets the shape again */
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    bool Aider(int cpu, int seq, void* data);
+
+    void GetShape(Node* node);
+    bool NeedPadBuffer(void) const;
+    void PadInput(const float* input, float* buf);
+    void RunRows(const float* input, float* output, int unit_start, int unit_end);
+
+    template <int N> void RunTile(const float* input, float* output, int ocb, int oy, int ox);
+
+    conv_shape shape;
+    bool in_blocked;
+    bool out_blocked;
+
+    float* packed_weight;
+    float* packed_bias;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<conv_task_param> param_list;
+};
+
+void ConvNCHWc::GetShape(Node* node)
+{
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    shape.in_c = input_shape.GetC();
+    shape.in_h = input_shape.GetH();
+    shape.in_w = input_shape.GetW();
+    shape.out_c = output_shape.GetC();
+    shape.out_h = output_shape.GetH();
+    shape.out_w = output_shape.GetW();
+    shape.kernel_h = param->kernel_h;
+    shape.kernel_w = param->kernel_w;
+    shape.stride_h = param->stride_h;
+    shape.stride_w = param->stride_w;
+    shape.dilation_h = param->dilation_h;
+    shape.dilation_w = param->dilation_w;
+    shape.pad_top = param->pads[0];
+    shape.pad_left = param->pads[1];
+    shape.pad_bottom = param->pads[2];
+    shape.pad_right = param->pads[3];
+    shape.activation = param->activation;
+
+    shape.ic_block = (shape.in_c + 3) / 4;
+    shape.oc_block = (shape.out_c + 3) / 4;
+
+    if(NeedPadBuffer())
+    {
+        shape.buf_h = shape.in_h + shape.pad_top + shape.pad_bottom;
+        shape.buf_w = shape.in_w + shape.pad_left + shape.pad_right;
+    }
+    else
+    {
+        shape.buf_h = shape.in_h;
+        shape.buf_w = shape.in_w;
+    }
+}
+
+bool ConvNCHWc::NeedPadBuffer(void) const
+{
+    return !in_blocked || shape.pad_top || shape.pad_left || shape.pad_bottom || shape.pad_right;
+}
+
+bool ConvNCHWc::Prerun(Node* node)
+{
+    in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+    out_blocked = IsBlockedLayout(node->GetOutputTensor(0));
+
+    GetShape(node);
+
+    int in_c = shape.in_c;
+    int out_c = shape.out_c;
+    int kernel_size = shape.kernel_h * shape.kernel_w;
+    int ic_block = shape.ic_block;
+
+    const float* weight = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    /* [oc / 4][ic / 4][kh][kw][4 ic][4 oc], zero filled */
+    int weight_size = shape.oc_block * ic_block * kernel_size * 16;
+
+    packed_weight = ( float* )mem_alloc(sizeof(float) * weight_size);
+    memset(packed_weight, 0, sizeof(float) * weight_size);
+
+    for(int oc = 0; oc < out_c; oc++)
+    {
+        for(int ic = 0; ic < in_c; ic++)
+        {
+            const float* src = weight + (oc * in_c + ic) * kernel_size;
+            float* dst = packed_weight + ((oc / 4) * ic_block + ic / 4) * kernel_size * 16 + (ic % 4) * 4 + oc % 4;
+
+            for(int k = 0; k < kernel_size; k++)
+                dst[k * 16] = src[k];
+        }
+    }
+
+    packed_bias = ( float* )mem_alloc(sizeof(float) * shape.oc_block * 4);
+    memset(packed_bias, 0, sizeof(float) * shape.oc_block * 4);
+
+    if(node->GetInputNum() > 2)
+    {
+        const float* bias = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+        memcpy(packed_bias, bias, sizeof(float) * out_c);
+    }
+
+    return Reshape(node);
+}
+
+bool ConvNCHWc::Reshape(Node* node)
+{
+    GetShape(node);
+
+    if(NeedPadBuffer())
+        ScratchReserve(sizeof(float) * shape.ic_block * shape.buf_h * shape.buf_w * 4);
+
+    return true;
+}
+
+/* one image, to [ic / 4][buf_h][buf_w][4] with zero borders and zero filled channels */
+void ConvNCHWc::PadInput(const float* input, float* buf)
+{
+    int in_c = shape.in_c;
+    int in_h = shape.in_h;
+    int in_w = shape.in_w;
+    int buf_h = shape.buf_h;
+    int buf_w = shape.buf_w;
+
+    memset(buf, 0, sizeof(float) * shape.ic_block * buf_h * buf_w * 4);
+
+    for(int icb = 0; icb < shape.ic_block; icb++)
+    {
+        for(int y = 0; y < in_h; y++)
+        {
+            float* dst = buf + ((icb * buf_h + y + shape.pad_top) * buf_w + shape.pad_left) * 4;
+
+            if(in_blocked)
+            {
+                memcpy(dst, input + (icb * in_h + y) * in_w * 4, sizeof(float) * in_w * 4);
+                continue;
+            }
+
+            for(int c = 0; c < 4 && icb * 4 + c < in_c; c++)
+            {
+                const float* src = input + ((icb * 4 + c) * in_h + y) * in_w;
+
+                for(int x = 0; x < in_w; x++)
+                    dst[x * 4 + c] = src[x];
+            }
+        }
+    }
+}
+
+template <int N> void ConvNCHWc::RunTile(const float* input, float* output, int ocb, int oy, int ox)
+{
+    const conv_shape* s = &shape;
+    vf4_t bias = vf4_load(packed_bias + ocb * 4);
+    vf4_t acc[N];
+
+    for(int j = 0; j < N; j++)
+        acc[j] = bias;
+
+    const float* in = input + (oy * s->stride_h * s->buf_w + ox * s->stride_w) * 4;
+    const float* weight = packed_weight + ocb * s->ic_block * s->kernel_h * s->kernel_w * 16;
+
+    conv_tile<N>(in, weight, acc, s);
+
+    for(int j = 0; j < N; j++)
+        acc[j] = vf4_activation(acc[j], s->activation);
+
+    if(out_blocked)
+    {
+        float* out = output + ((ocb * s->out_h + oy) * s->out_w + ox) * 4;
+
+        for(int j = 0; j < N; j++)
+            vf4_store(out + j * 4, acc[j]);
+
+        return;
+    }
+
+    int out_hw = s->out_h * s->out_w;
+    int c_num = s->out_c - ocb * 4;
+    float* out = output + ocb * 4 * out_hw + oy * s->out_w + ox;
+
+    if(c_num > 4)
+        c_num = 4;
+
+    if(N % 4 == 0)
+    {
+        for(int j = 0; j < N; j += 4)
+        {
+            vf4_transpose4(acc + j);
+
+            for(int c = 0; c < c_num; c++)
+                vf4_store(out + c * out_hw + j, acc[j + c]);
+        }
+    }
+    else
+    {
+        float tmp[N * 4];
+
+        for(int j = 0; j < N; j++)
+            vf4_store(tmp + j * 4, acc[j]);
+
+        for(int c = 0; c < c_num; c++)
+            for(int j = 0; j < N; j++)
+                out[c * out_hw + j] = tmp[j * 4 + c];
+    }
+}
+
+/* a unit is one output row of one block of 4 output channels */
+void ConvNCHWc::RunRows(const float* input, float* output, int unit_start, int unit_end)
+{
+    int out_h = shape.out_h;
+    int out_w = shape.out_w;
+
+    for(int u = unit_start; u < unit_end; u++)
+    {
+        int ocb = u / out_h;
+        int oy = u % out_h;
+        int ox = 0;
+
+        for(; ox + CONV_NCHWC_TILE <= out_w; ox += CONV_NCHWC_TILE)
+            RunTile<CONV_NCHWC_TILE>(input, output, ocb, oy, ox);
+
+        for(; ox + 4 <= out_w; ox += 4)
+            RunTile<4>(input, output, ocb, oy, ox);
+
+        for(; ox < out_w; ox++)
+            RunTile<1>(input, output, ocb, oy, ox);
+    }
+}
+
+bool ConvNCHWc::Aider(int cpu, int seq, void* data)
+{
+    conv_task_param* param = ( conv_task_param* )data;
+
+    RunRows(param->input, param->output, param->unit_start, param->unit_end);
+
+    return true;
+}
+
+bool ConvNCHWc::Run(Node* node)
+{
+    GetShape(node);
+
+    Tensor* input_tensor = node->GetInputTensor(0);
+
+    const float* input_org = ( const float* )get_tensor_mem(input_tensor);
+    float* output_org = ( float* )get_tensor_mem(node->GetOutputTensor(0));
+
+    int batch = input_tensor->GetShape().GetN();
+    int in_size = shape.in_c * shape.in_h * shape.in_w;
+    int out_size = shape.oc_block * 4 * shape.out_h * shape.out_w;
+    float* buf = nullptr;
+
+    /* a blocked output has a multiple of 4 channels, a plain one may not */
+    if(!out_blocked)
+        out_size = shape.out_c * shape.out_h * shape.out_w;
+
+    if(NeedPadBuffer())
+    {
+        buf = ( float* )ScratchAlloc(sizeof(float) * shape.ic_block * shape.buf_h * shape.buf_w * 4);
+
+        if(buf == nullptr)
+            return false;
+    }
+
+    int cpu_number = cpu_info->GetCPUNumber();
+    int unit_num = shape.oc_block * shape.out_h;
+
+    for(int n = 0; n < batch; n++)
+    {
+        const float* input = input_org + n * in_size;
+        float* output = output_org + n * out_size;
+
+        if(buf)
+        {
+            PadInput(input, buf);
+            input = buf;
+        }
+
+        if(cpu_number == 1 || unit_num < cpu_number)
+        {
+            RunRows(input, output, 0, unit_num);
+            continue;
+        }
+
+        auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+        task_list.resize(cpu_number);
+        param_list.resize(cpu_number);
+
+        int step = unit_num / cpu_number;
+
+        for(int i = 0; i < cpu_number; i++)
+        {
+            conv_task_param* p = &param_list[i];
+            sub_op_task* task = &task_list[i];
+
+            task->exec_func = f;
+            task->seq = i;
+            task->data = p;
+
+            p->input = input;
+            p->output = output;
+            p->unit_start = i * step;
+            p->unit_end = p->unit_start + step;
+        }
+
+        param_list[cpu_number - 1].unit_end = unit_num;
+
+        task_dispatch(task_list, -1);
+        wait_done();
+    }
+
+    return true;
+}
+
+bool ConvNCHWc::Postrun(Node* node)
+{
+    mem_free(packed_weight);
+    mem_free(packed_bias);
+
+    packed_weight = nullptr;
+    packed_bias = nullptr;
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->layout == TENGINE_LAYOUT_NHWC || exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    if(param->group != 1 || param->pads.size() < 4)
+        return nullptr;
+
+    if(param->stride_h < 1 || param->stride_w < 1 || param->dilation_h < 1 || param->dilation_w < 1)
+        return nullptr;
+
+    ConvNCHWc* ops = new ConvNCHWc();
+
+    ops->need_free = true;
+
+    return ops;
+}
+
+}    // namespace conv_nchwc
+
+void RegisterConv2dNCHWc(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Convolution", conv_nchwc::SelectFunc,
+                                                  conv_nchwc::default_prio);
+}
+
+}    // namespace TEngine
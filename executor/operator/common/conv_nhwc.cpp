@@ -0,0 +1,548 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+#include <vector>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/convolution.hpp"
+
+#include "sgemm_kernel.h"
+
+/*
+ * Float convolution for the NHWC layout (TFLite models).
+ *
+ * In NHWC the input channels of one pixel are contiguous, as are the
+ * [KH][KW][IC] weights of one output channel. So a tile of output pixels
+ * is packed straight from the input into a SGEMM A panel, the weights are
+ * packed once in Prerun as the B panels, and the product is the output
+ * tile in NHWC order. Bias and activation are applied on the write back.
+ *
+ * Depthwise convolution ([1][KH][KW][C] weights) is computed on four
+ * channels at a time, which are the contiguous elements in this layout.
+ */
+
+namespace TEngine {
+
+namespace conv_nhwc {
+
+const char* conv_name = "CONV_NHWC";
+const int default_prio = 200;
+
+/* size of the per cpu A panel a tile is chosen to fit in */
+#define CONV_NHWC_PANEL_SIZE (128 * 1024)
+#define CONV_NHWC_MAX_TILE 64
+
+struct conv_shape
+{
+    int batch;
+    int in_c;
+    int in_h;
+    int in_w;
+    int out_c;
+    int out_h;
+    int out_w;
+    int kernel_h;
+    int kernel_w;
+    int stride_h;
+    int stride_w;
+    int dilation_h;
+    int dilation_w;
+    int pad_top;
+    int pad_left;
+    int activation;
+};
+
+struct conv_task_param
+{
+    const float* input;
+    float* output;
+    int unit_start;
+    int unit_end;
+    float* buf;
+};
+
+struct ConvNHWC : public MTNodeOps
+{
+    ConvNHWC()
+    {
+        packed_weight = nullptr;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    bool Aider(int cpu, int seq, void* data);
+
+    void GetShape(Node* node);
+    void RunGemm(const float* input, float* output, int unit_start, int unit_end, float* buf);
+    void RunDepthwise(const float* input, float* output, int unit_start, int unit_end);
+    void PackInput(const float* input, int p0, int rows, float* packed);
+
+    bool depthwise;
+    conv_shape shape;
+
+    /* rows of the GEMM A panel: output pixels computed at once */
+    int tile;
+    int k_dim;
+
+    /* weights as SGEMM B panels: [k_dim] x [out_c] */
+    float* packed_weight;
+    const float* weight;
+    const float* bias;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<conv_task_param> param_list;
+};
+
+void ConvNHWC::GetShape(Node* node)
+{
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    shape.batch = input_shape.GetN();
+    shape.in_c = input_shape.GetC();
+    shape.in_h = input_shape.GetH();
+    shape.in_w = input_shape.GetW();
+    shape.out_c = output_shape.GetC();
+    shape.out_h = output_shape.GetH();
+    shape.out_w = output_shape.GetW();
+    shape.kernel_h = param->kernel_h;
+    shape.kernel_w = param->kernel_w;
+    shape.stride_h = param->stride_h;
+    shape.stride_w = param->stride_w;
+    shape.dilation_h = param->dilation_h;
+    shape.dilation_w = param->dilation_w;
+    shape.pad_top = param->pads[0];
+    shape.pad_left = param->pads[1];
+
+    /* as ConvRef: only relu and relu6 are fused */
+    if(param->activation == 0 || param->activation == 6)
+        shape.activation = param->activation;
+    else
+        shape.activation = -1;
+}
+
+bool ConvNHWC::Prerun(Node* node)
+{
+    GetShape(node);
+
+    weight = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    if(depthwise)
+        return true;
+
+    k_dim = shape.kernel_h * shape.kernel_w * shape.in_c;
+
+    tile = CONV_NHWC_PANEL_SIZE / (k_dim * sizeof(float)) / SGEMM_MR * SGEMM_MR;
+
+    if(tile < SGEMM_MR)
+        tile = SGEMM_MR;
+    if(tile > CONV_NHWC_MAX_TILE)
+        tile = CONV_NHWC_MAX_TILE;
+
+    /* B[k][oc] = weight[oc][k], packed by columns of SGEMM_NR output channels */
+    int out_c = shape.out_c;
+
+    packed_weight = ( float* )mem_alloc(sizeof(float) * sgemm_pack_b_size(k_dim, out_c));
+
+    float* dst = packed_weight;
+
+    for(int n = 0; n < out_c; n += SGEMM_NR)
+    {
+        for(int k = 0; k < k_dim; k++)
+        {
+            for(int c = 0; c < SGEMM_NR; c++)
+                dst[c] = (n + c < out_c) ? weight[(n + c) * k_dim + k] : 0.f;
+
+            dst += SGEMM_NR;
+        }
+    }
+
+    int cpu_number = cpu_info->GetCPUNumber();
+
+    ScratchReserve(sizeof(float) * sgemm_pack_a_size(tile, k_dim) * cpu_number);
+
+    return true;
+}
+
+/* im2col of output pixels [p0, p0 + rows) of one image, into a SGEMM A panel */
+void ConvNHWC::PackInput(const float* input, int p0, int rows, float* packed)
+{
+    int in_c = shape.in_c;
+    int in_h = shape.in_h;
+    int in_w = shape.in_w;
+
+    for(int m = 0; m < rows; m += SGEMM_MR)
+    {
+        float* panel = packed + m * k_dim;
+
+        for(int r = 0; r < SGEMM_MR; r++)
+        {
+            float* dst = panel + r;
+
+            if(m + r >= rows)
+            {
+                for(int k = 0; k < k_dim; k++)
+                    dst[k * SGEMM_MR] = 0.f;
+
+                continue;
+            }
+
+            int p = p0 + m + r;
+            int oy = p / shape.out_w;
+            int ox = p % shape.out_w;
+            int iy0 = oy * shape.stride_h - shape.pad_top;
+            int ix0 = ox * shape.stride_w - shape.pad_left;
+
+            for(int kh = 0; kh < shape.kernel_h; kh++)
+            {
+                int iy = iy0 + kh * shape.dilation_h;
+
+                for(int kw = 0; kw < shape.kernel_w; kw++)
+                {
+                    int ix = ix0 + kw * shape.dilation_w;
+
+                    if(iy < 0 || iy >= in_h || ix < 0 || ix >= in_w)
+                    {
+                        for(int c = 0; c < in_c; c++)
+                            dst[c * SGEMM_MR] = 0.f;
+                    }
+                    else
+                    {
+                        const float* src = input + (iy * in_w + ix) * in_c;
+
+                        for(int c = 0; c < in_c; c++)
+                            dst[c * SGEMM_MR] = src[c];
+                    }
+
+                    dst += in_c * SGEMM_MR;
+                }
+            }
+        }
+    }
+}
+
+static void bias_activation(float* output, int pixel_num, int out_c, const float* bias, int activation)
+{
+    if(bias == nullptr && activation < 0)
+        return;
+
+    int c_end = out_c & -4;
+
+    for(int p = 0; p < pixel_num; p++)
+    {
+        float* out = output + p * out_c;
+        int c = 0;
+
+        for(; c < c_end; c += 4)
+        {
+            vf4_t v = vf4_load(out + c);
+
+            if(bias)
+                v = vf4_add(v, vf4_load(bias + c));
+
+            vf4_store(out + c, vf4_activation(v, activation));
+        }
+
+        for(; c < out_c; c++)
+        {
+            float v = out[c];
+
+            if(bias)
+                v += bias[c];
+
+            out[c] = f_activation(v, activation);
+        }
+    }
+}
+
+/* a unit is one tile of output pixels */
+void ConvNHWC::RunGemm(const float* input, float* output, int unit_start, int unit_end, float* buf)
+{
+    int out_hw = shape.out_h * shape.out_w;
+    int tile_num = (out_hw + tile - 1) / tile;
+    int in_size = shape.in_h * shape.in_w * shape.in_c;
+    int out_c = shape.out_c;
+
+    for(int u = unit_start; u < unit_end; u++)
+    {
+        int n = u / tile_num;
+        int p0 = (u % tile_num) * tile;
+        int rows = std::min(tile, out_hw - p0);
+
+        const float* in = input + n * in_size;
+        float* out = output + (n * out_hw + p0) * out_c;
+
+        PackInput(in, p0, rows, buf);
+
+        sgemm_packed(rows, out_c, k_dim, buf, packed_weight, out, out_c);
+
+        bias_activation(out, rows, out_c, bias, shape.activation);
+    }
+}
+
+/* a unit is one output row */
+void ConvNHWC::RunDepthwise(const float* input, float* output, int unit_start, int unit_end)
+{
+    int channel = shape.in_c;
+    int in_h = shape.in_h;
+    int in_w = shape.in_w;
+    int out_h = shape.out_h;
+    int out_w = shape.out_w;
+    int kernel_h = shape.kernel_h;
+    int kernel_w = shape.kernel_w;
+    int activation = shape.activation;
+    int c_end = channel & -4;
+
+    for(int u = unit_start; u < unit_end; u++)
+    {
+        int n = u / out_h;
+        int oy = u % out_h;
+
+        const float* in = input + n * in_h * in_w * channel;
+        float* out = output + (n * out_h + oy) * out_w * channel;
+
+        int iy0 = oy * shape.stride_h - shape.pad_top;
+
+        for(int ox = 0; ox < out_w; ox++)
+        {
+            int ix0 = ox * shape.stride_w - shape.pad_left;
+            int c = 0;
+
+            for(; c < c_end; c += 4)
+            {
+                vf4_t sum = bias ? vf4_load(bias + c) : vf4_zero();
+
+                for(int kh = 0; kh < kernel_h; kh++)
+                {
+                    int iy = iy0 + kh * shape.dilation_h;
+
+                    if(iy < 0 || iy >= in_h)
+                        continue;
+
+                    const float* in_row = in + iy * in_w * channel + c;
+                    const float* w_row = weight + kh * kernel_w * channel + c;
+
+                    for(int kw = 0; kw < kernel_w; kw++)
+                    {
+                        int ix = ix0 + kw * shape.dilation_w;
+
+                        if(ix < 0 || ix >= in_w)
+                            continue;
+
+                        sum = vf4_mla(sum, vf4_load(in_row + ix * channel), vf4_load(w_row + kw * channel));
+                    }
+                }
+
+                vf4_store(out + c, vf4_activation(sum, activation));
+            }
+
+            for(; c < channel; c++)
+            {
+                float sum = bias ? bias[c] : 0.f;
+
+                for(int kh = 0; kh < kernel_h; kh++)
+                {
+                    int iy = iy0 + kh * shape.dilation_h;
+
+                    if(iy < 0 || iy >= in_h)
+                        continue;
+
+                    for(int kw = 0; kw < kernel_w; kw++)
+                    {
+                        int ix = ix0 + kw * shape.dilation_w;
+
+                        if(ix < 0 || ix >= in_w)
+                            continue;
+
+                        sum += in[(iy * in_w + ix) * channel + c] * weight[(kh * kernel_w + kw) * channel + c];
+                    }
+                }
+
+                out[c] = f_activation(sum, activation);
+            }
+
+            out += channel;
+        }
+    }
+}
+
+bool ConvNHWC::Aider(int cpu, int seq, void* data)
+{
+    conv_task_param* param = ( conv_task_param* )data;
+
+    if(depthwise)
+        RunDepthwise(param->input, param->output, param->unit_start, param->unit_end);
+    else
+        RunGemm(param->input, param->output, param->unit_start, param->unit_end, param->buf);
+
+    return true;
+}
+
+bool ConvNHWC::Run(Node* node)
+{
+    /* the spatial dims may change on reshape, the weights may not */
+    GetShape(node);
+
+    const float* input = ( const float* )get_tensor_mem(node->GetInputTensor(0));
+    float* output = ( float* )get_tensor_mem(node->GetOutputTensor(0));
+
+    bias = nullptr;
+
+    if(node->GetInputNum() > 2)
+        bias = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+    int cpu_number = cpu_info->GetCPUNumber();
+    int unit_num;
+    float* buf = nullptr;
+    int buf_stride = 0;
+
+    if(depthwise)
+    {
+        unit_num = shape.batch * shape.out_h;
+    }
+    else
+    {
+        int out_hw = shape.out_h * shape.out_w;
+
+        unit_num = shape.batch * ((out_hw + tile - 1) / tile);
+
+        buf_stride = sgemm_pack_a_size(tile, k_dim);
+        buf = ( float* )ScratchAlloc(sizeof(float) * buf_stride * cpu_number);
+
+        if(buf == nullptr)
+            return false;
+    }
+
+    if(cpu_number == 1 || unit_num < cpu_number)
+    {
+        if(depthwise)
+            RunDepthwise(input, output, 0, unit_num);
+        else
+            RunGemm(input, output, 0, unit_num, buf);
+
+        return true;
+    }
+
+    auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+    task_list.resize(cpu_number);
+    param_list.resize(cpu_number);
+
+    int step = unit_num / cpu_number;
+
+    for(int i = 0; i < cpu_number; i++)
+    {
+        conv_task_param* p = &param_list[i];
+        sub_op_task* task = &task_list[i];
+
+        task->exec_func = f;
+        task->seq = i;
+        task->data = p;
+
+        p->input = input;
+        p->output = output;
+        p->unit_start = i * step;
+        p->unit_end = p->unit_start + step;
+        p->buf = buf ? buf + i * buf_stride : nullptr;
+    }
+
+    param_list[cpu_number - 1].unit_end = unit_num;
+
+    task_dispatch(task_list, -1);
+    wait_done();
+
+    return true;
+}
+
+bool ConvNHWC::Postrun(Node* node)
+{
+    if(packed_weight)
+    {
+        mem_free(packed_weight);
+        packed_weight = nullptr;
+    }
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->layout != TENGINE_LAYOUT_NHWC || exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    if(param->pads.size() < 4 || param->stride_h < 1 || param->stride_w < 1 || param->dilation_h < 1 ||
+       param->dilation_w < 1)
+        return nullptr;
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    int input_c = input_shape.GetC();
+    int output_c = output_shape.GetC();
+    bool depthwise = false;
+
+    if(param->group != 1)
+    {
+        /* only depthwise with a channel multiplier of 1 has a known NHWC weight layout */
+        if(param->group != input_c || output_c != input_c)
+            return nullptr;
+
+        depthwise = true;
+    }
+
+    ConvNHWC* ops = new ConvNHWC();
+
+    ops->need_free = true;
+    ops->depthwise = depthwise;
+
+    return ops;
+}
+
+}    // namespace conv_nhwc
+
+void RegisterConv2dNHWC(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Convolution", conv_nhwc::SelectFunc,
+                                                  conv_nhwc::default_prio);
+}
+
+}    // namespace TEngine
@@ -30,6 +30,7 @@
 #include "logger.hpp"
 #include "node_ops.hpp"
 #include "tensor_mem.hpp"
+#include "mem_account.hpp"
 #include "data_type.hpp"
 
 #include "graph.hpp"
@@ -336,6 +337,8 @@ bool ConvRef::Prerun(Node* node)
 
             GetSharedMemorySize(node, col_size);
 
+            MemTag mem_tag(MEM_STAT_SCRATCH);
+
             void* col_buf = mem_alloc(col_size);
             (*node)["col_buf"] = col_buf;
             node->SetAttr("col_buf_allocated", col_size);
@@ -476,6 +479,18 @@ bool ConvRef::Postrun(Node* node)
 
 NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
 {
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    /* Run has no NCHW path yet, and RunNHWC no dilation: leave those to the others */
+    if(exec_attr->layout != TENGINE_LAYOUT_NHWC)
+        return nullptr;
+
+    Convolution* conv_op = dynamic_cast<Convolution*>(node->GetOp());
+    ConvParam* param = conv_op->GetParam();
+
+    if(param->dilation_h != 1 || param->dilation_w != 1)
+        return nullptr;
+
     ConvRef* ops = new ConvRef();
 
     ops->need_free = true;
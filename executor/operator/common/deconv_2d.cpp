@@ -0,0 +1,477 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+#include <vector>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/deconvolution.hpp"
+
+#include "sgemm_kernel.h"
+
+/*
+ * Deconvolution by sub-pixel decomposition.
+ *
+ * For stride s, output pixel (oy, ox) only receives contributions from the
+ * kernel taps with (k * dilation) % s == (o + pad) % s. So the output splits
+ * into s * s phases, and every phase is an ordinary convolution of the input
+ * with a sub kernel built from its taps. Each phase runs as
+ * im2col + packed SGEMM, with bias and activation fused into the write back,
+ * so no multiply is spent on the zeros a col2im based deconvolution inserts.
+ */
+
+namespace TEngine {
+
+namespace deconv_2d {
+
+const char* deconv_name = "DECONV_NATIVE";
+const int default_prio = 500;
+
+struct deconv_phase
+{
+    int py;
+    int px;
+
+    /* taps of this phase and their input offsets */
+    std::vector<int> ky;
+    std::vector<int> kx;
+    std::vector<int> my;
+    std::vector<int> mx;
+
+    /* output positions: oy = (qy0 + j) * stride + py - pad, j in [0, qy_num) */
+    int qy0;
+    int qy_num;
+    int qx0;
+    int qx_num;
+
+    int k_dim;
+    float* packed_weight;
+};
+
+struct deconv_task_param
+{
+    const float* input;
+    float* output;
+    const deconv_phase* phase;
+    int panel_start;
+    int panel_end;
+    float* buf;
+};
+
+struct Deconv2dNative : public MTNodeOps
+{
+    Deconv2dNative()
+    {
+        buffer = nullptr;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    bool Aider(int cpu, int seq, void* data);
+
+    void RunPhase(const deconv_phase* phase, const float* input, float* output, int panel_start, int panel_end,
+                  float* buf);
+
+    std::vector<deconv_phase> phases;
+
+    int in_c;
+    int in_h;
+    int in_w;
+    int out_c;
+    int out_h;
+    int out_w;
+    int stride;
+    int pad;
+    int activation;
+
+    const float* bias;
+
+    /* one im2col panel per cpu, from the scratch arena */
+    float* buffer;
+    int buf_stride;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<deconv_task_param> param_list;
+};
+
+static int ceil_div(int a, int b)
+{
+    return a >= 0 ? (a + b - 1) / b : -((-a) / b);
+}
+
+bool Deconv2dNative::Prerun(Node* node)
+{
+    Deconvolution* deconv_op = dynamic_cast<Deconvolution*>(node->GetOp());
+    DeconvParam* param = deconv_op->GetParam();
+
+    const TShape& input_shape = node->GetInputTensor(0)->GetShape();
+    const TShape& output_shape = node->GetOutputTensor(0)->GetShape();
+
+    in_c = input_shape.GetC();
+    in_h = input_shape.GetH();
+    in_w = input_shape.GetW();
+    out_c = output_shape.GetC();
+    out_h = output_shape.GetH();
+    out_w = output_shape.GetW();
+    stride = param->stride;
+    pad = param->pad;
+    activation = param->activation;
+
+    int ksize = param->kernel_size;
+    int dilation = param->dilation;
+
+    /* weight layout: [in_c][out_c][ksize][ksize] */
+    const float* weight = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    int max_k_dim = 0;
+
+    phases.resize(stride * stride);
+
+    for(int py = 0; py < stride; py++)
+        for(int px = 0; px < stride; px++)
+        {
+            deconv_phase& phase = phases[py * stride + px];
+
+            phase.py = py;
+            phase.px = px;
+
+            for(int k = 0; k < ksize; k++)
+            {
+                if((k * dilation) % stride == py)
+                {
+                    phase.ky.push_back(k);
+                    phase.my.push_back((k * dilation - py) / stride);
+                }
+
+                if((k * dilation) % stride == px)
+                {
+                    phase.kx.push_back(k);
+                    phase.mx.push_back((k * dilation - px) / stride);
+                }
+            }
+
+            phase.qy0 = ceil_div(pad - py, stride);
+            phase.qy_num = ceil_div(out_h + pad - py, stride) - phase.qy0;
+            phase.qx0 = ceil_div(pad - px, stride);
+            phase.qx_num = ceil_div(out_w + pad - px, stride) - phase.qx0;
+
+            if(phase.qy_num < 0)
+                phase.qy_num = 0;
+            if(phase.qx_num < 0)
+                phase.qx_num = 0;
+
+            int ty_num = phase.ky.size();
+            int tx_num = phase.kx.size();
+
+            phase.k_dim = in_c * ty_num * tx_num;
+            phase.packed_weight = nullptr;
+
+            if(phase.k_dim == 0)
+                continue;
+
+            /* sub kernel as a [out_c][in_c * ty_num * tx_num] matrix */
+            std::vector<float> sub_kernel(out_c * phase.k_dim);
+
+            for(int oc = 0; oc < out_c; oc++)
+            {
+                float* dst = sub_kernel.data() + oc * phase.k_dim;
+
+                for(int ic = 0; ic < in_c; ic++)
+                {
+                    const float* src = weight + (ic * out_c + oc) * ksize * ksize;
+
+                    for(int ty = 0; ty < ty_num; ty++)
+                        for(int tx = 0; tx < tx_num; tx++)
+                            *dst++ = src[phase.ky[ty] * ksize + phase.kx[tx]];
+                }
+            }
+
+            phase.packed_weight = ( float* )mem_alloc(sizeof(float) * sgemm_pack_a_size(out_c, phase.k_dim));
+
+            sgemm_pack_a(out_c, phase.k_dim, sub_kernel.data(), phase.k_dim, phase.packed_weight);
+
+            if(phase.k_dim > max_k_dim)
+                max_k_dim = phase.k_dim;
+        }
+
+    int cpu_number = cpu_info->GetCPUNumber();
+
+    buf_stride = max_k_dim * SGEMM_NR;
+    ScratchReserve(sizeof(float) * buf_stride * cpu_number);
+
+    return true;
+}
+
+void Deconv2dNative::RunPhase(const deconv_phase* phase, const float* input, float* output, int panel_start,
+                              int panel_end, float* buf)
+{
+    int qx_num = phase->qx_num;
+    int n_total = phase->qy_num * qx_num;
+    int ty_num = phase->ky.size();
+    int tx_num = phase->kx.size();
+    int in_hw = in_h * in_w;
+    int out_hw = out_h * out_w;
+
+    int row[SGEMM_NR];
+    int col[SGEMM_NR];
+    int out_offset[SGEMM_NR];
+    float tile[SGEMM_MR * SGEMM_NR];
+
+    for(int panel = panel_start; panel < panel_end; panel++)
+    {
+        int n0 = panel * SGEMM_NR;
+        int cols = n_total - n0 < SGEMM_NR ? n_total - n0 : SGEMM_NR;
+
+        for(int c = 0; c < cols; c++)
+        {
+            int j = (n0 + c) / qx_num;
+            int i = (n0 + c) % qx_num;
+
+            row[c] = phase->qy0 + j;
+            col[c] = phase->qx0 + i;
+            out_offset[c] = ((phase->qy0 + j) * stride + phase->py - pad) * out_w +
+                            (phase->qx0 + i) * stride + phase->px - pad;
+        }
+
+        if(phase->k_dim == 0)
+        {
+            for(int oc = 0; oc < out_c; oc++)
+            {
+                float v = f_activation(bias ? bias[oc] : 0.f, activation);
+
+                for(int c = 0; c < cols; c++)
+                    output[oc * out_hw + out_offset[c]] = v;
+            }
+
+            continue;
+        }
+
+        /* im2col of this panel, directly in packed layout */
+        bool one_row = (cols == SGEMM_NR && row[0] == row[SGEMM_NR - 1]);
+        float* b = buf;
+
+        for(int ic = 0; ic < in_c; ic++)
+        {
+            const float* in_ch = input + ic * in_hw;
+
+            for(int ty = 0; ty < ty_num; ty++)
+            {
+                int my = phase->my[ty];
+
+                for(int tx = 0; tx < tx_num; tx++)
+                {
+                    int mx = phase->mx[tx];
+
+                    if(one_row)
+                    {
+                        int iy = row[0] - my;
+                        int ix = col[0] - mx;
+
+                        if(iy >= 0 && iy < in_h && ix >= 0 && ix + SGEMM_NR <= in_w)
+                        {
+                            const float* src = in_ch + iy * in_w + ix;
+
+                            vf4_store(b, vf4_load(src));
+                            vf4_store(b + 4, vf4_load(src + 4));
+
+                            b += SGEMM_NR;
+                            continue;
+                        }
+                    }
+
+                    int c = 0;
+
+                    for(; c < cols; c++)
+                    {
+                        int iy = row[c] - my;
+                        int ix = col[c] - mx;
+
+                        if(iy >= 0 && iy < in_h && ix >= 0 && ix < in_w)
+                            b[c] = in_ch[iy * in_w + ix];
+                        else
+                            b[c] = 0.f;
+                    }
+
+                    for(; c < SGEMM_NR; c++)
+                        b[c] = 0.f;
+
+                    b += SGEMM_NR;
+                }
+            }
+        }
+
+        for(int m = 0; m < out_c; m += SGEMM_MR)
+        {
+            int rows = out_c - m < SGEMM_MR ? out_c - m : SGEMM_MR;
+
+            sgemm_kernel_4x8(phase->k_dim, phase->packed_weight + m * phase->k_dim, buf, tile, SGEMM_NR);
+
+            for(int r = 0; r < rows; r++)
+            {
+                float* out_ch = output + (m + r) * out_hw;
+                const float* t = tile + r * SGEMM_NR;
+                float bias_v = bias ? bias[m + r] : 0.f;
+
+                for(int c = 0; c < cols; c++)
+                    out_ch[out_offset[c]] = f_activation(t[c] + bias_v, activation);
+            }
+        }
+    }
+}
+
+bool Deconv2dNative::Aider(int cpu, int seq, void* data)
+{
+    deconv_task_param* param = ( deconv_task_param* )data;
+
+    RunPhase(param->phase, param->input, param->output, param->panel_start, param->panel_end, param->buf);
+
+    return true;
+}
+
+bool Deconv2dNative::Run(Node* node)
+{
+    Tensor* input_tensor = node->GetInputTensor(0);
+    Tensor* output_tensor = node->GetOutputTensor(0);
+
+    const float* input_org = ( const float* )get_tensor_mem(input_tensor);
+    float* output_org = ( float* )get_tensor_mem(output_tensor);
+
+    bias = nullptr;
+
+    if(node->GetInputNum() > 2)
+        bias = ( const float* )get_tensor_mem(node->GetInputTensor(2));
+
+    int batch = input_tensor->GetShape().GetN();
+    int cpu_number = cpu_info->GetCPUNumber();
+
+    buffer = ( float* )ScratchAlloc(sizeof(float) * buf_stride * cpu_number);
+
+    if(buffer == nullptr)
+        return false;
+
+    for(int n = 0; n < batch; n++)
+    {
+        const float* input = input_org + n * in_c * in_h * in_w;
+        float* output = output_org + n * out_c * out_h * out_w;
+
+        for(unsigned int i = 0; i < phases.size(); i++)
+        {
+            const deconv_phase* phase = &phases[i];
+
+            int panel_num = (phase->qy_num * phase->qx_num + SGEMM_NR - 1) / SGEMM_NR;
+
+            if(panel_num == 0)
+                continue;
+
+            if(cpu_number == 1 || panel_num < cpu_number)
+            {
+                RunPhase(phase, input, output, 0, panel_num, buffer);
+                continue;
+            }
+
+            auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+            task_list.resize(cpu_number);
+            param_list.resize(cpu_number);
+
+            int step = panel_num / cpu_number;
+
+            for(int t = 0; t < cpu_number; t++)
+            {
+                deconv_task_param* p = &param_list[t];
+                sub_op_task* task = &task_list[t];
+
+                task->exec_func = f;
+                task->seq = t;
+                task->data = p;
+
+                p->input = input;
+                p->output = output;
+                p->phase = phase;
+                p->panel_start = t * step;
+                p->panel_end = p->panel_start + step;
+                p->buf = buffer + t * buf_stride;
+            }
+
+            param_list[cpu_number - 1].panel_end = panel_num;
+
+            task_dispatch(task_list, -1);
+            wait_done();
+        }
+    }
+
+    return true;
+}
+
+bool Deconv2dNative::Postrun(Node* node)
+{
+    for(unsigned int i = 0; i < phases.size(); i++)
+    {
+        if(phases[i].packed_weight)
+            mem_free(phases[i].packed_weight);
+    }
+
+    phases.clear();
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->layout == TENGINE_LAYOUT_NHWC || exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    Deconvolution* deconv_op = dynamic_cast<Deconvolution*>(node->GetOp());
+    DeconvParam* param = deconv_op->GetParam();
+
+    if(param->stride < 1 || param->dilation < 1 || param->kernel_size < 1)
+        return nullptr;
+
+    Deconv2dNative* ops = new Deconv2dNative();
+
+    ops->need_free = true;
+
+    return ops;
+}
+
+}    // namespace deconv_2d
+
+void RegisterDeconv2dNative(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Deconvolution", deconv_2d::SelectFunc,
+                                                  deconv_2d::default_prio);
+}
+
+}    // namespace TEngine
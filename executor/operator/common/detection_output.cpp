@@ -31,30 +31,47 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "operator/detection_output.hpp"
+#include "nms.hpp"
 #include <math.h>
 namespace TEngine {
 
 namespace DetectionOutputImpl {
 
-struct DetectionOutputOps : public NodeOps
+struct class_nms_param
 {
-    struct Box
-    {
-        float x0;
-        float y0;
-        float x1;
-        float y1;
-        int class_idx;
-        float score;
-    };
-
-    void get_boxes(std::vector<Box>& boxes, int num_prior, float* loc_ptr, float* prior_ptr)
+    const NmsBoxes* boxes;
+    const float* conf;
+    const DetectionOutputParam* param;
+    int num_classes;
+    int class_start;
+    int class_step;
+    std::vector<int>* class_picked;
+    std::vector<float>* class_score;
+    NmsScratch* scratch;
+};
+
+struct DetectionOutputOps : public MTNodeOps
+{
+    /* decode the priors whose best foreground score passes the threshold, the others can never be picked */
+    void get_boxes(NmsBoxes& boxes, int num_prior, int num_classes, float threshold, const float* conf_ptr,
+                   const float* loc_ptr, const float* prior_ptr)
     {
+        boxes.Clear();
+
         for(int i = 0; i < num_prior; i++)
         {
-            float* loc = loc_ptr + i * 4;
-            float* pbox = prior_ptr + i * 4;
-            float* pvar = pbox + num_prior * 4;
+            const float* conf = conf_ptr + i * num_classes;
+            float max_score = conf[1];
+
+            for(int c = 2; c < num_classes; c++)
+                max_score = std::max(max_score, conf[c]);
+
+            if(!(max_score > threshold))
+                continue;
+
+            const float* loc = loc_ptr + i * 4;
+            const float* pbox = prior_ptr + i * 4;
+            const float* pvar = pbox + num_prior * 4;
             // center size
             // pbox [xmin,ymin,xmax,ymax]
             float pbox_w = pbox[2] - pbox[0];
@@ -68,63 +85,58 @@ struct DetectionOutputOps : public NodeOps
             float bbox_w = pbox_w * exp(pvar[2] * loc[2]);
             float bbox_h = pbox_h * exp(pvar[3] * loc[3]);
             // bbox [xmin,ymin,xmax,ymax]
-            boxes[i].x0 = bbox_cx - bbox_w * 0.5f;
-            boxes[i].y0 = bbox_cy - bbox_h * 0.5f;
-            boxes[i].x1 = bbox_cx + bbox_w * 0.5f;
-            boxes[i].y1 = bbox_cy + bbox_h * 0.5f;
+            boxes.Push(bbox_cx - bbox_w * 0.5f, bbox_cy - bbox_h * 0.5f, bbox_cx + bbox_w * 0.5f,
+                       bbox_cy + bbox_h * 0.5f, max_score, i);
         }
     }
-    static inline float intersection_area(const Box& a, const Box& b)
-    {
-        if(a.x0 > b.x1 || a.x1 < b.x0 || a.y0 > b.y1 || a.y1 < b.y0)
-        {
-            // no intersection
-            return 0.f;
-        }
 
-        float inter_width = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
-        float inter_height = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
-
-        return inter_width * inter_height;
-    }
-    void nms_sorted_bboxes(const std::vector<Box>& bboxes, std::vector<int>& picked, float nms_threshold)
+    void class_nms(const class_nms_param* p)
     {
-        picked.clear();
-        const int n = bboxes.size();
+        const NmsBoxes& boxes = *p->boxes;
+        int num_box = boxes.Size();
 
-        std::vector<float> areas(n);
-        for(int i = 0; i < n; i++)
-        {
-            const Box& r = bboxes[i];
+        std::vector<float> score(num_box);
+        std::vector<int> order;
 
-            float width = r.x1 - r.x0;
-            float height = r.y1 - r.y0;
+        NmsParam nms_param(p->param->nms_threshold);
 
-            areas[i] = width * height;
-        }
+        order.reserve(num_box);
 
-        for(int i = 0; i < n; i++)
+        for(int c = p->class_start; c < p->num_classes; c += p->class_step)
         {
-            const Box& a = bboxes[i];
+            order.clear();
 
-            int keep = 1;
-            for(int j = 0; j < ( int )picked.size(); j++)
+            for(int j = 0; j < num_box; j++)
             {
-                const Box& b = bboxes[picked[j]];
-
-                // intersection over union
-                float inter_area = intersection_area(a, b);
-                float union_area = areas[i] + areas[picked[j]] - inter_area;
-                //             float IoU = inter_area / union_area
-                if(inter_area / union_area > nms_threshold)
-                    keep = 0;
+                score[j] = p->conf[boxes.tag[j] * p->num_classes + c];
+
+                if(score[j] > p->param->confidence_threshold)
+                    order.push_back(j);
             }
 
-            if(keep)
-                picked.push_back(i);
+            // keep nms_top_k
+            nms_topk(order, score.data(), p->param->nms_top_k);
+
+            std::vector<int>& picked = p->class_picked[c];
+
+            nms_sorted(boxes, order, nms_param, *p->scratch, picked);
+
+            std::vector<float>& picked_score = p->class_score[c];
+
+            picked_score.resize(picked.size());
+
+            for(unsigned int j = 0; j < picked.size(); j++)
+                picked_score[j] = score[picked[j]];
         }
     }
 
+    bool class_nms_aider(int cpu, int seq, void* data)
+    {
+        class_nms(( const class_nms_param* )data);
+
+        return true;
+    }
+
     bool Run(Node* node)
     {
         const Tensor* loc_tensor = node->GetInputTensor(0);
@@ -157,63 +169,92 @@ struct DetectionOutputOps : public NodeOps
         float* conf_ptr = confidence + b * num_prior * num_classes;
         float* prior_ptr = priorbox + b * num_priorx4 * 2;
 
-        std::vector<Box> boxes(num_prior);
-        get_boxes(boxes, num_prior, loc_ptr, prior_ptr);
+        NmsBoxes boxes;
+
+        if(num_classes > 1)
+            get_boxes(boxes, num_prior, num_classes, param_->confidence_threshold, conf_ptr, loc_ptr, prior_ptr);
+
+        std::vector<std::vector<int>> all_class_picked(num_classes);
+        std::vector<std::vector<float>> all_class_score(num_classes);
 
-        std::vector<std::vector<Box>> all_class_bbox_rects;
-        all_class_bbox_rects.resize(num_classes);
         // start from 1 to ignore background class
-        for(int i = 1; i < num_classes; i++)
+        int cpu_number = cpu_info->GetCPUNumber();
+        int task_num = std::min(cpu_number, num_classes - 1);
+
+        if(boxes.Size() == 0)
+            task_num = 0;
+
+        std::vector<class_nms_param> param_list(std::max(task_num, 1));
+
+        if(( int )scratch_list.size() < task_num)
+            scratch_list.resize(task_num);
+
+        for(int i = 0; i < task_num; i++)
         {
-            std::vector<Box> class_box;
-            for(int j = 0; j < num_prior; j++)
-            {
-                float score = conf_ptr[j * num_classes + i];
-                if(score > param_->confidence_threshold)
-                {
-                    boxes[j].score = score;
-                    boxes[j].class_idx = i;
-                    class_box.push_back(boxes[j]);
-                }
-            }
-            // sort
-            std::sort(class_box.begin(), class_box.end(), [](const Box& a, const Box& b) { return a.score > b.score; });
+            class_nms_param* p = &param_list[i];
+
+            p->boxes = &boxes;
+            p->conf = conf_ptr;
+            p->param = param_;
+            p->num_classes = num_classes;
+            p->class_start = 1 + i;
+            p->class_step = task_num;
+            p->class_picked = all_class_picked.data();
+            p->class_score = all_class_score.data();
+            p->scratch = &scratch_list[i];
+        }
 
-            // keep nms_top_k
-            if(param_->nms_top_k < ( int )class_box.size())
-            {
-                class_box.resize(param_->nms_top_k);
-            }
-            // apply nms
-            std::vector<int> picked;
-            nms_sorted_bboxes(class_box, picked, param_->nms_threshold);
-            // select
-            for(int j = 0; j < ( int )picked.size(); j++)
+        if(task_num == 1)
+        {
+            class_nms(&param_list[0]);
+        }
+        else if(task_num > 1)
+        {
+            std::vector<sub_op_task> task_list(task_num);
+
+            auto f = std::bind(&DetectionOutputOps::class_nms_aider, this, std::placeholders::_1,
+                               std::placeholders::_2, std::placeholders::_3);
+
+            for(int i = 0; i < task_num; i++)
             {
-                int z = picked[j];
-                all_class_bbox_rects[i].push_back(class_box[z]);
+                sub_op_task* task = &task_list[i];
+
+                task->exec_func = f;
+                task->seq = i;
+                task->data = &param_list[i];
             }
+
+            task_dispatch(task_list, -1);
+            wait_done();
         }
+
         // gather all class
-        std::vector<Box> bbox_rects;
+        std::vector<int> rect_class;
+        std::vector<int> rect_box;
+        std::vector<float> rect_score;
 
-        for(int i = 0; i < num_classes; i++)
+        for(int i = 1; i < num_classes; i++)
         {
-            const std::vector<Box>& class_bbox_rects = all_class_bbox_rects[i];
-            bbox_rects.insert(bbox_rects.end(), class_bbox_rects.begin(), class_bbox_rects.end());
+            const std::vector<int>& picked = all_class_picked[i];
+
+            for(unsigned int j = 0; j < picked.size(); j++)
+            {
+                rect_class.push_back(i);
+                rect_box.push_back(picked[j]);
+                rect_score.push_back(all_class_score[i][j]);
+            }
         }
 
-        // global sort inplace
-        std::sort(bbox_rects.begin(), bbox_rects.end(), [](const Box& a, const Box& b) { return a.score > b.score; });
+        // global top keep_top_k
+        std::vector<int> order(rect_score.size());
 
-        // keep_top_k
-        if(param_->keep_top_k < ( int )bbox_rects.size())
-        {
-            bbox_rects.resize(param_->keep_top_k);
-        }
+        for(unsigned int i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        nms_topk(order, rect_score.data(), param_->keep_top_k);
 
         // output     [b,num,6,1]
-        int num_detected = bbox_rects.size();
+        int num_detected = order.size();
         int total_size = num_detected * 6 * 4;
         // alloc mem
         void* mem_addr = mem_alloc(total_size);
@@ -226,18 +267,22 @@ struct DetectionOutputOps : public NodeOps
 
         for(int i = 0; i < num_detected; i++)
         {
-            const Box& r = bbox_rects[i];
+            int r = order[i];
+            int k = rect_box[r];
             float* outptr = output + i * 6;
-            outptr[0] = r.class_idx;
-            outptr[1] = r.score;
-            outptr[2] = r.x0;
-            outptr[3] = r.y0;
-            outptr[4] = r.x1;
-            outptr[5] = r.y1;
+            outptr[0] = rect_class[r];
+            outptr[1] = rect_score[r];
+            outptr[2] = boxes.x0[k];
+            outptr[3] = boxes.y0[k];
+            outptr[4] = boxes.x1[k];
+            outptr[5] = boxes.y1[k];
         }
 
         return true;
     }
+
+    /* one per task, kept across runs */
+    std::vector<NmsScratch> scratch_list;
 };
 
 }    // namespace DetectionOutputImpl
@@ -33,6 +33,7 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "operator/detection_postprocess.hpp"
+#include "nms.hpp"
 #include "prof_utils.hpp"
 #include "data_type.hpp"
 
@@ -40,99 +41,25 @@ namespace TEngine {
 
 namespace DetectionPostProcessImpl {
 
-struct DetectionPostProcessOps : public NodeOps
+struct class_nms_param
 {
-    struct Box
-    {
-        float x0;    // xmin
-        float y0;    // ymin
-        float x1;    // xmax
-        float y1;    // ymax
-        int box_idx;
-        int class_idx;
-        float score;
-    };
-
-    static inline float intersection_area(const Box& a, const Box& b)
-    {
-        if(a.x0 > b.x1 || a.x1 < b.x0 || a.y0 > b.y1 || a.y1 < b.y0)
-        {
-            // no intersection
-            return 0.f;
-        }
-
-        float inter_width = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
-        float inter_height = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
-
-        return inter_width * inter_height;
-    }
-
-    static inline void nms_sorted_bboxes(const std::vector<Box>& bboxes, std::vector<int>& picked, float nms_threshold)
-    {
-        const int n = bboxes.size();
-
-        std::vector<float> areas(n);
-        for(int i = 0; i < n; i++)
-        {
-            const Box& r = bboxes[i];
-
-            float width = r.x1 - r.x0;
-            float height = r.y1 - r.y0;
-
-            areas[i] = width * height;
-        }
-
-        for(int i = 0; i < n; i++)
-        {
-            const Box& a = bboxes[i];
-
-            int keep = 1;
-            for(int j = 0; j < ( int )picked.size(); j++)
-            {
-                const Box& b = bboxes[picked[j]];
-
-                // intersection over union
-                float inter_area = intersection_area(a, b);
-                float union_area = areas[i] + areas[picked[j]] - inter_area;
-                // float IoU = inter_area / union_area
-                if(inter_area / union_area > nms_threshold)
-                    keep = 0;
-            }
-
-            if(keep)
-                picked.push_back(i);
-        }
-    }
-
-    void decode_boxes(std::vector<Box>& decoded_boxes, const float* box_ptr, const float* anchor_ptr,
-                      const DetectionPostProcessParam* param)
-    {
-        const int num_boxes = decoded_boxes.size();
-        std::vector<float> scales = param->scales;
-
-        for(int i = 0; i < num_boxes; i++)
-        {
-            const float* box_coord = box_ptr + i * 4;
-            const float* anchor = anchor_ptr + i * 4;
-
-            // [0]: y  [1]: x  [2]: h  [3]: w
-            float ycenter = box_coord[0] / scales[0] * anchor[2] + anchor[0];
-            float xcenter = box_coord[1] / scales[1] * anchor[3] + anchor[1];
-            float half_h = 0.5f * static_cast<float>(std::exp(box_coord[2] / scales[2])) * anchor[2];
-            float half_w = 0.5f * static_cast<float>(std::exp(box_coord[3] / scales[3])) * anchor[3];
-
-            decoded_boxes[i].y0 = ycenter - half_h;
-            decoded_boxes[i].x0 = xcenter - half_w;
-            decoded_boxes[i].y1 = ycenter + half_h;
-            decoded_boxes[i].x1 = xcenter + half_w;
-        }
-    }
+    const NmsBoxes* boxes;
+    const float* score;
+    int num_classes;
+    int class_start;
+    int class_step;
+    int top_k;
+    float nms_threshold;
+    std::vector<int>* class_picked;
+    std::vector<float>* class_score;
+    NmsScratch* scratch;
+};
 
-    static inline int decode_single_box(Box& box, const float* box_ptr, const float* anchor_ptr,
+struct DetectionPostProcessOps : public MTNodeOps
+{
+    static inline int decode_single_box(float* box, int i, const float* box_ptr, const float* anchor_ptr,
                                         const std::vector<float>& scales)
     {
-        int i = box.box_idx;
-
         const float* box_coord = box_ptr + i * 4;
         const float* anchor = anchor_ptr + i * 4;
 
@@ -142,11 +69,12 @@ struct DetectionPostProcessOps : public NodeOps
         float half_h = 0.5f * static_cast<float>(std::exp(box_coord[2] / scales[2])) * anchor[2];
         float half_w = 0.5f * static_cast<float>(std::exp(box_coord[3] / scales[3])) * anchor[3];
 
-        box.y0 = ycenter - half_h;
-        box.x0 = xcenter - half_w;
-        box.y1 = ycenter + half_h;
-        box.x1 = xcenter + half_w;
-        if(box.y0 < 0 || box.x0 < 0)
+        // [x0, y0, x1, y1]
+        box[0] = xcenter - half_w;
+        box[1] = ycenter - half_h;
+        box[2] = xcenter + half_w;
+        box[3] = ycenter + half_h;
+        if(box[1] < 0 || box[0] < 0)
             return -1;
         return 0;
     }
@@ -154,10 +82,14 @@ struct DetectionPostProcessOps : public NodeOps
     int score_zero = 0;
     int anchor_zero = 0;
 
+    /*
+     * each box is decoded once, and only when one of its class scores can be selected;
+     * returns the float scores, which are dequantized into score_buf for uint8_t
+     */
     template <typename type>
-    void get_all_boxes_rect(std::vector<std::vector<Box>>& all_class_bbox_rects, uint8_t* box, uint8_t* score,
-                            uint8_t* anchor, float box_scale, float score_scale, float anchor_scale, int num_boxes,
-                            int num_classes, std::vector<float>& scales)
+    const float* get_all_boxes_rect(NmsBoxes& boxes, std::vector<float>& score_buf, uint8_t* box, uint8_t* score,
+                                    uint8_t* anchor, float box_scale, float score_scale, float anchor_scale,
+                                    int num_boxes, int num_classes, std::vector<float>& scales)
     {
         float* box_ptr = nullptr;
         float* score_ptr = nullptr;
@@ -172,49 +104,92 @@ struct DetectionPostProcessOps : public NodeOps
         {
             box_ptr = ( float* )std::malloc(sizeof(float) * num_boxes * 4);
             anchor_ptr = ( float* )std::malloc(sizeof(float) * num_boxes * 4);
-            score_ptr = ( float* )std::malloc(sizeof(float) * num_boxes * (num_classes));
+            score_buf.resize(num_boxes * num_classes);
+            score_ptr = score_buf.data();
             for(int i = 0; i < num_boxes * 4; i++)
             {
                 box_ptr[i] = (box[i] - box_zero) * box_scale;
                 anchor_ptr[i] = anchor[i] * anchor_scale;
             }
-            // FILE* pf = fopen("score","w");
             for(int i = 0; i < num_boxes * (num_classes); i++)
             {
                 score_ptr[i] = score[i] * score_scale;
-                //    if(i%91 ==0) fprintf(pf,"\n[%d]:",i/91);
-                //    fprintf(pf,"%f,",score_ptr[i]);
             }
-            // fclose(pf);
         }
 
-        Box selected_box;
+        boxes.Clear();
+
+        float rect[4];
         for(int j = 0; j < num_boxes; j++)
         {
-            for(int i = 1; i < num_classes; i++)
-            {
-                float score = score_ptr[j * (num_classes) + i];
+            const float* box_score = score_ptr + j * num_classes;
+            float max_score = box_score[1];
 
-                if(score < 0.6)
-                    continue;
+            for(int i = 2; i < num_classes; i++)
+                max_score = std::max(max_score, box_score[i]);
 
-                selected_box.score = score;
-                selected_box.class_idx = i;
-                selected_box.box_idx = j;
+            if(max_score < 0.6)
+                continue;
 
-                if(decode_single_box(selected_box, box_ptr, anchor_ptr, scales) < 0)
-                    continue;
+            if(decode_single_box(rect, j, box_ptr, anchor_ptr, scales) < 0)
+                continue;
 
-                auto& cls_vector = all_class_bbox_rects.at(i);
-                cls_vector.emplace_back(selected_box);
-            }
+            boxes.Push(rect[0], rect[1], rect[2], rect[3], max_score, j);
         }
+
         if(sizeof(type) == 1)
         {
             std::free(anchor_ptr);
-            std::free(score_ptr);
             std::free(box_ptr);
         }
+
+        return score_ptr;
+    }
+
+    void class_nms(const class_nms_param* p)
+    {
+        const NmsBoxes& boxes = *p->boxes;
+        int num_box = boxes.Size();
+
+        std::vector<float> score(num_box);
+        std::vector<int> order;
+
+        NmsParam nms_param(p->nms_threshold);
+
+        order.reserve(num_box);
+
+        for(int c = p->class_start; c < p->num_classes; c += p->class_step)
+        {
+            order.clear();
+
+            for(int j = 0; j < num_box; j++)
+            {
+                score[j] = p->score[boxes.tag[j] * p->num_classes + c];
+
+                if(score[j] >= 0.6)
+                    order.push_back(j);
+            }
+
+            nms_topk(order, score.data(), p->top_k);
+
+            std::vector<int>& picked = p->class_picked[c];
+
+            nms_sorted(boxes, order, nms_param, *p->scratch, picked);
+
+            std::vector<float>& picked_score = p->class_score[c];
+
+            picked_score.resize(picked.size());
+
+            for(unsigned int j = 0; j < picked.size(); j++)
+                picked_score[j] = score[picked[j]];
+        }
+    }
+
+    bool class_nms_aider(int cpu, int seq, void* data)
+    {
+        class_nms(( const class_nms_param* )data);
+
+        return true;
     }
 
     bool Run(Node* node)
@@ -246,17 +221,15 @@ struct DetectionPostProcessOps : public NodeOps
         const int num_classes = param->num_classes + 1;
         const int max_detections = param->max_detections;
 
-        // printf("num_box: %d ,num_classes: %d ,max: %d \n",num_boxes,num_classes,max_detections);
-
-        std::vector<std::vector<Box>> all_class_bbox_rects;
+        NmsBoxes boxes;
+        std::vector<float> score_buf;
+        const float* scores = nullptr;
         std::vector<float>& scales = param->scales;
 
-        all_class_bbox_rects.resize(num_classes);
-
         if(elem_size == 4)
         {
-            get_all_boxes_rect<float>(all_class_bbox_rects, box_ptr, score_ptr, anchor_ptr, 1, 1, 1, num_boxes,
-                                      num_classes, scales);
+            scores = get_all_boxes_rect<float>(boxes, score_buf, box_ptr, score_ptr, anchor_ptr, 1, 1, 1, num_boxes,
+                                               num_classes, scales);
         }
         else if(elem_size == 1)
         {
@@ -269,60 +242,111 @@ struct DetectionPostProcessOps : public NodeOps
             auto anchor_quant = input_anchors->GetQuantParam();
             float anchor_scale = (*anchor_quant)[0].scale;
             anchor_zero = (*anchor_quant)[0].zero_point;
-            get_all_boxes_rect<uint8_t>(all_class_bbox_rects, box_ptr, score_ptr, anchor_ptr, box_scale, score_scale,
-                                        anchor_scale, num_boxes, num_classes, scales);
+            scores = get_all_boxes_rect<uint8_t>(boxes, score_buf, box_ptr, score_ptr, anchor_ptr, box_scale,
+                                                 score_scale, anchor_scale, num_boxes, num_classes, scales);
         }
 
-        std::vector<Box> all_boxes;
+        std::vector<std::vector<int>> all_class_picked(num_classes);
+        std::vector<std::vector<float>> all_class_score(num_classes);
 
-        for(int i = 1; i < num_classes; i++)
+        int cpu_number = cpu_info->GetCPUNumber();
+        int task_num = std::min(cpu_number, num_classes - 1);
+
+        if(boxes.Size() == 0)
+            task_num = 0;
+
+        std::vector<class_nms_param> param_list(std::max(task_num, 1));
+
+        if(( int )scratch_list.size() < task_num)
+            scratch_list.resize(task_num);
+
+        for(int i = 0; i < task_num; i++)
         {
-            std::vector<Box>& class_box = all_class_bbox_rects.at(i);
+            class_nms_param* p = &param_list[i];
+
+            p->boxes = &boxes;
+            p->score = scores;
+            p->num_classes = num_classes;
+            p->class_start = 1 + i;
+            p->class_step = task_num;
+            p->top_k = max_detections * 2;
+            p->nms_threshold = param->nms_iou_threshold;
+            p->class_picked = all_class_picked.data();
+            p->class_score = all_class_score.data();
+            p->scratch = &scratch_list[i];
+        }
 
-            if(class_box.empty())
-                continue;
+        if(task_num == 1)
+        {
+            class_nms(&param_list[0]);
+        }
+        else if(task_num > 1)
+        {
+            std::vector<sub_op_task> task_list(task_num);
 
-            // sort
-            std::sort(class_box.begin(), class_box.end(), [](const Box& a, const Box& b) { return a.score > b.score; });
+            auto f = std::bind(&DetectionPostProcessOps::class_nms_aider, this, std::placeholders::_1,
+                               std::placeholders::_2, std::placeholders::_3);
 
-            if(( int )class_box.size() > max_detections * 2)
-                class_box.resize(max_detections * 2);
+            for(int i = 0; i < task_num; i++)
+            {
+                sub_op_task* task = &task_list[i];
+
+                task->exec_func = f;
+                task->seq = i;
+                task->data = &param_list[i];
+            }
+
+            task_dispatch(task_list, -1);
+            wait_done();
+        }
 
-            std::vector<int> picked;
-            nms_sorted_bboxes(class_box, picked, param->nms_iou_threshold);
+        // gather the survivors of all classes
+        std::vector<int> rect_class;
+        std::vector<int> rect_box;
+        std::vector<float> rect_score;
 
-            // save the survivors
-            for(int j = 0; j < ( int )picked.size(); j++)
+        for(int i = 1; i < num_classes; i++)
+        {
+            const std::vector<int>& picked = all_class_picked[i];
+
+            for(unsigned int j = 0; j < picked.size(); j++)
             {
-                int z = picked[j];
-                all_boxes.emplace_back(class_box[z]);
+                rect_class.push_back(i);
+                rect_box.push_back(picked[j]);
+                rect_score.push_back(all_class_score[i][j]);
             }
         }
 
-        std::sort(all_boxes.begin(), all_boxes.end(), [](const Box& a, const Box& b) { return a.score > b.score; });
+        std::vector<int> order(rect_score.size());
 
-        if(max_detections < ( int )all_boxes.size())
-            all_boxes.resize(max_detections);
+        for(unsigned int i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        nms_topk(order, rect_score.data(), max_detections);
 
         // generate output tensors
 
-        num_detections[0] = all_boxes.size();
+        num_detections[0] = order.size();
 
-        for(unsigned int i = 0; i < all_boxes.size(); i++)
+        for(unsigned int i = 0; i < order.size(); i++)
         {
-            Box& box = all_boxes[i];
+            int r = order[i];
+            int k = rect_box[r];
 
-            detection_classes[i] = box.class_idx;
-            detection_scores[i] = box.score;
+            detection_classes[i] = rect_class[r];
+            detection_scores[i] = rect_score[r];
 
-            detection_boxes[4 * i] = box.x0;
-            detection_boxes[4 * i + 1] = box.y0;
-            detection_boxes[4 * i + 2] = box.x1;
-            detection_boxes[4 * i + 3] = box.y1;
+            detection_boxes[4 * i] = boxes.x0[k];
+            detection_boxes[4 * i + 1] = boxes.y0[k];
+            detection_boxes[4 * i + 2] = boxes.x1[k];
+            detection_boxes[4 * i + 3] = boxes.y1[k];
         }
 
         return true;
     }
+
+    /* one per task, kept across runs */
+    std::vector<NmsScratch> scratch_list;
 };
 
 }    // namespace DetectionPostProcessImpl
@@ -48,6 +48,12 @@ struct DropoutOps : public NodeOps
         return true;
     }
 
+    /* elementwise, any layout does */
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
     bool Run(Node* node)
     {
         // Nothing needs to do for inference
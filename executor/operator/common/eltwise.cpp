@@ -34,174 +34,450 @@
 #include "graph.hpp"
 #include "operator/eltwise.hpp"
 #include "data_type.hpp"
+
+#include "simd_vec.h"
+
+/*
+ * Element wise binary operations with numpy style broadcasting, and the
+ * per channel second input of caffe in NCHW graphs, see BroadcastDims().
+ *
+ * The dims of the two inputs are aligned to the output dims, the dims of
+ * size 1 in the output are dropped and the adjacent dims that both inputs
+ * walk in the same way are merged. What is left is a set of rows of the
+ * last dim, where each input either moves along with the output or stays
+ * on one element. The rows are cut into units of at most ELT_UNIT_SIZE
+ * elements, run on all cpus when there are enough of them.
+ *
+ * The *_SCALAR types are the same operations with a broadcast input.
+ */
+
 namespace TEngine {
 
 namespace EltwiseImpl {
 
-struct EltwiseOps : public NodeOps
+#define ELT_MAX_DIM 8
+
+/* elements of one unit */
+#define ELT_UNIT_SIZE (16 * 1024)
+
+/* less elements are run on one cpu */
+#define ELT_MT_MIN_SIZE (64 * 1024)
+
+enum EltOp
 {
-    template <typename data_type>
-    bool kernel_run(void* output, void* input0, void* input1, int type, const TShape ishape, int input1_count4)
+    ELT_OP_SUM,
+    ELT_OP_PROD,
+    ELT_OP_SUB,
+    ELT_OP_DIV,
+    ELT_OP_MAX,
+    ELT_OP_MIN,
+    ELT_OP_RSQRT
+};
+
+struct elt_plan
+{
+    int ndim;
+    long dims[ELT_MAX_DIM];
+
+    /* input strides in elements, 0 along a broadcast dim */
+    long stride0[ELT_MAX_DIM];
+    long stride1[ELT_MAX_DIM];
+
+    int chunk_num;
+    long unit_num;
+};
+
+static bool elt_make_plan(elt_plan* plan, const std::vector<int>& dims0, const std::vector<int>& dims1, int layout)
+{
+    std::vector<int> in0;
+    std::vector<int> in1;
+    std::vector<int> out;
+
+    if(!Eltwise::BroadcastDims(dims0, dims1, layout, in0, in1, out) || out.size() > ELT_MAX_DIM)
+        return false;
+
+    int ndim = out.size();
+    long s0[ELT_MAX_DIM];
+    long s1[ELT_MAX_DIM];
+    long size0 = 1;
+    long size1 = 1;
+
+    for(int i = ndim - 1; i >= 0; i--)
     {
-        data_type* out_ptr = ( data_type* )output;
-        data_type* in0 = ( data_type* )input0;
-        data_type* in1 = ( data_type* )input1;
+        s0[i] = in0[i] == 1 ? 0 : size0;
+        s1[i] = in1[i] == 1 ? 0 : size1;
+        size0 *= in0[i];
+        size1 *= in1[i];
+    }
+
+    /* drop the dims of size 1, merge a dim into the previous one when both inputs allow it */
+    int n = 0;
 
-        int input_count4 = ishape.GetSize();
-        int input_chan = ishape.GetC();
-        int input_hw = ishape.GetH() * ishape.GetW();
+    for(int i = 0; i < ndim; i++)
+    {
+        if(out[i] == 1)
+            continue;
 
-        switch(type)
+        if(n > 0 && plan->stride0[n - 1] == s0[i] * out[i] && plan->stride1[n - 1] == s1[i] * out[i])
         {
-            case ELT_SUB:
-                if(input_count4 == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = (*in0++) - (*in1++);
-                    }
-                }
-                else if(input_chan == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = in0[i] - in1[i / input_hw];
-                    }
-                }
-                else
-                    return false;
-                break;
-            case ELT_SUM:
-                if(input1_count4 == 1)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = (*in0++) + in1[0];
-                    }
-                }
-                else if(input_count4 == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = (*in0++) + (*in1++);
-                    }
-                }
-                else if(input_chan == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = in0[i] + in1[i / input_hw];
-                    }
-                }
-                else
-                    return false;
-                break;
-            case ELT_MAX:
-                for(int i = 0; i < input_count4; ++i)
-                {
-                    *out_ptr++ = std::max(in0[i], in1[i]);
-                }
-                break;
-            case ELT_PROD:
-                if(input1_count4 == 1)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = (*in0++) * in1[0];
-                    }
-                }
-                else if(input_count4 == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = in0[i] * in1[i];
-                    }
-                }
-                else if(input_chan == input1_count4)
-                {
-                    for(int i = 0; i < input_count4; ++i)
-                    {
-                        *out_ptr++ = in0[i] * in1[i / input_hw];
-                    }
-                }
-                else
-                    return false;
-                break;
-            case ELT_RSQRT:
-                for(int i = 0; i < input_count4; ++i)
-                {
-                    *out_ptr++ = 1 / sqrt(in0[i]);
-                }
-                break;
-            case ELT_MIN_SCALAR:
-                for(int i = 0; i < input_count4; ++i)
-                {
-                    *out_ptr++ = std::min((*in0++), in1[0]);
-                }
-                break;
-            case ELT_SUB_SCALAR:
-                for(int i = 0; i < input_count4; ++i)
-                {
-                    *out_ptr++ = (*in0++) - in1[0];
-                }
-                break;
-            case ELT_PROD_SCALAR:
-                for(int i = 0; i < input_count4; ++i)
-                {
-                    *out_ptr++ = (*in0++) * in1[0];
-                }
-                break;
+            plan->dims[n - 1] *= out[i];
+            plan->stride0[n - 1] = s0[i];
+            plan->stride1[n - 1] = s1[i];
+
+            continue;
         }
-        return true;
+
+        plan->dims[n] = out[i];
+        plan->stride0[n] = s0[i];
+        plan->stride1[n] = s1[i];
+        n++;
     }
 
-    bool Run(Node* node)
+    if(n == 0)
     {
-        // input
-        Tensor* input_tensor0 = node->GetInputTensor(0);
-        int element_size = DataType::GetTypeSize(input_tensor0->GetDataType());
-        const TShape& ishape = input_tensor0->GetShape();
-        void* input0 = get_tensor_mem(input_tensor0);
+        plan->dims[0] = 1;
+        plan->stride0[0] = 0;
+        plan->stride1[0] = 0;
+        n = 1;
+    }
 
-        Tensor* input_tensor1 = nullptr;
-        void* input1 = nullptr;
-        int input1_count4 = 0;
+    plan->ndim = n;
 
-        if(node->GetInputNum() > 1)
+    long row_num = 1;
+
+    for(int i = 0; i < n - 1; i++)
+        row_num *= plan->dims[i];
+
+    plan->chunk_num = (plan->dims[n - 1] + ELT_UNIT_SIZE - 1) / ELT_UNIT_SIZE;
+    plan->unit_num = row_num * plan->chunk_num;
+
+    return true;
+}
+
+template <int OP, typename T> static inline T elt_op(T a, T b)
+{
+    switch(OP)
+    {
+        case ELT_OP_SUM:
+            return a + b;
+        case ELT_OP_PROD:
+            return a * b;
+        case ELT_OP_SUB:
+            return a - b;
+        case ELT_OP_DIV:
+            return a / b;
+        case ELT_OP_MAX:
+            return std::max(a, b);
+        case ELT_OP_MIN:
+            return std::min(a, b);
+        default:
+            return 1 / sqrt(a);
+    }
+}
+
+template <int OP> static inline vf4_t vf4_elt_op(vf4_t a, vf4_t b)
+{
+    switch(OP)
+    {
+        case ELT_OP_SUM:
+            return vf4_add(a, b);
+        case ELT_OP_PROD:
+            return vf4_mul(a, b);
+        case ELT_OP_SUB:
+            return vf4_sub(a, b);
+        case ELT_OP_DIV:
+            return vf4_div(a, b);
+        case ELT_OP_MAX:
+            return vf4_max(a, b);
+        default:
+            return vf4_min(a, b);
+    }
+}
+
+template <typename T> static inline T elt_activation(T a, int activation)
+{
+    if(activation >= 0)
+    {
+        if(a < 0)
+            a = 0;
+
+        if(activation > 0 && a > activation)
+            a = activation;
+    }
+
+    return a;
+}
+
+/* out[i] = a[i * sa] op b[i * sb], the strides are 0 or 1 */
+template <int OP, typename T>
+static void elt_row(const T* a, long sa, const T* b, long sb, T* out, long n, int activation)
+{
+    for(long i = 0; i < n; i++)
+        out[i] = elt_activation(elt_op<OP>(a[i * sa], b[i * sb]), activation);
+}
+
+template <int OP>
+static void elt_row(const float* a, long sa, const float* b, long sb, float* out, long n, int activation)
+{
+    long i = 0;
+
+    if(OP != ELT_OP_RSQRT)
+    {
+        vf4_t va = vf4_dup(a[0]);
+        vf4_t vb = vf4_dup(b[0]);
+
+        for(; i + 4 <= n; i += 4)
         {
-            input_tensor1 = node->GetInputTensor(1);
-            input1 = get_tensor_mem(input_tensor1);
-            input1_count4 = input_tensor1->GetTotalSize() / element_size;
+            if(sa)
+                va = vf4_load(a + i);
+            if(sb)
+                vb = vf4_load(b + i);
+
+            vf4_store(out + i, vf4_activation(vf4_elt_op<OP>(va, vb), activation));
         }
+    }
 
-        // this version only support for input_num=2
-        // int input_number=node->GetInputNum();
+    for(; i < n; i++)
+        out[i] = f_activation(elt_op<OP>(a[i * sa], b[i * sb]), activation);
+}
 
-        // output
-        Tensor* output_tensor = node->GetOutputTensor(0);
-        void* output = get_tensor_mem(output_tensor);
-        Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
-        EltwiseParam* param = eltwise_op->GetParam();
+template <int OP, typename T>
+static void elt_run(const elt_plan* plan, const T* in0, const T* in1, T* out, long unit_start, long unit_end,
+                    int activation)
+{
+    int last = plan->ndim - 1;
+    long row_size = plan->dims[last];
+
+    for(long u = unit_start; u < unit_end; u++)
+    {
+        long row = u / plan->chunk_num;
+        long start = (u % plan->chunk_num) * ELT_UNIT_SIZE;
+        long n = std::min(row_size - start, ( long )ELT_UNIT_SIZE);
+        long off0 = start * plan->stride0[last];
+        long off1 = start * plan->stride1[last];
+        long idx = row;
 
-        bool result = false;
+        for(int i = last - 1; i >= 0; i--)
+        {
+            long v = idx % plan->dims[i];
+
+            idx /= plan->dims[i];
+
+            off0 += v * plan->stride0[i];
+            off1 += v * plan->stride1[i];
+        }
+
+        elt_row<OP>(in0 + off0, plan->stride0[last], in1 + off1, plan->stride1[last], out + row * row_size + start,
+                    n, activation);
+    }
+}
+
+template <typename T>
+static void elt_run_op(int op, const elt_plan* plan, const void* in0, const void* in1, void* out, long unit_start,
+                       long unit_end, int activation)
+{
+    const T* a = ( const T* )in0;
+    const T* b = ( const T* )in1;
+    T* c = ( T* )out;
+
+    switch(op)
+    {
+        case ELT_OP_SUM:
+            elt_run<ELT_OP_SUM>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_PROD:
+            elt_run<ELT_OP_PROD>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_SUB:
+            elt_run<ELT_OP_SUB>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_DIV:
+            elt_run<ELT_OP_DIV>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_MAX:
+            elt_run<ELT_OP_MAX>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_MIN:
+            elt_run<ELT_OP_MIN>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+        case ELT_OP_RSQRT:
+            elt_run<ELT_OP_RSQRT>(plan, a, b, c, unit_start, unit_end, activation);
+            break;
+    }
+}
+
+static int GetEltOp(int type)
+{
+    switch(type)
+    {
+        case ELT_SUM:
+        case ELT_SUM_SCALAR:
+            return ELT_OP_SUM;
+        case ELT_PROD:
+        case ELT_PROD_SCALAR:
+            return ELT_OP_PROD;
+        case ELT_SUB:
+        case ELT_SUB_SCALAR:
+            return ELT_OP_SUB;
+        case ELT_DIV:
+            return ELT_OP_DIV;
+        case ELT_MAX:
+            return ELT_OP_MAX;
+        case ELT_MIN_SCALAR:
+            return ELT_OP_MIN;
+        case ELT_RSQRT:
+            return ELT_OP_RSQRT;
+        default:
+            return -1;
+    }
+}
+
+struct elt_task_param
+{
+    const void* input0;
+    const void* input1;
+    void* output;
+    long unit_start;
+    long unit_end;
+};
+
+struct EltwiseOps : public MTNodeOps
+{
+    /* same layout when both inputs share it, or the second one is a scalar */
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        if(node->GetInputNum() < 2)
+            return BLOCKED_LAYOUT_SAME;
+
+        const TShape& shape0 = node->GetInputTensor(0)->GetShape();
+        const TShape& shape1 = node->GetInputTensor(1)->GetShape();
+
+        if(shape1.GetSize() == 1)
+            return BLOCKED_LAYOUT_SAME;
+
+        if(shape1.GetDim().size() == 4 && shape1.GetDim() == shape0.GetDim())
+            return BLOCKED_LAYOUT_SAME;
+
+        return BLOCKED_LAYOUT_NONE;
+    }
+
+    void RunUnits(const void* input0, const void* input1, void* output, long unit_start, long unit_end)
+    {
         switch(element_size)
         {
             case 4:
-                result = kernel_run<float>(output, input0, input1, param->type, ishape, input1_count4);
+                elt_run_op<float>(op, &plan, input0, input1, output, unit_start, unit_end, activation);
                 break;
 #ifdef CONFIG_FLOAT16
             case 2:
-                result = kernel_run<__fp16>(output, input0, input1, param->type, ishape, input1_count4);
+                elt_run_op<__fp16>(op, &plan, input0, input1, output, unit_start, unit_end, activation);
                 break;
 #endif
             case 1:
-                result = kernel_run<char>(output, input0, input1, param->type, ishape, input1_count4);
+                elt_run_op<char>(op, &plan, input0, input1, output, unit_start, unit_end, activation);
                 break;
         }
+    }
+
+    bool Aider(int cpu, int seq, void* data)
+    {
+        elt_task_param* param = ( elt_task_param* )data;
+
+        RunUnits(param->input0, param->input1, param->output, param->unit_start, param->unit_end);
 
-        return result;
+        return true;
+    }
+
+    bool Run(Node* node) override
+    {
+        Tensor* input_tensor0 = node->GetInputTensor(0);
+        Eltwise* eltwise_op = dynamic_cast<Eltwise*>(node->GetOp());
+        EltwiseParam* param = eltwise_op->GetParam();
+
+        element_size = DataType::GetTypeSize(input_tensor0->GetDataType());
+        op = GetEltOp(param->type);
+        activation = param->activation;
+
+        if(op < 0 || (element_size != 4 && element_size != 2 && element_size != 1))
+            return false;
+
+        const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+        const void* input0 = get_tensor_mem(input_tensor0);
+        const void* input1 = input0;
+        const std::vector<int>& dims0 = input_tensor0->GetShape().GetDim();
+        bool ok;
+
+        // this version only support for input_num=2
+        if(node->GetInputNum() > 1)
+        {
+            Tensor* input_tensor1 = node->GetInputTensor(1);
+
+            input1 = get_tensor_mem(input_tensor1);
+            ok = elt_make_plan(&plan, dims0, input_tensor1->GetShape().GetDim(), exec_attr->layout);
+        }
+        else
+        {
+            if(op != ELT_OP_RSQRT)
+                return false;
+
+            ok = elt_make_plan(&plan, dims0, dims0, exec_attr->layout);
+        }
+
+        if(!ok)
+        {
+            LOG_ERROR() << "Eltwise: input shapes cannot be broadcast on node " << node->GetName() << "\n";
+            return false;
+        }
+
+        void* output = get_tensor_mem(node->GetOutputTensor(0));
+        int cpu_number = cpu_info->GetCPUNumber();
+        long total = plan.unit_num / plan.chunk_num * plan.dims[plan.ndim - 1];
+
+        if(cpu_number == 1 || total < ELT_MT_MIN_SIZE || plan.unit_num < cpu_number)
+        {
+            RunUnits(input0, input1, output, 0, plan.unit_num);
+            return true;
+        }
+
+        auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+        task_list.resize(cpu_number);
+        param_list.resize(cpu_number);
+
+        long step = plan.unit_num / cpu_number;
+
+        for(int i = 0; i < cpu_number; i++)
+        {
+            elt_task_param* p = &param_list[i];
+            sub_op_task* task = &task_list[i];
+
+            task->exec_func = f;
+            task->seq = i;
+            task->data = p;
+
+            p->input0 = input0;
+            p->input1 = input1;
+            p->output = output;
+            p->unit_start = i * step;
+            p->unit_end = p->unit_start + step;
+        }
+
+        param_list[cpu_number - 1].unit_end = plan.unit_num;
+
+        task_dispatch(task_list, -1);
+        wait_done();
+
+        return true;
     }    // Run
 
+    elt_plan plan;
+    int element_size;
+    int op;
+    int activation;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<elt_task_param> param_list;
+
 };    // struct EltwiseOps
 
 }    // namespace EltwiseImpl
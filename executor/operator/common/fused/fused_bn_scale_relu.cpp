@@ -134,11 +134,7 @@ struct FusedOps : public MTNodeOps
             }
             else
             {
-                std::vector<sub_op_task> task_list;
-                std::vector<BNParam> param_list;
-
-                auto f = std::bind(&FusedOps::Aider, this, std::placeholders::_1, std::placeholders::_2,
-                                   std::placeholders::_3);
+                auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
 
                 int step = (channel_num + (cpu_number - 1)) / cpu_number;
 
@@ -185,6 +181,10 @@ struct FusedOps : public MTNodeOps
 
         return true;
     }
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<BNParam> param_list;
 };
 
 }    // namespace FusedBNScaleReluImpl
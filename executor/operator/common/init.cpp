@@ -48,8 +48,16 @@ extern void RegisterReLu6NodeExec(void);
 extern void RegisterReLuNodeExec(void);
 extern void RegisterResizeNodeExec(void);
 extern void RegisterLogisticNodeExec(void);
+extern void RegisterSigmoid_NodeExec(void);
+extern void RegisterTanH_NodeExec(void);
 extern void RegisterDetectionPostProcessNodeExec(void);
 extern void RegisterConv2dRef(void);
+extern void RegisterConv2dDepthGeneric(void);
+extern void RegisterConv2dNHWC(void);
+extern void RegisterConv2dNCHWc(void);
+extern void RegisterConv2d1x1(void);
+extern void RegisterDeconv2dNative(void);
+extern void RegisterLSTMNative(void);
 
 #ifdef CONFIG_ARCH_BLAS
 extern void RegisterConvBlasNodeExec(void);
@@ -91,8 +99,16 @@ void RegisterCommonOps(void)
     RegisterReLuNodeExec();
     RegisterResizeNodeExec();
     RegisterLogisticNodeExec();
+    RegisterSigmoid_NodeExec();
+    RegisterTanH_NodeExec();
     RegisterDetectionPostProcessNodeExec();
     RegisterConv2dRef();
+    RegisterConv2dDepthGeneric();
+    RegisterConv2dNHWC();
+    RegisterConv2dNCHWc();
+    RegisterConv2d1x1();
+    RegisterDeconv2dNative();
+    RegisterLSTMNative();
 
 #ifdef CONFIG_ARCH_BLAS
     RegisterConvBlasNodeExec();
@@ -33,6 +33,7 @@
 #include "graph.hpp"
 #include "operator/logistic.hpp"
 #include "data_type.hpp"
+#include "simd_vec.h"
 
 namespace TEngine {
 
@@ -63,8 +64,7 @@ struct LogisticOps : public NodeOps
             float* input_ptr = ( float* )get_tensor_mem(input);
             float* output_ptr = ( float* )get_tensor_mem(output);
 
-            for(int i = 0; i < elements; i++)
-                output_ptr[i] = 1.f / (1.f + std::exp(-input_ptr[i]));
+            vec_sigmoid(input_ptr, output_ptr, elements);
         }
         else if(element_size == 1)
         {
@@ -78,12 +78,21 @@ struct LogisticOps : public NodeOps
             float o_scale = (*o_quantized)[0].scale;
             float o_zero = (*o_quantized)[0].zero_point;
 
+            /* only 256 distinct inputs: build the lookup table once per run */
+            float real_input[256];
+            float real_output[256];
+            uint8_t table[256];
+
+            for(int i = 0; i < 256; i++)
+                real_input[i] = (i - i_zero) * i_scale;
+
+            vec_sigmoid(real_input, real_output, 256);
+
+            for(int i = 0; i < 256; i++)
+                table[i] = std::round(real_output[i] / o_scale) + o_zero;
+
             for(int i = 0; i < elements; i++)
-            {
-                float real_input = (input_ptr[i] - i_zero) * i_scale;
-                float real_output = 1.f / (1.f + std::exp(-real_input));
-                output_ptr[i] = std::round(real_output / o_scale) + o_zero;
-            }
+                output_ptr[i] = table[input_ptr[i]];
         }
 
         return true;
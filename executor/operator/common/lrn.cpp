@@ -39,6 +39,20 @@ namespace LRNImpl {
 
 struct LRNOps : public NodeOps
 {
+    bool Prerun(Node* node)
+    {
+        const TShape& shape = node->GetInputTensor(0)->GetShape();
+        const std::vector<int>& dims = shape.GetDim();
+
+        int channel_size = dims[2] * dims[3];
+
+        /* square and accum_square */
+        ScratchReserve(dims[1] * channel_size * sizeof(float));
+        ScratchReserve(channel_size * sizeof(float));
+
+        return true;
+    }
+
     bool Run(Node* node)
     {
         Tensor* input_tensor = node->GetInputTensor(0);
@@ -50,8 +64,6 @@ struct LRNOps : public NodeOps
         float* input = ( float* )get_tensor_mem(input_tensor);
         float* output = ( float* )get_tensor_mem(output_tensor);
 
-        float* square = ( float* )(std::malloc(input_tensor->GetTotalSize()));
-
         const TShape& shape = input_tensor->GetShape();
         const std::vector<int>& dims = shape.GetDim();
 
@@ -67,7 +79,11 @@ struct LRNOps : public NodeOps
         float bias = param->k;
         int local_size = param->local_size;
 
-        float* accum_square = ( float* )(std::malloc(channel_size * sizeof(float)));
+        float* square = ( float* )ScratchAlloc(img_size * sizeof(float));
+        float* accum_square = ( float* )ScratchAlloc(channel_size * sizeof(float));
+
+        if(square == nullptr || accum_square == nullptr)
+            return false;
 
         for(int i = 0; i < n; i++)
         {
@@ -115,9 +131,6 @@ struct LRNOps : public NodeOps
             }
         }
 
-        std::free(square);
-        std::free(accum_square);
-
         return true;
     }
 };
@@ -178,6 +178,17 @@ struct LRNOps : public NodeOps
     {
         return vexpq_f32(vmulq_f32(n, vlogq_f32(val)));
     }
+
+    bool Prerun(Node* node)
+    {
+        const TShape& shape = node->GetInputTensor(0)->GetShape();
+        const std::vector<int>& dims = shape.GetDim();
+
+        ScratchReserve(dims[1] * dims[2] * dims[3] * sizeof(float));
+
+        return true;
+    }
+
     bool Run(Node* node)
     {
         Tensor* input_tensor = node->GetInputTensor(0);
@@ -189,8 +200,6 @@ struct LRNOps : public NodeOps
         float* input = ( float* )get_tensor_mem(input_tensor);
         float* output = ( float* )get_tensor_mem(output_tensor);
 
-        float* square = ( float* )(std::malloc(input_tensor->GetTotalSize()));
-
         const TShape& shape = input_tensor->GetShape();
         const std::vector<int>& dims = shape.GetDim();
 
@@ -209,6 +218,11 @@ struct LRNOps : public NodeOps
         const float32x4_t beta_vec = vdupq_n_f32(beta);
         const float32x4_t bias_vec = vdupq_n_f32(bias);
 
+        float* square = ( float* )ScratchAlloc(img_size * sizeof(float));
+
+        if(square == nullptr)
+            return false;
+
         for(int i = 0; i < n; i++)
         {
             /* get square value */
@@ -263,8 +277,6 @@ struct LRNOps : public NodeOps
             }
         }
 
-        std::free(square);
-
         return true;
     }
 };
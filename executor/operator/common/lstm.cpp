@@ -0,0 +1,484 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <iostream>
+#include <functional>
+#include <cstring>
+#include <vector>
+#include <math.h>
+
+#include "logger.hpp"
+#include "node_ops.hpp"
+#include "tensor_mem.hpp"
+#include "graph.hpp"
+#include "operator/lstm.hpp"
+
+#include "sgemm_kernel.h"
+
+/*
+ * LSTM on packed weights.
+ *
+ * The kernel tensor [input_size + hidden_size, 4 * cell_size] is split into
+ * the input part and the recurrent part and both are packed once at prerun.
+ * The input projection of all timesteps is one GEMM; each step then only does
+ * the recurrent GEMM for all four gates at once, followed by a vectorized
+ * gate/cell update. The h/c state lives in the ops, so with keep_state set a
+ * run continues from where the previous run stopped.
+ */
+
+namespace TEngine {
+
+namespace lstm_native {
+
+const char* lstm_name = "LSTM_NATIVE";
+const int default_prio = 500;
+
+/* don't split GEMMs smaller than this (in MACs) over cpus */
+const int mt_gemm_threshold = 1 << 18;
+
+struct gemm_param
+{
+    int M;
+    int N;
+    int K;
+    const float* packed_a;
+    const float* packed_b;
+    float* C;
+    int ldc;
+};
+
+struct LSTMNative : public MTNodeOps
+{
+    LSTMNative()
+    {
+        init_c_tensor = nullptr;
+        init_h_tensor = nullptr;
+        bias_tensor = nullptr;
+        w_f_tensor = nullptr;
+        w_i_tensor = nullptr;
+        w_o_tensor = nullptr;
+        proj_tensor = nullptr;
+
+        packed_wx = nullptr;
+        packed_wh = nullptr;
+        packed_proj = nullptr;
+
+        state_batch = 0;
+    }
+
+    bool Prerun(Node* node) override;
+    bool Run(Node* node) override;
+    bool Postrun(Node* node) override;
+
+    bool Aider(int cpu, int seq, void* data);
+
+    void ParallelGemm(int M, int N, int K, const float* packed_a, const float* packed_b, float* C, int ldc);
+    void InitState(int batch);
+    void GateStep(const float* gates, const float* xproj, const float* bias, const float* w_f, const float* w_i,
+                  const float* w_o, float forget_bias, float* c, float* out);
+
+    Tensor* init_c_tensor;
+    Tensor* init_h_tensor;
+    Tensor* bias_tensor;
+    Tensor* w_f_tensor;
+    Tensor* w_i_tensor;
+    Tensor* w_o_tensor;
+    Tensor* proj_tensor;
+
+    int input_size;
+    int hidden_size;
+    int cell_size;
+
+    float* packed_wx;
+    float* packed_wh;
+    float* packed_proj;
+
+    /* h/c state carried over runs */
+    std::vector<float> h_state;
+    std::vector<float> c_state;
+    int state_batch;
+
+    std::vector<float> x_packed;
+    std::vector<float> xproj;
+    std::vector<float> h_packed;
+    std::vector<float> gates;
+    std::vector<float> cell_out;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<gemm_param> param_list;
+};
+
+bool LSTMNative::Aider(int cpu, int seq, void* data)
+{
+    gemm_param* param = ( gemm_param* )data;
+
+    sgemm_packed(param->M, param->N, param->K, param->packed_a, param->packed_b, param->C, param->ldc);
+
+    return true;
+}
+
+void LSTMNative::ParallelGemm(int M, int N, int K, const float* packed_a, const float* packed_b, float* C, int ldc)
+{
+    int cpu_number = cpu_info->GetCPUNumber();
+    int panel_num = (N + SGEMM_NR - 1) / SGEMM_NR;
+
+    if(cpu_number == 1 || panel_num < cpu_number || ( long )M * N * K < mt_gemm_threshold)
+    {
+        sgemm_packed(M, N, K, packed_a, packed_b, C, ldc);
+        return;
+    }
+
+    auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+    task_list.resize(cpu_number);
+    param_list.resize(cpu_number);
+
+    int step = panel_num / cpu_number;
+
+    for(int i = 0; i < cpu_number; i++)
+    {
+        gemm_param* p = &param_list[i];
+        sub_op_task* task = &task_list[i];
+
+        int n_start = i * step * SGEMM_NR;
+        int n_end = (i == cpu_number - 1) ? N : n_start + step * SGEMM_NR;
+
+        task->exec_func = f;
+        task->seq = i;
+        task->data = p;
+
+        p->M = M;
+        p->N = n_end - n_start;
+        p->K = K;
+        p->packed_a = packed_a;
+        p->packed_b = packed_b + n_start * K;
+        p->C = C + n_start;
+        p->ldc = ldc;
+    }
+
+    task_dispatch(task_list, -1);
+    wait_done();
+}
+
+bool LSTMNative::Prerun(Node* node)
+{
+    LSTM* lstm_op = dynamic_cast<LSTM*>(node->GetOp());
+    LSTMParam* param = lstm_op->GetParam();
+
+    int in_num = node->GetInputNum();
+
+    for(int count = 0; count < in_num; count++)
+    {
+        Tensor* temptensor = node->GetInputTensor(count);
+        const std::string& name = temptensor->GetName();
+
+        if(name.find(lstm_op->GetInitCellName()) != std::string::npos)
+            init_c_tensor = temptensor;
+        if(name.find(lstm_op->GetInitHiddenName()) != std::string::npos)
+            init_h_tensor = temptensor;
+        if(name.find(lstm_op->GetBiasName()) != std::string::npos)
+            bias_tensor = temptensor;
+        if(name.find(lstm_op->GetPeepholeForgetName()) != std::string::npos)
+            w_f_tensor = temptensor;
+        if(name.find(lstm_op->GetPeepholeOutputName()) != std::string::npos)
+            w_o_tensor = temptensor;
+        if(name.find(lstm_op->GetPeepholeInputName()) != std::string::npos)
+            w_i_tensor = temptensor;
+        if(name.find(lstm_op->GetProjectionName()) != std::string::npos)
+            proj_tensor = temptensor;
+    }
+
+    input_size = param->input_size;
+    hidden_size = param->hidden_size;
+    cell_size = param->cell_size;
+
+    if(param->has_projection && proj_tensor == nullptr)
+    {
+        LOG_ERROR() << "LSTM " << node->GetName() << ": projection tensor not found\n";
+        return false;
+    }
+
+    if(!param->has_projection && hidden_size != cell_size)
+    {
+        LOG_ERROR() << "LSTM " << node->GetName() << ": hidden_size != cell_size without projection\n";
+        return false;
+    }
+
+    int gate_size = 4 * cell_size;
+    const float* kernel = ( const float* )get_tensor_mem(node->GetInputTensor(1));
+
+    packed_wx = ( float* )mem_alloc(sizeof(float) * sgemm_pack_b_size(input_size, gate_size));
+    packed_wh = ( float* )mem_alloc(sizeof(float) * sgemm_pack_b_size(hidden_size, gate_size));
+
+    sgemm_pack_b(input_size, gate_size, kernel, gate_size, packed_wx);
+    sgemm_pack_b(hidden_size, gate_size, kernel + input_size * gate_size, gate_size, packed_wh);
+
+    if(param->has_projection)
+    {
+        const float* proj = ( const float* )get_tensor_mem(proj_tensor);
+
+        packed_proj = ( float* )mem_alloc(sizeof(float) * sgemm_pack_b_size(cell_size, hidden_size));
+        sgemm_pack_b(cell_size, hidden_size, proj, hidden_size, packed_proj);
+    }
+
+    state_batch = 0;
+
+    return true;
+}
+
+void LSTMNative::InitState(int batch)
+{
+    h_state.resize(batch * hidden_size);
+    c_state.resize(batch * cell_size);
+
+    const float* init_h = init_h_tensor ? ( const float* )get_tensor_mem(init_h_tensor) : nullptr;
+    const float* init_c = init_c_tensor ? ( const float* )get_tensor_mem(init_c_tensor) : nullptr;
+
+    for(int i = 0; i < batch; i++)
+    {
+        float* h = h_state.data() + i * hidden_size;
+        float* c = c_state.data() + i * cell_size;
+
+        if(init_h)
+            memcpy(h, init_h, hidden_size * sizeof(float));
+        else
+            memset(h, 0, hidden_size * sizeof(float));
+
+        if(init_c)
+            memcpy(c, init_c, cell_size * sizeof(float));
+        else
+            memset(c, 0, cell_size * sizeof(float));
+    }
+
+    state_batch = batch;
+}
+
+static inline float sigmoid(float x)
+{
+    return 1.f / (1.f + expf(-x));
+}
+
+/*
+ * gates and xproj hold one row of [i | c | f | o]; updates c in place
+ * and writes o * tanh(c) to out
+ */
+void LSTMNative::GateStep(const float* gates, const float* xproj, const float* bias, const float* w_f,
+                          const float* w_i, const float* w_o, float forget_bias, float* c, float* out)
+{
+    const float* g_i = gates;
+    const float* g_c = gates + cell_size;
+    const float* g_f = gates + 2 * cell_size;
+    const float* g_o = gates + 3 * cell_size;
+
+    const float* x_i = xproj;
+    const float* x_c = xproj + cell_size;
+    const float* x_f = xproj + 2 * cell_size;
+    const float* x_o = xproj + 3 * cell_size;
+
+    vf4_t v_forget_bias = vf4_dup(forget_bias);
+
+    int j = 0;
+
+    for(; j + 4 <= cell_size; j += 4)
+    {
+        vf4_t ig = vf4_add(vf4_load(g_i + j), vf4_load(x_i + j));
+        vf4_t cg = vf4_add(vf4_load(g_c + j), vf4_load(x_c + j));
+        vf4_t fg = vf4_add(vf4_add(vf4_load(g_f + j), vf4_load(x_f + j)), v_forget_bias);
+        vf4_t og = vf4_add(vf4_load(g_o + j), vf4_load(x_o + j));
+        vf4_t cell = vf4_load(c + j);
+
+        if(bias)
+        {
+            ig = vf4_add(ig, vf4_load(bias + j));
+            cg = vf4_add(cg, vf4_load(bias + cell_size + j));
+            fg = vf4_add(fg, vf4_load(bias + 2 * cell_size + j));
+            og = vf4_add(og, vf4_load(bias + 3 * cell_size + j));
+        }
+
+        if(w_f)
+        {
+            fg = vf4_mla(fg, cell, vf4_load(w_f + j));
+            ig = vf4_mla(ig, cell, vf4_load(w_i + j));
+        }
+
+        cell = vf4_add(vf4_mul(cell, vf4_sigmoid(fg)), vf4_mul(vf4_tanh(cg), vf4_sigmoid(ig)));
+
+        if(w_o)
+            og = vf4_mla(og, cell, vf4_load(w_o + j));
+
+        vf4_store(c + j, cell);
+        vf4_store(out + j, vf4_mul(vf4_sigmoid(og), vf4_tanh(cell)));
+    }
+
+    for(; j < cell_size; j++)
+    {
+        float ig = g_i[j] + x_i[j];
+        float cg = g_c[j] + x_c[j];
+        float fg = g_f[j] + x_f[j] + forget_bias;
+        float og = g_o[j] + x_o[j];
+        float cell = c[j];
+
+        if(bias)
+        {
+            ig += bias[j];
+            cg += bias[cell_size + j];
+            fg += bias[2 * cell_size + j];
+            og += bias[3 * cell_size + j];
+        }
+
+        if(w_f)
+        {
+            fg += cell * w_f[j];
+            ig += cell * w_i[j];
+        }
+
+        cell = cell * sigmoid(fg) + tanhf(cg) * sigmoid(ig);
+
+        if(w_o)
+            og += cell * w_o[j];
+
+        c[j] = cell;
+        out[j] = sigmoid(og) * tanhf(cell);
+    }
+}
+
+bool LSTMNative::Run(Node* node)
+{
+    LSTM* lstm_op = dynamic_cast<LSTM*>(node->GetOp());
+    LSTMParam* param = lstm_op->GetParam();
+
+    Tensor* input_tensor = node->GetInputTensor(0);
+    Tensor* output_tensor = node->GetOutputTensor(0);
+
+    const float* input = ( const float* )get_tensor_mem(input_tensor);
+    float* output = ( float* )get_tensor_mem(output_tensor);
+
+    const TShape& input_shape = input_tensor->GetShape();
+
+    int seq_lens = input_shape.Shape(0);
+    int batch_size = input_shape.Shape(1);
+    int output_len = param->output_len;
+    int gate_size = 4 * cell_size;
+
+    const float* bias = bias_tensor ? ( const float* )get_tensor_mem(bias_tensor) : nullptr;
+    const float* w_f = nullptr;
+    const float* w_i = nullptr;
+    const float* w_o = nullptr;
+
+    if(param->has_peephole)
+    {
+        w_f = ( const float* )get_tensor_mem(w_f_tensor);
+        w_i = ( const float* )get_tensor_mem(w_i_tensor);
+        w_o = ( const float* )get_tensor_mem(w_o_tensor);
+    }
+
+    if(!param->keep_state || state_batch != batch_size)
+        InitState(batch_size);
+
+    /* input projection of all timesteps at once */
+    int rows = seq_lens * batch_size;
+
+    x_packed.resize(sgemm_pack_a_size(rows, input_size));
+    xproj.resize(rows * gate_size);
+
+    sgemm_pack_a(rows, input_size, input, input_size, x_packed.data());
+    ParallelGemm(rows, gate_size, input_size, x_packed.data(), packed_wx, xproj.data(), gate_size);
+
+    h_packed.resize(sgemm_pack_a_size(batch_size, cell_size > hidden_size ? cell_size : hidden_size));
+    gates.resize(batch_size * gate_size);
+    cell_out.resize(batch_size * cell_size);
+
+    float* h = h_state.data();
+    float* c = c_state.data();
+
+    for(int t = 0; t < seq_lens; t++)
+    {
+        sgemm_pack_a(batch_size, hidden_size, h, hidden_size, h_packed.data());
+        ParallelGemm(batch_size, gate_size, hidden_size, h_packed.data(), packed_wh, gates.data(), gate_size);
+
+        float* step_out = packed_proj ? cell_out.data() : h;
+
+        for(int b = 0; b < batch_size; b++)
+        {
+            GateStep(gates.data() + b * gate_size, xproj.data() + (t * batch_size + b) * gate_size, bias, w_f, w_i,
+                     w_o, param->forget_bias, c + b * cell_size, step_out + b * cell_size);
+        }
+
+        if(packed_proj)
+        {
+            sgemm_pack_a(batch_size, cell_size, cell_out.data(), cell_size, h_packed.data());
+            ParallelGemm(batch_size, hidden_size, cell_size, h_packed.data(), packed_proj, h, hidden_size);
+        }
+
+        if(t + output_len >= seq_lens)
+        {
+            memcpy(output, h, batch_size * hidden_size * sizeof(float));
+            output += batch_size * hidden_size;
+        }
+    }
+
+    return true;
+}
+
+bool LSTMNative::Postrun(Node* node)
+{
+    mem_free(packed_wx);
+    mem_free(packed_wh);
+
+    if(packed_proj)
+        mem_free(packed_proj);
+
+    packed_wx = nullptr;
+    packed_wh = nullptr;
+    packed_proj = nullptr;
+
+    state_batch = 0;
+
+    return true;
+}
+
+NodeOps* SelectFunc(const CPUInfo* cpu_info, Node* node)
+{
+    const ExecAttr* exec_attr = any_cast<const ExecAttr*>(node->GetAttr(ATTR_EXEC_ATTR));
+
+    if(exec_attr->kernel_mode != EXEC_KERNEL_FP32)
+        return nullptr;
+
+    if(node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+        return nullptr;
+
+    LSTMNative* ops = new LSTMNative();
+
+    ops->need_free = true;
+
+    return ops;
+}
+
+}    // namespace lstm_native
+
+void RegisterLSTMNative(void)
+{
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "LSTM", lstm_native::SelectFunc, lstm_native::default_prio);
+}
+
+}    // namespace TEngine
@@ -0,0 +1,205 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <algorithm>
+#include <limits>
+
+#include "nms.hpp"
+#include "simd_vec.h"
+
+namespace TEngine {
+
+void NmsBoxes::Clear(void)
+{
+    x0.clear();
+    y0.clear();
+    x1.clear();
+    y1.clear();
+    score.clear();
+    tag.clear();
+}
+
+void NmsBoxes::Reserve(int n)
+{
+    x0.reserve(n);
+    y0.reserve(n);
+    x1.reserve(n);
+    y1.reserve(n);
+    score.reserve(n);
+    tag.reserve(n);
+}
+
+void NmsBoxes::Push(float bx0, float by0, float bx1, float by1, float s, int t)
+{
+    x0.push_back(bx0);
+    y0.push_back(by0);
+    x1.push_back(bx1);
+    y1.push_back(by1);
+    score.push_back(s);
+    tag.push_back(t);
+}
+
+void NmsScratch::Resize(int n)
+{
+    if(( int )area.size() >= n)
+        return;
+
+    x0.resize(n);
+    y0.resize(n);
+    x1.resize(n);
+    y1.resize(n);
+    area.resize(n);
+}
+
+void nms_topk(std::vector<int>& index, const float* score, int top_k)
+{
+    auto greater = [score](int a, int b) { return score[a] > score[b] || (score[a] == score[b] && a < b); };
+
+    int n = index.size();
+
+    if(top_k > 0 && top_k < n)
+    {
+        std::partial_sort(index.begin(), index.begin() + top_k, index.end(), greater);
+        index.resize(top_k);
+    }
+    else
+    {
+        std::sort(index.begin(), index.end(), greater);
+    }
+}
+
+void nms_sorted(const NmsBoxes& boxes, const std::vector<int>& order, const NmsParam& param, NmsScratch& scratch,
+                std::vector<int>& picked)
+{
+    int n = order.size();
+    float offset = param.offset;
+    float threshold = param.iou_threshold;
+
+    picked.clear();
+
+    scratch.Resize(n);
+
+    float* kx0 = scratch.x0.data();
+    float* ky0 = scratch.y0.data();
+    float* kx1 = scratch.x1.data();
+    float* ky1 = scratch.y1.data();
+    float* karea = scratch.area.data();
+
+    int kept = 0;
+
+    vf4_t v_offset = vf4_dup(offset);
+    vf4_t v_threshold = vf4_dup(threshold);
+    vf4_t v_never = vf4_dup(std::numeric_limits<float>::infinity());
+
+    for(int i = 0; i < n; i++)
+    {
+        int idx = order[i];
+
+        float x0 = boxes.x0[idx];
+        float y0 = boxes.y0[idx];
+        float x1 = boxes.x1[idx];
+        float y1 = boxes.y1[idx];
+        float area = (x1 - x0 + offset) * (y1 - y0 + offset);
+
+        vf4_t v_x0 = vf4_dup(x0);
+        vf4_t v_y0 = vf4_dup(y0);
+        vf4_t v_x1 = vf4_dup(x1);
+        vf4_t v_y1 = vf4_dup(y1);
+        vf4_t v_area = vf4_dup(area);
+
+        bool keep = true;
+        int j = 0;
+
+        /*
+           IoU > t  <=>  inter > t * union, when union is positive. two boxes of
+           no area have no IoU, and are never suppressed: their limit is +inf
+         */
+        for(; j + 4 <= kept; j += 4)
+        {
+            vf4_t w = vf4_sub(vf4_min(v_x1, vf4_load(&kx1[j])), vf4_max(v_x0, vf4_load(&kx0[j])));
+            vf4_t h = vf4_sub(vf4_min(v_y1, vf4_load(&ky1[j])), vf4_max(v_y0, vf4_load(&ky0[j])));
+
+            w = vf4_max(vf4_add(w, v_offset), vf4_zero());
+            h = vf4_max(vf4_add(h, v_offset), vf4_zero());
+
+            vf4_t inter = vf4_mul(w, h);
+            vf4_t v_union = vf4_sub(vf4_add(v_area, vf4_load(&karea[j])), inter);
+            vf4_t limit = vf4_select_lt(vf4_zero(), v_union, vf4_mul(v_threshold, v_union), v_never);
+
+            if(param.suppress_equal ? vf4_any_ge(inter, limit) : vf4_any_gt(inter, limit))
+            {
+                keep = false;
+                break;
+            }
+        }
+
+        for(; keep && j < kept; j++)
+        {
+            float w = std::min(x1, kx1[j]) - std::max(x0, kx0[j]) + offset;
+            float h = std::min(y1, ky1[j]) - std::max(y0, ky0[j]) + offset;
+
+            w = std::max(w, 0.f);
+            h = std::max(h, 0.f);
+
+            float inter = w * h;
+            float area_union = area + karea[j] - inter;
+
+            if(area_union <= 0.f)
+                continue;
+
+            float limit = threshold * area_union;
+
+            if(param.suppress_equal ? inter >= limit : inter > limit)
+                keep = false;
+        }
+
+        if(!keep)
+            continue;
+
+        kx0[kept] = x0;
+        ky0[kept] = y0;
+        kx1[kept] = x1;
+        ky1[kept] = y1;
+        karea[kept] = area;
+        kept++;
+
+        picked.push_back(idx);
+
+        if(param.max_keep > 0 && kept >= param.max_keep)
+            break;
+    }
+}
+
+void nms_boxes(const NmsBoxes& boxes, int candidate_k, const NmsParam& param, NmsScratch& scratch,
+               std::vector<int>& picked)
+{
+    std::vector<int> order(boxes.Size());
+
+    for(int i = 0; i < boxes.Size(); i++)
+        order[i] = i;
+
+    nms_topk(order, boxes.score.data(), candidate_k);
+    nms_sorted(boxes, order, param, scratch, picked);
+}
+
+}    // namespace TEngine
@@ -30,30 +30,64 @@
 #include "node_ops.hpp"
 #include "tensor_mem.hpp"
 #include "graph.hpp"
+#include "data_type.hpp"
 #include "operator/permute.hpp"
-#include <math.h>
+#include "transpose.hpp"
 
 namespace TEngine {
 
 namespace PermuteImpl {
 
-struct PermuteOps : public NodeOps
+/* below this many elements, one cpu is faster than dispatching */
+#define PERMUTE_MT_SIZE (1 << 15)
+
+struct permute_param
 {
-    void permute_hwc(float* input, float* output, int height, int width, int channel, int _wc, int _hw)
+    const void* input;
+    void* output;
+    long unit_start;
+    long unit_end;
+};
+
+struct PermuteOps : public MTNodeOps
+{
+    bool Prerun(Node* node)
+    {
+        return Reshape(node);
+    }
+
+    bool Reshape(Node* node)
     {
-        for(int h = 0; h < height; h++)
+        const Tensor* input_tensor = node->GetInputTensor(0);
+        const std::vector<int>& dims = input_tensor->GetShape().GetDim();
+
+        Permute* permute_op = dynamic_cast<Permute*>(node->GetOp());
+        PermuteParam* param = permute_op->GetParam();
+
+        int order[4] = {param->order0, param->order1, param->order2, param->order3};
+        int ndim = dims.size();
+
+        if(ndim > 4)
+            return false;
+
+        int elem_size = DataType::GetTypeSize(input_tensor->GetDataType());
+
+        if(!transpose_plan(&plan, dims.data(), order, ndim, elem_size))
         {
-            float* output_ptr = output + h * _wc;
-
-            for(int w = 0; w < width; w++)
-            {
-                for(int c = 0; c < channel; c++)
-                {
-                    const float* input_ptr = input + c * _hw + h * width;
-                    output_ptr[w * channel + c] = input_ptr[w];
-                }
-            }
+            LOG_ERROR() << "permute: bad order for node: " << node->GetName() << "\n";
+            return false;
         }
+
+        return true;
+    }
+
+    bool Aider(int cpu, int seq, void* data)
+    {
+        const permute_param* param = ( const permute_param* )data;
+
+        transpose_run(&plan, param->input, param->output, param->unit_start, param->unit_end);
+
+        return true;
     }
 
     bool Run(Node* node)
@@ -61,35 +95,52 @@ struct PermuteOps : public NodeOps
         const Tensor* input_tensor = node->GetInputTensor(0);
         Tensor* output_tensor = node->GetOutputTensor(0);
 
-        Permute* permute_op = dynamic_cast<Permute*>(node->GetOp());
-        PermuteParam* param = permute_op->GetParam();
+        const void* input = get_tensor_mem(input_tensor);
+        void* output = get_tensor_mem(output_tensor);
 
-        const TShape& shape = input_tensor->GetShape();
-        const std::vector<int> dims = shape.GetDim();
-
-        int batch_number = dims[0];
-        int channel = dims[1];
-        int width = dims[3];
-        int height = dims[2];
-        int _wc = width * channel;
-        int _hw = width * height;
-        int _chw = channel * _hw;
-
-        float* input = ( float* )get_tensor_mem(input_tensor);
-        float* output = ( float* )get_tensor_mem(output_tensor);
-        // 0231 [bhwc]
-        if((param->order0 == 0) && (param->order1 == 2) && (param->order2 == 3) && (param->order3 == 1))
+        int cpu_number = cpu_info->GetCPUNumber();
+        long unit_num = plan.unit_num;
+
+        if(cpu_number == 1 || unit_num < cpu_number || plan.total < PERMUTE_MT_SIZE)
         {
-            for(int b = 0; b < batch_number; b++)
-            {
-                permute_hwc(input, output, height, width, channel, _wc, _hw);
-                input += _chw;
-                output += _chw;
-            }
+            transpose_run(&plan, input, output, 0, unit_num);
+            return true;
         }
-        // other case to be support
+
+        task_list.resize(cpu_number);
+        param_list.resize(cpu_number);
+
+        auto f = [this](int cpu, int seq, void* data) { return Aider(cpu, seq, data); };
+
+        long step = unit_num / cpu_number;
+
+        for(int i = 0; i < cpu_number; i++)
+        {
+            sub_op_task* task = &task_list[i];
+            permute_param* p = &param_list[i];
+
+            task->exec_func = f;
+            task->seq = i;
+            task->data = p;
+
+            p->input = input;
+            p->output = output;
+            p->unit_start = i * step;
+            p->unit_end = p->unit_start + step;
+        }
+
+        param_list[cpu_number - 1].unit_end = unit_num;
+
+        task_dispatch(task_list, -1);
+        wait_done();
+
         return true;
     }
+
+    TransposePlan plan;
+
+    std::vector<sub_op_task> task_list;
+    std::vector<permute_param> param_list;
 };
 
 }    // namespace PermuteImpl
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <functional>
 #include <stdlib.h>
+#include <string.h>
 
 #include "logger.hpp"
 #include "node_ops.hpp"
@@ -32,6 +33,8 @@
 #include "operator/pooling.hpp"
 #include "data_type.hpp"
 
+#include "simd_vec.h"
+
 namespace TEngine {
 
 namespace PoolingRef {
@@ -215,8 +218,196 @@ struct PoolOps : public NodeOps
         }
     }
 
+    /*
+       float NHWC pooling works on four channels at a time, it also runs the blocks
+       of the channel blocked layout. avg excludes the padding, unless caffe_flavor
+     */
+    void Generic_Pool_nhwc(const float* input, float* output, int inc, int inh, int inw, int outh, int outw, int k_h,
+                           int k_w, int stride_h, int stride_w, int pad_h, int pad_w, bool is_max, bool caffe_flavor)
+    {
+        int c_end = inc & -4;
+
+        for(int ph = 0; ph < outh; ph++)
+        {
+            int h_start = ph * stride_h - pad_h;
+            int h_end = std::min(h_start + k_h, inh);
+            h_start = std::max(h_start, 0);
+
+            for(int pw = 0; pw < outw; pw++)
+            {
+                int w_start = pw * stride_w - pad_w;
+                int w_end = std::min(w_start + k_w, inw);
+                w_start = std::max(w_start, 0);
+
+                int pool_size = (h_end - h_start) * (w_end - w_start);
+
+                if(caffe_flavor)
+                {
+                    int h0 = ph * stride_h - pad_h;
+                    int w0 = pw * stride_w - pad_w;
+
+                    pool_size = (std::min(h0 + k_h, inh + pad_h) - h0) * (std::min(w0 + k_w, inw + pad_w) - w0);
+                }
+
+                float scale = 1.f / pool_size;
+                const float* first = input + (h_start * inw + w_start) * inc;
+                float* out = output + (ph * outw + pw) * inc;
+                int c = 0;
+
+                for(; c < c_end; c += 4)
+                {
+                    vf4_t v = is_max ? vf4_load(first + c) : vf4_zero();
+
+                    for(int h = h_start; h < h_end; h++)
+                    {
+                        const float* in = input + (h * inw + w_start) * inc + c;
+
+                        for(int w = w_start; w < w_end; w++)
+                        {
+                            v = is_max ? vf4_max(v, vf4_load(in)) : vf4_add(v, vf4_load(in));
+                            in += inc;
+                        }
+                    }
+
+                    vf4_store(out + c, is_max ? v : vf4_mul(v, vf4_dup(scale)));
+                }
+
+                for(; c < inc; c++)
+                {
+                    float v = is_max ? first[c] : 0.f;
+
+                    for(int h = h_start; h < h_end; h++)
+                        for(int w = w_start; w < w_end; w++)
+                        {
+                            float x = input[(h * inw + w) * inc + c];
+
+                            v = is_max ? std::max(v, x) : v + x;
+                        }
+
+                    out[c] = is_max ? v : v * scale;
+                }
+            }
+        }
+    }
+
+    void Global_Pool_nhwc(const float* input, float* output, int inc, int in_hw, bool is_max)
+    {
+        int c_end = inc & -4;
+
+        if(is_max)
+            memcpy(output, input, inc * sizeof(float));
+        else
+            memset(output, 0, inc * sizeof(float));
+
+        for(int j = is_max ? 1 : 0; j < in_hw; j++)
+        {
+            const float* in = input + j * inc;
+            int c = 0;
+
+            for(; c < c_end; c += 4)
+            {
+                vf4_t v = vf4_load(output + c);
+
+                v = is_max ? vf4_max(v, vf4_load(in + c)) : vf4_add(v, vf4_load(in + c));
+                vf4_store(output + c, v);
+            }
+
+            for(; c < inc; c++)
+                output[c] = is_max ? std::max(output[c], in[c]) : output[c] + in[c];
+        }
+
+        if(!is_max)
+        {
+            float scale = 1.f / in_hw;
+
+            for(int c = 0; c < inc; c++)
+                output[c] *= scale;
+        }
+    }
+
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        Pooling* pooling_op = dynamic_cast<Pooling*>(node->GetOp());
+        PoolParam* param_ = pooling_op->GetParam();
+
+        if(exec_attr->layout != TENGINE_LAYOUT_NCHW || node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+            return BLOCKED_LAYOUT_NONE;
+
+        if(param_->alg != kPoolMax && param_->alg != kPoolAvg)
+            return BLOCKED_LAYOUT_NONE;
+
+        /* [N][C][1][1] is the same in both layouts */
+        if(param_->global)
+            return BLOCKED_LAYOUT_ANY;
+
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        Pooling* pooling_op = dynamic_cast<Pooling*>(node->GetOp());
+        PoolParam* param_ = pooling_op->GetParam();
+
+        if(exec_attr->layout != TENGINE_LAYOUT_NCHW || node->GetInputTensor(0)->GetDataType() != TENGINE_DT_FP32)
+            return false;
+
+        if((param_->alg != kPoolMax && param_->alg != kPoolAvg) || param_->global)
+            return false;
+
+        /* caffe counts the bottom/right padding into the average, a tile cannot tell it */
+        if(param_->alg == kPoolAvg && param_->caffe_flavor &&
+           (param_->pads[0] || param_->pads[1] || param_->pads[2] || param_->pads[3]))
+            return false;
+
+        return true;
+    }
+
+    bool Prerun(Node* node) override
+    {
+        in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+
+        return true;
+    }
+
+    bool RunBlocked(Node* node)
+    {
+        Pooling* pooling_op = dynamic_cast<Pooling*>(node->GetOp());
+        PoolParam* param_ = pooling_op->GetParam();
+
+        const TShape& ishape = node->GetInputTensor(0)->GetShape();
+        const TShape& oshape = node->GetOutputTensor(0)->GetShape();
+
+        int block_num = ishape.GetN() * ishape.GetC() / 4;
+        int input_h = ishape.GetH();
+        int input_w = ishape.GetW();
+        int output_h = oshape.GetH();
+        int output_w = oshape.GetW();
+        bool is_max = (param_->alg == kPoolMax);
+
+        const float* input = ( const float* )get_tensor_mem(node->GetInputTensor(0));
+        float* output = ( float* )get_tensor_mem(node->GetOutputTensor(0));
+
+        for(int b = 0; b < block_num; b++)
+        {
+            const float* in = input + b * 4 * input_h * input_w;
+            float* out = output + b * 4 * output_h * output_w;
+
+            if(param_->global)
+                Global_Pool_nhwc(in, out, 4, input_h * input_w, is_max);
+            else
+                Generic_Pool_nhwc(in, out, 4, input_h, input_w, output_h, output_w, param_->kernel_shape[0],
+                                  param_->kernel_shape[1], param_->strides[0], param_->strides[1], param_->pads[0],
+                                  param_->pads[1], is_max, param_->caffe_flavor);
+        }
+
+        return true;
+    }
+
     bool Run(Node* node)
     {
+        if(in_blocked)
+            return RunBlocked(node);
+
         // operator, param
         Pooling* pooling_op = dynamic_cast<Pooling*>(node->GetOp());
         PoolParam* param_ = pooling_op->GetParam();
@@ -291,36 +482,41 @@ struct PoolOps : public NodeOps
                 return false;
             }
         }
+        else if(elem_size == 4 && (param_->alg == kPoolMax || param_->alg == kPoolAvg))
+        {
+            bool is_max = (param_->alg == kPoolMax);
+
+            for(int n = 0; n < input_n; n++)
+            {
+                const float* input = ( const float* )input_data + n * in_chw;
+                float* output = ( float* )output_data + n * out_chw;
+
+                if(param_->global)
+                    Global_Pool_nhwc(input, output, input_c, in_hw, is_max);
+                else
+                    Generic_Pool_nhwc(input, output, input_c, input_h, input_w, output_h, output_w,
+                                      param_->kernel_shape[0], param_->kernel_shape[1], param_->strides[0],
+                                      param_->strides[1], param_->pads[0], param_->pads[1], is_max, false);
+            }
+        }
         else
         {
-            if(param_->alg == kPoolAvg)
+            if(param_->alg == kPoolAvg && elem_size == 1)
             {
                 if(param_->global)
                 {
                     for(int n = 0; n < input_n; n++)
-                    {
-                        if(elem_size == 4)
-                            Global_AvgPool_nhwc<float>(input_data + n * in_chw * elem_size,
-                                                       output_data + n * out_chw * elem_size, input_c, in_hw);
-                        if(elem_size == 1)
-                            Global_AvgPool_nhwc<uint8_t>(input_data + n * in_chw * elem_size,
-                                                         output_data + n * out_chw * elem_size, input_c, in_hw);
-                    }
+                        Global_AvgPool_nhwc<uint8_t>(input_data + n * in_chw, output_data + n * out_chw, input_c,
+                                                     in_hw);
                 }
                 else
                 {
                     for(int n = 0; n < input_n; n++)
                     {
-                        if(elem_size == 4)
-                            Generic_AvgPool_nhwc<float>(
-                                input_data + n * in_chw * 4, output_data + n * out_chw * 4, input_c, input_h, input_w,
-                                output_h, output_w, param_->kernel_shape[0], param_->kernel_shape[1],
-                                param_->strides[0], param_->strides[1], param_->pads[0], param_->pads[1]);
-                        if(elem_size == 1)
-                            Generic_AvgPool_nhwc<uint8_t>(
-                                input_data + n * in_chw, output_data + n * out_chw * 1, input_c, input_h, input_w,
-                                output_h, output_w, param_->kernel_shape[0], param_->kernel_shape[1],
-                                param_->strides[0], param_->strides[1], param_->pads[0], param_->pads[1]);
+                        Generic_AvgPool_nhwc<uint8_t>(input_data + n * in_chw, output_data + n * out_chw, input_c,
+                                                      input_h, input_w, output_h, output_w, param_->kernel_shape[0],
+                                                      param_->kernel_shape[1], param_->strides[0], param_->strides[1],
+                                                      param_->pads[0], param_->pads[1]);
                     }
                 }
             }
@@ -333,6 +529,8 @@ struct PoolOps : public NodeOps
 
         return true;
     }
+
+    bool in_blocked;
 };
 
 }    // namespace PoolingRef
@@ -29,16 +29,15 @@
 #include "node_ops.hpp"
 #include "tensor_mem.hpp"
 #include "graph.hpp"
+#include "channel_affine.hpp"
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
 namespace TEngine {
 
 namespace PreluImpl {
 
-struct PreluOps : public NodeOps
+struct PreluOps : public ChannelAffineOps
 {
-    bool OnBind(Node* node)
+    bool OnBind(Node* node) override
     {
         // set the inplace feature
         inplace_t io_map;
@@ -50,7 +49,24 @@ struct PreluOps : public NodeOps
         return true;
     }
 
-    bool Run(Node* node)
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    bool Prerun(Node* node) override
+    {
+        in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+
+        return true;
+    }
+
+    bool Run(Node* node) override
     {
         // inplace implement
         Tensor* input_tensor = node->GetInputTensor(0);
@@ -58,26 +74,26 @@ struct PreluOps : public NodeOps
         const TShape& shape = input_tensor->GetShape();
         const std::vector<int> dims = shape.GetDim();
 
-        int channel_size = dims[2] * dims[3];
-        // int img_size=channel_size*dims[1];
-        float* data = ( float* )get_tensor_mem(input_tensor);
+        const float* data = ( const float* )get_tensor_mem(input_tensor);
         float* out_data = ( float* )get_tensor_mem(output_tensor);
         const Tensor* slope_tensor = node->GetInputTensor(1);
-        float* slope = ( float* )get_tensor_mem(slope_tensor);
-        for(int i = 0; i < dims[0]; i++)
-        {
-            for(int c = 0; c < dims[1]; c++)
-            {
-                for(int l = 0; l < channel_size; l++)
-                {
-                    *out_data = MAX(*data, 0) + slope[c] * MIN(*data, 0.f);
-                    out_data++;
-                    data++;
-                }
-            }
-        }
+        const float* slope = ( const float* )get_tensor_mem(slope_tensor);
+
+        channel_affine_plan(&plan, dims[0], dims[1], ( long )dims[2] * dims[3], in_blocked);
+
+        /* a single slope shared by all channels */
+        if(slope_tensor->GetShape().GetSize() == 1)
+            plan.slope_value = slope[0];
+        else
+            plan.slope = slope;
+
+        RunAffine(&plan, data, out_data);
+
         return true;
     }
+
+    bool in_blocked;
+    ChannelAffine plan;
 };
 
 }    // namespace PreluImpl
@@ -31,12 +31,13 @@
 #include "graph.hpp"
 #include "operator/relu.hpp"
 #include "data_type.hpp"
+#include "channel_affine.hpp"
 
 namespace TEngine {
 
 namespace ReLuImpl {
 
-struct ReLuOps : public NodeOps
+struct ReLuOps : public ChannelAffineOps
 {
     bool OnBind(Node* node) override
     {
@@ -72,6 +73,17 @@ struct ReLuOps : public NodeOps
         }
     }
 
+    /* elementwise, any layout does */
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
     bool Run(Node* node) override
     {
         // input tensor and output tensor is the same
@@ -87,7 +99,14 @@ struct ReLuOps : public NodeOps
         switch(element_size)
         {
             case 4:
-                kernel_run<float>(data, elem_num, param->negative_slope);
+                channel_affine_plan(&plan, elem_num);
+
+                if(param->negative_slope == 0)
+                    plan.activation = 0;
+                else
+                    plan.slope_value = param->negative_slope;
+
+                RunAffine(&plan, ( const float* )data, ( float* )data);
                 break;
 #ifdef CONFIG_FLOAT16
             case 2:
@@ -101,6 +120,8 @@ struct ReLuOps : public NodeOps
 
         return true;
     }
+
+    ChannelAffine plan;
 };
 
 }    // namespace ReLuImpl
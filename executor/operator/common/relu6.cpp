@@ -30,12 +30,13 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "data_type.hpp"
+#include "channel_affine.hpp"
 
 namespace TEngine {
 
 namespace ReLu6Impl {
 
-struct ReLu6Ops : public NodeOps
+struct ReLu6Ops : public ChannelAffineOps
 {
     bool OnBind(Node* node) override
     {
@@ -61,6 +62,17 @@ struct ReLu6Ops : public NodeOps
         }
     }
 
+    /* elementwise, any layout does */
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
     bool Run(Node* node) override
     {
         // input tensor and output tensor is the same
@@ -73,7 +85,10 @@ struct ReLu6Ops : public NodeOps
         switch(element_size)
         {
             case 4:
-                kernel_run<float>(data, elem_num);
+                channel_affine_plan(&plan, elem_num);
+                plan.activation = 6;
+
+                RunAffine(&plan, ( const float* )data, ( float* )data);
                 break;
 #ifdef CONFIG_FLOAT16
             case 2:
@@ -87,6 +102,8 @@ struct ReLu6Ops : public NodeOps
 
         return true;
     }
+
+    ChannelAffine plan;
 };
 
 }    // namespace ReLu6Impl
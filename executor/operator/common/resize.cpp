@@ -262,13 +262,11 @@ struct ResizeOps : public MTNodeOps
                 }
                 else
                 {
-                    std::vector<sub_op_task> task_list;
-                    std::vector<resize_param> param_list;
                     int steps = dims[1] / cpu_number;
+                    task_list.clear();
                     param_list.resize(cpu_number);
 
-                    auto f = std::bind(&ResizeOps::resize_aider, this, std::placeholders::_1, std::placeholders::_2,
-                                       std::placeholders::_3);
+                    auto f = [this](int cpu, int seq, void* data) { return resize_aider(cpu, seq, data); };
                     for(int i = 0; i < cpu_number; i++)
                     {
                         sub_op_task tmp_task;
@@ -307,6 +305,10 @@ struct ResizeOps : public MTNodeOps
 
         return true;
     }
+
+    /* kept across runs, so that dispatching does not allocate */
+    std::vector<sub_op_task> task_list;
+    std::vector<resize_param> param_list;
 };
 
 }    // namespace ResizeImpl
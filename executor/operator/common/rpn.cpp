@@ -32,6 +32,7 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "operator/rpn.hpp"
+#include "nms.hpp"
 #include <math.h>
 
 #ifndef MAX
@@ -82,18 +83,6 @@ void _exp(const int N, const float* a, float* y)
         y[i] = exp(a[i]);
 }
 
-struct SBox
-{
-    float x0;
-    float y0;
-    float x1;
-    float y1;
-    float score;
-    bool operator<(const SBox& tmp) const
-    {
-        return score < tmp.score;
-    }
-};
 void proposal_local_anchor(int feat_height, int feat_width, int feat_stride, std::vector<Anchor>& anchors,
                            float* local_anchors)
 {
@@ -152,11 +141,11 @@ void bbox_tranform_inv(float* m_box, float* local_anchors, int height, int width
     }
 }
 
-void filter_boxs(std::vector<SBox>& boxes, float* box, float* score, int min_size, int src_scale, int src_w, int src_h,
+void filter_boxs(TEngine::NmsBoxes& boxes, float* box, float* score, int min_size, int src_scale, int src_w, int src_h,
                  int feat_w, int feat_h, int num_anchors, int feat_c)
 {
     float local_minsize = min_size * src_scale;
-    boxes.clear();
+    boxes.Clear();
 
     int feat_c_ = feat_c / 4;
     int one_step = feat_h * feat_w;
@@ -178,17 +167,15 @@ void filter_boxs(std::vector<SBox>& boxes, float* box, float* score, int min_siz
                 float height = box[offset_h];
                 if((width >= local_minsize) & (height >= local_minsize))
                 {
-                    SBox tmp;
-                    tmp.x0 = box[offset_x] - 0.5 * width;
-                    tmp.y0 = box[offset_y] - 0.5 * height;
-                    tmp.x1 = box[offset_x] + 0.5 * width;
-                    tmp.y1 = box[offset_y] + 0.5 * height;
-                    tmp.x0 = MIN(MAX(tmp.x0, 0), src_w);
-                    tmp.y0 = MIN(MAX(tmp.y0, 0), src_h);
-                    tmp.x1 = MIN(MAX(tmp.x1, 0), src_w);
-                    tmp.y1 = MIN(MAX(tmp.y1, 0), src_h);
-                    tmp.score = score[offset_s];
-                    boxes.push_back(tmp);
+                    float x0 = box[offset_x] - 0.5 * width;
+                    float y0 = box[offset_y] - 0.5 * height;
+                    float x1 = box[offset_x] + 0.5 * width;
+                    float y1 = box[offset_y] + 0.5 * height;
+                    x0 = MIN(MAX(x0, 0), src_w);
+                    y0 = MIN(MAX(y0, 0), src_h);
+                    x1 = MIN(MAX(x1, 0), src_w);
+                    y1 = MIN(MAX(y1, 0), src_h);
+                    boxes.Push(x0, y0, x1, y1, score[offset_s], boxes.Size());
                 }
                 offset_x += step;
                 offset_y += step;
@@ -200,38 +187,6 @@ void filter_boxs(std::vector<SBox>& boxes, float* box, float* score, int min_siz
     }
 }
 
-void nms_rpn(std::vector<SBox>& input_boxes, float nms_thresh)
-{
-    std::vector<float> vArea(input_boxes.size());
-    for(int i = 0; i < ( int )input_boxes.size(); ++i)
-    {
-        vArea[i] =
-            (input_boxes.at(i).x1 - input_boxes.at(i).x0 + 1) * (input_boxes.at(i).y1 - input_boxes.at(i).y0 + 1);
-    }
-    for(int i = 0; i < ( int )input_boxes.size(); ++i)
-    {
-        for(int j = i + 1; j < ( int )input_boxes.size();)
-        {
-            float xx1 = std::max(input_boxes[i].x0, input_boxes[j].x0);
-            float yy1 = std::max(input_boxes[i].y0, input_boxes[j].y0);
-            float xx2 = std::min(input_boxes[i].x1, input_boxes[j].x1);
-            float yy2 = std::min(input_boxes[i].y1, input_boxes[j].y1);
-            float w = std::max(float(0), xx2 - xx1 + 1);
-            float h = std::max(float(0), yy2 - yy1 + 1);
-            float inter = w * h;
-            float ovr = inter / (vArea[i] + vArea[j] - inter);
-            if(ovr >= nms_thresh)
-            {
-                input_boxes.erase(input_boxes.begin() + j);
-                vArea.erase(vArea.begin() + j);
-            }
-            else
-            {
-                j++;
-            }
-        }
-    }
-}
 namespace TEngine {
 
 namespace RPNImpl {
@@ -277,7 +232,7 @@ struct RPNOps : public NodeOps
         bbox_tranform_inv(m_box, local_anchors, feat_height, feat_width, feat_channel, num_anchors);
 
         delete[] local_anchors;
-        std::vector<SBox> boxes;
+        NmsBoxes boxes;
         float* m_score = new float[score_channel * feat_size];
         for(int i = 0; i < score_channel * feat_size; i++)
             m_score[i] = m_score_[i];
@@ -286,23 +241,18 @@ struct RPNOps : public NodeOps
         delete[] m_box;
         delete[] m_score;
 
-        std::sort(boxes.rbegin(), boxes.rend());
+        // pixel boxes, suppressed when IoU >= nms_thresh; the first post_nms_topn survivors are final
+        NmsParam nms_param(param_->nms_thresh);
 
-        if(param_->per_nms_topn > 0)
-        {
-            int tmp = MIN(param_->per_nms_topn, ( int )boxes.size());
-            boxes.erase(boxes.begin() + tmp, boxes.end());
-        }
-        nms_rpn(boxes, param_->nms_thresh);
+        nms_param.offset = 1.f;
+        nms_param.suppress_equal = true;
+        nms_param.max_keep = param_->post_nms_topn;
 
-        if(param_->post_nms_topn > 0)
-        {
-            int tmp = MIN(param_->post_nms_topn, ( int )boxes.size());
+        std::vector<int> picked;
+        nms_boxes(boxes, param_->per_nms_topn, nms_param, nms_scratch, picked);
 
-            boxes.erase(boxes.begin() + tmp, boxes.end());
-        }
         // inder shape [default batch=1]
-        int num_box = boxes.size();
+        int num_box = picked.size();
         std::vector<int> outdim = {1, num_box, 4, 1};
         out_shape.SetDim(outdim);
 
@@ -310,15 +260,18 @@ struct RPNOps : public NodeOps
         // std::cout<<"num_box "<<num_box<<"\n";
         for(int i = 0; i < num_box; i++)
         {
-            const SBox& r = boxes[i];
+            int k = picked[i];
             float* outptr = out_data + i * 4;
-            outptr[0] = r.x0;
-            outptr[1] = r.y0;
-            outptr[2] = r.x1;
-            outptr[3] = r.y1;
+            outptr[0] = boxes.x0[k];
+            outptr[1] = boxes.y0[k];
+            outptr[2] = boxes.x1[k];
+            outptr[3] = boxes.y1[k];
         }
         return true;
     }
+
+    /* kept across runs */
+    NmsScratch nms_scratch;
 };
 
 }    // namespace RPNImpl
@@ -32,6 +32,7 @@
 #include "graph.hpp"
 #include "operator/scale.hpp"
 #include "data_type.hpp"
+#include "channel_affine.hpp"
 
 namespace TEngine {
 
@@ -67,9 +68,26 @@ void kernel_run(void* in_data, void* out_data, void* gamma_data, void* beta_data
     }
 }
 
-struct ScaleOps : public NodeOps
+struct ScaleOps : public ChannelAffineOps
 {
-    bool Run(Node* node)
+    int GetBlockedLayoutSupport(Node* node) override
+    {
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool GetTiledRunSupport(Node* node) override
+    {
+        return true;
+    }
+
+    bool Prerun(Node* node) override
+    {
+        in_blocked = IsBlockedLayout(node->GetInputTensor(0));
+
+        return true;
+    }
+
+    bool Run(Node* node) override
     {
         const Tensor* input_tensor = node->GetInputTensor(0);
         const Tensor* gamma_tensor = node->GetInputTensor(1);
@@ -92,8 +110,17 @@ struct ScaleOps : public NodeOps
         switch(element_size)
         {
             case 4:
-                kernel_run<float>(input, output, gamma, beta, shape);
+            {
+                const std::vector<int>& dims = shape.GetDim();
+
+                channel_affine_plan(&plan, dims[0], dims[1], ( long )dims[2] * dims[3], in_blocked);
+
+                plan.mul = ( const float* )gamma;
+                plan.add = ( const float* )beta;
+
+                RunAffine(&plan, ( const float* )input, ( float* )output);
                 break;
+            }
 #ifdef CONFIG_FLOAT16
             case 2:
                 kernel_run<__fp16>(input, output, gamma, beta, shape);
@@ -106,6 +133,9 @@ struct ScaleOps : public NodeOps
 
         return true;
     }
+
+    bool in_blocked;
+    ChannelAffine plan;
 };
 
 }    // namespace ScaleImpl
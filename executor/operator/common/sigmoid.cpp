@@ -7,49 +7,45 @@
 #include "tensor_mem.hpp"
 #include "graph.hpp"
 #include "operator/sigmoid.hpp"
-#include <math.h>
+#include "simd_vec.h"
+
+namespace TEngine {
+
+namespace SigmoidImpl {
 
-namespace TEngine
-{
-namespace SigmoidImpl
-{
 struct SigmoidOps : public NodeOps
 {
-    bool Run(Node * node)
+    /* elementwise, any layout does */
+    int GetBlockedLayoutSupport(Node* node) override
     {
-        const Tensor * input_tensor=node->GetInputTensor(0);
-        Tensor * output_tensor=node->GetOutputTensor(0);
-        const TShape&  shape=input_tensor->GetShape();
-        const std::vector<int> dims=shape.GetDim();
-       int batch_number=dims[0];
-        int channel_num=dims[1];
-        int channel_size=dims[2]*dims[3];
-        int img_size=channel_num*channel_size;
-        
-        const float * input=(const float *)get_tensor_mem(input_tensor);
-        float * output=(float *)get_tensor_mem(output_tensor);
-
-        for(int i=0;i<batch_number;i++)
-        {
-            for(int c=0;c<channel_num;c++)
-            {
-                int offset=i*img_size+c*channel_size;
-                for(int l=0;l<channel_size;l++)
-                {
-                    output[offset+l]=1 / (1 + exp(-input[offset+l]));
-                }
-            }
-        }
+        return BLOCKED_LAYOUT_SAME;
+    }
+
+    bool Run(Node* node)
+    {
+        const Tensor* input_tensor = node->GetInputTensor(0);
+        Tensor* output_tensor = node->GetOutputTensor(0);
+
+        int elements = input_tensor->GetShape().GetSize();
+
+        const float* input = ( const float* )get_tensor_mem(input_tensor);
+        float* output = ( float* )get_tensor_mem(output_tensor);
+
+        vec_sigmoid(input, output, elements);
+
         return true;
     }
 };
-} //namespace SigmoidImpl
+
+}    // namespace SigmoidImpl
 
 using namespace SigmoidImpl;
+
 void RegisterSigmoid_NodeExec(void)
 {
-    SigmoidOps *ops = new SigmoidOps();
-    NodeOpsRegistryManager::RegisterOPImplementor("common",
-                                                  "Sigmoid", ops);
+    SigmoidOps* ops = new SigmoidOps();
+
+    NodeOpsRegistryManager::RegisterOPImplementor("common", "Sigmoid", ops);
 }
-} //namespace TEngine
+
+}    // namespace TEngine
@@ -34,20 +34,221 @@
 #include "graph.hpp"
 #include "operator/softmax.hpp"
 #include "data_type.hpp"
+#include "simd_vec.h"
 
 namespace TEngine {
 
 namespace SoftmaxImpl {
 
-struct SoftmaxOps : public NodeOps
+/* columns of the inner dimension handled together, and the work below which one cpu is used */
+#define SOFTMAX_BLOCK 64
+#define SOFTMAX_MT_SIZE (1 << 14)
+
+/* softmax over n contiguous elements */
+static void softmax_row(const float* input, float* output, int n)
+{
+    vf4_t v_max = vf4_dup(input[0]);
+    int i = 0;
+
+    for(; i + 4 <= n; i += 4)
+        v_max = vf4_max(v_max, vf4_load(input + i));
+
+    float max = vf4_reduce_max(v_max);
+
+    for(; i < n; i++)
+        max = std::max(max, input[i]);
+
+    for(i = 0; i < n; i++)
+        output[i] = input[i] - max;
+
+    vec_exp(output, output, n);
+
+    vf4_t v_sum = vf4_zero();
+
+    for(i = 0; i + 4 <= n; i += 4)
+        v_sum = vf4_add(v_sum, vf4_load(output + i));
+
+    float sum = vf4_reduce_add(v_sum);
+
+    for(; i < n; i++)
+        sum += output[i];
+
+    float scale = 1.f / sum;
+
+    for(i = 0; i + 4 <= n; i += 4)
+        vf4_store(output + i, vf4_mul(vf4_load(output + i), vf4_dup(scale)));
+
+    for(; i < n; i++)
+        output[i] *= scale;
+}
+
+/* softmax over on_size rows of stride in_size, for columns [l0, l1), l1 - l0 <= SOFTMAX_BLOCK */
+static void softmax_cols(const float* input, float* output, int on_size, int in_size, int l0, int l1)
+{
+    float max[SOFTMAX_BLOCK];
+    float sum[SOFTMAX_BLOCK];
+    int w = l1 - l0;
+    int w4 = w & ~3;
+
+    input += l0;
+    output += l0;
+
+    memcpy(max, input, w * sizeof(float));
+
+    for(int j = 1; j < on_size; j++)
+    {
+        const float* row = input + j * in_size;
+        int l = 0;
+
+        for(; l < w4; l += 4)
+            vf4_store(max + l, vf4_max(vf4_load(max + l), vf4_load(row + l)));
+        for(; l < w; l++)
+            max[l] = std::max(max[l], row[l]);
+    }
+
+    memset(sum, 0, w * sizeof(float));
+
+    for(int j = 0; j < on_size; j++)
+    {
+        const float* row = input + j * in_size;
+        float* out_row = output + j * in_size;
+        int l = 0;
+
+        for(; l < w4; l += 4)
+            vf4_store(out_row + l, vf4_sub(vf4_load(row + l), vf4_load(max + l)));
+        for(; l < w; l++)
+            out_row[l] = row[l] - max[l];
+
+        vec_exp(out_row, out_row, w);
+
+        for(l = 0; l < w4; l += 4)
+            vf4_store(sum + l, vf4_add(vf4_load(sum + l), vf4_load(out_row + l)));
+        for(; l < w; l++)
+            sum[l] += out_row[l];
+    }
+
+    for(int l = 0; l < w; l++)
+        sum[l] = 1.f / sum[l];
+
+    for(int j = 0; j < on_size; j++)
+    {
+        float* out_row = output + j * in_size;
+        int l = 0;
+
+        for(; l < w4; l += 4)
+            vf4_store(out_row + l, vf4_mul(vf4_load(out_row + l), vf4_load(sum + l)));
+        for(; l < w; l++)
+            out_row[l] *= sum[l];
+    }
+}
+
+/* units are (outer index, column block) pairs */
+struct softmax_param
+{
+    const float* input;
+    float* output;
+    int on_size;
+    int in_size;
+    int block_num;
+    int unit_start;
+    int unit_end;
+};
+
+static void softmax_units(const softmax_param* param)
 {
+    int on_in_size = param->on_size * param->in_size;
+
+    for(int u = param->unit_start; u < param->unit_end; u++)
+    {
+        int i = u / param->block_num;
+        int b = u % param->block_num;
+
+        const float* input = param->input + i * on_in_size;
+        float* output = param->output + i * on_in_size;
+
+        if(param->in_size == 1)
+        {
+            softmax_row(input, output, param->on_size);
+        }
+        else
+        {
+            int l0 = b * SOFTMAX_BLOCK;
+            int l1 = std::min(l0 + SOFTMAX_BLOCK, param->in_size);
+
+            softmax_cols(input, output, param->on_size, param->in_size, l0, l1);
+        }
+    }
+}
+
+struct SoftmaxOps : public MTNodeOps
+{
+    bool softmax_aider(int cpu, int seq, void* data)
+    {
+        softmax_units(( const softmax_param* )data);
+
+        return true;
+    }
+
+    void SoftmaxFloat(const float* input, float* output, int out_size, int on_size, int in_size)
+    {
+        int block_num = (in_size + SOFTMAX_BLOCK - 1) / SOFTMAX_BLOCK;
+        int unit_num = out_size * block_num;
+        int cpu_number = cpu_info->GetCPUNumber();
+
+        softmax_param param;
+
+        param.input = input;
+        param.output = output;
+        param.on_size = on_size;
+        param.in_size = in_size;
+        param.block_num = block_num;
+        param.unit_start = 0;
+        param.unit_end = unit_num;
+
+        if(cpu_number == 1 || unit_num < 2 || out_size * on_size * in_size < SOFTMAX_MT_SIZE)
+        {
+            softmax_units(&param);
+            return;
+        }
+
+        int task_num = std::min(cpu_number, unit_num);
+        int step = unit_num / task_num;
+
+        /* kept in the ops, so that only the first run allocates them */
+        task_list.resize(task_num);
+        param_list.resize(task_num);
+
+        /* capture this only, which fits in std::function without allocation */
+        auto f = [this](int cpu, int seq, void* data) { return softmax_aider(cpu, seq, data); };
+
+        for(int t = 0; t < task_num; t++)
+        {
+            sub_op_task* task = &task_list[t];
+
+            task->exec_func = f;
+            task->seq = t;
+            task->data = &param_list[t];
+
+            param_list[t] = param;
+            param_list[t].unit_start = t * step;
+            param_list[t].unit_end = t * step + step;
+        }
+
+        param_list[task_num - 1].unit_end = unit_num;
+
+        task_dispatch(task_list, -1);
+        wait_done();
+    }
+
     template <typename data_type> inline void GetMaxArray(void* input, void* array, int in_size, int on_size)
     {
         data_type* input_ptr = ( data_type* )input;
         data_type* array_ptr = ( data_type* )array;
-        std::memset(array, 0, in_size * sizeof(data_type));
 
-        for(int j = 0; j < on_size; j++)
+        /* from the first row, as the fp32 one: a row of negatives has a negative max */
+        std::memcpy(array, input, in_size * sizeof(data_type));
+
+        for(int j = 1; j < on_size; j++)
             for(int l = 0; l < in_size; l++)
             {
                 if(array_ptr[l] < input_ptr[j * in_size + l])
@@ -84,19 +285,14 @@ struct SoftmaxOps : public NodeOps
             }
     }
 
-    bool Run(Node* node)
+    void GetSoftmaxSize(Node* node, int& out_size, int& on_size, int& in_size)
     {
-        Tensor* input_tensor = node->GetInputTensor(0);
-        Tensor* output_tensor = node->GetOutputTensor(0);
-        int element_size = DataType::GetTypeSize(input_tensor->GetDataType());
+        const std::vector<int>& dims = node->GetInputTensor(0)->GetShape().GetDim();
 
-        const std::vector<int>& dims = input_tensor->GetShape().GetDim();
-
-        //
         Softmax* softmax_op = dynamic_cast<Softmax*>(node->GetOp());
         SoftmaxParam* param_ = softmax_op->GetParam();
         int axis = param_->axis;
-        int out_size, in_size, on_size;
+
         out_size = 1;
         for(int i = 0; i < axis; i++)
         {
@@ -108,69 +304,102 @@ struct SoftmaxOps : public NodeOps
             in_size *= dims[i];
         }
         on_size = dims[axis];
+    }
+
+    bool Prerun(Node* node)
+    {
+        return Reshape(node);
+    }
+
+    bool Reshape(Node* node)
+    {
+        Tensor* input_tensor = node->GetInputTensor(0);
+        int element_size = DataType::GetTypeSize(input_tensor->GetDataType());
+        int out_size, in_size, on_size;
+
+        GetSoftmaxSize(node, out_size, on_size, in_size);
+
+        /* max/sum arrays for fp16, float copies of input and output for uint8 */
+        if(element_size == 2)
+        {
+            ScratchReserve(in_size * sizeof(float));
+            ScratchReserve(in_size * sizeof(float));
+        }
+        else if(element_size == 1)
+        {
+            ScratchReserve(out_size * on_size * in_size * sizeof(float));
+            ScratchReserve(out_size * on_size * in_size * sizeof(float));
+        }
+
+        return true;
+    }
+
+    bool Run(Node* node)
+    {
+        Tensor* input_tensor = node->GetInputTensor(0);
+        Tensor* output_tensor = node->GetOutputTensor(0);
+        int element_size = DataType::GetTypeSize(input_tensor->GetDataType());
+        int out_size, in_size, on_size;
+
+        GetSoftmaxSize(node, out_size, on_size, in_size);
 
         uint8_t* input = ( uint8_t* )get_tensor_mem(input_tensor);
         uint8_t* output = ( uint8_t* )get_tensor_mem(output_tensor);
-        float* max_array = ( float* )std::malloc(in_size * sizeof(float));
-        float* sum_array = ( float* )std::malloc(in_size * sizeof(float));
 
         int on_in_size = on_size * in_size;
+        int total_size = out_size * on_in_size;
 
-        float* input_f = nullptr;
-        float* output_f = nullptr;
-        if(element_size == 1)
+        if(element_size == 4)
         {
-            input_f = ( float* )std::malloc(on_in_size * 4);
-            output_f = ( float* )std::malloc(on_in_size * 4);
+            SoftmaxFloat(( const float* )input, ( float* )output, out_size, on_size, in_size);
         }
-        for(int i = 0; i < out_size; i++)
+#ifdef CONFIG_FLOAT16
+        else if(element_size == 2)
         {
-            /* get max */
-            int img_base = i * on_in_size * element_size;
-            switch(element_size)
+            float* max_array = ( float* )ScratchAlloc(in_size * sizeof(float));
+            float* sum_array = ( float* )ScratchAlloc(in_size * sizeof(float));
+
+            if(max_array == nullptr || sum_array == nullptr)
+                return false;
+
+            for(int i = 0; i < out_size; i++)
             {
-                case 4:
-                    GetMaxArray<float>(input + img_base, max_array, in_size, on_size);
-                    GetOutResult<float>(input + img_base, output + img_base, max_array, sum_array, in_size, on_size);
-                    break;
-#ifdef CONFIG_FLOAT16
-                case 2:
-                    GetMaxArray<__fp16>(input + img_base, max_array, in_size, on_size);
-                    GetOutResult<__fp16>(input + img_base, output + img_base, max_array, sum_array, in_size, on_size);
-                    break;
-#endif
-                case 1:
-                    auto i_quant = input_tensor->GetQuantParam();
-                    int i_zero = (*i_quant)[0].zero_point;
-                    float i_scale = (*i_quant)[0].scale;
-                    auto o_quant = output_tensor->GetQuantParam();
-                    int o_zero = (*o_quant)[0].zero_point;
-                    float o_scale = (*o_quant)[0].scale;
-                    uint8_t* input_cur = input + img_base;
-                    uint8_t* output_cur = output + img_base;
-                    for(int i = 0; i < on_in_size; i++)
-                        input_f[i] = (input_cur[i] - i_zero) * i_scale;
-
-                    GetMaxArray<float>(input_f, max_array, in_size, on_size);
-                    GetOutResult<float>(input_f, output_f, max_array, sum_array, in_size, on_size);
-
-                    for(int i = 0; i < on_in_size; i++)
-                    {
-                        output_cur[i] = std::round(output_f[i] / o_scale) + o_zero;
-                    }
-                    break;
+                int img_base = i * on_in_size * element_size;
+
+                GetMaxArray<__fp16>(input + img_base, max_array, in_size, on_size);
+                GetOutResult<__fp16>(input + img_base, output + img_base, max_array, sum_array, in_size, on_size);
             }
         }
-        if(element_size == 1)
+#endif
+        else if(element_size == 1)
         {
-            std::free(input_f);
-            std::free(output_f);
+            auto i_quant = input_tensor->GetQuantParam();
+            int i_zero = (*i_quant)[0].zero_point;
+            float i_scale = (*i_quant)[0].scale;
+            auto o_quant = output_tensor->GetQuantParam();
+            int o_zero = (*o_quant)[0].zero_point;
+            float o_scale = (*o_quant)[0].scale;
+
+            float* input_f = ( float* )ScratchAlloc(total_size * sizeof(float));
+            float* output_f = ( float* )ScratchAlloc(total_size * sizeof(float));
+
+            if(input_f == nullptr || output_f == nullptr)
+                return false;
+
+            for(int i = 0; i < total_size; i++)
+                input_f[i] = (input[i] - i_zero) * i_scale;
+
+            SoftmaxFloat(input_f, output_f, out_size, on_size, in_size);
+
+            for(int i = 0; i < total_size; i++)
+                output[i] = std::round(output_f[i] / o_scale) + o_zero;
         }
 
-        std::free(max_array);
-        std::free(sum_array);
         return true;
     }
+
+    std::vector<sub_op_task> task_list;
+    std::vector<softmax_param> param_list;
 };
 
 }    // namespace SoftmaxImpl
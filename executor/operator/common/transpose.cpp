@@ -0,0 +1,346 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#include "transpose.hpp"
+#include "simd_vec.h"
+
+namespace TEngine {
+
+bool transpose_plan(TransposePlan* plan, const int* dims, const int* perm, int ndim, int elem_size)
+{
+    if(ndim < 1 || ndim > TRANSPOSE_MAX_DIM)
+        return false;
+
+    bool seen[TRANSPOSE_MAX_DIM] = {false};
+
+    for(int i = 0; i < ndim; i++)
+    {
+        if(perm[i] < 0 || perm[i] >= ndim || seen[perm[i]])
+            return false;
+
+        seen[perm[i]] = true;
+    }
+
+    /* drop the dims of size 1 */
+    int map[TRANSPOSE_MAX_DIM];
+    int in_dims[TRANSPOSE_MAX_DIM];
+    int m = 0;
+
+    for(int i = 0; i < ndim; i++)
+    {
+        if(dims[i] == 1)
+        {
+            map[i] = -1;
+        }
+        else
+        {
+            map[i] = m;
+            in_dims[m++] = dims[i];
+        }
+    }
+
+    int p[TRANSPOSE_MAX_DIM];
+    int k = 0;
+
+    for(int i = 0; i < ndim; i++)
+    {
+        if(map[perm[i]] >= 0)
+            p[k++] = map[perm[i]];
+    }
+
+    /* merge the output dims that are also adjacent in the input */
+    int first[TRANSPOSE_MAX_DIM];
+    int last[TRANSPOSE_MAX_DIM];
+    int group_num = 0;
+
+    for(int i = 0; i < k; i++)
+    {
+        if(group_num > 0 && p[i] == last[group_num - 1] + 1)
+        {
+            last[group_num - 1] = p[i];
+        }
+        else
+        {
+            first[group_num] = p[i];
+            last[group_num] = p[i];
+            group_num++;
+        }
+    }
+
+    plan->elem_size = elem_size;
+
+    if(group_num == 0)
+    {
+        plan->ndim = 1;
+        plan->dims[0] = 1;
+        plan->in_stride[0] = 1;
+    }
+    else
+    {
+        plan->ndim = group_num;
+
+        for(int g = 0; g < group_num; g++)
+        {
+            long size = 1;
+            long stride = 1;
+
+            for(int j = first[g]; j <= last[g]; j++)
+                size *= in_dims[j];
+
+            for(int j = last[g] + 1; j < m; j++)
+                stride *= in_dims[j];
+
+            plan->dims[g] = size;
+            plan->in_stride[g] = stride;
+        }
+    }
+
+    int n = plan->ndim;
+    long total = 1;
+
+    for(int i = n - 1; i >= 0; i--)
+    {
+        plan->out_stride[i] = total;
+        total *= plan->dims[i];
+    }
+
+    plan->total = total;
+    plan->copy_rows = (plan->in_stride[n - 1] == 1);
+    plan->col_dim = -1;
+    plan->outer_num = 0;
+
+    if(plan->copy_rows)
+    {
+        for(int i = 0; i < n - 1; i++)
+            plan->outer_dim[plan->outer_num++] = i;
+
+        plan->unit_num = total / plan->dims[n - 1];
+
+        return true;
+    }
+
+    for(int i = 0; i < n - 1; i++)
+    {
+        if(plan->in_stride[i] == 1)
+            plan->col_dim = i;
+    }
+
+    long outer_size = 1;
+
+    for(int i = 0; i < n - 1; i++)
+    {
+        if(i == plan->col_dim)
+            continue;
+
+        plan->outer_dim[plan->outer_num++] = i;
+        outer_size *= plan->dims[i];
+    }
+
+    int row_blocks = (plan->dims[plan->col_dim] + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+
+    plan->unit_num = outer_size * row_blocks;
+
+    return true;
+}
+
+static inline void outer_offset(const TransposePlan* plan, long idx, long& in_off, long& out_off)
+{
+    in_off = 0;
+    out_off = 0;
+
+    for(int i = plan->outer_num - 1; i >= 0; i--)
+    {
+        int d = plan->outer_dim[i];
+        long v = idx % plan->dims[d];
+
+        idx /= plan->dims[d];
+
+        in_off += v * plan->in_stride[d];
+        out_off += v * plan->out_stride[d];
+    }
+}
+
+/* out[a * ldo + b] = in[a + b * ldi], for rows [a0, a1) and all cols */
+template <typename T>
+static void transpose_rows(const T* in, T* out, int a0, int a1, int cols, long ldi, long ldo)
+{
+    for(int b = 0; b < cols; b++)
+    {
+        const T* src = in + b * ldi;
+
+        for(int a = a0; a < a1; a++)
+            out[a * ldo + b] = src[a];
+    }
+}
+
+static void transpose_rows_f32(const float* in, float* out, int a0, int a1, int cols, long ldi, long ldo)
+{
+    int a_end = a0 + (a1 - a0) / 4 * 4;
+    int b_end = cols / 4 * 4;
+
+    for(int b = 0; b < b_end; b += 4)
+    {
+        const float* src = in + b * ldi;
+
+        for(int a = a0; a < a_end; a += 4)
+        {
+            vf4_t r[4];
+
+            r[0] = vf4_load(src + a);
+            r[1] = vf4_load(src + ldi + a);
+            r[2] = vf4_load(src + 2 * ldi + a);
+            r[3] = vf4_load(src + 3 * ldi + a);
+
+            vf4_transpose4(r);
+
+            vf4_store(out + a * ldo + b, r[0]);
+            vf4_store(out + (a + 1) * ldo + b, r[1]);
+            vf4_store(out + (a + 2) * ldo + b, r[2]);
+            vf4_store(out + (a + 3) * ldo + b, r[3]);
+        }
+    }
+
+    if(a_end < a1)
+        transpose_rows(in, out, a_end, a1, b_end, ldi, ldo);
+
+    if(b_end < cols)
+        transpose_rows(in + b_end * ldi, out + b_end, a0, a1, cols - b_end, ldi, ldo);
+}
+
+static void transpose_rows_any(const char* in, char* out, int a0, int a1, int cols, long ldi, long ldo, int elem_size)
+{
+    for(int b = 0; b < cols; b++)
+        for(int a = a0; a < a1; a++)
+            memcpy(out + (a * ldo + b) * elem_size, in + (a + b * ldi) * elem_size, elem_size);
+}
+
+void transpose_run(const TransposePlan* plan, const void* input, void* output, long unit_start, long unit_end)
+{
+    const char* in = ( const char* )input;
+    char* out = ( char* )output;
+    int elem_size = plan->elem_size;
+    int n = plan->ndim;
+
+    if(plan->copy_rows)
+    {
+        int row_size = plan->dims[n - 1] * elem_size;
+
+        for(long u = unit_start; u < unit_end; u++)
+        {
+            long in_off;
+            long out_off;
+
+            outer_offset(plan, u, in_off, out_off);
+
+            memcpy(out + out_off * elem_size, in + in_off * elem_size, row_size);
+        }
+
+        return;
+    }
+
+    int rows = plan->dims[plan->col_dim];
+    int cols = plan->dims[n - 1];
+    int row_blocks = (rows + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    long ldi = plan->in_stride[n - 1];
+    long ldo = plan->out_stride[plan->col_dim];
+
+    for(long u = unit_start; u < unit_end; u++)
+    {
+        long in_off;
+        long out_off;
+
+        outer_offset(plan, u / row_blocks, in_off, out_off);
+
+        int a0 = (u % row_blocks) * TRANSPOSE_BLOCK;
+        int a1 = std::min(a0 + TRANSPOSE_BLOCK, rows);
+
+        const char* src = in + in_off * elem_size;
+        char* dst = out + out_off * elem_size;
+
+        switch(elem_size)
+        {
+            case 4:
+                transpose_rows_f32(( const float* )src, ( float* )dst, a0, a1, cols, ldi, ldo);
+                break;
+            case 2:
+                transpose_rows(( const uint16_t* )src, ( uint16_t* )dst, a0, a1, cols, ldi, ldo);
+                break;
+            case 1:
+                transpose_rows(( const uint8_t* )src, ( uint8_t* )dst, a0, a1, cols, ldi, ldo);
+                break;
+            default:
+                transpose_rows_any(src, dst, a0, a1, cols, ldi, ldo, elem_size);
+                break;
+        }
+    }
+}
+
+bool transpose(const void* input, void* output, const int* dims, const int* perm, int ndim, int elem_size)
+{
+    TransposePlan plan;
+
+    if(!transpose_plan(&plan, dims, perm, ndim, elem_size))
+        return false;
+
+    transpose_run(&plan, input, output, 0, plan.unit_num);
+
+    return true;
+}
+
+void layout_nchw_to_nhwc(const float* input, float* output, int n, int c, int h, int w)
+{
+    int dims[4] = {n, c, h, w};
+    int perm[4] = {0, 2, 3, 1};
+
+    transpose(input, output, dims, perm, 4, sizeof(float));
+}
+
+void layout_nhwc_to_nchw(const float* input, float* output, int n, int c, int h, int w)
+{
+    int dims[4] = {n, h, w, c};
+    int perm[4] = {0, 3, 1, 2};
+
+    transpose(input, output, dims, perm, 4, sizeof(float));
+}
+
+void layout_nchw_to_nchw4(const float* input, float* output, int n, int c, int h, int w)
+{
+    int dims[4] = {n, c / 4, 4, h * w};
+    int perm[4] = {0, 1, 3, 2};
+
+    transpose(input, output, dims, perm, 4, sizeof(float));
+}
+
+void layout_nchw4_to_nchw(const float* input, float* output, int n, int c, int h, int w)
+{
+    int dims[4] = {n, c / 4, h * w, 4};
+    int perm[4] = {0, 1, 3, 2};
+
+    transpose(input, output, dims, perm, 4, sizeof(float));
+}
+
+}    // namespace TEngine
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __CHANNEL_AFFINE_HPP__
+#define __CHANNEL_AFFINE_HPP__
+
+#include <vector>
+
+#include "node_ops.hpp"
+
+/*
+ * Per channel affine transform and activation of a fp32 tensor:
+ *
+ *   y = x * mul[c] + add[c]
+ *   y = max(y, 0) + slope[c] * min(y, 0)
+ *   y = activation(y)
+ *
+ * the kernel of BatchNorm, Scale, PReLU, ReLU and ReLU6. The tensor is
+ * NCHW, or channel blocked [N][C / 4][H][W][4]; the elementwise ops see it
+ * as a single channel.
+ *
+ * The work is split into units: one channel (one block of 4 channels) of
+ * one image, cut into pieces of at most CHANNEL_AFFINE_UNIT_SIZE elements.
+ * channel_affine_run() on disjoint unit ranges may run on different cpus.
+ */
+
+#define CHANNEL_AFFINE_UNIT_SIZE (16 * 1024)
+
+/* smaller tensors are not split over the cpus */
+#define CHANNEL_AFFINE_MT_MIN_SIZE (64 * 1024)
+
+namespace TEngine {
+
+struct ChannelAffine
+{
+    /* per channel, nullptr for mul 1 and add 0 */
+    const float* mul;
+    const float* add;
+
+    /* per channel negative slope, or slope_value for all channels */
+    const float* slope;
+    float slope_value;
+
+    /* as ConvParam: <0 none, 0 relu, >0 relu clipped at that value */
+    int activation;
+
+    int batch_number;
+    int channel_num;
+    long channel_size;
+    bool blocked;
+
+    long chunk_num;
+    long unit_num;
+};
+
+/*
+   reset the coefficients and lay out the units.
+   dims are NCHW, blocked needs a channel number multiple of 4
+ */
+void channel_affine_plan(ChannelAffine* plan, int batch_number, int channel_num, long channel_size, bool blocked);
+
+/* a single channel of elem_num elements */
+void channel_affine_plan(ChannelAffine* plan, long elem_num);
+
+void channel_affine_run(const ChannelAffine* plan, const float* input, float* output, long unit_start,
+                        long unit_end);
+
+struct channel_affine_task_param
+{
+    const ChannelAffine* plan;
+    const float* input;
+    float* output;
+    long unit_start;
+    long unit_end;
+};
+
+struct ChannelAffineOps : public MTNodeOps
+{
+    /* run the units of the plan, split over the cpus of the node */
+    void RunAffine(const ChannelAffine* plan, const float* input, float* output);
+
+    bool Aider(int cpu, int seq, void* data);
+
+    std::vector<sub_op_task> task_list;
+    std::vector<channel_affine_task_param> param_list;
+};
+
+}    // namespace TEngine
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __CONV_DW_KERNEL_H__
+#define __CONV_DW_KERNEL_H__
+
+#include "simd_vec.h"
+
+/*
+ * Generic depthwise convolution (channel multiplier 1, NCHW).
+ *
+ * Each output row is split into a left border, an interior and a right border.
+ * Interior points never touch padding, so they are computed 4 outputs at a time
+ * with all kernel taps accumulated in registers; border points use the checked
+ * scalar path. Kernel size and horizontal stride are template parameters
+ * (0 means "decided at runtime") so the common 3x3/5x5/7x7, stride 1/2 cases
+ * get fully unrolled inner loops.
+ */
+
+struct dw_conv_shape
+{
+    int in_h;
+    int in_w;
+    int out_h;
+    int out_w;
+    int kernel_h;
+    int kernel_w;
+    int stride_h;
+    int stride_w;
+    int dilation_h;
+    int dilation_w;
+    int pad_top;
+    int pad_left;
+    int activation;
+};
+
+template <int K, int S>
+static void dw_conv_plane(const float* input, float* output, const float* kernel, float bias, const dw_conv_shape* s)
+{
+    const int kh = K ? K : s->kernel_h;
+    const int kw = K ? K : s->kernel_w;
+    const int sw = S ? S : s->stride_w;
+    const int sh = s->stride_h;
+    const int dh = s->dilation_h;
+    const int dw = s->dilation_w;
+    const int in_h = s->in_h;
+    const int in_w = s->in_w;
+    const int out_h = s->out_h;
+    const int out_w = s->out_w;
+    const int pt = s->pad_top;
+    const int pl = s->pad_left;
+    const int activation = s->activation;
+
+    /* [x_lo, x_hi): outputs whose taps are all inside the input row */
+    int last = in_w - 1 + pl - (kw - 1) * dw;
+    int x_lo = (pl + sw - 1) / sw;
+    int x_hi = last >= 0 ? last / sw + 1 : 0;
+
+    if(x_hi > out_w)
+        x_hi = out_w;
+    if(x_lo > out_w)
+        x_lo = out_w;
+    if(x_hi < x_lo)
+        x_hi = x_lo;
+
+    /* stride 2 loads read one extra float past the last tap */
+    int x_vec = x_hi;
+
+    if(S == 2)
+    {
+        int v = last >= 1 ? (last - 1) / sw + 1 : 0;
+
+        if(v < x_vec)
+            x_vec = v;
+    }
+
+    for(int oy = 0; oy < out_h; oy++)
+    {
+        int iy0 = oy * sh - pt;
+        int ky_lo = iy0 < 0 ? (-iy0 + dh - 1) / dh : 0;
+        int ky_hi = in_h - 1 - iy0 >= 0 ? (in_h - 1 - iy0) / dh + 1 : 0;
+
+        if(ky_hi > kh)
+            ky_hi = kh;
+
+        float* out_row = output + oy * out_w;
+        int ox = 0;
+
+        for(; ox < x_lo; ox++)
+        {
+            int ix0 = ox * sw - pl;
+            float sum = bias;
+
+            for(int ky = ky_lo; ky < ky_hi; ky++)
+            {
+                const float* row = input + (iy0 + ky * dh) * in_w;
+                const float* k = kernel + ky * kw;
+
+                for(int kx = 0; kx < kw; kx++)
+                {
+                    int ix = ix0 + kx * dw;
+
+                    if(ix >= 0 && ix < in_w)
+                        sum += row[ix] * k[kx];
+                }
+            }
+
+            out_row[ox] = f_activation(sum, activation);
+        }
+
+        for(; ox + 4 <= x_vec; ox += 4)
+        {
+            vf4_t acc = vf4_dup(bias);
+
+            for(int ky = ky_lo; ky < ky_hi; ky++)
+            {
+                const float* row = input + (iy0 + ky * dh) * in_w + ox * sw - pl;
+                const float* k = kernel + ky * kw;
+
+                for(int kx = 0; kx < kw; kx++)
+                {
+                    const float* p = row + kx * dw;
+                    vf4_t v;
+
+                    if(S == 1)
+                        v = vf4_load(p);
+                    else if(S == 2)
+                        v = vf4_load_even(p);
+                    else
+                        v = vf4_load_stride(p, sw);
+
+                    acc = vf4_mla_n(acc, v, k[kx]);
+                }
+            }
+
+            vf4_store(out_row + ox, vf4_activation(acc, activation));
+        }
+
+        for(; ox < x_hi; ox++)
+        {
+            float sum = bias;
+
+            for(int ky = ky_lo; ky < ky_hi; ky++)
+            {
+                const float* row = input + (iy0 + ky * dh) * in_w + ox * sw - pl;
+                const float* k = kernel + ky * kw;
+
+                for(int kx = 0; kx < kw; kx++)
+                    sum += row[kx * dw] * k[kx];
+            }
+
+            out_row[ox] = f_activation(sum, activation);
+        }
+
+        for(; ox < out_w; ox++)
+        {
+            int ix0 = ox * sw - pl;
+            float sum = bias;
+
+            for(int ky = ky_lo; ky < ky_hi; ky++)
+            {
+                const float* row = input + (iy0 + ky * dh) * in_w;
+                const float* k = kernel + ky * kw;
+
+                for(int kx = 0; kx < kw; kx++)
+                {
+                    int ix = ix0 + kx * dw;
+
+                    if(ix >= 0 && ix < in_w)
+                        sum += row[ix] * k[kx];
+                }
+            }
+
+            out_row[ox] = f_activation(sum, activation);
+        }
+    }
+}
+
+typedef void (*dw_conv_plane_t)(const float*, float*, const float*, float, const dw_conv_shape*);
+
+template <int K> static dw_conv_plane_t dw_conv_select_stride(int stride_w)
+{
+    if(stride_w == 1)
+        return dw_conv_plane<K, 1>;
+    else if(stride_w == 2)
+        return dw_conv_plane<K, 2>;
+    else
+        return dw_conv_plane<K, 0>;
+}
+
+static inline dw_conv_plane_t dw_conv_select(const dw_conv_shape* s)
+{
+    if(s->kernel_h == s->kernel_w)
+    {
+        switch(s->kernel_h)
+        {
+            case 3:
+                return dw_conv_select_stride<3>(s->stride_w);
+            case 5:
+                return dw_conv_select_stride<5>(s->stride_w);
+            case 7:
+                return dw_conv_select_stride<7>(s->stride_w);
+            default:
+                break;
+        }
+    }
+
+    return dw_conv_select_stride<0>(s->stride_w);
+}
+
+/* run channel_num planes; bias may be NULL */
+static inline void dw_conv_channels(const float* input, float* output, const float* kernel, const float* bias,
+                                    int channel_num, const dw_conv_shape* s)
+{
+    dw_conv_plane_t plane_func = dw_conv_select(s);
+
+    int in_hw = s->in_h * s->in_w;
+    int out_hw = s->out_h * s->out_w;
+    int kernel_hw = s->kernel_h * s->kernel_w;
+
+    for(int c = 0; c < channel_num; c++)
+    {
+        plane_func(input + c * in_hw, output + c * out_hw, kernel + c * kernel_hw, bias ? bias[c] : 0.f, s);
+    }
+}
+
+/*
+ * depthwise convolution of channel blocked data, [C / 4][H][W][4]:
+ * the 4 channels of a block are one vector. kernel is [C / 4][KH][KW][4].
+ */
+static inline void dw_conv_blocked(const float* input, float* output, const float* kernel, const float* bias,
+                                   int block_num, const dw_conv_shape* s)
+{
+    const int kh = s->kernel_h;
+    const int kw = s->kernel_w;
+    const int dh = s->dilation_h;
+    const int dw = s->dilation_w;
+    const int in_h = s->in_h;
+    const int in_w = s->in_w;
+    const int out_h = s->out_h;
+    const int out_w = s->out_w;
+
+    for(int b = 0; b < block_num; b++)
+    {
+        const float* in = input + b * in_h * in_w * 4;
+        const float* k = kernel + b * kh * kw * 4;
+        float* out = output + b * out_h * out_w * 4;
+        vf4_t v_bias = bias ? vf4_load(bias + b * 4) : vf4_zero();
+
+        for(int oy = 0; oy < out_h; oy++)
+        {
+            int iy0 = oy * s->stride_h - s->pad_top;
+            int ky_lo = iy0 < 0 ? (-iy0 + dh - 1) / dh : 0;
+            int ky_hi = in_h - 1 - iy0 >= 0 ? (in_h - 1 - iy0) / dh + 1 : 0;
+
+            if(ky_hi > kh)
+                ky_hi = kh;
+
+            for(int ox = 0; ox < out_w; ox++)
+            {
+                int ix0 = ox * s->stride_w - s->pad_left;
+                int kx_lo = ix0 < 0 ? (-ix0 + dw - 1) / dw : 0;
+                int kx_hi = in_w - 1 - ix0 >= 0 ? (in_w - 1 - ix0) / dw + 1 : 0;
+
+                if(kx_hi > kw)
+                    kx_hi = kw;
+
+                vf4_t acc = v_bias;
+
+                for(int ky = ky_lo; ky < ky_hi; ky++)
+                {
+                    const float* row = in + ((iy0 + ky * dh) * in_w + ix0) * 4;
+                    const float* kr = k + ky * kw * 4;
+
+                    for(int kx = kx_lo; kx < kx_hi; kx++)
+                        acc = vf4_mla(acc, vf4_load(row + kx * dw * 4), vf4_load(kr + kx * 4));
+                }
+
+                vf4_store(out + (oy * out_w + ox) * 4, vf4_activation(acc, s->activation));
+            }
+        }
+    }
+}
+
+#endif
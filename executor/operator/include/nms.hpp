@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __NMS_HPP__
+#define __NMS_HPP__
+
+#include <vector>
+
+/*
+ * Box post-processing shared by DetectionOutput, DetectionPostProcess and RPN:
+ * boxes are kept as structure of arrays, candidates are reduced with a
+ * partial sort and the greedy NMS tests each candidate against all kept
+ * boxes four at a time.
+ */
+
+namespace TEngine {
+
+struct NmsBoxes
+{
+    std::vector<float> x0;
+    std::vector<float> y0;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> score;
+
+    /* caller defined, e.g. the prior or anchor index */
+    std::vector<int> tag;
+
+    int Size(void) const
+    {
+        return score.size();
+    }
+
+    void Clear(void);
+    void Reserve(int n);
+    void Push(float bx0, float by0, float bx1, float by1, float s, int t);
+};
+
+struct NmsParam
+{
+    float iou_threshold;
+
+    /* 1 for pixel boxes whose width is x1 - x0 + 1 */
+    float offset;
+
+    /* suppress on IoU >= threshold instead of IoU > threshold */
+    bool suppress_equal;
+
+    /* stop after this many boxes are kept, <= 0 means no limit */
+    int max_keep;
+
+    NmsParam(float threshold)
+    {
+        iou_threshold = threshold;
+        offset = 0.f;
+        suppress_equal = false;
+        max_keep = 0;
+    }
+};
+
+/* the boxes kept by nms_sorted, packed so that they can be loaded four at a time */
+struct NmsScratch
+{
+    std::vector<float> x0;
+    std::vector<float> y0;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> area;
+
+    /* grows only: a scratch kept by the caller is allocated once */
+    void Resize(int n);
+};
+
+/*
+ * keep the top_k (all if top_k <= 0) entries of index with the highest score[index[i]],
+ * ordered by descending score; ties keep the lower index first
+ */
+void nms_topk(std::vector<int>& index, const float* score, int top_k);
+
+/*
+ * order: box indices sorted by descending score; picked: kept box indices, in order;
+ * scratch: owned by the caller, one per thread
+ */
+void nms_sorted(const NmsBoxes& boxes, const std::vector<int>& order, const NmsParam& param, NmsScratch& scratch,
+                std::vector<int>& picked);
+
+/* nms_topk over all boxes with candidate_k, then nms_sorted */
+void nms_boxes(const NmsBoxes& boxes, int candidate_k, const NmsParam& param, NmsScratch& scratch,
+               std::vector<int>& picked);
+
+}    // namespace TEngine
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __SGEMM_KERNEL_H__
+#define __SGEMM_KERNEL_H__
+
+#include <string.h>
+
+#include "simd_vec.h"
+
+/*
+ * Portable packed single precision GEMM: C(M x N) = A(M x K) * B(K x N).
+ *
+ * A is packed into panels of SGEMM_MR rows and B into panels of SGEMM_NR
+ * columns, both laid out k-major, so that the micro kernel streams through
+ * them linearly and keeps the whole 4x8 C tile in registers.
+ * Partial panels are zero filled, so the kernel never needs edge checks.
+ */
+
+#define SGEMM_MR 4
+#define SGEMM_NR 8
+
+#define SGEMM_ALIGN_M(m) (((m) + SGEMM_MR - 1) / SGEMM_MR * SGEMM_MR)
+#define SGEMM_ALIGN_N(n) (((n) + SGEMM_NR - 1) / SGEMM_NR * SGEMM_NR)
+
+/* packed size in floats */
+static inline int sgemm_pack_a_size(int M, int K)
+{
+    return SGEMM_ALIGN_M(M) * K;
+}
+
+static inline int sgemm_pack_b_size(int K, int N)
+{
+    return SGEMM_ALIGN_N(N) * K;
+}
+
+/* row major A, lda >= K */
+static inline void sgemm_pack_a(int M, int K, const float* A, int lda, float* packed)
+{
+    for(int m = 0; m < M; m += SGEMM_MR)
+    {
+        int rows = M - m < SGEMM_MR ? M - m : SGEMM_MR;
+
+        for(int k = 0; k < K; k++)
+        {
+            int r = 0;
+
+            for(; r < rows; r++)
+                packed[r] = A[(m + r) * lda + k];
+            for(; r < SGEMM_MR; r++)
+                packed[r] = 0.f;
+
+            packed += SGEMM_MR;
+        }
+    }
+}
+
+/* row major B, ldb >= N */
+static inline void sgemm_pack_b(int K, int N, const float* B, int ldb, float* packed)
+{
+    for(int n = 0; n < N; n += SGEMM_NR)
+    {
+        int cols = N - n < SGEMM_NR ? N - n : SGEMM_NR;
+
+        for(int k = 0; k < K; k++)
+        {
+            const float* src = B + k * ldb + n;
+
+            if(cols == SGEMM_NR)
+            {
+                vf4_store(packed, vf4_load(src));
+                vf4_store(packed + 4, vf4_load(src + 4));
+            }
+            else
+            {
+                int c = 0;
+
+                for(; c < cols; c++)
+                    packed[c] = src[c];
+                for(; c < SGEMM_NR; c++)
+                    packed[c] = 0.f;
+            }
+
+            packed += SGEMM_NR;
+        }
+    }
+}
+
+/*
+ * c[4][ldc] = a_panel * b, where the k rows of 8 floats of b are ldb apart:
+ * a packed B panel with ldb SGEMM_NR, or 8 columns of a row major B.
+ */
+static inline void sgemm_kernel_4x8_ldb(int K, const float* a, const float* b, int ldb, float* c, int ldc)
+{
+    vf4_t c00 = vf4_zero();
+    vf4_t c01 = vf4_zero();
+    vf4_t c10 = vf4_zero();
+    vf4_t c11 = vf4_zero();
+    vf4_t c20 = vf4_zero();
+    vf4_t c21 = vf4_zero();
+    vf4_t c30 = vf4_zero();
+    vf4_t c31 = vf4_zero();
+
+    for(int k = 0; k < K; k++)
+    {
+        vf4_t b0 = vf4_load(b);
+        vf4_t b1 = vf4_load(b + 4);
+
+        c00 = vf4_mla_n(c00, b0, a[0]);
+        c01 = vf4_mla_n(c01, b1, a[0]);
+        c10 = vf4_mla_n(c10, b0, a[1]);
+        c11 = vf4_mla_n(c11, b1, a[1]);
+        c20 = vf4_mla_n(c20, b0, a[2]);
+        c21 = vf4_mla_n(c21, b1, a[2]);
+        c30 = vf4_mla_n(c30, b0, a[3]);
+        c31 = vf4_mla_n(c31, b1, a[3]);
+
+        a += SGEMM_MR;
+        b += ldb;
+    }
+
+    vf4_store(c, c00);
+    vf4_store(c + 4, c01);
+    vf4_store(c + ldc, c10);
+    vf4_store(c + ldc + 4, c11);
+    vf4_store(c + 2 * ldc, c20);
+    vf4_store(c + 2 * ldc + 4, c21);
+    vf4_store(c + 3 * ldc, c30);
+    vf4_store(c + 3 * ldc + 4, c31);
+}
+
+/* c[4][ldc] = a_panel * b_panel */
+static inline void sgemm_kernel_4x8(int K, const float* a, const float* b, float* c, int ldc)
+{
+    sgemm_kernel_4x8_ldb(K, a, b, SGEMM_NR, c, ldc);
+}
+
+/* one row of a packed A panel: c[8] = a_panel[row] * b, b as in sgemm_kernel_4x8_ldb() */
+static inline void sgemm_kernel_1x8_ldb(int K, const float* a, const float* b, int ldb, float* c)
+{
+    vf4_t c0 = vf4_zero();
+    vf4_t c1 = vf4_zero();
+
+    for(int k = 0; k < K; k++)
+    {
+        c0 = vf4_mla_n(c0, vf4_load(b), a[0]);
+        c1 = vf4_mla_n(c1, vf4_load(b + 4), a[0]);
+
+        a += SGEMM_MR;
+        b += ldb;
+    }
+
+    vf4_store(c, c0);
+    vf4_store(c + 4, c1);
+}
+
+/* one row of a packed A panel: c[8] = a_panel[row] * b_panel */
+static inline void sgemm_kernel_1x8(int K, const float* a, const float* b, float* c)
+{
+    sgemm_kernel_1x8_ldb(K, a, b, SGEMM_NR, c);
+}
+
+/*
+ * C = packed_a * packed_b, for A rows [0, M) and B columns [0, N).
+ * packed_b must start at a panel boundary.
+ */
+static inline void sgemm_packed(int M, int N, int K, const float* packed_a, const float* packed_b, float* C, int ldc)
+{
+    float tile[SGEMM_MR * SGEMM_NR];
+
+    for(int n = 0; n < N; n += SGEMM_NR)
+    {
+        int cols = N - n < SGEMM_NR ? N - n : SGEMM_NR;
+        const float* b = packed_b + n * K;
+
+        for(int m = 0; m < M; m += SGEMM_MR)
+        {
+            int rows = M - m < SGEMM_MR ? M - m : SGEMM_MR;
+            const float* a = packed_a + m * K;
+
+            if(rows == SGEMM_MR && cols == SGEMM_NR)
+            {
+                sgemm_kernel_4x8(K, a, b, C + m * ldc + n, ldc);
+                continue;
+            }
+
+            /* a partial row panel, as in gemv like calls, only computes the valid rows */
+            if(rows < SGEMM_MR)
+            {
+                for(int r = 0; r < rows; r++)
+                    sgemm_kernel_1x8(K, a + r, b, tile + r * SGEMM_NR);
+            }
+            else
+            {
+                sgemm_kernel_4x8(K, a, b, tile, SGEMM_NR);
+            }
+
+            for(int r = 0; r < rows; r++)
+                memcpy(C + (m + r) * ldc + n, tile + r * SGEMM_NR, cols * sizeof(float));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,527 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __SIMD_VEC_H__
+#define __SIMD_VEC_H__
+
+/*
+ * A thin 4-lane float vector layer shared by the portable kernels,
+ * so that the same source compiles to NEON on arm, SSE on x86
+ * and plain C elsewhere.
+ */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_VEC_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_VEC_SSE 1
+#else
+#include <math.h>
+#define SIMD_VEC_SCALAR 1
+#endif
+
+#define VF4_LANES 4
+
+#if defined(SIMD_VEC_NEON)
+
+typedef float32x4_t vf4_t;
+
+static inline vf4_t vf4_load(const float* p)
+{
+    return vld1q_f32(p);
+}
+static inline void vf4_store(float* p, vf4_t a)
+{
+    vst1q_f32(p, a);
+}
+static inline vf4_t vf4_dup(float v)
+{
+    return vdupq_n_f32(v);
+}
+static inline vf4_t vf4_zero(void)
+{
+    return vdupq_n_f32(0.f);
+}
+static inline vf4_t vf4_add(vf4_t a, vf4_t b)
+{
+    return vaddq_f32(a, b);
+}
+static inline vf4_t vf4_sub(vf4_t a, vf4_t b)
+{
+    return vsubq_f32(a, b);
+}
+static inline vf4_t vf4_mul(vf4_t a, vf4_t b)
+{
+    return vmulq_f32(a, b);
+}
+/* acc + a * b */
+static inline vf4_t vf4_mla(vf4_t acc, vf4_t a, vf4_t b)
+{
+#ifdef __aarch64__
+    return vfmaq_f32(acc, a, b);
+#else
+    return vmlaq_f32(acc, a, b);
+#endif
+}
+static inline vf4_t vf4_mla_n(vf4_t acc, vf4_t a, float b)
+{
+#ifdef __aarch64__
+    return vfmaq_n_f32(acc, a, b);
+#else
+    return vmlaq_n_f32(acc, a, b);
+#endif
+}
+static inline vf4_t vf4_max(vf4_t a, vf4_t b)
+{
+    return vmaxq_f32(a, b);
+}
+static inline vf4_t vf4_min(vf4_t a, vf4_t b)
+{
+    return vminq_f32(a, b);
+}
+static inline vf4_t vf4_div(vf4_t a, vf4_t b)
+{
+#ifdef __aarch64__
+    return vdivq_f32(a, b);
+#else
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+}
+/* p[0], p[2], p[4], p[6] */
+static inline vf4_t vf4_load_even(const float* p)
+{
+    return vld2q_f32(p).val[0];
+}
+static inline float vf4_reduce_add(vf4_t a)
+{
+#ifdef __aarch64__
+    return vaddvq_f32(a);
+#else
+    float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+}
+static inline float vf4_reduce_max(vf4_t a)
+{
+#ifdef __aarch64__
+    return vmaxvq_f32(a);
+#else
+    float32x2_t s = vmax_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpmax_f32(s, s), 0);
+#endif
+}
+/* true if a[i] > b[i] for any lane */
+static inline bool vf4_any_gt(vf4_t a, vf4_t b)
+{
+    uint32x4_t m = vcgtq_f32(a, b);
+#ifdef __aarch64__
+    return vmaxvq_u32(m) != 0;
+#else
+    uint32x2_t t = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+    return (vget_lane_u32(t, 0) | vget_lane_u32(t, 1)) != 0;
+#endif
+}
+static inline bool vf4_any_ge(vf4_t a, vf4_t b)
+{
+    uint32x4_t m = vcgeq_f32(a, b);
+#ifdef __aarch64__
+    return vmaxvq_u32(m) != 0;
+#else
+    uint32x2_t t = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+    return (vget_lane_u32(t, 0) | vget_lane_u32(t, 1)) != 0;
+#endif
+}
+/* a[i] < b[i] ? x[i] : y[i] */
+static inline vf4_t vf4_select_lt(vf4_t a, vf4_t b, vf4_t x, vf4_t y)
+{
+    return vbslq_f32(vcltq_f32(a, b), x, y);
+}
+/* a is integral valued: 2^a */
+static inline vf4_t vf4_pow2_int(vf4_t a)
+{
+    int32x4_t n = vaddq_s32(vcvtq_s32_f32(a), vdupq_n_s32(127));
+    return vreinterpretq_f32_s32(vshlq_n_s32(n, 23));
+}
+static inline vf4_t vf4_floor(vf4_t a)
+{
+    float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(a));
+    uint32x4_t gt = vcgtq_f32(t, a);
+    return vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(gt, vreinterpretq_u32_f32(vdupq_n_f32(1.f)))));
+}
+
+#elif defined(SIMD_VEC_SSE)
+
+typedef __m128 vf4_t;
+
+static inline vf4_t vf4_load(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+static inline void vf4_store(float* p, vf4_t a)
+{
+    _mm_storeu_ps(p, a);
+}
+static inline vf4_t vf4_dup(float v)
+{
+    return _mm_set1_ps(v);
+}
+static inline vf4_t vf4_zero(void)
+{
+    return _mm_setzero_ps();
+}
+static inline vf4_t vf4_add(vf4_t a, vf4_t b)
+{
+    return _mm_add_ps(a, b);
+}
+static inline vf4_t vf4_sub(vf4_t a, vf4_t b)
+{
+    return _mm_sub_ps(a, b);
+}
+static inline vf4_t vf4_mul(vf4_t a, vf4_t b)
+{
+    return _mm_mul_ps(a, b);
+}
+static inline vf4_t vf4_mla(vf4_t acc, vf4_t a, vf4_t b)
+{
+    return _mm_add_ps(acc, _mm_mul_ps(a, b));
+}
+static inline vf4_t vf4_mla_n(vf4_t acc, vf4_t a, float b)
+{
+    return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(b)));
+}
+static inline vf4_t vf4_max(vf4_t a, vf4_t b)
+{
+    return _mm_max_ps(a, b);
+}
+static inline vf4_t vf4_min(vf4_t a, vf4_t b)
+{
+    return _mm_min_ps(a, b);
+}
+static inline vf4_t vf4_div(vf4_t a, vf4_t b)
+{
+    return _mm_div_ps(a, b);
+}
+static inline vf4_t vf4_load_even(const float* p)
+{
+    __m128 lo = _mm_loadu_ps(p);
+    __m128 hi = _mm_loadu_ps(p + 4);
+    return _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+}
+static inline float vf4_reduce_add(vf4_t a)
+{
+    __m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline float vf4_reduce_max(vf4_t a)
+{
+    __m128 s = _mm_max_ps(a, _mm_movehl_ps(a, a));
+    s = _mm_max_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline bool vf4_any_gt(vf4_t a, vf4_t b)
+{
+    return _mm_movemask_ps(_mm_cmpgt_ps(a, b)) != 0;
+}
+static inline bool vf4_any_ge(vf4_t a, vf4_t b)
+{
+    return _mm_movemask_ps(_mm_cmpge_ps(a, b)) != 0;
+}
+static inline vf4_t vf4_select_lt(vf4_t a, vf4_t b, vf4_t x, vf4_t y)
+{
+    __m128 m = _mm_cmplt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y));
+}
+static inline vf4_t vf4_pow2_int(vf4_t a)
+{
+    __m128i n = _mm_add_epi32(_mm_cvttps_epi32(a), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(n, 23));
+}
+static inline vf4_t vf4_floor(vf4_t a)
+{
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    __m128 gt = _mm_cmpgt_ps(t, a);
+    return _mm_sub_ps(t, _mm_and_ps(gt, _mm_set1_ps(1.f)));
+}
+
+#else
+
+typedef struct
+{
+    float v[4];
+} vf4_t;
+
+static inline vf4_t vf4_load(const float* p)
+{
+    vf4_t r = {{p[0], p[1], p[2], p[3]}};
+    return r;
+}
+static inline void vf4_store(float* p, vf4_t a)
+{
+    for(int i = 0; i < 4; i++)
+        p[i] = a.v[i];
+}
+static inline vf4_t vf4_dup(float v)
+{
+    vf4_t r = {{v, v, v, v}};
+    return r;
+}
+static inline vf4_t vf4_zero(void)
+{
+    return vf4_dup(0.f);
+}
+
+#define VF4_SCALAR_BINARY(name, expr)           \
+    static inline vf4_t name(vf4_t a, vf4_t b)  \
+    {                                           \
+        vf4_t r;                                \
+        for(int i = 0; i < 4; i++)              \
+        {                                       \
+            float x = a.v[i];                   \
+            float y = b.v[i];                   \
+            r.v[i] = (expr);                    \
+        }                                       \
+        return r;                               \
+    }
+
+VF4_SCALAR_BINARY(vf4_add, x + y)
+VF4_SCALAR_BINARY(vf4_sub, x - y)
+VF4_SCALAR_BINARY(vf4_mul, x* y)
+VF4_SCALAR_BINARY(vf4_max, x > y ? x : y)
+VF4_SCALAR_BINARY(vf4_min, x < y ? x : y)
+VF4_SCALAR_BINARY(vf4_div, x / y)
+
+static inline vf4_t vf4_mla(vf4_t acc, vf4_t a, vf4_t b)
+{
+    return vf4_add(acc, vf4_mul(a, b));
+}
+static inline vf4_t vf4_mla_n(vf4_t acc, vf4_t a, float b)
+{
+    return vf4_add(acc, vf4_mul(a, vf4_dup(b)));
+}
+static inline vf4_t vf4_load_even(const float* p)
+{
+    vf4_t r = {{p[0], p[2], p[4], p[6]}};
+    return r;
+}
+static inline float vf4_reduce_add(vf4_t a)
+{
+    return a.v[0] + a.v[1] + a.v[2] + a.v[3];
+}
+static inline float vf4_reduce_max(vf4_t a)
+{
+    float m = a.v[0];
+    for(int i = 1; i < 4; i++)
+        m = a.v[i] > m ? a.v[i] : m;
+    return m;
+}
+static inline bool vf4_any_gt(vf4_t a, vf4_t b)
+{
+    for(int i = 0; i < 4; i++)
+        if(a.v[i] > b.v[i])
+            return true;
+    return false;
+}
+static inline bool vf4_any_ge(vf4_t a, vf4_t b)
+{
+    for(int i = 0; i < 4; i++)
+        if(a.v[i] >= b.v[i])
+            return true;
+    return false;
+}
+static inline vf4_t vf4_select_lt(vf4_t a, vf4_t b, vf4_t x, vf4_t y)
+{
+    vf4_t r;
+    for(int i = 0; i < 4; i++)
+        r.v[i] = a.v[i] < b.v[i] ? x.v[i] : y.v[i];
+    return r;
+}
+static inline vf4_t vf4_pow2_int(vf4_t a)
+{
+    vf4_t r;
+    for(int i = 0; i < 4; i++)
+        r.v[i] = ldexpf(1.f, ( int )a.v[i]);
+    return r;
+}
+static inline vf4_t vf4_floor(vf4_t a)
+{
+    vf4_t r;
+    for(int i = 0; i < 4; i++)
+        r.v[i] = floorf(a.v[i]);
+    return r;
+}
+
+#endif
+
+/* transpose the 4x4 block held in r[0..3] */
+static inline void vf4_transpose4(vf4_t* r)
+{
+#if defined(SIMD_VEC_NEON)
+    float32x4x2_t t01 = vtrnq_f32(r[0], r[1]);
+    float32x4x2_t t23 = vtrnq_f32(r[2], r[3]);
+
+    r[0] = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r[1] = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r[2] = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r[3] = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+#elif defined(SIMD_VEC_SSE)
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+#else
+    for(int i = 0; i < 4; i++)
+        for(int j = i + 1; j < 4; j++)
+        {
+            float t = r[i].v[j];
+            r[i].v[j] = r[j].v[i];
+            r[j].v[i] = t;
+        }
+#endif
+}
+
+/* p[0], p[s], p[2s], p[3s] */
+static inline vf4_t vf4_load_stride(const float* p, int s)
+{
+    float tmp[4] = {p[0], p[s], p[2 * s], p[3 * s]};
+    return vf4_load(tmp);
+}
+
+/*
+ * activation follows ConvParam: <0 no activation, 0 relu,
+ * >0 relu clipped at that value (relu6 etc.)
+ */
+static inline vf4_t vf4_activation(vf4_t a, int activation)
+{
+    if(activation >= 0)
+    {
+        a = vf4_max(a, vf4_zero());
+
+        if(activation > 0)
+            a = vf4_min(a, vf4_dup(( float )activation));
+    }
+
+    return a;
+}
+
+static inline float f_activation(float a, int activation)
+{
+    if(activation >= 0)
+    {
+        if(a < 0)
+            a = 0;
+        if(activation > 0 && a > activation)
+            a = activation;
+    }
+
+    return a;
+}
+
+/*
+ * exp(x): range reduction to x = n * ln2 + r, |r| <= ln2 / 2,
+ * then a degree 5 polynomial for exp(r). Inputs are clamped so that the
+ * result stays a normal float; max relative error is about 2 ulp.
+ */
+static inline vf4_t vf4_exp(vf4_t x)
+{
+    x = vf4_min(x, vf4_dup(88.02f));
+    x = vf4_max(x, vf4_dup(-87.33f));
+
+    vf4_t fx = vf4_floor(vf4_mla_n(vf4_dup(0.5f), x, 1.44269504088896341f));
+
+    x = vf4_sub(x, vf4_mul(fx, vf4_dup(0.693359375f)));
+    x = vf4_sub(x, vf4_mul(fx, vf4_dup(-2.12194440e-4f)));
+
+    vf4_t y = vf4_dup(1.9875691500E-4f);
+
+    y = vf4_mla(vf4_dup(1.3981999507E-3f), y, x);
+    y = vf4_mla(vf4_dup(8.3334519073E-3f), y, x);
+    y = vf4_mla(vf4_dup(4.1665795894E-2f), y, x);
+    y = vf4_mla(vf4_dup(1.6666665459E-1f), y, x);
+    y = vf4_mla(vf4_dup(5.0000001201E-1f), y, x);
+    y = vf4_mla(vf4_add(x, vf4_dup(1.f)), y, vf4_mul(x, x));
+
+    return vf4_mul(y, vf4_pow2_int(fx));
+}
+
+static inline vf4_t vf4_sigmoid(vf4_t x)
+{
+    vf4_t one = vf4_dup(1.f);
+
+    return vf4_div(one, vf4_add(one, vf4_exp(vf4_sub(vf4_zero(), x))));
+}
+
+/*
+ * tanh(x) = 1 - 2 / (exp(2x) + 1), which loses relative accuracy near zero,
+ * so |x| < 0.625 uses an odd polynomial instead; max error is a few ulp
+ */
+static inline vf4_t vf4_tanh(vf4_t x)
+{
+    vf4_t one = vf4_dup(1.f);
+    vf4_t e = vf4_exp(vf4_add(x, x));
+    vf4_t big = vf4_sub(one, vf4_div(vf4_dup(2.f), vf4_add(e, one)));
+
+    vf4_t z = vf4_mul(x, x);
+    vf4_t y = vf4_dup(-5.70498872745E-3f);
+
+    y = vf4_mla(vf4_dup(2.06390887954E-2f), y, z);
+    y = vf4_mla(vf4_dup(-5.37397155531E-2f), y, z);
+    y = vf4_mla(vf4_dup(1.33314422036E-1f), y, z);
+    y = vf4_mla(vf4_dup(-3.33332819422E-1f), y, z);
+    y = vf4_mla(x, y, vf4_mul(z, x));
+
+    return vf4_select_lt(z, vf4_dup(0.625f * 0.625f), y, big);
+}
+
+/*
+ * Array forms, out may alias in. The tail goes through a padded
+ * vector too, so that every element gets the same rounding.
+ */
+#define VF4_ARRAY_FUNC(name, vfunc)                              \
+    static inline void name(const float* in, float* out, int n)  \
+    {                                                            \
+        int i = 0;                                               \
+                                                                 \
+        for(; i + 4 <= n; i += 4)                                \
+            vf4_store(out + i, vfunc(vf4_load(in + i)));         \
+                                                                 \
+        if(i < n)                                                \
+        {                                                        \
+            float tmp[4] = {0.f, 0.f, 0.f, 0.f};                 \
+                                                                 \
+            for(int j = 0; j < n - i; j++)                       \
+                tmp[j] = in[i + j];                              \
+                                                                 \
+            vf4_store(tmp, vfunc(vf4_load(tmp)));                \
+                                                                 \
+            for(int j = 0; j < n - i; j++)                       \
+                out[i + j] = tmp[j];                             \
+        }                                                        \
+    }
+
+VF4_ARRAY_FUNC(vec_exp, vf4_exp)
+VF4_ARRAY_FUNC(vec_sigmoid, vf4_sigmoid)
+VF4_ARRAY_FUNC(vec_tanh, vf4_tanh)
+
+#endif
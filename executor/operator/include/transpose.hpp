@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#ifndef __TRANSPOSE_HPP__
+#define __TRANSPOSE_HPP__
+
+/*
+ * N-D transpose: output dim i is input dim perm[i].
+ *
+ * The plan drops dims of size 1 and merges dims that stay adjacent, so
+ * that most permutes become either a copy of contiguous rows, or a 2D
+ * transpose repeated over the remaining dims. The 2D transpose works on
+ * row blocks, which keeps the written output rows in cache, and on 4x4
+ * register tiles for 4 byte elements.
+ *
+ * The work is split into units: transpose_run() on disjoint unit ranges
+ * may run on different cpus.
+ */
+
+#define TRANSPOSE_MAX_DIM 8
+
+/* rows of the 2D transpose handled by one unit */
+#define TRANSPOSE_BLOCK 16
+
+namespace TEngine {
+
+struct TransposePlan
+{
+    int elem_size;
+
+    /* simplified output dims, and the input stride (in elements) of each */
+    int ndim;
+    int dims[TRANSPOSE_MAX_DIM];
+    long in_stride[TRANSPOSE_MAX_DIM];
+    long out_stride[TRANSPOSE_MAX_DIM];
+
+    /* the last output dim is contiguous in the input: copy rows */
+    bool copy_rows;
+
+    /* otherwise, the output dim that is contiguous in the input */
+    int col_dim;
+
+    /* dims iterated around the row copy or the 2D transpose */
+    int outer_num;
+    int outer_dim[TRANSPOSE_MAX_DIM];
+
+    long total;
+    long unit_num;
+};
+
+/* false if perm is not a permutation of [0, ndim) */
+bool transpose_plan(TransposePlan* plan, const int* dims, const int* perm, int ndim, int elem_size);
+
+void transpose_run(const TransposePlan* plan, const void* input, void* output, long unit_start, long unit_end);
+
+/* plan and run on the calling thread */
+bool transpose(const void* input, void* output, const int* dims, const int* perm, int ndim, int elem_size);
+
+/* layout conversion of 4 byte elements */
+void layout_nchw_to_nhwc(const float* input, float* output, int n, int c, int h, int w);
+void layout_nhwc_to_nchw(const float* input, float* output, int n, int c, int h, int w);
+
+/* channel blocked layout [N][C / 4][H][W][4], c must be a multiple of 4 */
+void layout_nchw_to_nchw4(const float* input, float* output, int n, int c, int h, int w);
+void layout_nchw4_to_nchw(const float* input, float* output, int n, int c, int h, int w);
+
+}    // namespace TEngine
+
+#endif
@@ -35,6 +35,7 @@ struct DeconvParam : public NamedParam
     int pad;
     int num_output;
     int dilation;
+    int activation;
 
     DECLARE_PARSER_STRUCTURE(DeconvParam)
     {
@@ -43,6 +44,7 @@ struct DeconvParam : public NamedParam
         DECLARE_PARSER_ENTRY(pad);
         DECLARE_PARSER_ENTRY(num_output);
         DECLARE_PARSER_ENTRY(dilation);
+        DECLARE_PARSER_ENTRY(activation);
     };
 };
 
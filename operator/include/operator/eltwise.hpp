@@ -49,6 +49,10 @@ public:
             param.type = ELT_MAX;
         else if(method == "prod")
             param.type = ELT_PROD;
+        else if(method == "sub")
+            param.type = ELT_SUB;
+        else if(method == "div")
+            param.type = ELT_DIV;
     }
     void ParseParam(EltwiseParam& param, Operator* op) override
     {
@@ -58,6 +62,16 @@ public:
     void SetSchema(void) override;
 
     bool InferShape(const std::vector<TShape>& ishape, std::vector<TShape>& oshape, int layout) override;
+
+    /*
+       the output dims of two inputs, and the input dims aligned to them.
+       inputs of the same size are taken element by element, otherwise the
+       dims are broadcast as numpy does, from the trailing dims. failing that,
+       in an NCHW graph a second input with the channel number of a 4D first
+       one is per channel, as caffe does.
+     */
+    static bool BroadcastDims(const std::vector<int>& dims0, const std::vector<int>& dims1, int layout,
+                              std::vector<int>& in0, std::vector<int>& in1, std::vector<int>& out);
 };
 
 }    // namespace TEngine
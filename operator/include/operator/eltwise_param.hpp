@@ -37,6 +37,7 @@ enum EltType
     ELT_MAX,
     ELT_RSQRT,
     ELT_MIN_SCALAR,
+    ELT_DIV,
     ELT_LAST
 };
 
@@ -47,11 +48,13 @@ struct EltwiseParam : public NamedParam
     std::string method;
     EltType type;
     int caffe_flavor;
+    int activation;    // as ConvParam, set when a relu is fused
 
     DECLARE_PARSER_STRUCTURE(EltwiseParam)
     {
         DECLARE_PARSER_ENTRY(method);
         DECLARE_PARSER_ENTRY(caffe_flavor);
+        DECLARE_PARSER_ENTRY(activation);
     };
 };
 
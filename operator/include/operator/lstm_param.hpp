@@ -44,6 +44,7 @@ struct LSTMParam : public NamedParam
     int has_clip;
     int has_bias;
     int has_init_state;
+    int keep_state;
     const char* forget_act;
     const char* input_act;
     const char* output_act;
@@ -64,6 +65,7 @@ struct LSTMParam : public NamedParam
         DECLARE_PARSER_ENTRY(has_clip);
         DECLARE_PARSER_ENTRY(has_bias);
         DECLARE_PARSER_ENTRY(has_init_state);
+        DECLARE_PARSER_ENTRY(keep_state);
         DECLARE_PARSER_ENTRY(forget_act);
         DECLARE_PARSER_ENTRY(input_act);
         DECLARE_PARSER_ENTRY(cellin_act);
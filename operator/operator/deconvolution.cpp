@@ -68,6 +68,7 @@ void Deconvolution::SetSchema(void)
         .SetAttr("pad", 1)
         .SetAttr("num_output", 1)
         .SetAttr("dilation", 1)
+        .SetAttr("activation", -1)
 
         .SetDoc(R"DOC(Deconvolution Layer)DOC");
 }
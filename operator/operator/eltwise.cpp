@@ -24,6 +24,7 @@
 #include "operator/eltwise.hpp"
 #include "static_graph.hpp"
 #include <cmath>
+#include <algorithm>
 
 namespace TEngine {
 
@@ -40,19 +41,77 @@ bool Eltwise::InferShape(const std::vector<TShape>& ishape, std::vector<TShape>&
         return false;
     }
 
+    std::vector<int> in0;
+    std::vector<int> in1;
+    std::vector<int> out;
+
     int i0_size = ishape[0].GetSize();
     int i1_size = ishape[1].GetSize();
 
-    if(i0_size >= i1_size)
+    oshape[0] = i0_size >= i1_size ? ishape[0] : ishape[1];
+
+    /* shapes that cannot be broadcast keep the shape of the bigger input, the kernel reports them */
+    if(BroadcastDims(ishape[0].GetDim(), ishape[1].GetDim(), layout, in0, in1, out))
+        oshape[0].SetDim(out);
+
+    return true;
+}
+
+bool Eltwise::BroadcastDims(const std::vector<int>& dims0, const std::vector<int>& dims1, int layout,
+                            std::vector<int>& in0, std::vector<int>& in1, std::vector<int>& out)
+{
+    int size0 = 1;
+    int size1 = 1;
+
+    for(unsigned int i = 0; i < dims0.size(); i++)
+        size0 *= dims0[i];
+
+    for(unsigned int i = 0; i < dims1.size(); i++)
+        size1 *= dims1[i];
+
+    if(size0 == size1)
+    {
+        out = dims0;
+        in0 = out;
+        in1 = out;
+
+        return true;
+    }
+
+    int ndim = std::max(dims0.size(), dims1.size());
+    bool numpy = true;
+
+    in0.assign(ndim - dims0.size(), 1);
+    in0.insert(in0.end(), dims0.begin(), dims0.end());
+    in1.assign(ndim - dims1.size(), 1);
+    in1.insert(in1.end(), dims1.begin(), dims1.end());
+    out.resize(ndim);
+
+    for(int i = 0; i < ndim; i++)
     {
-        oshape[0] = ishape[0];
+        if(in0[i] != in1[i] && in0[i] != 1 && in1[i] != 1)
+        {
+            numpy = false;
+            break;
+        }
+
+        out[i] = in0[i] == 1 ? in1[i] : in0[i];
     }
-    else if(i0_size < i1_size)
+
+    if(numpy)
+        return true;
+
+    /* the channel of an NHWC tensor is the last dim, numpy broadcasting covers it */
+    if(layout == TENGINE_LAYOUT_NCHW && dims0.size() == 4 && size1 == dims0[1])
     {
-        oshape[0] = ishape[1];
+        out = dims0;
+        in0 = dims0;
+        in1 = {1, size1, 1, 1};
+
+        return true;
     }
 
-    return true;
+    return false;
 }
 
 void Eltwise::SetSchema(void)
@@ -62,6 +121,7 @@ void Eltwise::SetSchema(void)
         .SetLayout("NCHW")
         .SetAttr("method", "sum")
         .SetAttr("caffe_flavor", 1)
+        .SetAttr("activation", -1)
         .SetDoc(R"DOC(Eltwise Layer)DOC");
 }
 
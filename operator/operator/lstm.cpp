@@ -45,6 +45,7 @@ void LSTM::SetSchema(void)
         .SetAttr("has_clip", 0)
         .SetAttr("has_bias", 0)
         .SetAttr("has_init_state", 0)
+        .SetAttr("keep_state", 0)
         .SetAttr("forget_act", "sigmoid")
         .SetAttr("input_act", "sigmoid")
         .SetAttr("output_act", "sigmoid")
@@ -56,6 +57,8 @@ void LSTM::SetSchema(void)
               bias:   i/f/c/o bias tensor, [num_directions, 4*hidden_size]
               w_f_diag/w_o_diag/w_i_diag: optional [num_directions, hidden_size]
               init_c/init_h: optional [cell_size]/[hidden_size]
+              keep_state: when set, a run starts from the h/c state left by the previous run
+                          instead of init_c/init_h, so a stream can be fed a few frames at a time
                  )DOC");
 }
 }    // namespace TEngine
@@ -28,25 +28,38 @@ namespace TEngine {
 bool Permute::InferShape(const std::vector<TEngine::TShape>& ishape, std::vector<TEngine::TShape>& oshape, int layout)
 {
     const TShape& input = ishape[0];
-    int n = input.GetN();
-    int c = input.GetC();
-    int h = input.GetH();
-    int w = input.GetW();
+    const std::vector<int>& in_dim = input.GetDim();
 
-    // only support for 0231[bhwc]
-    if((param_.order0 == 0) && (param_.order1 == 2) && (param_.order2 == 3) && (param_.order3 == 1))
+    /* order0 .. order(n-1) are used for a n dims input */
+    int order[4] = {param_.order0, param_.order1, param_.order2, param_.order3};
+    int dim_num = in_dim.size();
+
+    if(dim_num > 4)
+        return false;
+
+    std::vector<int> dim(dim_num);
+    bool seen[4] = {false, false, false, false};
+
+    for(int i = 0; i < dim_num; i++)
     {
-        TShape shape;
-        std::vector<int> dim = {n, h, w, c};
-        shape.SetDim(dim);
-        shape.SetDataLayout("NCHW");
-        oshape[0] = shape;
-        return true;
+        if(order[i] < 0 || order[i] >= dim_num || seen[order[i]])
+            return false;
+
+        seen[order[i]] = true;
+        dim[i] = in_dim[order[i]];
     }
+
+    TShape shape;
+    shape.SetDim(dim);
+
+    if(dim_num == 4)
+        shape.SetDataLayout("NCHW");
     else
-    {
-        return false;
-    }
+        shape.SetDataLayout(input.GetDataLayout());
+
+    oshape[0] = shape;
+
+    return true;
 }
 
 void Permute::SetSchema(void)
@@ -82,6 +82,7 @@ using op_load_t = std::function<bool(StaticGraph*, StaticNode*, void* const, con
 tm_uoffset_t SaveTmOperator(void* const start_ptr, tm_uoffset_t* cur_pos, Operator* op);
 op_load_t LoadTmOpFunc(uint32_t op_type);
 std::string GetOpStr(uint32_t op_type);
+unsigned int GetTmParamSize(uint32_t op_type);
 bool LoadTmAccuracyOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM_Operator* tm_op);
 bool LoadTmBatchNormOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM_Operator* tm_op);
 bool LoadTmResizeOp(StaticGraph* graph, StaticNode* node, void* const start_ptr, const TM_Operator* tm_op);
@@ -65,13 +65,15 @@ public:
         return false;
     }
 
-    bool LoadModelFromMem(void* mmap_buf, StaticGraph* graph);
+    bool LoadModelFromMem(void* mmap_buf, int mmap_size, StaticGraph* graph);
 
     bool IsSaveString(void);
     bool IsSaveData(void);
+    bool IsLazyLoad(void);
 
 protected:
     bool LoadBinaryFile(const char* tm_fname, int& fd, void*& buf, int& size);
+    bool CheckModelBounds(void* mmap_buf, int mmap_size);
     bool LoadNode(StaticGraph* graph, StaticNode* node, const TM_Node* tm_node, void* mmap_buf);
     bool LoadTensor(StaticGraph* graph, const TM_Tensor* tm_tensor, const TM_Buffer* tm_buf, void* mmap_buf);
     bool LoadGraph(StaticGraph* graph, const TM_Model* tm_model, void* mmap_buf);
@@ -581,11 +581,31 @@ static bool LoadOnnxDropout(StaticGraph* graph, StaticNode* node, const onnx::No
     return true;
 }
 
-static bool LoadOnnxAdd(StaticGraph* graph, StaticNode* node, const onnx::NodeProto& onnx_node)
+static bool LoadOnnxEltwise(StaticGraph* graph, StaticNode* node, const onnx::NodeProto& onnx_node)
 {
     EltwiseParam param = any_cast<EltwiseParam>(OpManager::GetOpDefParam("Eltwise"));
+    const std::string& op_type = onnx_node.op_type();
+
+    if(op_type == "Sub")
+        param.type = ELT_SUB;
+    else if(op_type == "Mul")
+        param.type = ELT_PROD;
+    else if(op_type == "Div")
+        param.type = ELT_DIV;
+    else if(op_type == "Max")
+        param.type = ELT_MAX;
+    else if(op_type == "Min")
+        param.type = ELT_MIN_SCALAR;
+    else
+        param.type = ELT_SUM;
 
-    param.type = ELT_SUM;
+    /* Max and Min take any number of inputs, the Eltwise kernels two */
+    if(onnx_node.input_size() > 2)
+    {
+        LOG_ERROR() << "onnx serializer: " << op_type << " node " << onnx_node.name() << " has "
+                    << onnx_node.input_size() << " inputs, at most 2 are supported\n";
+        return false;
+    }
 
     StaticOp* op = CreateStaticOp(graph, "Eltwise");
 
@@ -634,7 +654,12 @@ bool OnnxSerializerRegisterOpLoader(void)
     p_onnx->RegisterOpLoadMethod("Dropout", op_load_t(LoadOnnxDropout));
     p_onnx->RegisterOpLoadMethod("Softmax", op_load_t(LoadOnnxSoftmax));
     p_onnx->RegisterOpLoadMethod("BatchNormalization", op_load_t(LoadOnnxBN));
-    p_onnx->RegisterOpLoadMethod("Add", op_load_t(LoadOnnxAdd));
+    p_onnx->RegisterOpLoadMethod("Add", op_load_t(LoadOnnxEltwise));
+    p_onnx->RegisterOpLoadMethod("Sub", op_load_t(LoadOnnxEltwise));
+    p_onnx->RegisterOpLoadMethod("Mul", op_load_t(LoadOnnxEltwise));
+    p_onnx->RegisterOpLoadMethod("Div", op_load_t(LoadOnnxEltwise));
+    p_onnx->RegisterOpLoadMethod("Max", op_load_t(LoadOnnxEltwise));
+    p_onnx->RegisterOpLoadMethod("Min", op_load_t(LoadOnnxEltwise));
     p_onnx->RegisterOpLoadMethod("Flatten", op_load_t(LoadOnnxFlatten));
     p_onnx->RegisterOpLoadMethod("Gemm", op_load_t(LoadOnnxGemm));
 
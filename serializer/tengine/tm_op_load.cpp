@@ -659,4 +659,60 @@ std::string GetOpStr(uint32_t op_type)
     }
 }
 
+/* the size of the param table of op_type read by its load function, 0 for an op of no param */
+unsigned int GetTmParamSize(uint32_t op_type)
+{
+    switch(op_type)
+    {
+        case TM_OPTYPE_BATCHNORMALIZATION:
+            return sizeof(TM_BatchNormParam);
+        case TM_OPTYPE_BILINEARRESIZE:
+            return sizeof(TM_ResizeParam);
+        case TM_OPTYPE_CONCAT:
+            return sizeof(TM_ConcatParam);
+        case TM_OPTYPE_CONVOLUTION:
+            return sizeof(TM_ConvParam);
+        case TM_OPTYPE_DECONVOLUTION:
+            return sizeof(TM_DeconvParam);
+        case TM_OPTYPE_DETECTIONOUTPUT:
+            return sizeof(TM_DetectionOutputParam);
+        case TM_OPTYPE_ELTWISE:
+            return sizeof(TM_EltwiseParam);
+        case TM_OPTYPE_FLATTEN:
+            return sizeof(TM_FlattenParam);
+        case TM_OPTYPE_FULLYCONNECTED:
+            return sizeof(TM_FCParam);
+        case TM_OPTYPE_LRN:
+            return sizeof(TM_LRNParam);
+        case TM_OPTYPE_NORMALIZE:
+            return sizeof(TM_NormalizeParam);
+        case TM_OPTYPE_PERMUTE:
+            return sizeof(TM_PermuteParam);
+        case TM_OPTYPE_POOLING:
+            return sizeof(TM_PoolParam);
+        case TM_OPTYPE_PRIORBOX:
+            return sizeof(TM_PriorBoxParam);
+        case TM_OPTYPE_REGION:
+            return sizeof(TM_RegionParam);
+        case TM_OPTYPE_RELU:
+            return sizeof(TM_ReLuParam);
+        case TM_OPTYPE_REORG:
+            return sizeof(TM_ReorgParam);
+        case TM_OPTYPE_RESHAPE:
+            return sizeof(TM_ReshapeParam);
+        case TM_OPTYPE_ROIPOOLING:
+            return sizeof(TM_ROIPoolingParam);
+        case TM_OPTYPE_RPN:
+            return sizeof(TM_RPNParam);
+        case TM_OPTYPE_SCALE:
+            return sizeof(TM_ScaleParam);
+        case TM_OPTYPE_SLICE:
+            return sizeof(TM_SliceParam);
+        case TM_OPTYPE_SOFTMAX:
+            return sizeof(TM_SoftmaxParam);
+        default:
+            return 0;
+    }
+}
+
 }    // namespace TEngine
@@ -60,6 +60,16 @@ bool TmSerializer::IsSaveData(void)
         return true;
 }
 
+bool TmSerializer::IsLazyLoad(void)
+{
+    const char* env = std::getenv("TM_LAZY_LOAD");
+
+    if(env && env[0] != '0')
+        return true;
+    else
+        return false;
+}
+
 tm_uoffset_t TmSerializer::SaveTmTensor(void* const start_ptr, tm_uoffset_t* cur_pos, Tensor* tensor,
                                         unsigned int tensor_id, unsigned int buffer_id)
 {
@@ -484,6 +494,15 @@ bool TmSerializer::LoadTensor(StaticGraph* graph, const TM_Tensor* tm_tensor, co
     if(tm_tensor->type == kConstTensor)
     {
         SetTensorSize(tensor, tm_buf->size);
+
+        /* the model buffer lives as long as the graph: read the data at its first use */
+        if(tm_buf->offset_data != NOT_SET && IsLazyLoad())
+        {
+            SetConstTensorLazySource(tensor, GetTmPtr<void>(mmap_buf, tm_buf->offset_data));
+            SetConstTensorFileLocation(tensor, tm_buf->offset_data, tm_buf->size);
+            return true;
+        }
+
         void* buf = malloc(tm_buf->size);
         if(tm_buf->offset_data != NOT_SET)
         {
@@ -611,8 +630,207 @@ bool TmSerializer::LoadBinaryFile(const char* tm_fname, int& fd, void*& buf, int
     return true;
 }
 
-bool TmSerializer::LoadModelFromMem(void* mmap_buf, StaticGraph* graph)
+/* [offset, offset + size) is in the first mmap_size bytes */
+static inline bool in_bounds(tm_uoffset_t offset, unsigned int size, unsigned int mmap_size)
+{
+    return offset <= mmap_size && size <= mmap_size - offset;
+}
+
+/* a vector of element_size elements at offset: its v_num, then the elements */
+static inline bool vector_in_bounds(void* mmap_buf, tm_uoffset_t offset, unsigned int element_size,
+                                    unsigned int mmap_size)
+{
+    if(!in_bounds(offset, sizeof(tm_size_t), mmap_size))
+        return false;
+
+    tm_size_t v_num = GetTmPtr<TM_Vector_offsets>(mmap_buf, offset)->v_num;
+
+    return v_num <= (mmap_size - offset - sizeof(tm_size_t)) / element_size;
+}
+
+/* a string at offset and its data, if set */
+static inline bool string_in_bounds(void* mmap_buf, tm_uoffset_t offset, unsigned int mmap_size)
 {
+    if(offset == NOT_SET)
+        return true;
+
+    if(!in_bounds(offset, sizeof(TM_String), mmap_size))
+        return false;
+
+    const TM_String* tm_string = GetTmPtr<TM_String>(mmap_buf, offset);
+
+    return in_bounds(tm_string->offset_data, tm_string->size, mmap_size);
+}
+
+/* a vector of indices at offset, each of them less than limit */
+static inline bool indices_in_bounds(void* mmap_buf, tm_uoffset_t offset, unsigned int limit, unsigned int mmap_size)
+{
+    if(!vector_in_bounds(mmap_buf, offset, sizeof(uint32_t), mmap_size))
+        return false;
+
+    const TM_Vector_indices* v_indices = GetTmPtr<TM_Vector_indices>(mmap_buf, offset);
+
+    for(unsigned int i = 0; i < v_indices->v_num; i++)
+    {
+        if(v_indices->indices[i] >= limit)
+            return false;
+    }
+
+    return true;
+}
+
+/* the operator of a node, its param table and the vectors the param points to */
+static bool operator_in_bounds(void* mmap_buf, tm_uoffset_t offset, unsigned int mmap_size)
+{
+    if(!in_bounds(offset, sizeof(TM_Operator), mmap_size))
+        return false;
+
+    const TM_Operator* tm_op = GetTmPtr<TM_Operator>(mmap_buf, offset);
+
+    if(tm_op->operator_type >= TM_OPTYPE_NUM)
+        return false;
+
+    unsigned int param_size = GetTmParamSize(tm_op->operator_type);
+
+    if(param_size == 0)
+        return true;
+
+    if(!in_bounds(tm_op->offset_t_param, param_size, mmap_size))
+        return false;
+
+    unsigned int float_size = sizeof(float);
+
+    switch(tm_op->operator_type)
+    {
+        case TM_OPTYPE_PRIORBOX:
+        {
+            const TM_PriorBoxParam* tm_param = GetTmPtr<TM_PriorBoxParam>(mmap_buf, tm_op->offset_t_param);
+
+            return vector_in_bounds(mmap_buf, tm_param->offset_vf_min_size, float_size, mmap_size) &&
+                   vector_in_bounds(mmap_buf, tm_param->offset_vf_max_size, float_size, mmap_size) &&
+                   vector_in_bounds(mmap_buf, tm_param->offset_vf_variance, float_size, mmap_size) &&
+                   vector_in_bounds(mmap_buf, tm_param->offset_vf_aspect_ratio, float_size, mmap_size);
+        }
+        case TM_OPTYPE_REGION:
+        {
+            const TM_RegionParam* tm_param = GetTmPtr<TM_RegionParam>(mmap_buf, tm_op->offset_t_param);
+
+            return vector_in_bounds(mmap_buf, tm_param->offset_vf_biases, float_size, mmap_size);
+        }
+        case TM_OPTYPE_RPN:
+        {
+            const TM_RPNParam* tm_param = GetTmPtr<TM_RPNParam>(mmap_buf, tm_op->offset_t_param);
+
+            return vector_in_bounds(mmap_buf, tm_param->offset_vf_ratios, float_size, mmap_size) &&
+                   vector_in_bounds(mmap_buf, tm_param->offset_vf_anchor_scales, float_size, mmap_size);
+        }
+        default:
+            return true;
+    }
+}
+
+/*
+   a truncated or corrupt file would point out of the mapping: check every
+   table, string and vector LoadGraph() reads, down to the params of the
+   operators and the data of each buffer, and every index into the tensors
+   and the nodes, before loading
+ */
+bool TmSerializer::CheckModelBounds(void* mmap_buf, int mmap_size)
+{
+    if(mmap_size < ( int )sizeof(TM_Header))
+        return false;
+
+    unsigned int size = mmap_size;
+    const TM_Header* tm_header = reinterpret_cast<const TM_Header*>(mmap_buf);
+
+    if(!in_bounds(tm_header->offset_root, sizeof(TM_Model), size))
+        return false;
+
+    const TM_Model* tm_model = GetTmPtr<TM_Model>(mmap_buf, tm_header->offset_root);
+
+    if(!vector_in_bounds(mmap_buf, tm_model->offset_vo_subgraphs, sizeof(tm_uoffset_t), size) ||
+       !string_in_bounds(mmap_buf, tm_model->offset_s_mname, size))
+        return false;
+
+    const TM_Vector_offsets* v_graphs = GetTmPtr<TM_Vector_offsets>(mmap_buf, tm_model->offset_vo_subgraphs);
+
+    if(v_graphs->v_num == 0 || !in_bounds(v_graphs->offsets[0], sizeof(TM_Subgraph), size))
+        return false;
+
+    const TM_Subgraph* tm_graph = GetTmPtr<TM_Subgraph>(mmap_buf, v_graphs->offsets[0]);
+
+    if(!vector_in_bounds(mmap_buf, tm_graph->offset_vo_seq_nodes, sizeof(tm_uoffset_t), size) ||
+       !vector_in_bounds(mmap_buf, tm_graph->offset_vo_tensors, sizeof(tm_uoffset_t), size) ||
+       !vector_in_bounds(mmap_buf, tm_graph->offset_vo_buffers, sizeof(tm_uoffset_t), size))
+        return false;
+
+    const TM_Vector_offsets* v_nodes = GetTmPtr<TM_Vector_offsets>(mmap_buf, tm_graph->offset_vo_seq_nodes);
+    const TM_Vector_offsets* v_tensors = GetTmPtr<TM_Vector_offsets>(mmap_buf, tm_graph->offset_vo_tensors);
+    const TM_Vector_offsets* v_buffers = GetTmPtr<TM_Vector_offsets>(mmap_buf, tm_graph->offset_vo_buffers);
+
+    for(unsigned int i = 0; i < v_buffers->v_num; i++)
+    {
+        if(!in_bounds(v_buffers->offsets[i], sizeof(TM_Buffer), size))
+            return false;
+
+        const TM_Buffer* tm_buf = GetTmPtr<TM_Buffer>(mmap_buf, v_buffers->offsets[i]);
+
+        if(tm_buf->offset_data != NOT_SET && !in_bounds(tm_buf->offset_data, tm_buf->size, size))
+            return false;
+    }
+
+    for(unsigned int i = 0; i < v_tensors->v_num; i++)
+    {
+        if(!in_bounds(v_tensors->offsets[i], sizeof(TM_Tensor), size))
+            return false;
+
+        const TM_Tensor* tm_tensor = GetTmPtr<TM_Tensor>(mmap_buf, v_tensors->offsets[i]);
+
+        if(tm_tensor->type == kConstTensor && tm_tensor->buffer_id >= v_buffers->v_num)
+            return false;
+
+        if(!string_in_bounds(mmap_buf, tm_tensor->offset_s_tname, size))
+            return false;
+
+        if(tm_tensor->offset_vd_dims != NOT_SET &&
+           !vector_in_bounds(mmap_buf, tm_tensor->offset_vd_dims, sizeof(int32_t), size))
+            return false;
+    }
+
+    for(unsigned int i = 0; i < v_nodes->v_num; i++)
+    {
+        if(!in_bounds(v_nodes->offsets[i], sizeof(TM_Node), size))
+            return false;
+
+        const TM_Node* tm_node = GetTmPtr<TM_Node>(mmap_buf, v_nodes->offsets[i]);
+
+        if(!string_in_bounds(mmap_buf, tm_node->offset_s_nname, size))
+            return false;
+
+        if(tm_node->offset_vi_input_tensors != NOT_SET &&
+           !indices_in_bounds(mmap_buf, tm_node->offset_vi_input_tensors, v_tensors->v_num, size))
+            return false;
+
+        if(tm_node->offset_vi_output_tensors != NOT_SET &&
+           !indices_in_bounds(mmap_buf, tm_node->offset_vi_output_tensors, v_tensors->v_num, size))
+            return false;
+
+        if(!operator_in_bounds(mmap_buf, tm_node->offset_t_operator, size))
+            return false;
+    }
+
+    return indices_in_bounds(mmap_buf, tm_graph->offset_vi_input_indices, v_nodes->v_num, size) &&
+           indices_in_bounds(mmap_buf, tm_graph->offset_vi_output_indices, v_nodes->v_num, size);
+}
+
+bool TmSerializer::LoadModelFromMem(void* mmap_buf, int mmap_size, StaticGraph* graph)
+{
+    if(!CheckModelBounds(mmap_buf, mmap_size))
+    {
+        printf("Truncated or corrupt tm file\n");
+        return false;
+    }
+
     const TM_Header* tm_header = reinterpret_cast<const TM_Header*>(mmap_buf);
     /* Check the version of tm file format */
     if(tm_header->ver_main != TM_FILE_VER_MAIN || tm_header->ver_sub != TM_FILE_VER_SUB ||
@@ -656,9 +874,20 @@ bool TmSerializer::LoadModel(const std::vector<std::string>& file_list, StaticGr
     SetGraphSourceFormat(graph, "tengine");
     SetGraphConstTensorFile(graph, file_list[0]);
 
-    bool ret = LoadModelFromMem(mmap_buf, graph);
+    bool lazy_load = IsLazyLoad();
+
+    /* keep the mapping for the lazy const tensors: the graph unmaps it */
+    if(lazy_load)
+        graph->mapped_src.emplace_back(mmap_buf, mmap_size);
+
+    bool ret = LoadModelFromMem(mmap_buf, mmap_size, graph);
+
+    if(!ret)
+        printf("Cannot load tm file '%s'\n", file_list[0].c_str());
+
+    if(!lazy_load)
+        munmap(const_cast<void*>(mmap_buf), mmap_size);
 
-    munmap(const_cast<void*>(mmap_buf), mmap_size);
     close(fd);
     return ret;
 }
@@ -666,7 +895,7 @@ bool TmSerializer::LoadModel(const std::vector<std::string>& file_list, StaticGr
 bool TmSerializer::LoadModel(const std::vector<const void*>& addr_list, const std::vector<int>& size_list,
                              StaticGraph* graph)
 {
-    if(addr_list.size() != GetFileNum())
+    if(addr_list.size() != GetFileNum() || size_list.size() != GetFileNum())
         return false;
 
     void* mmap_buf = ( void* )addr_list[0];
@@ -674,7 +903,7 @@ bool TmSerializer::LoadModel(const std::vector<const void*>& addr_list, const st
     SetGraphSource(graph, "in_mem");
     SetGraphSourceFormat(graph, "tengine");
 
-    bool ret = LoadModelFromMem(mmap_buf, graph);
+    bool ret = LoadModelFromMem(mmap_buf, size_list[0], graph);
 
     if(ret)
         graph->mem_src.push_back(mmap_buf);
@@ -2107,6 +2107,10 @@ static EltType MapEltwise(TFNode* tf_node, const std::string& elt_op)
         return ELT_RSQRT;
     else if(elt_op == "Minimum")
         return ELT_MIN_SCALAR;
+    else if(elt_op == "Maximum")
+        return ELT_MAX;
+    else if(elt_op == "RealDiv")
+        return ELT_DIV;
     else
         return ELT_LAST;
 }
@@ -2115,7 +2119,7 @@ static bool LoadEltwise(TFNode* tf_node, TFGraph& tf_graph, StaticGraph* graph)
 {
     // sanity check
     if(tf_node->op == "Add" || tf_node->op == "Mul" || tf_node->op == "Sub" || tf_node->op == "Minimum" ||
-       tf_node->op == "AddN")
+       tf_node->op == "AddN" || tf_node->op == "Maximum" || tf_node->op == "RealDiv")
     {
         if(tf_node->inputs.size() != 2)
             return false;
@@ -2676,6 +2680,8 @@ bool TFSerializerRegisterOpLoader(void)
     p_tf->RegisterOpLoadMethod("Sub", op_load_t(LoadEltwise));
     p_tf->RegisterOpLoadMethod("Mul", op_load_t(LoadEltwise));
     p_tf->RegisterOpLoadMethod("Minimum", op_load_t(LoadEltwise));
+    p_tf->RegisterOpLoadMethod("Maximum", op_load_t(LoadEltwise));
+    p_tf->RegisterOpLoadMethod("RealDiv", op_load_t(LoadEltwise));
     p_tf->RegisterOpLoadMethod("Rsqrt", op_load_t(LoadEltwise));
     p_tf->RegisterOpLoadMethod("ResizeNearestNeighbor", op_load_t(LoadResize));
     p_tf->RegisterOpLoadMethod("ComposedBN", op_load_t(LoadComposedBN));
@@ -0,0 +1,622 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+
+/*
+ * Benchmark driver for any model in any serializer format.
+ *
+ * The cpu list of the runtime is fixed by init_tengine(), so each point of
+ * the cpu list sweep runs in a forked child process, which reports its
+ * result on a pipe. This also gives each point its own cold start and
+ * peak memory figures. The memory of the graph is broken down by category
+ * from GRAPH_ATTR_MEM_STAT, and by node with -M.
+ *
+ *   bench_model -f caffe -m mobilenet_deploy.prototxt -w mobilenet.caffemodel
+ *               -i 1,3,224,224 -t 1,2,4 -r 100 -o result.json
+ */
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "tengine_c_api.h"
+#include "common_util.hpp"
+
+using namespace TEngine;
+
+struct BenchConfig
+{
+    std::string format;
+    std::string model_file;
+    std::string weight_file;
+    std::string device;
+    std::vector<std::vector<int>> input_shapes;
+    int warmup_count;
+    int repeat_count;
+    bool mem_dump;
+};
+
+/* plain data, passed back from the child on a pipe */
+struct BenchResult
+{
+    bool ok;
+
+    /* cold start, in us */
+    unsigned long init_time;
+    unsigned long load_time;
+    unsigned long prerun_time;
+    unsigned long first_run_time;
+
+    /* per run latency, in us */
+    double mean;
+    double min;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+    double throughput;
+
+    /* in KB */
+    long prerun_rss;
+    long peak_rss;
+
+    /* graph memory by MEM_STAT_xxx, in bytes */
+    uint64_t mem_current[MEM_STAT_NUM];
+    uint64_t mem_peak[MEM_STAT_NUM];
+    uint64_t mem_total_peak;
+};
+
+static const char* mem_category_name[MEM_STAT_NUM] = {"weight", "packed_weight", "activation", "scratch"};
+
+static void show_usage(const char* prog)
+{
+    std::printf("usage: %s -f format -m model_file [-w weight_file] [options]\n", prog);
+    std::printf("  -i n,c,h,w    shape of the next graph input, repeat for each input\n");
+    std::printf("  -n count      warmup runs, default 10\n");
+    std::printf("  -r count      timed runs, default 100\n");
+    std::printf("  -p cpu_list   run on cpu_list, e.g. 0,1,2,3, repeat to sweep\n");
+    std::printf("  -t threads    sweep the thread counts, e.g. 1,2,4, on cpus 0..threads-1\n");
+    std::printf("  -d device     device to run the graph on\n");
+    std::printf("  -o file       write the results as json to file, - for stdout\n");
+    std::printf("  -M            print the memory of each node\n");
+}
+
+static std::vector<int> parse_int_list(const char* str)
+{
+    std::vector<int> list;
+    const char* p = str;
+
+    while(*p)
+    {
+        char* end;
+        long v = strtol(p, &end, 10);
+
+        if(end == p)
+            break;
+
+        list.push_back(v);
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    return list;
+}
+
+static std::string json_string(const std::string& str)
+{
+    std::string out;
+
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\')
+            out += '\\';
+
+        out += c;
+    }
+
+    return out;
+}
+
+static long get_current_rss(void)
+{
+    long pages = 0;
+    long resident = 0;
+    FILE* fp = fopen("/proc/self/statm", "r");
+
+    if(fp == nullptr)
+        return 0;
+
+    if(fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+
+    fclose(fp);
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static double percentile(const std::vector<unsigned long>& sorted, double p)
+{
+    int idx = ( int )std::ceil(p / 100 * sorted.size()) - 1;
+
+    idx = std::max(0, std::min(idx, ( int )sorted.size() - 1));
+
+    return sorted[idx];
+}
+
+static bool setup_inputs(graph_t graph, const BenchConfig& config, std::vector<std::vector<float>>& buffers)
+{
+    int input_num = get_graph_input_node_number(graph);
+
+    buffers.resize(input_num);
+
+    for(int i = 0; i < input_num; i++)
+    {
+        tensor_t tensor = get_graph_input_tensor(graph, i, 0);
+
+        if(tensor == nullptr)
+        {
+            std::fprintf(stderr, "cannot find graph input %d\n", i);
+            return false;
+        }
+
+        if(i < ( int )config.input_shapes.size())
+        {
+            std::vector<int> dims = config.input_shapes[i];
+
+            set_tensor_shape(tensor, dims.data(), dims.size());
+        }
+
+        int size = get_tensor_buffer_size(tensor);
+
+        if(size <= 0)
+        {
+            std::fprintf(stderr, "graph input %d has no shape, set it with -i\n", i);
+            release_graph_tensor(tensor);
+            return false;
+        }
+
+        std::vector<float>& buf = buffers[i];
+
+        buf.resize((size + sizeof(float) - 1) / sizeof(float));
+
+        for(unsigned int k = 0; k < buf.size(); k++)
+            buf[k] = (k % 255) / 255.f;
+
+        set_tensor_buffer(tensor, buf.data(), size);
+        release_graph_tensor(tensor);
+    }
+
+    return true;
+}
+
+static bool get_mem_stat(graph_t graph, std::vector<struct mem_stat>& stats)
+{
+    unsigned int entry_number = 256;
+
+    /* a full buffer may have missed some nodes */
+    do
+    {
+        entry_number *= 2;
+        stats.resize(entry_number);
+
+        if(get_graph_attr(graph, GRAPH_ATTR_MEM_STAT, stats.data(), entry_number * sizeof(struct mem_stat)) < 0)
+            return false;
+    } while(stats.back().name != nullptr);
+
+    while(!stats.empty() && stats.back().name == nullptr)
+        stats.pop_back();
+
+    return !stats.empty();
+}
+
+static void dump_node_mem(const std::vector<struct mem_stat>& stats)
+{
+    std::vector<struct mem_stat> nodes(stats.begin() + 1, stats.end());
+
+    std::sort(nodes.begin(), nodes.end(),
+              [](const struct mem_stat& a, const struct mem_stat& b) { return a.total_peak > b.total_peak; });
+
+    std::printf("    node memory KB, peak (current): %s", nodes.empty() ? "none\n" : "\n");
+
+    for(unsigned int i = 0; i < nodes.size(); i++)
+    {
+        const struct mem_stat& m = nodes[i];
+
+        std::printf("    %-32s", m.name);
+
+        for(int c = 0; c < MEM_STAT_NUM; c++)
+        {
+            if(m.peak[c])
+                std::printf(" %s %.1f (%.1f)", mem_category_name[c], m.peak[c] / 1024.0, m.current[c] / 1024.0);
+        }
+
+        std::printf("\n");
+    }
+
+    /* the child leaves with _exit() */
+    std::fflush(stdout);
+}
+
+/* runs in the child process: from init_tengine() to the last run */
+static void run_bench(const BenchConfig& config, const std::string& cpu_list, BenchResult& result)
+{
+    memset(&result, 0x0, sizeof(result));
+
+    if(!cpu_list.empty())
+    {
+        std::vector<char> str(cpu_list.begin(), cpu_list.end());
+
+        str.push_back(0);
+        set_cpu_list(str.data());
+    }
+
+    unsigned long start = get_cur_time();
+
+    if(init_tengine() < 0)
+        return;
+
+    result.init_time = get_cur_time() - start;
+
+    start = get_cur_time();
+
+    graph_t graph = create_graph(nullptr, config.format.c_str(), config.model_file.c_str(),
+                                 config.weight_file.empty() ? nullptr : config.weight_file.c_str());
+
+    if(graph == nullptr)
+    {
+        std::fprintf(stderr, "create graph failed, errno: %d\n", get_tengine_errno());
+        return;
+    }
+
+    result.load_time = get_cur_time() - start;
+
+    std::vector<std::vector<float>> buffers;
+
+    if(!setup_inputs(graph, config, buffers))
+        return;
+
+    if(!config.device.empty())
+        set_graph_device(graph, config.device.c_str());
+
+    start = get_cur_time();
+
+    if(prerun_graph(graph) < 0)
+    {
+        std::fprintf(stderr, "prerun failed\n");
+        return;
+    }
+
+    result.prerun_time = get_cur_time() - start;
+    result.prerun_rss = get_current_rss();
+
+    start = get_cur_time();
+
+    if(run_graph(graph, 1) < 0)
+    {
+        std::fprintf(stderr, "run failed\n");
+        return;
+    }
+
+    result.first_run_time = get_cur_time() - start;
+
+    for(int i = 0; i < config.warmup_count; i++)
+        run_graph(graph, 1);
+
+    std::vector<unsigned long> times(config.repeat_count);
+    unsigned long total = 0;
+
+    for(int i = 0; i < config.repeat_count; i++)
+    {
+        start = get_cur_time();
+        run_graph(graph, 1);
+        times[i] = get_cur_time() - start;
+        total += times[i];
+    }
+
+    std::sort(times.begin(), times.end());
+
+    int batch = 1;
+
+    if(!config.input_shapes.empty() && !config.input_shapes[0].empty())
+        batch = config.input_shapes[0][0];
+
+    result.mean = ( double )total / config.repeat_count;
+    result.min = times.front();
+    result.p50 = percentile(times, 50);
+    result.p90 = percentile(times, 90);
+    result.p99 = percentile(times, 99);
+    result.max = times.back();
+    result.throughput = total ? 1e6 * config.repeat_count * batch / total : 0;
+
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss = usage.ru_maxrss;
+
+    std::vector<struct mem_stat> mem_stats;
+
+    if(get_mem_stat(graph, mem_stats))
+    {
+        for(int c = 0; c < MEM_STAT_NUM; c++)
+        {
+            result.mem_current[c] = mem_stats[0].current[c];
+            result.mem_peak[c] = mem_stats[0].peak[c];
+        }
+
+        result.mem_total_peak = mem_stats[0].total_peak;
+
+        if(config.mem_dump)
+            dump_node_mem(mem_stats);
+    }
+
+    postrun_graph(graph);
+    destroy_graph(graph);
+    release_tengine();
+
+    result.ok = true;
+}
+
+static bool fork_bench(const BenchConfig& config, const std::string& cpu_list, BenchResult& result)
+{
+    int fd[2];
+
+    if(pipe(fd) < 0)
+        return false;
+
+    fflush(stdout);
+
+    pid_t pid = fork();
+
+    if(pid < 0)
+    {
+        close(fd[0]);
+        close(fd[1]);
+        return false;
+    }
+
+    if(pid == 0)
+    {
+        close(fd[0]);
+
+        BenchResult r;
+
+        run_bench(config, cpu_list, r);
+
+        if(write(fd[1], &r, sizeof(r)) != sizeof(r))
+            _exit(1);
+
+        close(fd[1]);
+        _exit(0);
+    }
+
+    close(fd[1]);
+
+    BenchResult r;
+    int n = read(fd[0], &r, sizeof(r));
+
+    close(fd[0]);
+    waitpid(pid, nullptr, 0);
+
+    if(n != sizeof(r))
+        return false;
+
+    result = r;
+
+    return result.ok;
+}
+
+static void print_result(const std::string& cpu_list, const BenchResult& r)
+{
+    std::printf("cpu [%s]: init %.2f ms, load %.2f ms, prerun %.2f ms, first run %.2f ms\n",
+                cpu_list.empty() ? "default" : cpu_list.c_str(), r.init_time / 1000.0, r.load_time / 1000.0,
+                r.prerun_time / 1000.0, r.first_run_time / 1000.0);
+    std::printf("    latency ms: mean %.3f min %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n", r.mean / 1000,
+                r.min / 1000, r.p50 / 1000, r.p90 / 1000, r.p99 / 1000, r.max / 1000);
+    std::printf("    throughput %.2f /s, rss after prerun %ld KB, peak rss %ld KB\n", r.throughput, r.prerun_rss,
+                r.peak_rss);
+    std::printf("    graph memory KB, peak (current):");
+
+    for(int c = 0; c < MEM_STAT_NUM; c++)
+        std::printf(" %s %.1f (%.1f)", mem_category_name[c], r.mem_peak[c] / 1024.0, r.mem_current[c] / 1024.0);
+
+    std::printf(", total %.1f\n", r.mem_total_peak / 1024.0);
+}
+
+static void write_json(FILE* fp, const BenchConfig& config, const std::vector<std::string>& cpu_lists,
+                       const std::vector<BenchResult>& results)
+{
+    std::fprintf(fp, "{\n");
+    std::fprintf(fp, "  \"version\": \"%s\",\n", get_tengine_version());
+    std::fprintf(fp, "  \"format\": \"%s\",\n", json_string(config.format).c_str());
+    std::fprintf(fp, "  \"model\": \"%s\",\n", json_string(config.model_file).c_str());
+    std::fprintf(fp, "  \"weight\": \"%s\",\n", json_string(config.weight_file).c_str());
+    std::fprintf(fp, "  \"device\": \"%s\",\n", json_string(config.device).c_str());
+    std::fprintf(fp, "  \"inputs\": [");
+
+    for(unsigned int i = 0; i < config.input_shapes.size(); i++)
+    {
+        std::fprintf(fp, "%s[", i ? ", " : "");
+
+        for(unsigned int k = 0; k < config.input_shapes[i].size(); k++)
+            std::fprintf(fp, "%s%d", k ? ", " : "", config.input_shapes[i][k]);
+
+        std::fprintf(fp, "]");
+    }
+
+    std::fprintf(fp, "],\n");
+    std::fprintf(fp, "  \"warmup\": %d,\n", config.warmup_count);
+    std::fprintf(fp, "  \"repeat\": %d,\n", config.repeat_count);
+    std::fprintf(fp, "  \"results\": [\n");
+
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        int threads = parse_int_list(cpu_lists[i].c_str()).size();
+
+        std::fprintf(fp, "    {\"cpu_list\": \"%s\", \"threads\": %d, \"ok\": %s", cpu_lists[i].c_str(), threads,
+                     r.ok ? "true" : "false");
+
+        if(r.ok)
+        {
+            std::fprintf(fp, ",\n     \"init_ms\": %.3f, \"load_ms\": %.3f, \"prerun_ms\": %.3f, \"first_run_ms\": %.3f,\n",
+                         r.init_time / 1000.0, r.load_time / 1000.0, r.prerun_time / 1000.0,
+                         r.first_run_time / 1000.0);
+            std::fprintf(fp,
+                         "     \"latency_ms\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+                         "\"p99\": %.4f, \"max\": %.4f},\n",
+                         r.mean / 1000, r.min / 1000, r.p50 / 1000, r.p90 / 1000, r.p99 / 1000, r.max / 1000);
+            std::fprintf(fp, "     \"throughput\": %.3f, \"prerun_rss_kb\": %ld, \"peak_rss_kb\": %ld,\n", r.throughput,
+                         r.prerun_rss, r.peak_rss);
+            std::fprintf(fp, "     \"memory_kb\": {");
+
+            for(int c = 0; c < MEM_STAT_NUM; c++)
+                std::fprintf(fp, "\"%s\": {\"current\": %.1f, \"peak\": %.1f}, ", mem_category_name[c],
+                             r.mem_current[c] / 1024.0, r.mem_peak[c] / 1024.0);
+
+            std::fprintf(fp, "\"total_peak\": %.1f}", r.mem_total_peak / 1024.0);
+        }
+
+        std::fprintf(fp, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(fp, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+    std::vector<std::string> cpu_lists;
+    std::string json_file;
+    int res;
+
+    config.warmup_count = 10;
+    config.repeat_count = 100;
+    config.mem_dump = false;
+
+    while((res = getopt(argc, argv, "f:m:w:i:n:r:p:t:d:o:Mh")) != -1)
+    {
+        switch(res)
+        {
+            case 'f':
+                config.format = optarg;
+                break;
+            case 'm':
+                config.model_file = optarg;
+                break;
+            case 'w':
+                config.weight_file = optarg;
+                break;
+            case 'i':
+                config.input_shapes.push_back(parse_int_list(optarg));
+                break;
+            case 'n':
+                config.warmup_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                config.repeat_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                cpu_lists.push_back(optarg);
+                break;
+            case 't':
+                for(int threads : parse_int_list(optarg))
+                {
+                    std::string list;
+
+                    for(int c = 0; c < threads; c++)
+                        list += (c ? "," : "") + std::to_string(c);
+
+                    cpu_lists.push_back(list);
+                }
+                break;
+            case 'd':
+                config.device = optarg;
+                break;
+            case 'o':
+                json_file = optarg;
+                break;
+            case 'M':
+                config.mem_dump = true;
+                break;
+            default:
+                show_usage(argv[0]);
+                return res == 'h' ? 0 : -1;
+        }
+    }
+
+    if(config.format.empty() || config.model_file.empty() || config.repeat_count <= 0)
+    {
+        show_usage(argv[0]);
+        return -1;
+    }
+
+    /* the default cpus, or TENGINE_CPU_LIST */
+    if(cpu_lists.empty())
+        cpu_lists.push_back("");
+
+    std::vector<BenchResult> results;
+    int fail = 0;
+
+    for(unsigned int i = 0; i < cpu_lists.size(); i++)
+    {
+        BenchResult r;
+
+        if(!fork_bench(config, cpu_lists[i], r))
+        {
+            std::printf("cpu [%s]: benchmark failed\n", cpu_lists[i].c_str());
+            r.ok = false;
+            fail++;
+        }
+        else
+        {
+            print_result(cpu_lists[i], r);
+        }
+
+        results.push_back(r);
+    }
+
+    if(!json_file.empty())
+    {
+        FILE* fp = (json_file == "-") ? stdout : fopen(json_file.c_str(), "w");
+
+        if(fp == nullptr)
+        {
+            std::fprintf(stderr, "cannot open %s\n", json_file.c_str());
+            return -1;
+        }
+
+        write_json(fp, config, cpu_lists, results);
+
+        if(fp != stdout)
+            fclose(fp);
+    }
+
+    return fail ? -1 : 0;
+}
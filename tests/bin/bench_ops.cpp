@@ -0,0 +1,505 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+
+/*
+ * Operator micro-benchmarks, on single nodes built with tengine_test_api.
+ *
+ * Each case is a representative shape (MobileNet, ResNet, YOLO ...) and
+ * runs on every implementation registered for its op: each registry, and
+ * in it each priority, that takes the node. The rates are rough: the flops
+ * count multiply and add as two, and the bytes are the input, weight and
+ * output tensors read or written once.
+ *
+ *   bench_ops [-r repeat] [-k case_filter] [-p cpu_list] [-o result.json]
+ *
+ * -k keeps the cases whose name or op contains the filter, -o - writes the
+ * json to stdout.
+ */
+#include <unistd.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "tengine_c_api.h"
+#include "tengine_test_api.h"
+#include "common_util.hpp"
+
+using namespace TEngine;
+
+struct OpCase
+{
+    std::string name;
+    std::string op;
+
+    /* set the params and add the inputs of a new node */
+    std::function<void(test_node_t node, OpCase& c)> setup;
+
+    std::vector<std::vector<float>> buffers;
+    double flops;
+};
+
+struct OpResult
+{
+    std::string case_name;
+    std::string registry;
+    int priority;
+    std::string impl;
+    double time;    // ms, median
+    double gflops;
+    double gbps;
+};
+
+static void add_input(test_node_t node, OpCase& c, std::vector<int> dims)
+{
+    long size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    c.buffers.emplace_back(size);
+
+    std::vector<float>& buf = c.buffers.back();
+
+    for(long i = 0; i < size; i++)
+        buf[i] = ((i * 7) % 17 - 8) / 16.f;
+
+    test_node_add_input(node, buf.data(), dims.data(), dims.size());
+}
+
+static OpCase conv_case(const char* name, int c, int h, int w, int oc, int k, int s, int p, int g = 1)
+{
+    OpCase oc_case;
+    int oh = (h + 2 * p - k) / s + 1;
+    int ow = (w + 2 * p - k) / s + 1;
+
+    oc_case.name = name;
+    oc_case.op = "Convolution";
+    oc_case.flops = 2.0 * oc * oh * ow * (c / g) * k * k;
+    oc_case.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_int(node, "kernel_h", k);
+        test_node_set_param_int(node, "kernel_w", k);
+        test_node_set_param_int(node, "stride_h", s);
+        test_node_set_param_int(node, "stride_w", s);
+        test_node_set_param_int(node, "pad_h", p);
+        test_node_set_param_int(node, "pad_w", p);
+        test_node_set_param_int(node, "output_channel", oc);
+        test_node_set_param_int(node, "group", g);
+
+        add_input(node, cs, {1, c, h, w});
+        add_input(node, cs, {oc, c / g, k, k});
+        add_input(node, cs, {oc});
+    };
+
+    return oc_case;
+}
+
+static OpCase fc_case(const char* name, int batch, int hidden, int output)
+{
+    OpCase c;
+
+    c.name = name;
+    c.op = "FullyConnected";
+    c.flops = 2.0 * batch * hidden * output;
+    c.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_int(node, "num_output", output);
+
+        add_input(node, cs, {batch, hidden});
+        add_input(node, cs, {output, hidden});
+        add_input(node, cs, {output});
+    };
+
+    return c;
+}
+
+static OpCase pool_case(const char* name, int alg, int c, int h, int w, int k, int s, int p, int global)
+{
+    OpCase pc;
+    int oh = global ? 1 : (h + 2 * p - k) / s + 1;
+    int ow = global ? 1 : (w + 2 * p - k) / s + 1;
+
+    pc.name = name;
+    pc.op = "Pooling";
+    pc.flops = global ? ( double )c * h * w : ( double )c * oh * ow * k * k;
+    pc.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_int(node, "alg", alg);
+        test_node_set_param_int(node, "kernel_h", k);
+        test_node_set_param_int(node, "kernel_w", k);
+        test_node_set_param_int(node, "stride_h", s);
+        test_node_set_param_int(node, "stride_w", s);
+        test_node_set_param_int(node, "pad_h", p);
+        test_node_set_param_int(node, "pad_w", p);
+        test_node_set_param_int(node, "global", global);
+
+        add_input(node, cs, {1, c, h, w});
+    };
+
+    return pc;
+}
+
+static OpCase eltwise_case(const char* name, std::vector<int> dims0, std::vector<int> dims1)
+{
+    OpCase c;
+    double size = 1;
+
+    for(int d : dims0)
+        size *= d;
+
+    c.name = name;
+    c.op = "Eltwise";
+    c.flops = size;
+    c.setup = [=](test_node_t node, OpCase& cs) {
+        add_input(node, cs, dims0);
+        add_input(node, cs, dims1);
+    };
+
+    return c;
+}
+
+static OpCase softmax_case(const char* name, std::vector<int> dims, int axis)
+{
+    OpCase c;
+    double size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    /* max, exp, sum and scale */
+    c.name = name;
+    c.op = "Softmax";
+    c.flops = 4 * size;
+    c.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_int(node, "axis", axis);
+
+        add_input(node, cs, dims);
+    };
+
+    return c;
+}
+
+static OpCase resize_case(const char* name, int c, int h, int w, float scale)
+{
+    OpCase rc;
+
+    rc.name = name;
+    rc.op = "Resize";
+    rc.flops = 0;
+    rc.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_float(node, "scale_h", scale);
+        test_node_set_param_float(node, "scale_w", scale);
+
+        add_input(node, cs, {1, c, h, w});
+    };
+
+    return rc;
+}
+
+static OpCase lstm_case(const char* name, int seq, int batch, int input, int hidden)
+{
+    OpCase c;
+
+    c.name = name;
+    c.op = "LSTM";
+    c.flops = 2.0 * seq * batch * (input + hidden) * 4 * hidden;
+    c.setup = [=](test_node_t node, OpCase& cs) {
+        test_node_set_param_int(node, "sequence_len", seq);
+        test_node_set_param_int(node, "input_size", input);
+        test_node_set_param_int(node, "hidden_size", hidden);
+        test_node_set_param_int(node, "cell_size", hidden);
+        test_node_set_param_int(node, "output_len", seq);
+
+        add_input(node, cs, {seq, batch, input});
+        add_input(node, cs, {input + hidden, 4 * hidden});
+    };
+
+    return c;
+}
+
+static std::vector<OpCase> get_cases(void)
+{
+    return {
+        /* MobileNet */
+        conv_case("mobilenet_conv1", 3, 224, 224, 32, 3, 2, 1),
+        conv_case("mobilenet_pw_112", 32, 112, 112, 64, 1, 1, 0),
+        conv_case("mobilenet_pw_14", 512, 14, 14, 512, 1, 1, 0),
+        conv_case("mobilenet_pw_7", 1024, 7, 7, 1024, 1, 1, 0),
+        conv_case("mobilenet_dw_112", 32, 112, 112, 32, 3, 1, 1, 32),
+        conv_case("mobilenet_dw_112_s2", 64, 112, 112, 64, 3, 2, 1, 64),
+        conv_case("mobilenet_dw_14", 512, 14, 14, 512, 3, 1, 1, 512),
+        conv_case("mobilenet_dw_7", 1024, 7, 7, 1024, 3, 1, 1, 1024),
+        conv_case("mnasnet_dw5_28", 240, 28, 28, 240, 5, 1, 2, 240),
+        /* ResNet */
+        conv_case("resnet_conv1", 3, 224, 224, 64, 7, 2, 3),
+        conv_case("resnet_3x3_56", 64, 56, 56, 64, 3, 1, 1),
+        conv_case("resnet_1x1_56", 256, 56, 56, 64, 1, 1, 0),
+        conv_case("resnet_3x3_s2_56", 128, 56, 56, 128, 3, 2, 1),
+        conv_case("resnet_1x1_s2_56", 256, 56, 56, 512, 1, 2, 0),
+        conv_case("resnet_3x3_7", 512, 7, 7, 512, 3, 1, 1),
+        /* YOLO */
+        conv_case("yolo_3x3_416", 3, 416, 416, 16, 3, 1, 1),
+        conv_case("yolo_3x3_26", 256, 26, 26, 512, 3, 1, 1),
+        conv_case("yolo_1x1_13", 1024, 13, 13, 125, 1, 1, 0),
+        /* FC */
+        fc_case("fc_mobilenet", 1, 1024, 1000),
+        fc_case("fc_resnet", 1, 2048, 1000),
+        fc_case("fc_vgg6", 1, 25088, 4096),
+        fc_case("fc_4096_b8", 8, 4096, 4096),
+        /* pooling */
+        pool_case("maxpool_k3s2_112", 0, 64, 112, 112, 3, 2, 0, 0),
+        pool_case("maxpool_k2s2_416", 0, 16, 416, 416, 2, 2, 0, 0),
+        pool_case("avgpool_global_7", 1, 1024, 7, 7, 7, 1, 0, 1),
+        pool_case("avgpool_k3s1_28", 1, 256, 28, 28, 3, 1, 1, 0),
+        /* eltwise */
+        eltwise_case("eltwise_sum_56", {1, 256, 56, 56}, {1, 256, 56, 56}),
+        eltwise_case("eltwise_sum_chan_56", {1, 256, 56, 56}, {256}),
+        /* softmax */
+        softmax_case("softmax_1000", {1, 1000}, 1),
+        softmax_case("softmax_ssd", {1, 1917, 21}, 2),
+        /* resize */
+        resize_case("resize_2x_13", 256, 13, 13, 2.f),
+        resize_case("resize_2x_56", 128, 56, 56, 2.f),
+        /* LSTM */
+        lstm_case("lstm_s16_256", 16, 1, 256, 256),
+        lstm_case("lstm_s1_b8_512", 1, 8, 512, 512),
+    };
+}
+
+static long tensor_bytes(const std::vector<int>& dims)
+{
+    long size = sizeof(float);
+
+    for(int d : dims)
+        size *= d;
+
+    return size;
+}
+
+/* build, prerun and time the case on one implementation; false if it cannot run the node */
+static bool run_case(OpCase& c, const char* registry, int priority, int repeat, OpResult& result)
+{
+    test_node_t node = create_test_node(c.op.c_str());
+
+    if(node == nullptr)
+        return false;
+
+    c.buffers.clear();
+    c.setup(node, c);
+
+    long bytes = 0;
+
+    for(auto& buf : c.buffers)
+        bytes += buf.size() * sizeof(float);
+
+    std::vector<std::vector<float>> outputs;
+
+    for(int i = 0;; i++)
+    {
+        int dims[8];
+        int dim_number = test_node_infer_output_shape(node, i, dims, 8);
+
+        if(dim_number < 0)
+            break;
+
+        std::vector<int> out_dims(dims, dims + dim_number);
+
+        outputs.emplace_back(tensor_bytes(out_dims) / sizeof(float));
+        test_node_add_output(node, outputs.back().data(), dims, dim_number);
+        bytes += tensor_bytes(out_dims);
+    }
+
+    if(registry)
+        test_node_set_ops(node, registry, priority);
+
+    if(outputs.empty() || test_node_prerun(node) < 0)
+    {
+        destroy_test_node(node);
+        return false;
+    }
+
+    /* some implementations take the node but not its layout or type */
+    if(test_node_run(node) < 0)
+    {
+        test_node_postrun(node);
+        destroy_test_node(node);
+        return false;
+    }
+
+    const char* impl = test_node_get_ops_name(node);
+
+    result.case_name = c.name;
+    result.registry = registry ? registry : "default";
+    result.priority = priority;
+    result.impl = impl ? impl : "";
+
+    std::vector<double> times(repeat);
+
+    for(int i = 0; i < repeat; i++)
+    {
+        unsigned long start = get_cur_time();
+        test_node_run(node);
+        times[i] = (get_cur_time() - start) / 1000.0;
+    }
+
+    std::sort(times.begin(), times.end());
+
+    result.time = times[repeat / 2];
+    result.gflops = c.flops / result.time / 1e6;
+    result.gbps = bytes / result.time / 1e6;
+
+    test_node_postrun(node);
+    destroy_test_node(node);
+
+    return true;
+}
+
+static void write_json(FILE* fp, const std::vector<OpResult>& results)
+{
+    std::fprintf(fp, "[\n");
+
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        const OpResult& r = results[i];
+
+        std::fprintf(fp,
+                     "  {\"case\": \"%s\", \"registry\": \"%s\", \"priority\": %d, \"impl\": \"%s\", "
+                     "\"time_ms\": %.4f, \"gflops\": %.3f, \"gbps\": %.3f}%s\n",
+                     r.case_name.c_str(), r.registry.c_str(), r.priority, r.impl.c_str(), r.time, r.gflops, r.gbps,
+                     i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(fp, "]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int repeat = 20;
+    std::string filter;
+    std::string json_file;
+    char* cpu_list_str = nullptr;
+    int res;
+
+    while((res = getopt(argc, argv, "r:k:p:o:")) != -1)
+    {
+        switch(res)
+        {
+            case 'r':
+                repeat = strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                filter = optarg;
+                break;
+            case 'p':
+                cpu_list_str = optarg;
+                break;
+            case 'o':
+                json_file = optarg;
+                break;
+            default:
+                std::printf("usage: %s [-r repeat] [-k case_filter] [-p cpu_list] [-o result.json]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if(repeat <= 0)
+        repeat = 1;
+
+    if(cpu_list_str)
+        set_cpu_list(cpu_list_str);
+
+    init_tengine();
+
+    const char* registry_names[16];
+    int registry_number = test_get_registry_names(registry_names, 16);
+
+    std::vector<OpCase> cases = get_cases();
+    std::vector<OpResult> results;
+
+    std::printf("%-22s %-8s %5s %10s %9s %9s  %s\n", "case", "registry", "prio", "time(ms)", "GFLOPS", "GB/s",
+                "implementation");
+
+    for(auto& c : cases)
+    {
+        if(!filter.empty() && c.name.find(filter) == std::string::npos && c.op.find(filter) == std::string::npos)
+            continue;
+
+        /* the default choice first, then every implementation */
+        std::vector<std::pair<const char*, int>> impls;
+
+        impls.emplace_back(nullptr, -1);
+
+        for(int i = 0; i < registry_number; i++)
+        {
+            int priority[32];
+            int number = test_get_ops_priority(registry_names[i], c.op.c_str(), priority, 32);
+
+            for(int k = 0; k < number; k++)
+                impls.emplace_back(registry_names[i], priority[k]);
+        }
+
+        bool done = false;
+
+        for(auto& impl : impls)
+        {
+            OpResult r;
+
+            if(!run_case(c, impl.first, impl.second, repeat, r))
+                continue;
+
+            done = true;
+
+            std::printf("%-22s %-8s %5d %10.3f %9.2f %9.2f  %s\n", r.case_name.c_str(), r.registry.c_str(),
+                        r.priority, r.time, r.gflops, r.gbps, r.impl.c_str());
+
+            results.push_back(r);
+        }
+
+        if(!done)
+            std::printf("%-22s no implementation of %s\n", c.name.c_str(), c.op.c_str());
+    }
+
+    if(json_file == "-")
+        write_json(stdout, results);
+    else if(!json_file.empty())
+    {
+        FILE* fp = fopen(json_file.c_str(), "w");
+
+        if(fp == nullptr)
+        {
+            std::fprintf(stderr, "cannot open %s\n", json_file.c_str());
+            return -1;
+        }
+
+        write_json(fp, results);
+        fclose(fp);
+    }
+
+    release_tengine();
+
+    return 0;
+}
@@ -0,0 +1,1005 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+
+/*
+ * Differential test of the operator implementations, on single nodes built
+ * with tengine_test_api.
+ *
+ * Each case is a node of random shape and random data, from the seed. It
+ * runs on every implementation registered for its op: each registry, and
+ * in it each priority, that takes the node. The inputs and outputs of a run
+ * are taken by the node dump of the implementation; the outputs are checked
+ * against the first implementation which ran, and the inputs against the
+ * data given, to catch a kernel writing its inputs. The "reference" registry
+ * runs first, then "common", then the others, and in a registry the last
+ * priority of the search order first: the baseline is the most generic
+ * implementation taking the node. A case with a host reference, for the ops
+ * with a single implementation in some builds, is checked against it
+ * instead. An implementation taking the node but failing to run it fails.
+ * The error is the max abs difference over the max abs value of the baseline
+ * output (at least 1); the speedup is the time of the first implementation
+ * over the time, both medians.
+ *
+ *   diff_ops [-s seed] [-n case_number] [-k op_filter] [-t tolerance]
+ *            [-r repeat] [-p cpu_list] [-o result.json]
+ *
+ * Returns 1 if an implementation differs beyond the tolerance.
+ */
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+#include "tengine_c_api.h"
+#include "tengine_test_api.h"
+#include "node_ops.hpp"
+#include "common_util.hpp"
+
+using namespace TEngine;
+
+struct DiffCase
+{
+    std::string name;
+    std::string op;
+
+    /* set the params of a new node */
+    std::function<void(test_node_t node)> set_param;
+
+    int layout = TENGINE_LAYOUT_NCHW;
+
+    std::vector<std::vector<int>> input_dims;
+    std::vector<std::vector<float>> inputs;
+
+    /* if set, the expected outputs from the inputs, of the dims inferred */
+    std::function<void(const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                       std::vector<std::vector<float>>& outputs)>
+        reference;
+};
+
+struct DiffResult
+{
+    std::string case_name;
+    std::string registry;
+    int priority;
+    std::string impl;
+    double time;    // ms, median
+    double speedup;
+    double error;
+    bool input_changed;
+    bool run_failed;
+    bool pass;
+};
+
+enum RunStatus
+{
+    RUN_SKIPPED,    // the implementation does not take the node
+    RUN_FAILED,
+    RUN_DONE
+};
+
+/* what a run on one implementation leaves */
+struct ImplRun
+{
+    std::string impl;
+    double time;
+    bool input_changed;
+    std::vector<std::vector<float>> outputs;
+};
+
+static std::mt19937 rand_gen;
+
+static int rand_int(int low, int high)
+{
+    return std::uniform_int_distribution<int>(low, high)(rand_gen);
+}
+
+static std::string dims_str(const std::vector<int>& dims)
+{
+    std::string s;
+
+    for(unsigned int i = 0; i < dims.size(); i++)
+        s += (i ? "x" : "") + std::to_string(dims[i]);
+
+    return s;
+}
+
+static void add_input(DiffCase& c, std::vector<int> dims)
+{
+    long size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    std::vector<float> data(size);
+
+    for(long i = 0; i < size; i++)
+        data[i] = dist(rand_gen);
+
+    c.input_dims.push_back(dims);
+    c.inputs.push_back(data);
+}
+
+static inline float ref_sigmoid(float x)
+{
+    return 1.f / (1.f + std::exp(-x));
+}
+
+/* the begin pad of Convolution::InferShape: pad_h/pad_w, or SAME_UPPER (-1) and SAME_LOWER (-2) */
+static int conv_begin_pad(int input, int kernel, int stride, int pad)
+{
+    if(pad >= 0)
+        return pad;
+
+    int n = (input - 1) / stride + 1;
+    int pad_num = (n - 1) * stride + kernel - input;
+
+    return pad == -1 ? pad_num / 2 : pad_num - pad_num / 2;
+}
+
+static std::string pad_str(int pad)
+{
+    return pad == -1 ? "U" : (pad == -2 ? "L" : std::to_string(pad));
+}
+
+/*
+ * NCHW: weight [oc][c / g][k][k]; NHWC: weight [oc][k][k][c], or [k][k][c]
+ * for depthwise, as the NHWC implementations read it
+ */
+static void conv_reference(int layout, int c, int h, int w, int k, int s, int d, int p, int g,
+                           const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                           std::vector<std::vector<float>>& outputs)
+{
+    bool nhwc = layout == TENGINE_LAYOUT_NHWC;
+    const std::vector<int>& dims = output_dims[0];
+    int oc = nhwc ? dims[3] : dims[1];
+    int oh = nhwc ? dims[1] : dims[2];
+    int ow = nhwc ? dims[2] : dims[3];
+    int pad_h = conv_begin_pad(h, k, s, p);
+    int pad_w = conv_begin_pad(w, k, s, p);
+    int group_c = c / g;
+    int group_oc = oc / g;
+
+    const float* input = inputs[0].data();
+    const float* weight = inputs[1].data();
+    const float* bias = inputs[2].data();
+
+    outputs.assign(1, std::vector<float>(oc * oh * ow));
+
+    for(int o = 0; o < oc; o++)
+    {
+        int c0 = (o / group_oc) * group_c;
+
+        for(int y = 0; y < oh; y++)
+        {
+            for(int x = 0; x < ow; x++)
+            {
+                float sum = bias[o];
+
+                for(int i = 0; i < group_c; i++)
+                {
+                    for(int ky = 0; ky < k; ky++)
+                    {
+                        int iy = y * s - pad_h + ky * d;
+
+                        if(iy < 0 || iy >= h)
+                            continue;
+
+                        for(int kx = 0; kx < k; kx++)
+                        {
+                            int ix = x * s - pad_w + kx * d;
+
+                            if(ix < 0 || ix >= w)
+                                continue;
+
+                            if(!nhwc)
+                                sum += input[((c0 + i) * h + iy) * w + ix] * weight[((o * group_c + i) * k + ky) * k + kx];
+                            else if(g == 1)
+                                sum += input[(iy * w + ix) * c + i] * weight[((o * k + ky) * k + kx) * c + i];
+                            else
+                                sum += input[(iy * w + ix) * c + c0] * weight[(ky * k + kx) * c + o];
+                        }
+                    }
+                }
+
+                outputs[0][nhwc ? (y * ow + x) * oc + o : (o * oh + y) * ow + x] = sum;
+            }
+        }
+    }
+}
+
+static DiffCase conv_case(int layout)
+{
+    static const int kernel[4] = {1, 3, 5, 7};
+
+    bool nhwc = layout == TENGINE_LAYOUT_NHWC;
+    int k = kernel[rand_int(0, 3)];
+    int s = rand_int(1, 2);
+    int d = (k > 1 && rand_int(0, 3) == 0) ? 2 : 1;
+    int p = rand_int(0, k / 2);
+    int c = rand_int(1, 48);
+    int oc = rand_int(1, 64);
+    int g = 1;
+
+    /* SAME_UPPER or SAME_LOWER one time out of three, when its pads are not negative */
+    if(k >= s && rand_int(0, 2) == 0)
+        p = -rand_int(1, 2);
+
+    int extent = d * (k - 1) + 1;
+    int h = rand_int(extent, 40);
+    int w = rand_int(extent, 40);
+
+    /* depthwise one time out of three */
+    if(rand_int(0, 2) == 0)
+    {
+        oc = c;
+        g = c;
+    }
+
+    DiffCase dc;
+
+    dc.op = "Convolution";
+    dc.layout = layout;
+    dc.name = std::string(nhwc ? "conv_nhwc_k" : "conv_k") + std::to_string(k) + "s" + std::to_string(s) + "d" +
+              std::to_string(d) + "p" + pad_str(p) + "g" + std::to_string(g) + "_" +
+              dims_str(nhwc ? std::vector<int>{1, h, w, c} : std::vector<int>{1, c, h, w}) + "_" + std::to_string(oc);
+    dc.set_param = [=](test_node_t node) {
+        test_node_set_param_int(node, "kernel_h", k);
+        test_node_set_param_int(node, "kernel_w", k);
+        test_node_set_param_int(node, "stride_h", s);
+        test_node_set_param_int(node, "stride_w", s);
+        test_node_set_param_int(node, "pad_h", p);
+        test_node_set_param_int(node, "pad_w", p);
+        test_node_set_param_int(node, "dilation_h", d);
+        test_node_set_param_int(node, "dilation_w", d);
+        test_node_set_param_int(node, "output_channel", oc);
+        test_node_set_param_int(node, "group", g);
+    };
+    dc.reference = [=](const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                       std::vector<std::vector<float>>& outputs) {
+        conv_reference(layout, c, h, w, k, s, d, p, g, inputs, output_dims, outputs);
+    };
+
+    if(nhwc)
+    {
+        add_input(dc, {1, h, w, c});
+        add_input(dc, {oc, k, k, c / g});
+    }
+    else
+    {
+        add_input(dc, {1, c, h, w});
+        add_input(dc, {oc, c / g, k, k});
+    }
+
+    add_input(dc, {oc});
+
+    return dc;
+}
+
+/* weight [ic][oc][k][k], bias [oc] */
+static DiffCase deconv_case(void)
+{
+    int k = rand_int(1, 5);
+    int s = rand_int(1, 3);
+    int d = (k > 1 && rand_int(0, 3) == 0) ? 2 : 1;
+    int p = rand_int(0, (d * (k - 1)) / 2);
+    int c = rand_int(1, 32);
+    int h = rand_int(1, 20);
+    int w = rand_int(1, 20);
+    int oc = rand_int(1, 32);
+
+    DiffCase dc;
+
+    dc.op = "Deconvolution";
+    dc.name = "deconv_k" + std::to_string(k) + "s" + std::to_string(s) + "d" + std::to_string(d) + "p" +
+              std::to_string(p) + "_" + dims_str({1, c, h, w}) + "_" + std::to_string(oc);
+    dc.set_param = [=](test_node_t node) {
+        test_node_set_param_int(node, "kernel_size", k);
+        test_node_set_param_int(node, "stride", s);
+        test_node_set_param_int(node, "pad", p);
+        test_node_set_param_int(node, "dilation", d);
+        test_node_set_param_int(node, "num_output", oc);
+    };
+    dc.reference = [=](const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                       std::vector<std::vector<float>>& outputs) {
+        int oh = output_dims[0][2];
+        int ow = output_dims[0][3];
+        const float* input = inputs[0].data();
+        const float* weight = inputs[1].data();
+        const float* bias = inputs[2].data();
+
+        outputs.assign(1, std::vector<float>(oc * oh * ow));
+
+        float* output = outputs[0].data();
+
+        for(int o = 0; o < oc; o++)
+        {
+            for(int i = 0; i < oh * ow; i++)
+                output[o * oh * ow + i] = bias[o];
+        }
+
+        for(int i = 0; i < c; i++)
+            for(int y = 0; y < h; y++)
+                for(int x = 0; x < w; x++)
+                    for(int o = 0; o < oc; o++)
+                        for(int ky = 0; ky < k; ky++)
+                        {
+                            int oy = y * s - p + ky * d;
+
+                            if(oy < 0 || oy >= oh)
+                                continue;
+
+                            for(int kx = 0; kx < k; kx++)
+                            {
+                                int ox = x * s - p + kx * d;
+
+                                if(ox >= 0 && ox < ow)
+                                    output[(o * oh + oy) * ow + ox] += input[(i * h + y) * w + x] *
+                                                                        weight[((i * oc + o) * k + ky) * k + kx];
+                            }
+                        }
+    };
+
+    add_input(dc, {1, c, h, w});
+    add_input(dc, {c, oc, k, k});
+    add_input(dc, {oc});
+
+    return dc;
+}
+
+/* the NHWC implementations do not take caffe_flavor: the average is over the window in the input */
+static DiffCase pool_case(int layout)
+{
+    bool nhwc = layout == TENGINE_LAYOUT_NHWC;
+    int alg = rand_int(0, 1);
+    int global = rand_int(0, 3) == 0;
+    int k = rand_int(2, 3);
+    int s = rand_int(1, 2);
+    int p = k == 3 ? rand_int(0, 1) : 0;
+    int caffe = nhwc ? 0 : rand_int(0, 1);
+    int c = rand_int(1, 64);
+    int h = rand_int(k, 40);
+    int w = rand_int(k, 40);
+
+    if(global)
+    {
+        p = 0;
+        caffe = 0;
+    }
+
+    int kh = global ? h : k;
+    int kw = global ? w : k;
+
+    DiffCase pc;
+
+    pc.op = "Pooling";
+    pc.layout = layout;
+    pc.name = std::string(alg ? "avgpool" : "maxpool") + (nhwc ? "_nhwc" : "") +
+              (global ? std::string("_global") :
+                        "_k" + std::to_string(k) + "s" + std::to_string(s) + "p" + std::to_string(p)) +
+              (caffe ? "_caffe" : "") + "_" +
+              dims_str(nhwc ? std::vector<int>{1, h, w, c} : std::vector<int>{1, c, h, w});
+    pc.set_param = [=](test_node_t node) {
+        test_node_set_param_int(node, "alg", alg);
+        test_node_set_param_int(node, "kernel_h", kh);
+        test_node_set_param_int(node, "kernel_w", kw);
+        test_node_set_param_int(node, "stride_h", s);
+        test_node_set_param_int(node, "stride_w", s);
+        test_node_set_param_int(node, "pad_h", p);
+        test_node_set_param_int(node, "pad_w", p);
+        test_node_set_param_int(node, "global", global);
+        test_node_set_param_int(node, "caffe_flavor", caffe);
+    };
+    pc.reference = [=](const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                       std::vector<std::vector<float>>& outputs) {
+        const std::vector<int>& dims = output_dims[0];
+        int oh = nhwc ? dims[1] : dims[2];
+        int ow = nhwc ? dims[2] : dims[3];
+        const float* input = inputs[0].data();
+
+        outputs.assign(1, std::vector<float>(c * oh * ow));
+
+        for(int ch = 0; ch < c; ch++)
+            for(int y = 0; y < oh; y++)
+                for(int x = 0; x < ow; x++)
+                {
+                    int h0 = y * s - p;
+                    int w0 = x * s - p;
+                    int h1 = std::min(h0 + kh, h + p);
+                    int w1 = std::min(w0 + kw, w + p);
+                    int pool_size = (h1 - h0) * (w1 - w0);
+
+                    h0 = std::max(h0, 0);
+                    w0 = std::max(w0, 0);
+                    h1 = std::min(h1, h);
+                    w1 = std::min(w1, w);
+
+                    if(!caffe)
+                        pool_size = (h1 - h0) * (w1 - w0);
+
+                    float v = alg ? 0.f : -INFINITY;
+
+                    for(int i = h0; i < h1; i++)
+                        for(int j = w0; j < w1; j++)
+                        {
+                            float in = input[nhwc ? (i * w + j) * c + ch : (ch * h + i) * w + j];
+
+                            v = alg ? v + in : std::max(v, in);
+                        }
+
+                    if(alg)
+                        v /= pool_size;
+
+                    outputs[0][nhwc ? (y * ow + x) * c + ch : (ch * oh + y) * ow + x] = v;
+                }
+    };
+
+    add_input(pc, nhwc ? std::vector<int>{1, h, w, c} : std::vector<int>{1, c, h, w});
+
+    return pc;
+}
+
+static DiffCase eltwise_case(void)
+{
+    int c = rand_int(1, 128);
+    int h = rand_int(1, 56);
+    int w = rand_int(1, 56);
+    bool per_channel = rand_int(0, 1);
+
+    /* a {c} input is broadcast along the width when it matches it */
+    if(per_channel && w == c && c > 1)
+        w = c - 1;
+
+    DiffCase ec;
+
+    ec.op = "Eltwise";
+    ec.name = std::string("eltwise_sum") + (per_channel ? "_chan_" : "_") + dims_str({1, c, h, w});
+    ec.set_param = [](test_node_t) {};
+
+    add_input(ec, {1, c, h, w});
+
+    if(per_channel)
+        add_input(ec, {c});
+    else
+        add_input(ec, {1, c, h, w});
+
+    return ec;
+}
+
+static DiffCase softmax_case(void)
+{
+    std::vector<int> dims;
+    int axis;
+
+    if(rand_int(0, 1))
+    {
+        dims = {1, rand_int(1, 2000)};
+        axis = 1;
+    }
+    else
+    {
+        dims = {1, rand_int(1, 2000), rand_int(1, 32)};
+        axis = 2;
+    }
+
+    DiffCase c;
+
+    c.op = "Softmax";
+    c.name = "softmax_axis" + std::to_string(axis) + "_" + dims_str(dims);
+    c.set_param = [=](test_node_t node) { test_node_set_param_int(node, "axis", axis); };
+
+    add_input(c, dims);
+
+    return c;
+}
+
+/*
+ * input [seq][batch][input_size], kernel [input_size + hidden][4 * hidden]
+ * of the gates i, c, f, o; no bias, peephole nor projection
+ */
+static DiffCase lstm_case(void)
+{
+    int seq = rand_int(1, 8);
+    int batch = rand_int(1, 4);
+    int input_size = rand_int(1, 64);
+    int hidden = rand_int(1, 64);
+    int output_len = rand_int(1, seq);
+    float forget_bias = rand_int(0, 1);
+
+    DiffCase lc;
+
+    lc.op = "LSTM";
+    lc.name = "lstm_" + dims_str({seq, batch, input_size}) + "_" + std::to_string(hidden) + "_out" +
+              std::to_string(output_len);
+    lc.set_param = [=](test_node_t node) {
+        test_node_set_param_int(node, "input_size", input_size);
+        test_node_set_param_int(node, "hidden_size", hidden);
+        test_node_set_param_int(node, "cell_size", hidden);
+        test_node_set_param_int(node, "sequence_len", seq);
+        test_node_set_param_int(node, "output_len", output_len);
+        test_node_set_param_float(node, "forget_bias", forget_bias);
+    };
+    lc.reference = [=](const std::vector<std::vector<float>>& inputs, const std::vector<std::vector<int>>& output_dims,
+                       std::vector<std::vector<float>>& outputs) {
+        const float* input = inputs[0].data();
+        const float* kernel = inputs[1].data();
+        int gate_size = 4 * hidden;
+
+        std::vector<float> h(batch * hidden, 0.f);
+        std::vector<float> c(batch * hidden, 0.f);
+        std::vector<float> gates(gate_size);
+
+        outputs.assign(1, std::vector<float>());
+
+        for(int t = 0; t < seq; t++)
+        {
+            for(int b = 0; b < batch; b++)
+            {
+                const float* x = input + (t * batch + b) * input_size;
+                float* hb = h.data() + b * hidden;
+                float* cb = c.data() + b * hidden;
+
+                for(int j = 0; j < gate_size; j++)
+                {
+                    float sum = 0;
+
+                    for(int i = 0; i < input_size; i++)
+                        sum += x[i] * kernel[i * gate_size + j];
+
+                    for(int i = 0; i < hidden; i++)
+                        sum += hb[i] * kernel[(input_size + i) * gate_size + j];
+
+                    gates[j] = sum;
+                }
+
+                for(int j = 0; j < hidden; j++)
+                {
+                    float ig = gates[j];
+                    float cg = gates[hidden + j];
+                    float fg = gates[2 * hidden + j] + forget_bias;
+                    float og = gates[3 * hidden + j];
+
+                    cb[j] = cb[j] * ref_sigmoid(fg) + std::tanh(cg) * ref_sigmoid(ig);
+                    hb[j] = ref_sigmoid(og) * std::tanh(cb[j]);
+                }
+            }
+
+            if(t + output_len >= seq)
+                outputs[0].insert(outputs[0].end(), h.begin(), h.end());
+        }
+    };
+
+    add_input(lc, {seq, batch, input_size});
+    add_input(lc, {input_size + hidden, 4 * hidden});
+
+    return lc;
+}
+
+static std::vector<DiffCase> get_cases(int case_number)
+{
+    static const std::function<DiffCase(void)> generators[] = {
+        [] { return conv_case(TENGINE_LAYOUT_NCHW); },
+        [] { return conv_case(TENGINE_LAYOUT_NHWC); },
+        deconv_case,
+        [] { return pool_case(TENGINE_LAYOUT_NCHW); },
+        [] { return pool_case(TENGINE_LAYOUT_NHWC); },
+        eltwise_case,
+        softmax_case,
+        lstm_case};
+
+    std::vector<DiffCase> cases;
+
+    for(auto& gen : generators)
+    {
+        for(int i = 0; i < case_number; i++)
+            cases.push_back(gen());
+    }
+
+    return cases;
+}
+
+/* a node of the case, with its inputs, from the data of the case; the dims of its outputs */
+static test_node_t build_node(const DiffCase& c, std::vector<std::vector<float>>& inputs,
+                              std::vector<std::vector<int>>& output_dims)
+{
+    test_node_t node = create_test_node(c.op.c_str());
+
+    if(node == nullptr)
+        return nullptr;
+
+    c.set_param(node);
+    test_node_set_layout(node, c.layout);
+
+    /* the inputs written by an earlier run do not pass on */
+    inputs = c.inputs;
+
+    for(unsigned int i = 0; i < inputs.size(); i++)
+        test_node_add_input(node, inputs[i].data(), c.input_dims[i].data(), c.input_dims[i].size());
+
+    output_dims.clear();
+
+    for(int i = 0;; i++)
+    {
+        int dims[8];
+        int dim_number = test_node_infer_output_shape(node, i, dims, 8);
+
+        if(dim_number < 0)
+            break;
+
+        output_dims.emplace_back(dims, dims + dim_number);
+    }
+
+    return node;
+}
+
+/* the outputs of the host reference of the case; false if it has none */
+static bool run_reference(const DiffCase& c, ImplRun& run)
+{
+    if(!c.reference)
+        return false;
+
+    std::vector<std::vector<float>> inputs;
+    std::vector<std::vector<int>> output_dims;
+    test_node_t node = build_node(c, inputs, output_dims);
+
+    if(node == nullptr)
+        return false;
+
+    destroy_test_node(node);
+
+    run.impl = "host reference";
+    run.time = 0;
+    run.input_changed = false;
+
+    c.reference(c.inputs, output_dims, run.outputs);
+
+    return true;
+}
+
+/* build, prerun, dump and time the case on one implementation */
+static RunStatus run_impl(const DiffCase& c, const char* registry, int priority, int repeat, ImplRun& run)
+{
+    std::vector<std::vector<float>> inputs;
+    std::vector<std::vector<int>> output_dims;
+    test_node_t node = build_node(c, inputs, output_dims);
+
+    if(node == nullptr)
+        return RUN_SKIPPED;
+
+    std::vector<std::vector<float>> outputs;
+
+    for(auto& dims : output_dims)
+    {
+        long size = 1;
+
+        for(int d : dims)
+            size *= d;
+
+        outputs.emplace_back(size);
+        test_node_add_output(node, outputs.back().data(), dims.data(), dims.size());
+    }
+
+    if(registry)
+        test_node_set_ops(node, registry, priority);
+
+    if(outputs.empty() || test_node_prerun(node) < 0)
+    {
+        destroy_test_node(node);
+        return RUN_SKIPPED;
+    }
+
+    const char* impl = test_node_get_ops_name(node);
+
+    run.impl = impl ? impl : "";
+    run.time = 0;
+    run.input_changed = false;
+    run.outputs.clear();
+
+    /* one dumped run: the first run of some implementations packs or caches */
+    test_node_do_dump(node, NODE_DUMP_ACTION_ENABLE);
+    test_node_do_dump(node, NODE_DUMP_ACTION_START);
+
+    if(test_node_run(node) < 0)
+    {
+        test_node_do_dump(node, NODE_DUMP_ACTION_DISABLE);
+        test_node_postrun(node);
+        destroy_test_node(node);
+        return RUN_FAILED;
+    }
+
+    test_node_do_dump(node, NODE_DUMP_ACTION_STOP);
+
+    void* dump_buf[16];
+    int dump_number = test_node_get_dump(node, dump_buf, 16);
+    int input_number = inputs.size();
+
+    for(int i = 0; i < dump_number; i++)
+    {
+        tensor_dump_header* header = ( tensor_dump_header* )dump_buf[i];
+        const float* data = ( const float* )header->data;
+
+        if(i < input_number)
+        {
+            if(header->elem_number != ( int )c.inputs[i].size() ||
+               memcmp(data, c.inputs[i].data(), c.inputs[i].size() * sizeof(float)))
+                run.input_changed = true;
+        }
+        else
+            run.outputs.emplace_back(data, data + header->elem_number);
+    }
+
+    test_node_do_dump(node, NODE_DUMP_ACTION_DISABLE);
+
+    std::vector<double> times(repeat);
+
+    for(int i = 0; i < repeat; i++)
+    {
+        unsigned long start = get_cur_time();
+        test_node_run(node);
+        times[i] = (get_cur_time() - start) / 1000.0;
+    }
+
+    std::sort(times.begin(), times.end());
+
+    run.time = times[repeat / 2];
+
+    test_node_postrun(node);
+    destroy_test_node(node);
+
+    return RUN_DONE;
+}
+
+/* max abs difference over the max abs value of the baseline, -1 if the shapes differ */
+static double get_error(const ImplRun& base, const ImplRun& run)
+{
+    if(run.outputs.size() != base.outputs.size())
+        return -1;
+
+    double max_diff = 0;
+    double max_value = 1;
+
+    for(unsigned int i = 0; i < base.outputs.size(); i++)
+    {
+        const std::vector<float>& b = base.outputs[i];
+        const std::vector<float>& r = run.outputs[i];
+
+        if(r.size() != b.size())
+            return -1;
+
+        for(unsigned int k = 0; k < b.size(); k++)
+        {
+            double diff = std::fabs(( double )r[k] - b[k]);
+
+            /* NaN never compares */
+            if(!(diff <= max_diff))
+                max_diff = std::isnan(diff) ? INFINITY : diff;
+
+            max_value = std::max(max_value, ( double )std::fabs(b[k]));
+        }
+    }
+
+    return max_diff / max_value;
+}
+
+static void write_json(FILE* fp, unsigned int seed, double tolerance, const std::vector<DiffResult>& results)
+{
+    std::fprintf(fp, "{\"seed\": %u, \"tolerance\": %g, \"results\": [\n", seed, tolerance);
+
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        const DiffResult& r = results[i];
+        char speedup[32] = "null";
+
+        if(r.speedup > 0)
+            std::snprintf(speedup, sizeof(speedup), "%.3f", r.speedup);
+
+        std::fprintf(fp,
+                     "  {\"case\": \"%s\", \"registry\": \"%s\", \"priority\": %d, \"impl\": \"%s\", "
+                     "\"time_ms\": %.4f, \"speedup\": %s, \"error\": %g, \"input_changed\": %s, \"run_failed\": %s, "
+                     "\"pass\": %s}%s\n",
+                     r.case_name.c_str(), r.registry.c_str(), r.priority, r.impl.c_str(), r.time, speedup, r.error,
+                     r.input_changed ? "true" : "false", r.run_failed ? "true" : "false", r.pass ? "true" : "false",
+                     i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(fp, "]}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int seed = 1;
+    int case_number = 4;
+    int repeat = 10;
+    double tolerance = 1e-3;
+    std::string filter;
+    std::string json_file;
+    char* cpu_list_str = nullptr;
+    int res;
+
+    while((res = getopt(argc, argv, "s:n:k:t:r:p:o:")) != -1)
+    {
+        switch(res)
+        {
+            case 's':
+                seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                case_number = strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                filter = optarg;
+                break;
+            case 't':
+                tolerance = strtod(optarg, NULL);
+                break;
+            case 'r':
+                repeat = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                cpu_list_str = optarg;
+                break;
+            case 'o':
+                json_file = optarg;
+                break;
+            default:
+                std::printf("usage: %s [-s seed] [-n case_number] [-k op_filter] [-t tolerance] [-r repeat] "
+                            "[-p cpu_list] [-o result.json]\n",
+                            argv[0]);
+                return -1;
+        }
+    }
+
+    if(repeat <= 0)
+        repeat = 1;
+
+    if(cpu_list_str)
+        set_cpu_list(cpu_list_str);
+
+    init_tengine();
+
+    const char* registry_names[16];
+    int registry_number = test_get_registry_names(registry_names, 16);
+
+    /* the reference registry first, then common, then the arch ones: the first to run is the baseline */
+    std::stable_partition(registry_names, registry_names + registry_number,
+                          [](const char* name) { return !strcmp(name, "common"); });
+    std::stable_partition(registry_names, registry_names + registry_number,
+                          [](const char* name) { return !strcmp(name, REF_REGISTRY_NAME); });
+
+    rand_gen.seed(seed);
+
+    std::vector<DiffCase> cases = get_cases(case_number);
+    std::vector<DiffResult> results;
+    int fail_number = 0;
+
+    std::printf("seed %u, tolerance %g\n", seed, tolerance);
+    std::printf("%-36s %-9s %5s %10s %8s %10s %5s  %s\n", "case", "registry", "prio", "time(ms)", "speedup", "error",
+                "", "implementation");
+
+    for(auto& c : cases)
+    {
+        if(!filter.empty() && c.op.find(filter) == std::string::npos && c.name.find(filter) == std::string::npos)
+            continue;
+
+        ImplRun base;
+        bool has_base = run_reference(c, base);
+        bool has_impl = false;
+        double first_time = 0;
+
+        for(int i = 0; i < registry_number; i++)
+        {
+            int priority[32];
+            int number = test_get_ops_priority(registry_names[i], c.op.c_str(), priority, 32);
+
+            /* the last in the search order first: the most generic */
+            for(int k = number - 1; k >= 0; k--)
+            {
+                ImplRun run;
+                RunStatus status = run_impl(c, registry_names[i], priority[k], repeat, run);
+
+                if(status == RUN_SKIPPED)
+                    continue;
+
+                DiffResult r;
+
+                r.case_name = c.name;
+                r.registry = registry_names[i];
+                r.priority = priority[k];
+                r.impl = run.impl;
+                r.time = run.time;
+                r.input_changed = run.input_changed;
+                r.run_failed = status == RUN_FAILED;
+                r.speedup = 0;
+                r.error = -1;
+
+                if(!r.run_failed)
+                {
+                    if(!has_base)
+                    {
+                        base = run;
+                        has_base = true;
+                    }
+
+                    if(first_time <= 0)
+                        first_time = run.time;
+
+                    if(first_time > 0 && run.time > 0)
+                        r.speedup = first_time / run.time;
+
+                    r.error = get_error(base, run);
+                }
+
+                has_impl = true;
+                r.pass = !r.run_failed && r.error >= 0 && r.error <= tolerance && !r.input_changed;
+
+                if(!r.pass)
+                    fail_number++;
+
+                char speedup[16] = "-";
+
+                if(r.speedup > 0)
+                    std::snprintf(speedup, sizeof(speedup), "%.2f", r.speedup);
+
+                std::printf("%-36s %-9s %5d %10.3f %8s %10.3g %5s  %s\n", r.case_name.c_str(), r.registry.c_str(),
+                            r.priority, r.time, speedup, r.error,
+                            r.pass ? "ok" : (r.run_failed ? "RUN" : (r.input_changed ? "INPUT" : "FAIL")),
+                            r.impl.c_str());
+
+                results.push_back(r);
+            }
+        }
+
+        if(!has_impl)
+            std::printf("%-36s no implementation of %s\n", c.name.c_str(), c.op.c_str());
+    }
+
+    std::printf("%d runs, %d failed\n", ( int )results.size(), fail_number);
+
+    if(json_file == "-")
+        write_json(stdout, seed, tolerance, results);
+    else if(!json_file.empty())
+    {
+        FILE* fp = fopen(json_file.c_str(), "w");
+
+        if(fp == nullptr)
+        {
+            std::fprintf(stderr, "cannot open %s\n", json_file.c_str());
+            return -1;
+        }
+
+        write_json(fp, seed, tolerance, results);
+        fclose(fp);
+    }
+
+    release_tengine();
+
+    return fail_number ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "tengine_c_api.h"
+#include "tensor.hpp"
+
+/*
+ * an internal tensor read by name or dumped is NCHW, whether or not the graph
+ * stores it channel blocked: a conv -> pool -> conv -> softmax graph built
+ * with the C API is run with BLOCKED_LAYOUT=0 and BLOCKED_LAYOUT=1, and the
+ * data of the internal tensors "conv1" and "pool" must be the same in both.
+ *
+ *   test_blocked_layout [-c channel]
+ */
+
+static std::vector<std::vector<float>> const_data;
+
+/* the C API sets no layout on the tensors it creates */
+static void set_nchw(tensor_t tensor)
+{
+    reinterpret_cast<TEngine::Tensor*>(tensor)->GetShape().SetDataLayout("NCHW");
+}
+
+static tensor_t add_const(graph_t graph, const std::string& name, const std::vector<int>& dims)
+{
+    node_t node = create_graph_node(graph, name.c_str(), "Const");
+    tensor_t tensor = create_graph_tensor(graph, name.c_str(), TENGINE_DT_FP32);
+    int size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    const_data.emplace_back(size);
+
+    for(int i = 0; i < size; i++)
+        const_data.back()[i] = ((i * 37 + size) % 101) / 101.f - 0.5f;
+
+    set_node_output_tensor(node, 0, tensor, TENSOR_TYPE_CONST);
+    set_nchw(tensor);
+    set_tensor_shape(tensor, dims.data(), dims.size());
+    set_tensor_buffer(tensor, const_data.back().data(), size * sizeof(float));
+
+    release_graph_node(node);
+
+    return tensor;
+}
+
+static node_t add_node(graph_t graph, const char* node_name, const char* op_name, const std::vector<tensor_t>& inputs)
+{
+    node_t node = create_graph_node(graph, node_name, op_name);
+    tensor_t output = create_graph_tensor(graph, node_name, TENGINE_DT_FP32);
+
+    for(unsigned int i = 0; i < inputs.size(); i++)
+        set_node_input_tensor(node, i, inputs[i]);
+
+    set_node_output_tensor(node, 0, output, TENSOR_TYPE_VAR);
+    set_nchw(output);
+
+    return node;
+}
+
+static node_t add_conv(graph_t graph, const char* node_name, tensor_t input, int channel)
+{
+    std::string name(node_name);
+    tensor_t weight = add_const(graph, name + "_w", {channel, channel, 3, 3});
+    tensor_t bias = add_const(graph, name + "_b", {channel});
+    node_t node = add_node(graph, node_name, "Convolution", {input, weight, bias});
+
+    int kernel = 3;
+    int pad = 1;
+    int stride = 1;
+    int group = 1;
+    int activation = 0;
+
+    set_node_attr_int(node, "kernel_h", &kernel);
+    set_node_attr_int(node, "kernel_w", &kernel);
+    set_node_attr_int(node, "stride_h", &stride);
+    set_node_attr_int(node, "stride_w", &stride);
+    set_node_attr_int(node, "pad_h", &pad);
+    set_node_attr_int(node, "pad_w", &pad);
+    set_node_attr_int(node, "output_channel", &channel);
+    set_node_attr_int(node, "group", &group);
+    set_node_attr_int(node, "activation", &activation);
+
+    return node;
+}
+
+static graph_t create_test_graph(int channel)
+{
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+
+    if(graph == nullptr)
+        return nullptr;
+
+    node_t input_node = create_graph_node(graph, "input", "InputOp");
+    tensor_t input = create_graph_tensor(graph, "input", TENGINE_DT_FP32);
+    int dims[] = {1, channel, 16, 16};
+
+    set_node_output_tensor(input_node, 0, input, TENSOR_TYPE_INPUT);
+    set_nchw(input);
+    set_tensor_shape(input, dims, 4);
+
+    node_t conv1 = add_conv(graph, "conv1", input, channel);
+    node_t pool = add_node(graph, "pool", "Pooling", {get_node_output_tensor(conv1, 0)});
+    node_t conv2 = add_conv(graph, "conv2", get_node_output_tensor(pool, 0), channel);
+    node_t softmax = add_node(graph, "softmax", "Softmax", {get_node_output_tensor(conv2, 0)});
+
+    int pool_size = 2;
+    int axis = 1;
+
+    set_node_attr_int(pool, "kernel_h", &pool_size);
+    set_node_attr_int(pool, "kernel_w", &pool_size);
+    set_node_attr_int(pool, "stride_h", &pool_size);
+    set_node_attr_int(pool, "stride_w", &pool_size);
+    set_node_attr_int(softmax, "axis", &axis);
+
+    const char* input_nodes[] = {"input"};
+    const char* output_nodes[] = {"softmax"};
+
+    set_graph_input_node(graph, input_nodes, 1);
+    set_graph_output_node(graph, output_nodes, 1);
+
+    return graph;
+}
+
+struct tensor_dump_header
+{
+    int elem_size;
+    int elem_number;
+    int dim_number;
+    int dim[4];
+    void* data;
+};
+
+/*
+   the data seen by the user after a run, appended to outputs: the dumps of
+   the input and the output of "pool", then "conv1" read by name. blocked
+   counts the blocked ones of these tensors
+ */
+static bool run_graph_once(int channel, bool blocked_layout, std::vector<float>& outputs, int& blocked)
+{
+    graph_t graph = create_test_graph(channel);
+
+    if(graph == nullptr)
+        return false;
+
+    std::vector<float> input_data(channel * 16 * 16);
+
+    for(unsigned int i = 0; i < input_data.size(); i++)
+        input_data[i] = (i % 255) / 255.f - 0.5f;
+
+    tensor_t input_tensor = get_graph_input_tensor(graph, 0, 0);
+
+    set_tensor_buffer(input_tensor, input_data.data(), input_data.size() * sizeof(float));
+    release_graph_tensor(input_tensor);
+
+    /* read by prerun_graph() */
+    setenv("BLOCKED_LAYOUT", blocked_layout ? "1" : "0", 1);
+
+    int ret = prerun_graph(graph);
+
+    unsetenv("BLOCKED_LAYOUT");
+
+    node_t pool_node = get_graph_node(graph, "pool");
+
+    if(ret < 0 || do_node_dump(pool_node, NODE_DUMP_ACTION_ENABLE) < 0 ||
+       do_node_dump(pool_node, NODE_DUMP_ACTION_START) < 0 || run_graph(graph, 1) < 0)
+    {
+        destroy_graph(graph);
+        return false;
+    }
+
+    void* dump_buf[2];
+    int dump_num = get_node_dump_buffer(pool_node, dump_buf, 2);
+
+    for(int i = 0; i < dump_num; i++)
+    {
+        tensor_dump_header* header = ( tensor_dump_header* )dump_buf[i];
+        const float* data = ( const float* )header->data;
+
+        outputs.insert(outputs.end(), data, data + header->elem_number);
+    }
+
+    /* the first tensor of the graph: the memory pool does not reuse its memory */
+    tensor_t tensor = get_graph_tensor(graph, "conv1");
+    const float* data = ( const float* )get_tensor_buffer(tensor);
+    int size = get_tensor_buffer_size(tensor) / sizeof(float);
+
+    outputs.insert(outputs.end(), data, data + size);
+
+    blocked = 0;
+
+    if(reinterpret_cast<TEngine::Tensor*>(tensor)->ExistAttr("BlockedLayout"))
+        blocked++;
+
+    release_graph_tensor(tensor);
+
+    tensor = get_graph_tensor(graph, "pool");
+
+    if(reinterpret_cast<TEngine::Tensor*>(tensor)->ExistAttr("BlockedLayout"))
+        blocked++;
+
+    release_graph_tensor(tensor);
+
+    do_node_dump(pool_node, NODE_DUMP_ACTION_DISABLE);
+    release_graph_node(pool_node);
+
+    postrun_graph(graph);
+    destroy_graph(graph);
+
+    return dump_num == 2;
+}
+
+int main(int argc, char* argv[])
+{
+    int channel = 8;
+    int res;
+
+    while((res = getopt(argc, argv, "c:")) != -1)
+    {
+        switch(res)
+        {
+            case 'c':
+                channel = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                break;
+        }
+    }
+
+    init_tengine();
+
+    std::vector<float> base;
+    std::vector<float> outputs;
+    int base_blocked = 0;
+    int blocked = 0;
+    bool pass = run_graph_once(channel, false, base, base_blocked) && run_graph_once(channel, true, outputs, blocked);
+
+    release_tengine();
+
+    if(!pass)
+    {
+        std::printf("FAIL: run failed, errno: %d\n", get_tengine_errno());
+        return -1;
+    }
+
+    /* nothing checked if the layout was not used */
+    if(base_blocked != 0 || blocked == 0)
+    {
+        std::printf("FAIL: %d blocked tensors with BLOCKED_LAYOUT=0, %d with BLOCKED_LAYOUT=1\n", base_blocked,
+                    blocked);
+        return -1;
+    }
+
+    if(outputs.size() != base.size())
+    {
+        std::printf("FAIL: %d values read, %d expected\n", ( int )outputs.size(), ( int )base.size());
+        return -1;
+    }
+
+    for(unsigned int i = 0; i < base.size(); i++)
+    {
+        if(std::fabs(outputs[i] - base[i]) > 1e-4f * (1 + std::fabs(base[i])))
+        {
+            std::printf("FAIL: value %u is %f, %f expected\n", i, outputs[i], base[i]);
+            return -1;
+        }
+    }
+
+    std::printf("PASS: %d tensors blocked, %d values\n", blocked, ( int )base.size());
+
+    return 0;
+}
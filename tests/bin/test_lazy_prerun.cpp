@@ -0,0 +1,291 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tengine_c_api.h"
+#include "tensor.hpp"
+#include "common_util.hpp"
+
+/*
+ * the outputs with lazy load (TM_LAZY_LOAD) and lazy prerun (lazy_prerun)
+ * are bit identical to the ones without: a conv/pool/softmax graph built
+ * with the C API is saved as a tm file, then loaded, run, reshaped and run
+ * again in the four ways. the lazy ways are run repeat_count times, each
+ * with another interleaving of the worker and the run: build the library
+ * with -fsanitize=thread to check them for data races.
+ *
+ *   test_lazy_prerun [-p cpu_list] [-f tm_file] [-r repeat_count]
+ */
+
+static std::vector<std::vector<float>> const_data;
+
+/* the C API sets no layout on the tensors it creates */
+static void set_nchw(tensor_t tensor)
+{
+    reinterpret_cast<TEngine::Tensor*>(tensor)->GetShape().SetDataLayout("NCHW");
+}
+
+static tensor_t add_const(graph_t graph, const std::string& name, const std::vector<int>& dims)
+{
+    node_t node = create_graph_node(graph, name.c_str(), "Const");
+    tensor_t tensor = create_graph_tensor(graph, name.c_str(), TENGINE_DT_FP32);
+    int size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    const_data.emplace_back(size);
+
+    for(int i = 0; i < size; i++)
+        const_data.back()[i] = ((i * 37 + size) % 101) / 101.f - 0.5f;
+
+    set_node_output_tensor(node, 0, tensor, TENSOR_TYPE_CONST);
+    set_nchw(tensor);
+    set_tensor_shape(tensor, dims.data(), dims.size());
+    set_tensor_buffer(tensor, const_data.back().data(), size * sizeof(float));
+
+    release_graph_node(node);
+
+    return tensor;
+}
+
+static node_t add_node(graph_t graph, const char* node_name, const char* op_name, const std::vector<tensor_t>& inputs)
+{
+    node_t node = create_graph_node(graph, node_name, op_name);
+    tensor_t output = create_graph_tensor(graph, node_name, TENGINE_DT_FP32);
+
+    for(unsigned int i = 0; i < inputs.size(); i++)
+        set_node_input_tensor(node, i, inputs[i]);
+
+    set_node_output_tensor(node, 0, output, TENSOR_TYPE_VAR);
+    set_nchw(output);
+
+    return node;
+}
+
+static node_t add_conv(graph_t graph, const char* node_name, tensor_t input, int input_c, int output_c, int kernel,
+                       int group)
+{
+    std::string name(node_name);
+    tensor_t weight = add_const(graph, name + "_w", {output_c, input_c / group, kernel, kernel});
+    tensor_t bias = add_const(graph, name + "_b", {output_c});
+    node_t node = add_node(graph, node_name, "Convolution", {input, weight, bias});
+
+    int pad = kernel / 2;
+    int stride = 1;
+    int activation = 0;
+
+    set_node_attr_int(node, "kernel_h", &kernel);
+    set_node_attr_int(node, "kernel_w", &kernel);
+    set_node_attr_int(node, "stride_h", &stride);
+    set_node_attr_int(node, "stride_w", &stride);
+    set_node_attr_int(node, "pad_h", &pad);
+    set_node_attr_int(node, "pad_w", &pad);
+    set_node_attr_int(node, "output_channel", &output_c);
+    set_node_attr_int(node, "group", &group);
+    set_node_attr_int(node, "activation", &activation);
+
+    return node;
+}
+
+static bool save_test_model(const char* file_name)
+{
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+
+    node_t input_node = create_graph_node(graph, "input", "InputOp");
+    tensor_t input = create_graph_tensor(graph, "input", TENGINE_DT_FP32);
+    int dims[] = {1, 64, 8, 8};
+
+    set_node_output_tensor(input_node, 0, input, TENSOR_TYPE_INPUT);
+    set_nchw(input);
+    set_tensor_shape(input, dims, 4);
+
+    /* big weights on small images: preparing a node takes longer than running the ones before it */
+    node_t conv1 = add_conv(graph, "conv1", input, 64, 256, 3, 1);
+    node_t conv2 = add_conv(graph, "conv2", get_node_output_tensor(conv1, 0), 256, 256, 1, 1);
+    node_t pool = add_node(graph, "pool", "Pooling", {get_node_output_tensor(conv2, 0)});
+    node_t conv3 = add_conv(graph, "conv3", get_node_output_tensor(pool, 0), 256, 256, 3, 256);
+    node_t conv4 = add_conv(graph, "conv4", get_node_output_tensor(conv3, 0), 256, 256, 3, 1);
+    node_t softmax = add_node(graph, "softmax", "Softmax", {get_node_output_tensor(conv4, 0)});
+
+    int pool_size = 2;
+    int axis = 1;
+
+    set_node_attr_int(pool, "kernel_h", &pool_size);
+    set_node_attr_int(pool, "kernel_w", &pool_size);
+    set_node_attr_int(pool, "stride_h", &pool_size);
+    set_node_attr_int(pool, "stride_w", &pool_size);
+    set_node_attr_int(softmax, "axis", &axis);
+
+    const char* input_nodes[] = {"input"};
+    const char* output_nodes[] = {"softmax"};
+
+    set_graph_input_node(graph, input_nodes, 1);
+    set_graph_output_node(graph, output_nodes, 1);
+
+    bool ret = save_graph(graph, "tengine", file_name) == 0;
+
+    destroy_graph(graph);
+
+    return ret;
+}
+
+/* the outputs of a run on 8x8 then on 6x10 inputs, appended to outputs */
+static bool run_model(const char* file_name, bool lazy_load, bool lazy_prerun, std::vector<float>& outputs)
+{
+    if(lazy_load)
+        setenv("TM_LAZY_LOAD", "1", 1);
+    else
+        unsetenv("TM_LAZY_LOAD");
+
+    graph_t graph = create_graph(nullptr, "tengine", file_name);
+
+    unsetenv("TM_LAZY_LOAD");
+
+    if(graph == nullptr)
+        return false;
+
+    int lazy = lazy_prerun;
+    int lazy_set = -1;
+
+    /* an attr the executor does not know would be dropped silently */
+    if(set_graph_attr(graph, "lazy_prerun", &lazy, sizeof(int)) < 0 ||
+       get_graph_attr(graph, "lazy_prerun", &lazy_set, sizeof(int)) < 0 || lazy_set != lazy)
+    {
+        std::printf("cannot set lazy_prerun\n");
+        destroy_graph(graph);
+        return false;
+    }
+
+    tensor_t input_tensor = get_graph_input_tensor(graph, 0, 0);
+    const int input_shapes[2][4] = {{1, 64, 8, 8}, {1, 64, 6, 10}};
+    std::vector<float> input_data(64 * 8 * 8);
+
+    for(unsigned int i = 0; i < input_data.size(); i++)
+        input_data[i] = (i % 255) / 255.f - 0.5f;
+
+    bool ret = true;
+
+    for(int i = 0; i < 2 && ret; i++)
+    {
+        set_tensor_shape(input_tensor, input_shapes[i], 4);
+        set_tensor_buffer(input_tensor, input_data.data(), input_data.size() * sizeof(float));
+
+        if((i == 0 && prerun_graph(graph) < 0) || run_graph(graph, 1) < 0)
+        {
+            ret = false;
+            break;
+        }
+
+        tensor_t output_tensor = get_graph_output_tensor(graph, 0, 0);
+        const float* data = ( const float* )get_tensor_buffer(output_tensor);
+        int size = get_tensor_buffer_size(output_tensor) / sizeof(float);
+
+        outputs.insert(outputs.end(), data, data + size);
+
+        release_graph_tensor(output_tensor);
+    }
+
+    release_graph_tensor(input_tensor);
+    postrun_graph(graph);
+    destroy_graph(graph);
+
+    return ret;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string file_name = "./lazy_prerun_test.tmfile";
+    char* cpu_list_str = nullptr;
+    int repeat_count = 5;
+    int res;
+
+    while((res = getopt(argc, argv, "p:f:r:")) != -1)
+    {
+        switch(res)
+        {
+            case 'p':
+                cpu_list_str = optarg;
+                break;
+            case 'f':
+                file_name = optarg;
+                break;
+            case 'r':
+                repeat_count = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(cpu_list_str)
+        TEngine::set_cpu_list(cpu_list_str);
+
+    init_tengine();
+
+    if(!save_test_model(file_name.c_str()))
+    {
+        std::printf("save %s failed, errno: %d\n", file_name.c_str(), get_tengine_errno());
+        return -1;
+    }
+
+    std::vector<float> base;
+    bool pass = run_model(file_name.c_str(), false, false, base);
+
+    for(int n = 0; n < repeat_count * 3 && pass; n++)
+    {
+        int i = n % 3 + 1;
+        bool lazy_load = i & 1;
+        bool lazy_prerun = i & 2;
+        std::vector<float> outputs;
+
+        if(!run_model(file_name.c_str(), lazy_load, lazy_prerun, outputs))
+            pass = false;
+        else if(outputs.size() != base.size() || memcmp(outputs.data(), base.data(), base.size() * sizeof(float)))
+        {
+            std::printf("lazy load %d, lazy prerun %d: the outputs differ\n", lazy_load, lazy_prerun);
+            pass = false;
+        }
+    }
+
+    unlink(file_name.c_str());
+
+    release_tengine();
+
+    if(!pass)
+    {
+        std::printf("FAIL\n");
+        return -1;
+    }
+
+    std::printf("PASS: %d outputs\n", ( int )base.size());
+
+    return 0;
+}
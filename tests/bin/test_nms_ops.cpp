@@ -0,0 +1,485 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "tengine_c_api.h"
+#include "tensor.hpp"
+#include "node.hpp"
+#include "common_util.hpp"
+#include "operator/detection_output.hpp"
+#include "operator/detection_postprocess.hpp"
+#include "operator/rpn.hpp"
+
+/*
+ * DetectionOutput, DetectionPostProcess and RPN on fixed inputs, checked
+ * against the outputs of the operators before they shared nms.cpp. the
+ * scores are all different, so that the order of the picked boxes does
+ * not depend on how ties are broken.
+ *
+ *   test_nms_ops [-p cpu_list] [-d]
+ *
+ * -d prints the outputs in the form of the expected tables below
+ */
+
+static std::vector<std::vector<float>> tensor_data;
+
+/* distinct values in [0, 1) */
+static float fixed_value(int i, int seed)
+{
+    return ((i * 7919 + seed * 104729) % 1009) / 1009.f;
+}
+
+/* the C API sets no layout on the tensors it creates */
+static void set_nchw(tensor_t tensor)
+{
+    reinterpret_cast<TEngine::Tensor*>(tensor)->GetShape().SetDataLayout("NCHW");
+}
+
+static tensor_t add_data(graph_t graph, const char* name, const char* op_name, int tensor_type,
+                         const std::vector<int>& dims, const std::vector<float>& data)
+{
+    node_t node = create_graph_node(graph, name, op_name);
+    tensor_t tensor = create_graph_tensor(graph, name, TENGINE_DT_FP32);
+
+    tensor_data.push_back(data);
+
+    set_node_output_tensor(node, 0, tensor, tensor_type);
+    set_nchw(tensor);
+    set_tensor_shape(tensor, dims.data(), dims.size());
+    set_tensor_buffer(tensor, tensor_data.back().data(), data.size() * sizeof(float));
+
+    release_graph_node(node);
+
+    return tensor;
+}
+
+static node_t add_op(graph_t graph, const char* op_name, const std::vector<tensor_t>& inputs, int output_number)
+{
+    node_t node = create_graph_node(graph, "op", op_name);
+
+    for(unsigned int i = 0; i < inputs.size(); i++)
+        set_node_input_tensor(node, i, inputs[i]);
+
+    for(int i = 0; i < output_number; i++)
+    {
+        std::string name = "output" + std::to_string(i);
+        tensor_t output = create_graph_tensor(graph, name.c_str(), TENGINE_DT_FP32);
+
+        set_node_output_tensor(node, i, output, TENSOR_TYPE_VAR);
+        set_nchw(output);
+        release_graph_tensor(output);
+    }
+
+    const char* input_nodes[] = {"input"};
+    const char* output_nodes[] = {"op"};
+
+    set_graph_input_node(graph, input_nodes, 1);
+    set_graph_output_node(graph, output_nodes, 1);
+
+    return node;
+}
+
+template <typename T> static auto get_param(node_t node) -> decltype(std::declval<T>().GetParam())
+{
+    return dynamic_cast<T*>(reinterpret_cast<TEngine::Node*>(node)->GetOp())->GetParam();
+}
+
+/* the outputs of the graph, each cut to the element number of its shape */
+static bool run_test_graph(graph_t graph, int output_number, std::vector<std::vector<float>>& outputs)
+{
+    if(prerun_graph(graph) < 0 || run_graph(graph, 1) < 0)
+        return false;
+
+    outputs.resize(output_number);
+
+    for(int i = 0; i < output_number; i++)
+    {
+        tensor_t tensor = get_graph_output_tensor(graph, 0, i);
+        const float* data = ( const float* )get_tensor_buffer(tensor);
+        int dims[4];
+        int dim_number = get_tensor_shape(tensor, dims, 4);
+        int size = 1;
+
+        for(int j = 0; j < dim_number; j++)
+            size *= dims[j];
+
+        outputs[i].assign(data, data + size);
+
+        release_graph_tensor(tensor);
+    }
+
+    postrun_graph(graph);
+
+    return true;
+}
+
+/* 64 priors on a 4x4 grid, 4 sizes each, so that many of them overlap */
+static bool run_detection_output(std::vector<float>& outputs)
+{
+    const int num_prior = 64;
+    const int num_classes = 4;
+
+    std::vector<float> loc(num_prior * 4);
+    std::vector<float> conf(num_prior * num_classes);
+    std::vector<float> prior(num_prior * 8);
+
+    for(int i = 0; i < num_prior; i++)
+    {
+        float cx = (i / 4 % 4 + 0.5f) / 4;
+        float cy = (i / 16 + 0.5f) / 4;
+        float size = 0.2f + 0.1f * (i % 4);
+
+        prior[i * 4] = cx - size / 2;
+        prior[i * 4 + 1] = cy - size / 2;
+        prior[i * 4 + 2] = cx + size / 2;
+        prior[i * 4 + 3] = cy + size / 2;
+
+        prior[num_prior * 4 + i * 4] = 0.1f;
+        prior[num_prior * 4 + i * 4 + 1] = 0.1f;
+        prior[num_prior * 4 + i * 4 + 2] = 0.2f;
+        prior[num_prior * 4 + i * 4 + 3] = 0.2f;
+
+        for(int k = 0; k < 4; k++)
+            loc[i * 4 + k] = fixed_value(i * 4 + k, 1) - 0.5f;
+
+        for(int c = 0; c < num_classes; c++)
+            conf[i * num_classes + c] = fixed_value(i * num_classes + c, 2);
+    }
+
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+    tensor_t loc_tensor = add_data(graph, "input", "InputOp", TENSOR_TYPE_INPUT, {1, num_prior * 4, 1, 1}, loc);
+    tensor_t conf_tensor =
+        add_data(graph, "conf", "Const", TENSOR_TYPE_CONST, {1, num_prior * num_classes, 1, 1}, conf);
+    tensor_t prior_tensor = add_data(graph, "prior", "Const", TENSOR_TYPE_CONST, {1, 2, num_prior * 4, 1}, prior);
+    node_t node = add_op(graph, "DetectionOutput", {loc_tensor, conf_tensor, prior_tensor}, 1);
+
+    TEngine::DetectionOutputParam* param = get_param<TEngine::DetectionOutput>(node);
+
+    param->num_classes = num_classes;
+    param->confidence_threshold = 0.4f;
+    param->nms_threshold = 0.45f;
+    param->nms_top_k = 40;
+    param->keep_top_k = 30;
+
+    release_graph_node(node);
+
+    std::vector<std::vector<float>> graph_outputs;
+    bool ret = run_test_graph(graph, 1, graph_outputs);
+
+    destroy_graph(graph);
+
+    if(ret)
+        outputs = graph_outputs[0];
+
+    return ret;
+}
+
+/* 48 anchors on a 4x4 grid, 3 shapes each */
+static bool run_detection_postprocess(std::vector<float>& outputs)
+{
+    const int num_boxes = 48;
+    const int num_classes = 3;
+
+    std::vector<float> box(num_boxes * 4);
+    std::vector<float> score(num_boxes * (num_classes + 1));
+    std::vector<float> anchor(num_boxes * 4);
+
+    for(int i = 0; i < num_boxes; i++)
+    {
+        /* y, x, h, w */
+        anchor[i * 4] = (i / 12 + 0.5f) / 4;
+        anchor[i * 4 + 1] = (i / 3 % 4 + 0.5f) / 4;
+        anchor[i * 4 + 2] = 0.3f + 0.1f * (i % 3);
+        anchor[i * 4 + 3] = 0.5f - 0.1f * (i % 3);
+
+        for(int k = 0; k < 4; k++)
+            box[i * 4 + k] = fixed_value(i * 4 + k, 3) - 0.5f;
+
+        for(int c = 0; c <= num_classes; c++)
+            score[i * (num_classes + 1) + c] = fixed_value(i * (num_classes + 1) + c, 4);
+    }
+
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+    tensor_t box_tensor = add_data(graph, "input", "InputOp", TENSOR_TYPE_INPUT, {1, num_boxes, 4}, box);
+    tensor_t score_tensor =
+        add_data(graph, "score", "Const", TENSOR_TYPE_CONST, {1, num_boxes, num_classes + 1}, score);
+    tensor_t anchor_tensor = add_data(graph, "anchor", "Const", TENSOR_TYPE_CONST, {num_boxes, 4}, anchor);
+    node_t node = add_op(graph, "DetectionPostProcess", {box_tensor, score_tensor, anchor_tensor}, 4);
+
+    TEngine::DetectionPostProcessParam* param = get_param<TEngine::DetectionPostProcess>(node);
+
+    param->max_detections = 10;
+    param->max_classes_per_detection = 1;
+    param->nms_score_threshold = 0.3f;
+    param->nms_iou_threshold = 0.5f;
+    param->num_classes = num_classes;
+    param->scales = {10.f, 10.f, 5.f, 5.f};
+
+    release_graph_node(node);
+
+    std::vector<std::vector<float>> graph_outputs;
+    bool ret = run_test_graph(graph, 4, graph_outputs);
+
+    destroy_graph(graph);
+
+    if(!ret)
+        return false;
+
+    /* the shapes of the outputs are not set: keep the detected boxes, their classes and scores, and their number */
+    unsigned int num_detected = graph_outputs[3][0];
+
+    if(num_detected > 10)
+        return false;
+
+    outputs.assign(graph_outputs[0].begin(), graph_outputs[0].begin() + num_detected * 4);
+    outputs.insert(outputs.end(), graph_outputs[1].begin(), graph_outputs[1].begin() + num_detected);
+    outputs.insert(outputs.end(), graph_outputs[2].begin(), graph_outputs[2].begin() + num_detected);
+    outputs.push_back(num_detected);
+
+    return true;
+}
+
+/* a 4x4 feature map of a 64x64 image, 6 anchors per position */
+static bool run_rpn(std::vector<float>& outputs)
+{
+    const int feat_h = 4;
+    const int feat_w = 4;
+    const int num_anchors = 6;
+    const int feat_size = feat_h * feat_w;
+
+    std::vector<float> score(2 * num_anchors * feat_size);
+    std::vector<float> box(4 * num_anchors * feat_size);
+    std::vector<float> info = {64.f, 64.f, 1.f};
+
+    for(unsigned int i = 0; i < score.size(); i++)
+        score[i] = fixed_value(i, 5);
+
+    for(unsigned int i = 0; i < box.size(); i++)
+        box[i] = (fixed_value(i, 6) - 0.5f) * 0.4f;
+
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+    tensor_t score_tensor =
+        add_data(graph, "input", "InputOp", TENSOR_TYPE_INPUT, {1, 2 * num_anchors, feat_h, feat_w}, score);
+    tensor_t box_tensor = add_data(graph, "box", "Const", TENSOR_TYPE_CONST, {1, 4 * num_anchors, feat_h, feat_w}, box);
+    tensor_t info_tensor = add_data(graph, "info", "Const", TENSOR_TYPE_CONST, {1, 3, 1, 1}, info);
+    node_t node = add_op(graph, "RPN", {score_tensor, box_tensor, info_tensor}, 1);
+
+    TEngine::RPNParam* param = get_param<TEngine::RPN>(node);
+
+    param->ratios = {0.5f, 1.f, 2.f};
+    param->anchor_scales = {1.f, 2.f};
+    param->feat_stride = 16;
+    param->basesize = 16;
+    param->min_size = 4;
+    param->per_nms_topn = 60;
+    param->post_nms_topn = 20;
+    param->nms_thresh = 0.7f;
+
+    release_graph_node(node);
+
+    std::vector<std::vector<float>> graph_outputs;
+    bool ret = run_test_graph(graph, 1, graph_outputs);
+
+    destroy_graph(graph);
+
+    if(ret)
+        outputs = graph_outputs[0];
+
+    return ret;
+}
+
+/* the outputs before nms.cpp */
+static const float detection_output_expected[] = {
+    1.f, 0.996035695f, 0.23350729f, 0.453610271f, 0.507662177f, 0.778461099f,
+    2.f, 0.992071331f, 0.733828545f, 0.483497024f, 1.01620114f, 0.757434607f,
+    3.f, 0.988107026f, 0.234026685f, 0.733821571f, 0.524863303f, 1.01597035f,
+    1.f, 0.97918731f, 0.48346296f, -0.0463488176f, 0.756695628f, 0.277409285f,
+    2.f, 0.975223005f, -0.0162019357f, 0.233452335f, 0.265220761f, 0.506468415f,
+    3.f, 0.9712587f, 0.484010458f, 0.233790666f, 0.77386868f, 0.51499033f,
+    1.f, 0.96333003f, 0.436226457f, 0.396584094f, 0.799383044f, 0.826894581f,
+    2.f, 0.959365726f, -0.0633094609f, 0.686211705f, 0.310732633f, 1.04908061f,
+    3.f, 0.955401361f, 0.436991453f, 0.686680198f, 0.822245359f, 1.06042588f,
+    1.f, 0.946481645f, 0.686163306f, -0.103366092f, 1.04809833f, 0.325496912f,
+    2.f, 0.94251734f, 0.186645746f, 0.146113247f, 0.559429586f, 0.587831259f,
+    3.f, 0.938553035f, 0.686965525f, 0.186634913f, 1.07092345f, 0.559123278f,
+    1.f, 0.930624366f, 0.58895278f, 0.339598238f, 1.13978851f, 0.873979509f,
+    2.f, 0.926660061f, 0.139502048f, 0.588972867f, 0.60400635f, 1.13937211f,
+    3.f, 0.922695756f, 0.63992393f, 0.639487922f, 1.11835158f, 1.10362411f,
+    3.f, 0.92170465f, -0.0630625784f, -0.0634125099f, 0.319603682f, 0.307822794f,
+    1.f, 0.91377604f, -0.160963118f, 0.0896546841f, 0.388019621f, 0.622238278f,
+    2.f, 0.909811676f, 0.389440924f, 0.0890562236f, 0.85238266f, 0.637603879f,
+    3.f, 0.905847371f, -0.11011377f, 0.389426172f, 0.366704464f, 0.852001011f,
+    1.f, 0.897918761f, 0.26064527f, 0.76088196f, 0.47954303f, 0.973240912f,
+    2.f, 0.893954396f, 0.78075242f, 0.760652661f, 0.96534276f, 0.979377031f,
+    3.f, 0.888998985f, 0.139845803f, -0.110638194f, 0.615060031f, 0.35038051f,
+    1.f, 0.881070375f, 0.510676444f, 0.260902226f, 0.728837907f, 0.472546756f,
+    2.f, 0.877106071f, 0.0307259262f, 0.510683656f, 0.21469529f, 0.728672147f,
+    3.f, 0.873141706f, 0.530922055f, 0.530719519f, 0.720405936f, 0.714543104f,
+    1.f, 0.865213096f, 0.453557134f, 0.70388031f, 0.779762983f, 1.02034175f,
+    2.f, 0.860257685f, 0.280698389f, 0.0107133612f, 0.464048892f, 0.227968514f,
+    3.f, 0.85629338f, 0.780903816f, 0.0306917652f, 0.969750285f, 0.21389693f,
+    1.f, 0.848364711f, 0.703600347f, 0.203907087f, 1.02870882f, 0.519304037f,
+    2.f, 0.844400406f, 0.23350729f, 0.453610271f, 0.507662177f, 0.778461099f
+};
+
+static const float detection_postprocess_expected[] = {
+    0.639699638f, 0.234025776f, 1.10985446f, 0.524804771f, 0.68626976f, 0.686730742f,
+    1.05029118f, 1.06196105f, 0.389010131f, 0.233765975f, 0.84250623f, 0.514241993f,
+    0.396633863f, 0.686163306f, 0.825496912f, 1.04809833f, 0.0896016657f, 0.203374714f,
+    0.623877048f, 0.533810616f, 0.703386664f, 0.139498547f, 1.03356075f, 0.603910804f,
+    0.436587453f, 0.436937422f, 0.807822824f, 0.819603682f, 0.453824818f, 0.0891178548f,
+    0.772300065f, 0.636253834f, 0.146309152f, 0.436501741f, 0.583671033f, 0.805609226f,
+    0.589283347f, 0.483547568f, 1.13242126f, 0.758573294f, 3.f, 2.f,
+    2.f, 1.f, 1.f, 2.f, 3.f, 1.f,
+    2.f, 2.f, 0.987115979f, 0.975223005f, 0.958374619f, 0.946481645f,
+    0.929633319f, 0.925668955f, 0.92170465f, 0.896927655f, 0.89296335f, 0.860257685f,
+    10.f
+};
+
+static const float rpn_expected[] = {
+    0.f, 0.f, 20.4834023f, 22.7812672f, 7.04726791f, 0.f,
+    41.0415306f, 16.922699f, 34.5572891f, 0.f, 53.2310181f, 31.779623f,
+    42.9645729f, 4.87944365f, 64.f, 14.8454323f, 0.229177475f, 14.9736271f,
+    19.0120525f, 30.8126965f, 17.4870815f, 13.3617764f, 27.8048916f, 39.3216705f,
+    26.8543129f, 11.6100044f, 64.f, 37.8647232f, 0.f, 19.8177681f,
+    23.8423347f, 47.7881813f, 18.243248f, 16.2848949f, 36.4635925f, 62.1277924f,
+    26.6742439f, 34.3142242f, 48.7759056f, 48.8207626f, 48.0639305f, 30.772646f,
+    64.f, 46.2271576f, 1.34196854f, 45.1361847f, 11.4092703f, 64.f,
+    28.6092854f, 43.3388367f, 64.f, 64.f, 38.2895584f, 48.1707954f,
+    64.f, 64.f, 12.3035107f, 0.f, 50.8869705f, 20.533783f,
+    22.1066399f, 0.f, 54.1002998f, 26.9382401f, 45.450531f, 0.f,
+    64.f, 27.7283173f, 0.f, 18.1383209f, 15.554615f, 32.1308556f,
+    15.811409f, 14.4692345f, 33.4888878f, 29.3761559f, 33.1234932f, 12.7912731f,
+    42.8340874f, 37.2233963f
+};
+
+static void dump_outputs(const char* name, const std::vector<float>& outputs)
+{
+    std::printf("%s: %d values\n", name, ( int )outputs.size());
+
+    for(unsigned int i = 0; i < outputs.size(); i++)
+    {
+        char text[32];
+
+        std::snprintf(text, sizeof(text), "%.9g", outputs[i]);
+        std::printf("%s%sf,%s", text, std::strpbrk(text, ".e") ? "" : ".",
+                    (i % 6 == 5 || i + 1 == outputs.size()) ? "\n" : " ");
+    }
+}
+
+static bool check_outputs(const char* name, const std::vector<float>& outputs, const float* expected,
+                          int expected_number)
+{
+    if(( int )outputs.size() != expected_number)
+    {
+        std::printf("%s: %d values, %d expected\n", name, ( int )outputs.size(), expected_number);
+        return false;
+    }
+
+    for(int i = 0; i < expected_number; i++)
+    {
+        if(std::fabs(outputs[i] - expected[i]) > 1e-5f * (1 + std::fabs(expected[i])))
+        {
+            std::printf("%s: value %d is %f, %f expected\n", name, i, outputs[i], expected[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    char* cpu_list_str = nullptr;
+    bool dump = false;
+    int res;
+
+    while((res = getopt(argc, argv, "p:d")) != -1)
+    {
+        switch(res)
+        {
+            case 'p':
+                cpu_list_str = optarg;
+                break;
+            case 'd':
+                dump = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(cpu_list_str)
+        TEngine::set_cpu_list(cpu_list_str);
+
+    init_tengine();
+
+    std::vector<float> detection_output;
+    std::vector<float> detection_postprocess;
+    std::vector<float> rpn;
+
+    bool pass = run_detection_output(detection_output) && run_detection_postprocess(detection_postprocess) &&
+                run_rpn(rpn);
+
+    release_tengine();
+
+    if(!pass)
+    {
+        std::printf("FAIL: run failed, errno: %d\n", get_tengine_errno());
+        return -1;
+    }
+
+    if(dump)
+    {
+        dump_outputs("DetectionOutput", detection_output);
+        dump_outputs("DetectionPostProcess", detection_postprocess);
+        dump_outputs("RPN", rpn);
+        return 0;
+    }
+
+    pass = check_outputs("DetectionOutput", detection_output, detection_output_expected,
+                         sizeof(detection_output_expected) / sizeof(float)) &&
+           check_outputs("DetectionPostProcess", detection_postprocess, detection_postprocess_expected,
+                         sizeof(detection_postprocess_expected) / sizeof(float)) &&
+           check_outputs("RPN", rpn, rpn_expected, sizeof(rpn_expected) / sizeof(float));
+
+    if(!pass)
+    {
+        std::printf("FAIL\n");
+        return -1;
+    }
+
+    std::printf("PASS: %d, %d and %d values\n", ( int )detection_output.size(), ( int )detection_postprocess.size(),
+                ( int )rpn.size());
+
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tengine_c_api.h"
+#include "tensor.hpp"
+#include "common_util.hpp"
+
+/*
+ * stress test of parallel_prerun: a graph of convolutions of every kind,
+ * pooling, LRN and softmax built with the C API is prepared on the aider
+ * threads again and again, and every run must give the output of the serial
+ * prerun bit for bit. build the library with -fsanitize=thread to check
+ * the Prerun() of the kernels for data races.
+ *
+ *   test_parallel_prerun [-p cpu_list] [-r repeat_count]
+ */
+
+static std::vector<std::vector<float>> const_data;
+
+/* the C API sets no layout on the tensors it creates */
+static void set_nchw(tensor_t tensor)
+{
+    reinterpret_cast<TEngine::Tensor*>(tensor)->GetShape().SetDataLayout("NCHW");
+}
+
+static tensor_t add_const(graph_t graph, const std::string& name, const std::vector<int>& dims)
+{
+    node_t node = create_graph_node(graph, name.c_str(), "Const");
+    tensor_t tensor = create_graph_tensor(graph, name.c_str(), TENGINE_DT_FP32);
+    int size = 1;
+
+    for(int d : dims)
+        size *= d;
+
+    const_data.emplace_back(size);
+
+    for(int i = 0; i < size; i++)
+        const_data.back()[i] = ((i * 37 + size) % 101) / 101.f - 0.5f;
+
+    set_node_output_tensor(node, 0, tensor, TENSOR_TYPE_CONST);
+    set_nchw(tensor);
+    set_tensor_shape(tensor, dims.data(), dims.size());
+    set_tensor_buffer(tensor, const_data.back().data(), size * sizeof(float));
+
+    release_graph_node(node);
+
+    return tensor;
+}
+
+static node_t add_node(graph_t graph, const char* node_name, const char* op_name, const std::vector<tensor_t>& inputs)
+{
+    node_t node = create_graph_node(graph, node_name, op_name);
+    tensor_t output = create_graph_tensor(graph, node_name, TENGINE_DT_FP32);
+
+    for(unsigned int i = 0; i < inputs.size(); i++)
+        set_node_input_tensor(node, i, inputs[i]);
+
+    set_node_output_tensor(node, 0, output, TENSOR_TYPE_VAR);
+    set_nchw(output);
+
+    return node;
+}
+
+static tensor_t add_conv(graph_t graph, const char* node_name, tensor_t input, int input_c, int output_c, int kernel,
+                         int group)
+{
+    std::string name(node_name);
+    tensor_t weight = add_const(graph, name + "_w", {output_c, input_c / group, kernel, kernel});
+    tensor_t bias = add_const(graph, name + "_b", {output_c});
+    node_t node = add_node(graph, node_name, "Convolution", {input, weight, bias});
+
+    int pad = kernel / 2;
+    int stride = 1;
+    int activation = 0;
+
+    set_node_attr_int(node, "kernel_h", &kernel);
+    set_node_attr_int(node, "kernel_w", &kernel);
+    set_node_attr_int(node, "stride_h", &stride);
+    set_node_attr_int(node, "stride_w", &stride);
+    set_node_attr_int(node, "pad_h", &pad);
+    set_node_attr_int(node, "pad_w", &pad);
+    set_node_attr_int(node, "output_channel", &output_c);
+    set_node_attr_int(node, "group", &group);
+    set_node_attr_int(node, "activation", &activation);
+
+    tensor_t output = get_node_output_tensor(node, 0);
+
+    release_graph_node(node);
+
+    return output;
+}
+
+static graph_t create_test_graph(void)
+{
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+
+    if(graph == nullptr)
+        return nullptr;
+
+    node_t input_node = create_graph_node(graph, "input", "InputOp");
+    tensor_t input = create_graph_tensor(graph, "input", TENGINE_DT_FP32);
+    int dims[] = {1, 8, 32, 32};
+
+    set_node_output_tensor(input_node, 0, input, TENSOR_TYPE_INPUT);
+    set_nchw(input);
+    set_tensor_shape(input, dims, 4);
+
+    tensor_t tensor = add_conv(graph, "conv1", input, 8, 16, 3, 1);
+    tensor = add_conv(graph, "conv2", tensor, 16, 32, 1, 1);
+    tensor = add_conv(graph, "conv3", tensor, 32, 32, 3, 32);
+    tensor = add_conv(graph, "conv4", tensor, 32, 32, 5, 32);
+
+    node_t pool = add_node(graph, "pool", "Pooling", {tensor});
+    int pool_size = 2;
+
+    set_node_attr_int(pool, "kernel_h", &pool_size);
+    set_node_attr_int(pool, "kernel_w", &pool_size);
+    set_node_attr_int(pool, "stride_h", &pool_size);
+    set_node_attr_int(pool, "stride_w", &pool_size);
+
+    tensor = add_conv(graph, "conv5", get_node_output_tensor(pool, 0), 32, 16, 3, 1);
+    tensor = add_conv(graph, "conv6", tensor, 16, 16, 3, 1);
+
+    node_t lrn = add_node(graph, "lrn", "LRN", {tensor});
+
+    tensor = add_conv(graph, "conv7", get_node_output_tensor(lrn, 0), 16, 8, 1, 1);
+
+    node_t softmax = add_node(graph, "softmax", "Softmax", {tensor});
+    int axis = 1;
+
+    set_node_attr_int(softmax, "axis", &axis);
+
+    const char* input_nodes[] = {"input"};
+    const char* output_nodes[] = {"softmax"};
+
+    set_graph_input_node(graph, input_nodes, 1);
+    set_graph_output_node(graph, output_nodes, 1);
+
+    return graph;
+}
+
+static bool run_test_graph(bool parallel_prerun, std::vector<float>& outputs)
+{
+    graph_t graph = create_test_graph();
+
+    if(graph == nullptr)
+        return false;
+
+    int parallel = parallel_prerun;
+    int parallel_set = -1;
+
+    /* an attr the executor does not know would be dropped silently */
+    if(set_graph_attr(graph, "parallel_prerun", &parallel, sizeof(int)) < 0 ||
+       get_graph_attr(graph, "parallel_prerun", &parallel_set, sizeof(int)) < 0 || parallel_set != parallel)
+    {
+        std::printf("cannot set parallel_prerun\n");
+        destroy_graph(graph);
+        return false;
+    }
+
+    std::vector<float> input_data(8 * 32 * 32);
+
+    for(unsigned int i = 0; i < input_data.size(); i++)
+        input_data[i] = (i % 255) / 255.f - 0.5f;
+
+    tensor_t input_tensor = get_graph_input_tensor(graph, 0, 0);
+
+    set_tensor_buffer(input_tensor, input_data.data(), input_data.size() * sizeof(float));
+    release_graph_tensor(input_tensor);
+
+    if(prerun_graph(graph) < 0 || run_graph(graph, 1) < 0)
+    {
+        destroy_graph(graph);
+        return false;
+    }
+
+    tensor_t output_tensor = get_graph_output_tensor(graph, 0, 0);
+    const float* data = ( const float* )get_tensor_buffer(output_tensor);
+    int size = get_tensor_buffer_size(output_tensor) / sizeof(float);
+
+    outputs.assign(data, data + size);
+
+    release_graph_tensor(output_tensor);
+    postrun_graph(graph);
+    destroy_graph(graph);
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    char* cpu_list_str = nullptr;
+    int repeat_count = 20;
+    int res;
+
+    while((res = getopt(argc, argv, "p:r:")) != -1)
+    {
+        switch(res)
+        {
+            case 'p':
+                cpu_list_str = optarg;
+                break;
+            case 'r':
+                repeat_count = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(cpu_list_str)
+        TEngine::set_cpu_list(cpu_list_str);
+
+    init_tengine();
+
+    std::vector<float> base;
+    bool pass = run_test_graph(false, base);
+
+    for(int i = 0; i < repeat_count && pass; i++)
+    {
+        std::vector<float> outputs;
+
+        if(!run_test_graph(true, outputs))
+        {
+            std::printf("run %d with parallel prerun failed\n", i);
+            pass = false;
+        }
+        else if(outputs.size() != base.size() || memcmp(outputs.data(), base.data(), base.size() * sizeof(float)))
+        {
+            std::printf("run %d with parallel prerun: the outputs differ\n", i);
+            pass = false;
+        }
+    }
+
+    release_tengine();
+
+    if(!pass)
+    {
+        std::printf("FAIL\n");
+        return -1;
+    }
+
+    std::printf("PASS: %d runs, %d outputs\n", repeat_count, ( int )base.size());
+
+    return 0;
+}
@@ -46,6 +46,7 @@ const float channel_mean[3] = {104.007, 116.669, 122.679};
 using namespace TEngine;
 
 int repeat_count = 10;
+int use_counter = 0;
 void LoadLabelFile(std::vector<std::string>& result, const char* fname)
 {
     std::ifstream labels(fname);
@@ -113,17 +114,59 @@ void dump_perf_stat(struct perf_info** info_array, int number)
     printf("\n================================\n");
 }
 
+void dump_perf_counter(struct perf_counter_info** info_array, int number)
+{
+    printf("\n================================\n");
+
+    for(int i = 0; i < number; i++)
+    {
+        struct perf_counter_info* info = info_array[i];
+        uint64_t* counter = info->counter;
+        uint32_t mask = info->valid_mask;
+        int count = info->count ? info->count : 1;
+
+        printf("node: %-40s\ttime: %.2f", info->name, info->total_time * 1.0 / count);
+
+        /* the cpu time of all threads, against the wall time */
+        if(mask & (1 << PERF_COUNTER_TASK_CLOCK))
+            printf("  cpu: %.2f", counter[PERF_COUNTER_TASK_CLOCK] / 1000.0 / count);
+
+        if(mask & (1 << PERF_COUNTER_CYCLES))
+            printf("  Mcycles: %.2f", counter[PERF_COUNTER_CYCLES] / 1e6 / count);
+
+        if((mask & (1 << PERF_COUNTER_CYCLES)) && (mask & (1 << PERF_COUNTER_INSTRUCTIONS)) &&
+           counter[PERF_COUNTER_CYCLES])
+            printf("  IPC: %.2f", counter[PERF_COUNTER_INSTRUCTIONS] * 1.0 / counter[PERF_COUNTER_CYCLES]);
+
+        if((mask & (1 << PERF_COUNTER_CACHE_REFERENCES)) && (mask & (1 << PERF_COUNTER_CACHE_MISSES)) &&
+           counter[PERF_COUNTER_CACHE_REFERENCES])
+            printf("  miss: %.1f%%",
+                   100.0 * counter[PERF_COUNTER_CACHE_MISSES] / counter[PERF_COUNTER_CACHE_REFERENCES]);
+
+        if((mask & (1 << PERF_COUNTER_CYCLES)) && (mask & (1 << PERF_COUNTER_STALLED_CYCLES)) &&
+           counter[PERF_COUNTER_CYCLES])
+            printf("  stall: %.1f%%", 100.0 * counter[PERF_COUNTER_STALLED_CYCLES] / counter[PERF_COUNTER_CYCLES]);
+
+        printf("\n");
+    }
+
+    printf("\n================================\n");
+}
+
 int main(int argc, char* argv[])
 {
     int res;
 
-    while((res = getopt(argc, argv, "d:r:")) != -1)
+    while((res = getopt(argc, argv, "d:r:c")) != -1)
     {
         switch(res)
         {
             case 'r':
                 repeat_count = strtoul(optarg, NULL, 10);
                 break;
+            case 'c':
+                use_counter = 1;
+                break;
             default:
                 break;
         }
@@ -212,7 +255,7 @@ int main(int argc, char* argv[])
     // warm up
     run_graph(graph, 1);
 
-    if(do_graph_perf_stat(graph, GRAPH_PERF_STAT_ENABLE) < 0)
+    if(do_graph_perf_stat(graph, use_counter ? GRAPH_PERF_STAT_ENABLE_COUNTER : GRAPH_PERF_STAT_ENABLE) < 0)
     {
         std::cerr << "PERF STAT ENABLE: " << get_tengine_errno() << "\n";
     }
@@ -256,6 +299,22 @@ int main(int argc, char* argv[])
 
     free(info);
 
+    if(use_counter)
+    {
+        struct perf_counter_info** counter_info;
+
+        counter_info = ( struct perf_counter_info** )malloc(info_size * sizeof(void*));
+
+        ret_number = get_graph_perf_counter(graph, counter_info, info_size);
+
+        if(ret_number > 0)
+            dump_perf_counter(counter_info, ret_number);
+        else
+            std::cerr << "PERF COUNTER GET: " << get_tengine_errno() << "\n";
+
+        free(counter_info);
+    }
+
     tensor_t output_tensor = get_graph_output_tensor(graph, 0, 0);
     float* data = ( float* )get_tensor_buffer(output_tensor);
     PrintTopLabels(label_file, data);
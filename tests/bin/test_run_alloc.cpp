@@ -0,0 +1,238 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * License); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * AS IS BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Copyright (c) 2018, Open AI Lab
+ * Author: haitao@openailab.com
+ */
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <vector>
+
+#include "tengine_c_api.h"
+#include "tensor.hpp"
+
+/*
+ * count the heap allocations done by run_graph() after warm up, on a
+ * relu -> lrn -> pool -> softmax graph built with the C API: none is
+ * expected. operators take their temporary memory from the scratch arena,
+ * and the graph dispatching reuses its task lists and queue entries.
+ *
+ * known exception: the worker thread task queues are std::deque, which
+ * take a new block every 512 bytes of tasks: one master task of 8 bytes
+ * per run, so one allocation in 64 runs. the default 10 runs do not reach
+ * it, for longer ones -e sets the allocations expected in all the runs.
+ *
+ *   test_run_alloc [-r repeat_count] [-e expected_alloc]
+ */
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static std::atomic<long> alloc_count(0);
+static std::atomic<bool> count_enabled(false);
+
+extern "C" void* malloc(size_t size) noexcept
+{
+    if(count_enabled)
+        alloc_count++;
+
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) noexcept
+{
+    if(count_enabled)
+        alloc_count++;
+
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept
+{
+    if(count_enabled)
+        alloc_count++;
+
+    return __libc_realloc(ptr, size);
+}
+
+/* the C API sets no layout on the tensors it creates */
+static void set_nchw(tensor_t tensor)
+{
+    reinterpret_cast<TEngine::Tensor*>(tensor)->GetShape().SetDataLayout("NCHW");
+}
+
+/* a node of op_name named node_name, reading input, writing a new tensor of its name */
+static node_t add_node(graph_t graph, const char* node_name, const char* op_name, tensor_t input)
+{
+    node_t node = create_graph_node(graph, node_name, op_name);
+    tensor_t output = create_graph_tensor(graph, node_name, TENGINE_DT_FP32);
+
+    set_node_input_tensor(node, 0, input);
+    set_node_output_tensor(node, 0, output, TENSOR_TYPE_VAR);
+    set_nchw(output);
+
+    release_graph_tensor(output);
+
+    return node;
+}
+
+static graph_t create_test_graph(int c, int h, int w)
+{
+    graph_t graph = create_graph(nullptr, nullptr, nullptr);
+
+    if(graph == nullptr)
+        return nullptr;
+
+    node_t input_node = create_graph_node(graph, "input", "InputOp");
+    tensor_t input_tensor = create_graph_tensor(graph, "input", TENGINE_DT_FP32);
+    int dims[] = {1, c, h, w};
+
+    set_node_output_tensor(input_node, 0, input_tensor, TENSOR_TYPE_INPUT);
+    set_nchw(input_tensor);
+    set_tensor_shape(input_tensor, dims, 4);
+
+    node_t relu = add_node(graph, "relu", "ReLu", input_tensor);
+    tensor_t relu_output = get_node_output_tensor(relu, 0);
+    node_t lrn = add_node(graph, "lrn", "LRN", relu_output);
+    tensor_t lrn_output = get_node_output_tensor(lrn, 0);
+    node_t pool = add_node(graph, "pool", "Pooling", lrn_output);
+    tensor_t pool_output = get_node_output_tensor(pool, 0);
+    node_t softmax = add_node(graph, "softmax", "Softmax", pool_output);
+
+    int pool_size = 2;
+    int axis = 1;
+
+    set_node_attr_int(pool, "kernel_h", &pool_size);
+    set_node_attr_int(pool, "kernel_w", &pool_size);
+    set_node_attr_int(pool, "stride_h", &pool_size);
+    set_node_attr_int(pool, "stride_w", &pool_size);
+    set_node_attr_int(softmax, "axis", &axis);
+
+    const char* input_nodes[] = {"input"};
+    const char* output_nodes[] = {"softmax"};
+
+    set_graph_input_node(graph, input_nodes, 1);
+    set_graph_output_node(graph, output_nodes, 1);
+
+    release_graph_tensor(input_tensor);
+    release_graph_tensor(relu_output);
+    release_graph_tensor(lrn_output);
+    release_graph_tensor(pool_output);
+    release_graph_node(input_node);
+    release_graph_node(relu);
+    release_graph_node(lrn);
+    release_graph_node(pool);
+    release_graph_node(softmax);
+
+    return graph;
+}
+
+int main(int argc, char* argv[])
+{
+    int repeat_count = 10;
+    int expected_alloc = 0;
+    int res;
+
+    while((res = getopt(argc, argv, "r:e:")) != -1)
+    {
+        switch(res)
+        {
+            case 'r':
+                repeat_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                expected_alloc = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(repeat_count <= 0)
+        repeat_count = 1;
+
+    int c = 8;
+    int h = 32;
+    int w = 32;
+
+    std::vector<float> input_data(c * h * w);
+
+    for(int i = 0; i < c * h * w; i++)
+        input_data[i] = (i % 255) / 255.f - 0.5f;
+
+    init_tengine();
+
+    graph_t graph = create_test_graph(c, h, w);
+
+    if(graph == nullptr)
+    {
+        std::printf("Create graph failed, errno: %d\n", get_tengine_errno());
+        return -1;
+    }
+
+    tensor_t input_tensor = get_graph_input_tensor(graph, 0, 0);
+
+    if(set_tensor_buffer(input_tensor, input_data.data(), input_data.size() * sizeof(float)) < 0)
+    {
+        std::printf("Set buffer for tensor failed\n");
+        return -1;
+    }
+
+    if(prerun_graph(graph) < 0)
+    {
+        std::printf("prerun failed\n");
+        return -1;
+    }
+
+    // warm up
+    run_graph(graph, 1);
+
+    alloc_count = 0;
+    count_enabled = true;
+
+    for(int i = 0; i < repeat_count; i++)
+        run_graph(graph, 1);
+
+    count_enabled = false;
+
+    long total = alloc_count.load();
+
+    std::printf("heap allocations: %ld in %d runs (expected: %d)\n", total, repeat_count, expected_alloc);
+
+    release_graph_tensor(input_tensor);
+    postrun_graph(graph);
+    destroy_graph(graph);
+
+    release_tengine();
+
+    if(total != expected_alloc)
+    {
+        std::printf("FAIL: %ld heap allocations, %d expected\n", total, expected_alloc);
+        return -1;
+    }
+
+    std::printf("PASS\n");
+
+    return 0;
+}